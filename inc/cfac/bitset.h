@@ -0,0 +1,150 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_BITSET_H
+#define CFAC_BITSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// A fixed-size (but resizable) set of bits, stored in 64-bit words. The words are kept in blocks
+// of 256 bits, aligned to 32 bytes, so that bulk operations and counting can process a whole block
+// at a time (with AVX2 if the CPU has it). Bits beyond the size are always clear.
+
+// ===========
+// == types ==
+
+typedef struct {
+  DAR_DArray words;    // uint64_t, always a whole number of blocks
+  size_t     num_bits; // size of set in bits
+} BIT_Set;
+
+#define BIT_BITS_PER_WORD 64
+
+// ==============================
+// == creation and destruction ==
+
+// Creates a set of num_bits bits, all clear.
+STAT_Val BIT_create(BIT_Set * this, size_t num_bits);
+STAT_Val BIT_create_from(BIT_Set * this, const BIT_Set * src);
+STAT_Val BIT_destroy(BIT_Set * this);
+
+// ==================
+// == modification ==
+
+// Bits that are added are clear.
+STAT_Val BIT_resize(BIT_Set * this, size_t num_bits);
+
+static inline void BIT_set(BIT_Set * this, size_t idx);
+static inline void BIT_clear(BIT_Set * this, size_t idx);
+static inline void BIT_assign(BIT_Set * this, size_t idx, bool value);
+
+void BIT_set_all(BIT_Set * this);
+void BIT_clear_all(BIT_Set * this);
+
+// Sets all bits in [first, last).
+STAT_Val BIT_set_range(BIT_Set * this, size_t first, size_t last);
+
+// Bulk operations, storing the result in this. Both sets must be of the same size.
+STAT_Val BIT_and(BIT_Set * this, const BIT_Set * other);
+STAT_Val BIT_or(BIT_Set * this, const BIT_Set * other);
+STAT_Val BIT_xor(BIT_Set * this, const BIT_Set * other);
+STAT_Val BIT_andnot(BIT_Set * this, const BIT_Set * other); // this & ~other
+
+// =============
+// == queries ==
+
+static inline bool   BIT_is_initialized(const BIT_Set * this);
+static inline size_t BIT_get_size(const BIT_Set * this);
+static inline bool   BIT_test(const BIT_Set * this, size_t idx);
+
+// Number of set bits.
+size_t BIT_count(const BIT_Set * this);
+
+// Number of set bits before idx (so BIT_rank(set, BIT_get_size(set)) == BIT_count(set)).
+size_t BIT_rank(const BIT_Set * this, size_t idx);
+
+// Outputs the index of the n-th set bit (counting from 0), i.e. the idx for which
+// BIT_rank(set, idx) == n and BIT_test(set, idx). Returns STAT_OK_NOT_FOUND if there are no more
+// than n bits set.
+STAT_Val BIT_select(const BIT_Set * this, size_t n, size_t * o_idx);
+
+// Outputs the index of the first set bit at or after from. Returns STAT_OK_NOT_FOUND if there is
+// none. To go over all set bits:
+//   size_t idx = 0;
+//   while(BIT_find_next_set(set, idx, &idx) == STAT_OK) {
+//     ...
+//     idx++;
+//   }
+STAT_Val BIT_find_next_set(const BIT_Set * this, size_t from, size_t * o_idx);
+
+// ==================
+// == span interop ==
+
+// Span of the uint64_t words holding the bits, bit i being (words[i / 64] >> (i % 64)) & 1.
+SPN_Span BIT_to_word_span(const BIT_Set * this);
+
+// The instruction sets that bulk operations, counting, rank and select can use. The widest one the
+// CPU supports is picked when the library is loaded; lowering the maximum is meant for tests, and
+// is not thread-safe. Outputs the level in use, which is never above what the CPU supports.
+typedef enum {
+  BIT_INT_SIMD_NONE,
+  BIT_INT_SIMD_POPCNT,
+  BIT_INT_SIMD_AVX2, // with BMI2 and POPCNT
+} BIT_INT_SimdLevel;
+
+BIT_INT_SimdLevel BIT_INT_set_max_simd_level(BIT_INT_SimdLevel max_level);
+BIT_INT_SimdLevel BIT_INT_get_simd_level(void);
+
+// =====================================
+// == inline function implementations ==
+
+static inline void BIT_set(BIT_Set * this, size_t idx) {
+  ((uint64_t *)this->words.data)[idx / BIT_BITS_PER_WORD] |= (1ull << (idx % BIT_BITS_PER_WORD));
+}
+
+static inline void BIT_clear(BIT_Set * this, size_t idx) {
+  ((uint64_t *)this->words.data)[idx / BIT_BITS_PER_WORD] &= ~(1ull << (idx % BIT_BITS_PER_WORD));
+}
+
+static inline void BIT_assign(BIT_Set * this, size_t idx, bool value) {
+  uint64_t *     word = &((uint64_t *)this->words.data)[idx / BIT_BITS_PER_WORD];
+  const uint64_t mask = (1ull << (idx % BIT_BITS_PER_WORD));
+  *word               = (*word & ~mask) | (value ? mask : 0);
+}
+
+static inline bool BIT_is_initialized(const BIT_Set * this) {
+  return (this != NULL) && DAR_is_initialized(&this->words);
+}
+
+static inline size_t BIT_get_size(const BIT_Set * this) {
+  return (this == NULL) ? 0 : this->num_bits;
+}
+
+static inline bool BIT_test(const BIT_Set * this, size_t idx) {
+  const uint64_t word = ((const uint64_t *)this->words.data)[idx / BIT_BITS_PER_WORD];
+  return ((word >> (idx % BIT_BITS_PER_WORD)) & 1) != 0;
+}
+
+#endif
@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_BTREE_H
+#define CFAC_BTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "span.h"
+#include "span_sort.h"
+#include "stat.h"
+
+// An ordered map as a B+tree. Keys and values are of a fixed size (set at creation) and are
+// stored inline in the nodes, which are allocated at a fixed size and aligned to cache lines, so
+// that a search touches one small contiguous block per level. All entries are in the leaves, which
+// are linked in key order for iteration and range scans.
+// Keys are ordered by cmp, or, if that is NULL, as byte strings (memcmp of the whole key), which
+// suits e.g. fixed-width strings and big-endian integers.
+// Any modification of the map invalidates all iterators and value pointers into it.
+
+// ===========
+// == types ==
+
+#define BT_DEFAULT_NODE_SIZE 512 // bytes, a few cache lines
+
+typedef struct BT_INT_Node BT_INT_Node;
+
+typedef struct {
+  BT_INT_Node * root;
+  BT_INT_Node * first_leaf;
+  SPN_CompareFn cmp;               // NULL for memcmp
+  size_t        key_size;          //
+  size_t        value_size;        //
+  size_t        node_size;         // in bytes
+  size_t        leaf_capacity;     // max number of entries in a leaf
+  size_t        internal_capacity; // max number of keys in an internal node
+  size_t        size;              // number of entries
+  size_t        height;            // number of levels, 1 when root is a leaf
+  BT_INT_Node * spare_nodes;       // allocated ahead, so that splitting can't fail halfway
+  size_t        num_spare_nodes;   //
+  uint8_t *     scratch;           // room for an overfull node's contents while splitting
+} BT_Map;
+
+typedef struct {
+  const BT_INT_Node * leaf; // NULL at end
+  size_t              idx;
+  size_t              key_size;
+  size_t              value_offset;
+  size_t              value_size;
+} BT_Iterator;
+
+// Return false to stop the scan.
+typedef bool (*BT_VisitFn)(const void * key, const void * value, void * ctx);
+
+// ==============================
+// == creation and destruction ==
+
+STAT_Val BT_create(BT_Map * this, size_t key_size, size_t value_size, SPN_CompareFn cmp);
+
+// node_size is in bytes, rounded up to a multiple of the cache line size. It must fit at least
+// four entries.
+STAT_Val BT_create_with_node_size(BT_Map *      this,
+                                  size_t        key_size,
+                                  size_t        value_size,
+                                  SPN_CompareFn cmp,
+                                  size_t        node_size);
+
+STAT_Val BT_destroy(BT_Map * this);
+
+// ==================
+// == modification ==
+
+// Inserts key with value, or replaces the value if key is already in the map.
+STAT_Val BT_set(BT_Map * this, const void * key, const void * value);
+
+// Returns STAT_OK_NOT_FOUND if key is not in the map.
+STAT_Val BT_remove(BT_Map * this, const void * key);
+
+STAT_Val BT_clear(BT_Map * this);
+
+// Fills an empty map with the (strictly ascending) keys and their values at once, in O(n),
+// with all nodes (nearly) full.
+STAT_Val BT_load_sorted(BT_Map * this, SPN_Span keys, SPN_Span values);
+
+// =============
+// == queries ==
+
+static inline bool   BT_is_initialized(const BT_Map * this);
+static inline bool   BT_is_empty(const BT_Map * this);
+static inline size_t BT_get_size(const BT_Map * this);
+
+bool BT_contains(const BT_Map * this, const void * key);
+
+//  [const] void * BT_get([const] BT_Map * this, const void * key)
+// Returns the value of key, or NULL if key is not in the map.
+#define BT_get(this, key)                                                                          \
+  _Generic((this), const BT_Map *: BT_INT_get_const, BT_Map *: BT_INT_get_nonconst)(this, key)
+void *       BT_INT_get_nonconst(BT_Map * this, const void * key);
+const void * BT_INT_get_const(const BT_Map * this, const void * key);
+
+// ===============
+// == iteration ==
+
+// e.g.
+//   for(BT_Iterator it = BT_begin(map); !BT_is_end(it); BT_next(&it)) {
+//     const int * key = BT_get_key(it);
+//     ...
+//   }
+BT_Iterator BT_begin(const BT_Map * this);
+BT_Iterator BT_lower_bound(const BT_Map * this, const void * key); // first key >= key
+BT_Iterator BT_upper_bound(const BT_Map * this, const void * key); // first key > key
+
+static inline bool         BT_is_end(BT_Iterator it);
+void                       BT_next(BT_Iterator * it);
+static inline const void * BT_get_key(BT_Iterator it);
+static inline const void * BT_get_value(BT_Iterator it);
+
+// Visits all entries with first <= key < last in order. Returns STAT_OK_FINISHED if fn stopped
+// the scan.
+STAT_Val BT_scan_range(const BT_Map * this,
+                       const void *   first,
+                       const void *   last,
+                       BT_VisitFn     fn,
+                       void *         ctx);
+
+// =====================================
+// == inline function implementations ==
+
+struct BT_INT_Node {
+  uint32_t      num_keys;
+  uint32_t      is_leaf;
+  BT_INT_Node * next; // next leaf in key order, NULL for the last leaf and internal nodes
+  _Alignas(max_align_t) uint8_t data[]; // keys, then values (leaf) or children (internal)
+};
+
+static inline bool BT_is_initialized(const BT_Map * this) {
+  return (this != NULL) && (this->root != NULL);
+}
+
+static inline bool BT_is_empty(const BT_Map * this) { return (this == NULL) || (this->size == 0); }
+
+static inline size_t BT_get_size(const BT_Map * this) { return (this == NULL) ? 0 : this->size; }
+
+static inline bool BT_is_end(BT_Iterator it) { return (it.leaf == NULL); }
+
+static inline const void * BT_get_key(BT_Iterator it) {
+  return &it.leaf->data[it.idx * it.key_size];
+}
+
+static inline const void * BT_get_value(BT_Iterator it) {
+  return &it.leaf->data[it.value_offset + (it.idx * it.value_size)];
+}
+
+#endif
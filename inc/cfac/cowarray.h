@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_COWARRAY_H
+#define CFAC_COWARRAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "darray.h"
+#include "refcount.h"
+#include "span.h"
+#include "stat.h"
+
+// A copy-on-write array shares its storage (a DAR_DArray in a ref-counted block) between copies,
+// so copying is just a ref count increment. The storage is only copied when a shared array is
+// about to be modified, i.e. on COW_get_mut.
+// NOTE like RC_Ref, this is not thread-safe; copies may not be used from different threads.
+
+typedef struct {
+  RC_Ref ref; // block holds a DAR_DArray
+} COW_Array;
+
+STAT_Val COW_create(COW_Array * this, size_t element_size);
+STAT_Val COW_create_from_span(COW_Array * this, SPN_Span span);
+
+// Makes this share src's storage, in O(1). If this is an array already, its storage is released
+// first, so this must be zero-initialized or an array.
+STAT_Val COW_copy(COW_Array * this, const COW_Array * src);
+
+STAT_Val COW_destroy(COW_Array * this);
+
+// Read-only view of the array, valid until this is modified or destroyed.
+const DAR_DArray * COW_get(const COW_Array * this);
+
+// Gives access to an array that is not shared (copying it first if it is), that can be modified
+// through any DAR_ function. The array is only guaranteed to be unshared until the next
+// COW_copy from this.
+STAT_Val COW_get_mut(COW_Array * this, DAR_DArray ** o_arr);
+
+static inline bool     COW_is_initialized(const COW_Array * this);
+static inline bool     COW_is_shared(const COW_Array * this);
+static inline size_t   COW_get_size(const COW_Array * this);
+static inline SPN_Span COW_to_span(const COW_Array * this);
+
+static inline bool COW_is_initialized(const COW_Array * this) {
+  return (this != NULL) && (this->ref.block != NULL);
+}
+
+static inline bool COW_is_shared(const COW_Array * this) {
+  return COW_is_initialized(this) && (RC_get_ref_count(this->ref) > 1);
+}
+
+static inline size_t COW_get_size(const COW_Array * this) {
+  return COW_is_initialized(this) ? COW_get(this)->size : 0;
+}
+
+static inline SPN_Span COW_to_span(const COW_Array * this) {
+  return COW_is_initialized(this) ? DAR_to_span(COW_get(this)) : (SPN_Span){0};
+}
+
+#endif
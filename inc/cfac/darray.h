@@ -31,20 +31,47 @@
 // ===========
 // == types ==
 
+typedef struct DAR_INT_Mapping DAR_INT_Mapping;
+
 typedef struct {
   void * data;
   size_t element_size; // size of each element in bytes
   size_t size;         // size of array in elements
   size_t capacity;     // capacity in elements
+  size_t alignment;    // alignment of data in bytes, 0 for that of malloc
+
+  DAR_INT_Mapping * mapping; // backing file if the array is mapped, NULL otherwise
 } DAR_DArray;
 
+// flags for DAR_open_mapped
+enum {
+  DAR_MAP_READ_ONLY  = 0,
+  DAR_MAP_READ_WRITE = (1 << 0),
+  DAR_MAP_CREATE     = (1 << 1), // create the file if it doesn't exist, needs DAR_MAP_READ_WRITE
+};
+
 // ==============================
 // == creation and destruction ==
 
 STAT_Val DAR_create(DAR_DArray * this, size_t element_size);
+// Data of an aligned array stays aligned across growth and shrinking, and its allocation is padded
+// to a multiple of the alignment, so e.g. 64 keeps it on cache lines of its own. alignment must be
+// a power of two.
+STAT_Val DAR_create_aligned(DAR_DArray * this, size_t element_size, size_t alignment);
 STAT_Val DAR_create_from(DAR_DArray * this, const DAR_DArray * src);
 STAT_Val DAR_create_from_cstr(DAR_DArray * this, const char * str);
 
+// Opens a file of raw elements as an array, without copying it. The array is backed by a shared
+// mapping of the file, so changes made to a writable array end up in the file, and the file grows
+// along with the array. Read-only arrays can't be modified in any way: all functions that would
+// modify them return STAT_ERR_USAGE. Destroying the array unmaps it and trims the file to the
+// array's size.
+STAT_Val DAR_open_mapped(DAR_DArray * this, const char * path, size_t element_size, int flags);
+
+// Checkpoints a writable mapped array: trims the file to the array's size and flushes the mapping
+// to it, so the file holds the array's exact contents. The file is extended again on growth.
+STAT_Val DAR_sync_mapped(DAR_DArray * this);
+
 STAT_Val DAR_destroy(DAR_DArray * this);
 
 // ==================
@@ -74,6 +101,22 @@ STAT_Val DAR_push_back_darray(DAR_DArray * this, const DAR_DArray * other);
 STAT_Val DAR_delete(DAR_DArray * this, size_t idx);
 STAT_Val DAR_order_preserving_delete(DAR_DArray * this, size_t idx);
 
+// Range operations; first/last denote the half-open range [first, last). Each of these moves the
+// tail of the array at most once and reallocates at most once. The span may point into this array.
+STAT_Val DAR_insert_span(DAR_DArray * this, size_t idx, SPN_Span span);
+STAT_Val DAR_erase_range(DAR_DArray * this, size_t first, size_t last);
+STAT_Val DAR_replace_range(DAR_DArray * this, size_t first, size_t last, SPN_Span span);
+
+// Removes all elements for which pred returns true, in a single order-preserving pass.
+STAT_Val DAR_remove_if(DAR_DArray * this, SPN_PredicateFn pred, void * ctx);
+// Appends all elements of src for which pred returns true to dst, preserving their order.
+STAT_Val DAR_filter_into(DAR_DArray * dst, SPN_Span src, SPN_PredicateFn pred, void * ctx);
+
+// Typed variants of DAR_remove_if for common predicates, vectorized where possible.
+STAT_Val DAR_remove_equal(DAR_DArray * this, const void * value);
+STAT_Val DAR_remove_less_i32(DAR_DArray * this, int32_t threshold);
+STAT_Val DAR_remove_less_i64(DAR_DArray * this, int64_t threshold);
+
 // =============
 // == queries ==
 
@@ -81,10 +124,12 @@ bool DAR_equals(const DAR_DArray * lhs, const DAR_DArray * rhs);
 
 size_t DAR_get_capacity(const DAR_DArray * this);
 size_t DAR_get_size_in_bytes(const DAR_DArray * this);
+size_t DAR_get_alignment(const DAR_DArray * this);
 
 static inline size_t DAR_get_byte_idx(const DAR_DArray * this, size_t element_idx);
 static inline bool   DAR_is_initialized(const DAR_DArray * this);
 static inline bool   DAR_is_empty(const DAR_DArray * this);
+static inline bool   DAR_is_mapped(const DAR_DArray * this);
 
 // ==================
 // == span interop ==
@@ -145,6 +190,10 @@ static inline bool DAR_is_empty(const DAR_DArray * this) {
   return (this == NULL || (this->size == 0));
 }
 
+static inline bool DAR_is_mapped(const DAR_DArray * this) {
+  return (this != NULL) && (this->mapping != NULL);
+}
+
 static inline void * DAR_INT_get_nonconst(DAR_DArray * this, size_t idx) {
   return &(((uint8_t *)this->data)[DAR_get_byte_idx(this, idx)]);
 }
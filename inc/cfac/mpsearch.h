@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_MPSEARCH_H
+#define CFAC_MPSEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// Multi-pattern search: a set of byte patterns is compiled into a matcher once, which then finds
+// occurrences of all of them in a single pass over a haystack. Small sets are found with a
+// vectorized filter on the first and last byte of each pattern, large sets with an Aho-Corasick
+// automaton. The automaton is a DFA over byte classes (all bytes that occur in no pattern share a
+// class), so each haystack byte costs one table lookup.
+//
+// Matches are ordered by where they end; at the same end, longer patterns come first, and equal
+// patterns in order of their index. Overlapping matches are all reported.
+
+#define MPS_FILTER_MAX_PATTERNS 8 // sets up to this size use the filter rather than the automaton
+
+typedef struct {
+  size_t pattern_idx;
+  size_t begin; // match is [begin, end) in the haystack
+  size_t end;
+} MPS_Match;
+
+typedef struct {
+  DAR_DArray pattern_bytes;  // uint8_t, all patterns back to back
+  DAR_DArray patterns;       // MPS_INT_Pattern
+  bool       use_automaton;  //
+  size_t     num_classes;    //
+  uint8_t    byte_classes[UINT8_MAX + 1];
+  DAR_DArray transitions;    // uint32_t, num_classes per state
+  DAR_DArray states;         // MPS_INT_State
+  DAR_DArray next_duplicate; // uint32_t per pattern, the next pattern with the same bytes
+} MPS_Matcher;
+
+typedef struct {
+  size_t offset; // in pattern_bytes
+  size_t len;
+} MPS_INT_Pattern;
+
+typedef struct {
+  uint32_t pattern;     // first pattern that ends in this state, or none
+  uint32_t fail;        // state of the longest proper suffix that is in the trie
+  uint32_t output_link; // next state along fail links in which a pattern ends, 0 if none
+} MPS_INT_State;
+
+// patterns is a span of SPN_Span, each a non-empty span of bytes. The patterns are copied.
+STAT_Val MPS_create(MPS_Matcher * this, SPN_Span patterns);
+STAT_Val MPS_destroy(MPS_Matcher * this);
+
+// Outputs the match that ends first, or returns STAT_OK_NOT_FOUND.
+STAT_Val MPS_find_first(const MPS_Matcher * this, SPN_Span haystack, MPS_Match * o_match);
+
+// Appends all matches (as MPS_Match) to o_matches. On failure o_matches is left as it was.
+STAT_Val MPS_find_all(const MPS_Matcher * this, SPN_Span haystack, DAR_DArray * o_matches);
+
+static inline size_t MPS_get_num_patterns(const MPS_Matcher * this);
+
+// =====================================
+// == inline function implementations ==
+
+static inline size_t MPS_get_num_patterns(const MPS_Matcher * this) {
+  return (this == NULL) ? 0 : this->patterns.size;
+}
+
+#endif
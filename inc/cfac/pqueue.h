@@ -0,0 +1,128 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_PQUEUE_H
+#define CFAC_PQUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "span_sort.h"
+#include "stat.h"
+
+// A priority queue as a d-ary min-heap: the top is the element that compares lowest by cmp. With
+// more children per node the tree is shallower, and the children of a node are adjacent in memory,
+// so a 4-ary heap does fewer cache misses per operation than a binary one.
+// Every element gets a handle when pushed, which stays valid (and refers to the same element)
+// until that element is popped or removed. Handles are used to update or remove elements that
+// aren't at the top, e.g. to reschedule or cancel timers.
+
+// ===========
+// == types ==
+
+#define PQ_DEFAULT_ARITY 4
+
+typedef size_t PQ_Handle;
+
+typedef struct {
+  DAR_DArray    elements;     // heap ordered
+  DAR_DArray    handles;      // PQ_Handle of the element at each position
+  DAR_DArray    positions;    // size_t, position of the element of each handle
+  DAR_DArray    free_handles; // PQ_Handle, not in use and available to reuse
+  SPN_CompareFn cmp;          //
+  size_t        arity;        // number of children per node
+  void *        tmp;          // scratch space for a single element
+} PQ_Heap;
+
+// Keeps the k greatest (by cmp) elements of all that are pushed into it.
+typedef struct {
+  PQ_Heap heap; // min-heap, with the least of the k greatest at the top
+  size_t  k;
+} PQ_TopK;
+
+// ==============================
+// == creation and destruction ==
+
+// Pass 0 for arity to get PQ_DEFAULT_ARITY.
+STAT_Val PQ_create(PQ_Heap * this, size_t element_size, size_t arity, SPN_CompareFn cmp);
+
+// Creates a heap of the elements in span in O(n). The handle of each element is its index in span.
+STAT_Val PQ_create_from_span(PQ_Heap * this, SPN_Span span, size_t arity, SPN_CompareFn cmp);
+
+STAT_Val PQ_destroy(PQ_Heap * this);
+
+// ==================
+// == modification ==
+
+STAT_Val PQ_push(PQ_Heap * this, const void * element, PQ_Handle * o_handle); // o_handle optional
+STAT_Val PQ_pop(PQ_Heap * this, void * o_element);                          // o_element optional
+
+// Replaces the top with element, keeping the handle of the top. Cheaper than a pop and a push.
+STAT_Val PQ_replace_top(PQ_Heap * this, const void * element);
+
+// Replaces the element of handle with element, e.g. to decrease its key, and restores the order.
+STAT_Val PQ_update(PQ_Heap * this, PQ_Handle handle, const void * element);
+STAT_Val PQ_remove(PQ_Heap * this, PQ_Handle handle, void * o_element); // o_element optional
+
+STAT_Val PQ_clear(PQ_Heap * this);
+
+// =============
+// == queries ==
+
+static inline bool   PQ_is_initialized(const PQ_Heap * this);
+static inline bool   PQ_is_empty(const PQ_Heap * this);
+static inline size_t PQ_get_size(const PQ_Heap * this);
+
+bool PQ_is_valid_handle(const PQ_Heap * this, PQ_Handle handle);
+
+const void * PQ_peek(const PQ_Heap * this);                   // NULL if empty
+PQ_Handle    PQ_peek_handle(const PQ_Heap * this);            // handle of top, heap can't be empty
+const void * PQ_get(const PQ_Heap * this, PQ_Handle handle); // NULL if handle not valid
+
+// ===========
+// == top k ==
+
+STAT_Val PQ_top_k_create(PQ_TopK * this, size_t element_size, size_t k, SPN_CompareFn cmp);
+STAT_Val PQ_top_k_destroy(PQ_TopK * this);
+
+STAT_Val PQ_top_k_push(PQ_TopK * this, const void * element);
+STAT_Val PQ_top_k_push_span(PQ_TopK * this, SPN_Span span);
+
+// Appends the (up to) k greatest elements to o_sorted in ascending order, so the greatest is last.
+STAT_Val PQ_top_k_to_darray(const PQ_TopK * this, DAR_DArray * o_sorted);
+
+// =====================================
+// == inline function implementations ==
+
+static inline bool PQ_is_initialized(const PQ_Heap * this) {
+  return (this != NULL) && DAR_is_initialized(&this->elements);
+}
+
+static inline bool PQ_is_empty(const PQ_Heap * this) {
+  return (this == NULL) || DAR_is_empty(&this->elements);
+}
+
+static inline size_t PQ_get_size(const PQ_Heap * this) {
+  return (this == NULL) ? 0 : this->elements.size;
+}
+
+#endif
@@ -0,0 +1,131 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_ROARING_H
+#define CFAC_ROARING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitset.h"
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// A compressed set of uint32_t values, in the style of roaring bitmaps. Values are grouped by their
+// upper 16 bits into containers, each holding the lower 16 bits of its values in whichever form is
+// cheapest for its contents:
+//  - a sorted array of uint16_t, for up to RBM_ARRAY_MAX_CARDINALITY values;
+//  - a bitset of 65536 bits, for more values than that;
+//  - a sorted array of runs, only produced by RBM_run_optimize, for values that are mostly
+//    consecutive. Modifying a run container turns it back into one of the other forms.
+
+// ===========
+// == types ==
+
+#define RBM_ARRAY_MAX_CARDINALITY 4096 // beyond this, a bitset (8kB) is smaller
+#define RBM_CONTAINER_NUM_VALUES  65536
+
+typedef enum {
+  RBM_CONTAINER_ARRAY,
+  RBM_CONTAINER_BITSET,
+  RBM_CONTAINER_RUN,
+} RBM_ContainerType;
+
+typedef struct {
+  uint16_t start;
+  uint16_t length; // number of values in run minus one, so a run can cover a whole container
+} RBM_Run;
+
+typedef struct {
+  uint16_t          key;         // upper 16 bits of all values in container
+  RBM_ContainerType type;        //
+  uint32_t          cardinality; // number of values in container, never 0
+  union {
+    DAR_DArray array; // RBM_CONTAINER_ARRAY: uint16_t, sorted
+    BIT_Set    bits;  // RBM_CONTAINER_BITSET
+    DAR_DArray runs;  // RBM_CONTAINER_RUN: RBM_Run, sorted and not touching
+  };
+} RBM_Container;
+
+typedef struct {
+  DAR_DArray containers; // RBM_Container, sorted by key
+} RBM_Bitmap;
+
+// ==============================
+// == creation and destruction ==
+
+STAT_Val RBM_create(RBM_Bitmap * this);
+STAT_Val RBM_create_from(RBM_Bitmap * this, const RBM_Bitmap * src);
+STAT_Val RBM_destroy(RBM_Bitmap * this);
+
+// ==================
+// == modification ==
+
+STAT_Val RBM_add(RBM_Bitmap * this, uint32_t value);
+STAT_Val RBM_remove(RBM_Bitmap * this, uint32_t value); // STAT_OK_NOT_FOUND if not in bitmap
+STAT_Val RBM_clear(RBM_Bitmap * this);
+
+// Stores the union/intersection of this and other in this.
+STAT_Val RBM_or(RBM_Bitmap * this, const RBM_Bitmap * other);
+STAT_Val RBM_and(RBM_Bitmap * this, const RBM_Bitmap * other);
+
+// Converts containers to runs where that takes less memory.
+STAT_Val RBM_run_optimize(RBM_Bitmap * this);
+
+// =============
+// == queries ==
+
+static inline bool   RBM_is_initialized(const RBM_Bitmap * this);
+static inline bool   RBM_is_empty(const RBM_Bitmap * this);
+static inline size_t RBM_get_num_containers(const RBM_Bitmap * this);
+
+bool     RBM_contains(const RBM_Bitmap * this, uint32_t value);
+uint64_t RBM_get_cardinality(const RBM_Bitmap * this);
+
+// Appends all values, in ascending order, to o_values (which holds uint32_t).
+STAT_Val RBM_to_darray(const RBM_Bitmap * this, DAR_DArray * o_values);
+
+// ===================
+// == serialization ==
+
+// The serialized form holds the containers as they are, in native byte order. It is meant for
+// storing and passing bitmaps between processes on the same kind of machine, and is not
+// compatible with other roaring implementations.
+size_t   RBM_get_serialized_size(const RBM_Bitmap * this);
+STAT_Val RBM_serialize(const RBM_Bitmap * this, SPN_MutSpan out); // out must fit serialized size
+STAT_Val RBM_deserialize(RBM_Bitmap * this, SPN_Span bytes);     // creates this, checks contents
+
+// =====================================
+// == inline function implementations ==
+
+static inline bool RBM_is_initialized(const RBM_Bitmap * this) {
+  return (this != NULL) && DAR_is_initialized(&this->containers);
+}
+
+static inline bool RBM_is_empty(const RBM_Bitmap * this) {
+  return (this == NULL) || DAR_is_empty(&this->containers);
+}
+
+static inline size_t RBM_get_num_containers(const RBM_Bitmap * this) {
+  return (this == NULL) ? 0 : this->containers.size;
+}
+
+#endif
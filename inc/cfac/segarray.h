@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SEGARRAY_H
+#define CFAC_SEGARRAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// A segmented array stores its elements in fixed-size chunks, which are allocated as the array
+// grows and never moved. Pointers to elements therefore remain valid for as long as the element
+// is in the array, and growing never copies existing elements. Chunks hold a power-of-two number
+// of elements, so that indexing is a shift and a mask.
+
+// ===========
+// == types ==
+
+typedef struct {
+  DAR_DArray chunks;          // pointers to chunks (uint8_t *), in order
+  size_t     element_size;    // size of each element in bytes
+  size_t     size;            // size of array in elements
+  size_t     chunk_size_log2; // each chunk holds (1 << chunk_size_log2) elements
+} SEG_Array;
+
+// ==============================
+// == creation and destruction ==
+
+// min_chunk_size is the minimum number of elements per chunk, it is rounded up to a power of two.
+// Pass 0 to get chunks of about a page.
+STAT_Val SEG_create(SEG_Array * this, size_t element_size, size_t min_chunk_size);
+STAT_Val SEG_destroy(SEG_Array * this);
+
+// ==================
+// == modification ==
+
+STAT_Val SEG_push_back(SEG_Array * this, const void * element);
+STAT_Val SEG_push_back_span(SEG_Array * this, SPN_Span span);
+STAT_Val SEG_pop_back(SEG_Array * this);
+
+STAT_Val SEG_resize_zeroed(SEG_Array * this, size_t new_size);
+STAT_Val SEG_reserve(SEG_Array * this, size_t num_elements);
+
+STAT_Val SEG_clear(SEG_Array * this);
+STAT_Val SEG_shrink_to_fit(SEG_Array * this);
+
+// =============
+// == queries ==
+
+static inline bool   SEG_is_initialized(const SEG_Array * this);
+static inline bool   SEG_is_empty(const SEG_Array * this);
+static inline size_t SEG_get_chunk_size(const SEG_Array * this);
+static inline size_t SEG_get_capacity(const SEG_Array * this);
+static inline size_t SEG_get_num_chunks_in_use(const SEG_Array * this);
+
+// ===============
+// == accessors ==
+
+//  [const] void * SEG_get([const] SEG_Array * this, size_t idx)
+#define SEG_get(this, idx)                                                                         \
+  _Generic((this),                                                                                 \
+      const SEG_Array *: SEG_INT_get_const,                                                        \
+      SEG_Array *: SEG_INT_get_nonconst)(this, idx)
+static inline void *       SEG_INT_get_nonconst(SEG_Array * this, size_t idx);
+static inline const void * SEG_INT_get_const(const SEG_Array * this, size_t idx);
+
+//  STAT_Val SEG_get_checked([const] SEG_Array *this, size_t idx, [const] void ** out)
+#define SEG_get_checked(this, idx, out)                                                            \
+  _Generic((this),                                                                                 \
+      const SEG_Array *: SEG_INT_get_checked_const,                                                \
+      SEG_Array *: SEG_INT_get_checked_nonconst)(this, idx, out)
+STAT_Val SEG_INT_get_checked_nonconst(SEG_Array * this, size_t idx, void ** out);
+STAT_Val SEG_INT_get_checked_const(const SEG_Array * this, size_t idx, const void ** out);
+
+// ==================
+// == span interop ==
+
+// Chunk-wise access to the elements, e.g. for vectorized scans:
+//   for(size_t c = 0; c < SEG_get_num_chunks_in_use(arr); c++) {
+//     const SPN_Span chunk = SEG_get_chunk_span(arr, c);
+//     ...
+//   }
+// All chunk spans are full, except possibly the last one.
+SPN_Span    SEG_get_chunk_span(const SEG_Array * this, size_t chunk_idx);
+SPN_MutSpan SEG_get_chunk_mut_span(SEG_Array * this, size_t chunk_idx);
+
+// =====================================
+// == inline function implementations ==
+
+static inline bool SEG_is_initialized(const SEG_Array * this) {
+  return (this != NULL) && DAR_is_initialized(&this->chunks);
+}
+
+static inline bool SEG_is_empty(const SEG_Array * this) {
+  return (this == NULL || (this->size == 0));
+}
+
+static inline size_t SEG_get_chunk_size(const SEG_Array * this) {
+  return ((size_t)1 << this->chunk_size_log2);
+}
+
+static inline size_t SEG_get_capacity(const SEG_Array * this) {
+  if(this == NULL) return 0;
+  return (this->chunks.size << this->chunk_size_log2);
+}
+
+static inline size_t SEG_get_num_chunks_in_use(const SEG_Array * this) {
+  if(this == NULL) return 0;
+  return ((this->size + (SEG_get_chunk_size(this) - 1)) >> this->chunk_size_log2);
+}
+
+static inline void * SEG_INT_get_nonconst(SEG_Array * this, size_t idx) {
+  uint8_t * chunk = ((uint8_t **)this->chunks.data)[idx >> this->chunk_size_log2];
+  return &chunk[(idx & (SEG_get_chunk_size(this) - 1)) * this->element_size];
+}
+static inline const void * SEG_INT_get_const(const SEG_Array * this, size_t idx) {
+  const uint8_t * chunk = ((uint8_t * const *)this->chunks.data)[idx >> this->chunk_size_log2];
+  return &chunk[(idx & (SEG_get_chunk_size(this) - 1)) * this->element_size];
+}
+
+#endif
@@ -0,0 +1,151 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SLOTMAP_H
+#define CFAC_SLOTMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// A slot map stores elements contiguously (for fast iteration) and hands out handles that keep
+// referring to the same element, however other elements are inserted and removed. A handle holds
+// the index of a slot, which points at the element, and the generation of that slot at the time
+// of insertion. Removing an element bumps the generation of its slot, so old handles to that slot
+// no longer match and are safely rejected, even once the slot is reused.
+// Removal moves the last element into the hole, so the order of elements is not preserved.
+
+// ===========
+// == types ==
+
+typedef uint64_t SLM_Handle; // slot index in the low 32 bits, generation in the high 32 bits
+
+#define SLM_NULL_HANDLE ((SLM_Handle)0) // never valid
+
+typedef struct {
+  uint32_t generation; // odd while in use, so a fresh slot (0) is free
+  uint32_t index;      // in use: index of element, free: next free slot
+} SLM_INT_Slot;
+
+typedef struct {
+  DAR_DArray values;    // elements, dense
+  DAR_DArray slot_idxs; // uint32_t, slot of each element
+  DAR_DArray slots;     // SLM_INT_Slot
+  uint32_t   free_head; // first free slot, SLM_INT_NO_SLOT if none
+} SLM_SlotMap;
+
+#define SLM_INT_NO_SLOT UINT32_MAX
+
+// ==============================
+// == creation and destruction ==
+
+STAT_Val SLM_create(SLM_SlotMap * this, size_t element_size);
+STAT_Val SLM_destroy(SLM_SlotMap * this);
+
+// ==================
+// == modification ==
+
+STAT_Val SLM_insert(SLM_SlotMap * this, const void * element, SLM_Handle * o_handle);
+
+// Returns STAT_OK_NOT_FOUND if handle does not refer to an element (anymore).
+STAT_Val SLM_remove(SLM_SlotMap * this, SLM_Handle handle);
+
+STAT_Val SLM_reserve(SLM_SlotMap * this, size_t num_elements);
+STAT_Val SLM_clear(SLM_SlotMap * this); // invalidates all handles
+
+// =============
+// == queries ==
+
+static inline bool   SLM_is_initialized(const SLM_SlotMap * this);
+static inline bool   SLM_is_empty(const SLM_SlotMap * this);
+static inline size_t SLM_get_size(const SLM_SlotMap * this);
+static inline bool   SLM_contains(const SLM_SlotMap * this, SLM_Handle handle);
+
+// ===============
+// == accessors ==
+
+//  [const] void * SLM_get([const] SLM_SlotMap * this, SLM_Handle handle)
+// Returns NULL if handle does not refer to an element. The pointer is valid until the next insert
+// or remove.
+#define SLM_get(this, handle)                                                                      \
+  _Generic((this),                                                                                 \
+      const SLM_SlotMap *: SLM_INT_get_const,                                                      \
+      SLM_SlotMap *: SLM_INT_get_nonconst)(this, handle)
+static inline void *       SLM_INT_get_nonconst(SLM_SlotMap * this, SLM_Handle handle);
+static inline const void * SLM_INT_get_const(const SLM_SlotMap * this, SLM_Handle handle);
+
+// Handle of the element at idx in the dense storage (as in SLM_to_span).
+SLM_Handle SLM_get_handle_at(const SLM_SlotMap * this, size_t idx);
+
+// ==================
+// == span interop ==
+
+// All elements, in no particular order.
+SPN_Span    SLM_to_span(const SLM_SlotMap * this);
+SPN_MutSpan SLM_to_mut_span(SLM_SlotMap * this);
+
+// =====================================
+// == inline function implementations ==
+
+static inline bool SLM_is_initialized(const SLM_SlotMap * this) {
+  return (this != NULL) && DAR_is_initialized(&this->values);
+}
+
+static inline bool SLM_is_empty(const SLM_SlotMap * this) {
+  return (this == NULL) || DAR_is_empty(&this->values);
+}
+
+static inline size_t SLM_get_size(const SLM_SlotMap * this) {
+  return (this == NULL) ? 0 : this->values.size;
+}
+
+static inline uint32_t SLM_INT_get_slot_idx(SLM_Handle handle) { return (uint32_t)handle; }
+static inline uint32_t SLM_INT_get_generation(SLM_Handle handle) {
+  return (uint32_t)(handle >> 32);
+}
+
+static inline const SLM_INT_Slot * SLM_INT_find_slot(const SLM_SlotMap * this, SLM_Handle handle) {
+  const uint32_t slot_idx = SLM_INT_get_slot_idx(handle);
+  if(this == NULL || slot_idx >= this->slots.size) return NULL;
+
+  const SLM_INT_Slot * slot = &((const SLM_INT_Slot *)this->slots.data)[slot_idx];
+  return (slot->generation == SLM_INT_get_generation(handle) && (slot->generation & 1) != 0)
+             ? slot
+             : NULL;
+}
+
+static inline bool SLM_contains(const SLM_SlotMap * this, SLM_Handle handle) {
+  return SLM_INT_find_slot(this, handle) != NULL;
+}
+
+static inline void * SLM_INT_get_nonconst(SLM_SlotMap * this, SLM_Handle handle) {
+  const SLM_INT_Slot * slot = SLM_INT_find_slot(this, handle);
+  return (slot == NULL) ? NULL : DAR_get(&this->values, slot->index);
+}
+
+static inline const void * SLM_INT_get_const(const SLM_SlotMap * this, SLM_Handle handle) {
+  const SLM_INT_Slot * slot = SLM_INT_find_slot(this, handle);
+  return (slot == NULL) ? NULL : DAR_get(&this->values, slot->index);
+}
+
+#endif
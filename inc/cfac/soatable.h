@@ -0,0 +1,108 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SOATABLE_H
+#define CFAC_SOATABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// A structure-of-arrays table stores each field of a record (row) in an array of its own (column),
+// so loops that only touch a few fields read only those, contiguously. Rows go in and out as
+// structs, the layout of which is described by a column per field.
+
+// ===========
+// == types ==
+
+typedef struct {
+  size_t offset; // offset of the field within a row struct, in bytes
+  size_t size;   // size of the field, in bytes
+} SOA_Column;
+
+typedef struct {
+  DAR_DArray columns; // DAR_DArray per column, holding the values for that field
+  DAR_DArray layout;  // SOA_Column per column
+  size_t     row_size;
+  size_t     num_rows;
+} SOA_Table;
+
+//  initializer for the SOA_Column of a field, e.g. SOA_Column cols[] = {SOA_COLUMN(type, field)}
+#define SOA_COLUMN(type, field)                                                                    \
+  { .offset = offsetof(type, field), .size = sizeof(((type *)0)->field) }
+
+// ==============================
+// == creation and destruction ==
+
+// row_size is the size of the struct that rows are passed as, columns need not cover all of it.
+STAT_Val SOA_create(SOA_Table *        this,
+                    const SOA_Column * columns,
+                    size_t             num_columns,
+                    size_t             row_size);
+STAT_Val SOA_destroy(SOA_Table * this);
+
+// ==================
+// == modification ==
+
+STAT_Val SOA_push_row(SOA_Table * this, const void * row);
+STAT_Val SOA_push_rows(SOA_Table * this, SPN_Span rows);
+
+STAT_Val SOA_reserve(SOA_Table * this, size_t num_rows);
+STAT_Val SOA_clear(SOA_Table * this);
+
+// =============
+// == queries ==
+
+// Gathers the fields of a row into o_row, bytes not covered by any column are zeroed.
+STAT_Val SOA_get_row(const SOA_Table * this, size_t row_idx, void * o_row);
+
+static inline size_t SOA_get_num_rows(const SOA_Table * this);
+static inline size_t SOA_get_num_columns(const SOA_Table * this);
+
+// ==================
+// == span interop ==
+
+// Column data is 64-byte aligned, to suit vectorized scans.
+SPN_Span    SOA_get_column(const SOA_Table * this, size_t column_idx);
+SPN_MutSpan SOA_get_mut_column(SOA_Table * this, size_t column_idx);
+
+// ================================
+// == array-of-structs conversion ==
+
+STAT_Val SOA_create_from_aos(SOA_Table *        this,
+                             const SOA_Column * columns,
+                             size_t             num_columns,
+                             SPN_Span           rows);
+STAT_Val SOA_to_aos(const SOA_Table * this, DAR_DArray * o_rows);
+
+// =====================================
+// == inline function implementations ==
+
+static inline size_t SOA_get_num_rows(const SOA_Table * this) {
+  return (this == NULL) ? 0 : this->num_rows;
+}
+
+static inline size_t SOA_get_num_columns(const SOA_Table * this) {
+  return (this == NULL) ? 0 : this->layout.size;
+}
+
+#endif
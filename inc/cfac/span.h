@@ -38,6 +38,15 @@ typedef struct {
   size_t element_size; // size of an element in bytes
 } SPN_MutSpan;
 
+typedef bool (*SPN_PredicateFn)(const void * element, void * ctx);
+
+// A set of byte values, for scanning spans of bytes. Besides a bit per byte value, it keeps a
+// lookup table by nibble, with which a whole vector of bytes is classified at once.
+typedef struct {
+  uint64_t bits[4];
+  uint8_t  nibble_table[2][16]; // per low nibble, a bit per high nibble (0-7, 8-15) in the set
+} SPN_ByteSet;
+
 SPN_Span    SPN_from_cstr(const char * cstr);
 SPN_MutSpan SPN_mut_span_from_cstr(char * cstr);
 
@@ -45,6 +54,11 @@ SPN_Span SPN_subspan(SPN_Span src, size_t begin_idx, size_t len);
 
 bool SPN_equals(SPN_Span lhs, SPN_Span rhs);
 
+// Compares the bytes of lhs and rhs as memcmp does, with a span that is a prefix of the other
+// ordering first. Returns a negative value, zero, or a positive value if lhs is less than, equal
+// to, or greater than rhs.
+int SPN_compare(SPN_Span lhs, SPN_Span rhs);
+
 bool SPN_contains_subspan(SPN_Span span, SPN_Span subspan);
 
 // NOTE find functions use memcmp, if your type has a sparse memory layout (e.g. structs), this may
@@ -64,6 +78,20 @@ STAT_Val SPN_find_subspan_reverse_at(SPN_Span span,
                                      size_t   at_idx,
                                      size_t * o_idx);
 
+// Outputs the number of elements equal to element.
+STAT_Val SPN_count(SPN_Span span, const void * element, size_t * o_count);
+
+// Byte sets can only be used with spans of bytes (element size 1).
+STAT_Val           SPN_byte_set_create(SPN_ByteSet * this, SPN_Span bytes);
+void               SPN_byte_set_add(SPN_ByteSet * this, uint8_t byte);
+static inline bool SPN_byte_set_contains(const SPN_ByteSet * this, uint8_t byte);
+
+// Output the index of the first/last byte that is (not) in set, or return STAT_OK_NOT_FOUND.
+STAT_Val SPN_find_any_of(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx);
+STAT_Val SPN_find_any_of_reverse(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx);
+STAT_Val SPN_find_first_not_of(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx);
+STAT_Val SPN_find_last_not_of(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx);
+
 void     SPN_swap(SPN_MutSpan span, size_t idx_a, size_t idx_b);
 STAT_Val SPN_swap_checked(SPN_MutSpan span, size_t idx_a, size_t idx_b);
 
@@ -106,4 +134,32 @@ inline static bool SPN_is_empty(SPN_Span sp) {
   return ((sp.begin == NULL) || (SPN_get_size_in_bytes(sp) == 0));
 }
 
+// The alignment of the span's data in bytes, i.e. the largest power of two its address is a
+// multiple of (0 for a NULL span).
+inline static size_t SPN_get_alignment(SPN_Span sp) {
+  const uintptr_t address = (uintptr_t)sp.begin;
+  return (size_t)(address & (~address + 1));
+}
+
+inline static bool SPN_is_aligned(SPN_Span sp, size_t alignment) {
+  return ((alignment != 0) && (((uintptr_t)sp.begin % alignment) == 0));
+}
+
+static inline bool SPN_byte_set_contains(const SPN_ByteSet * this, uint8_t byte) {
+  return (this->bits[byte / 64] & (UINT64_C(1) << (byte % 64))) != 0;
+}
+
+// The instruction sets that searching and counting can use. The widest one the CPU supports is
+// picked when the library is loaded; lowering the maximum is meant for tests, and is not
+// thread-safe. Outputs the level in use, which is never above what the CPU supports.
+typedef enum {
+  SPN_INT_SIMD_NONE,
+  SPN_INT_SIMD_SSE2,
+  SPN_INT_SIMD_SSSE3,
+  SPN_INT_SIMD_AVX2,
+} SPN_INT_SimdLevel;
+
+SPN_INT_SimdLevel SPN_INT_set_max_simd_level(SPN_INT_SimdLevel max_level);
+SPN_INT_SimdLevel SPN_INT_get_simd_level(void);
+
 #endif
@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_NUM_H
+#define CFAC_SPAN_NUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// Parsing numbers straight out of spans of chars, e.g. CSV fields, and formatting them onto the
+// end of char arrays, without NUL-terminated copies.
+//
+// Parsing reads a number at the start of chars and stops at the first char that can't extend it,
+// reporting how many chars it used through o_num_consumed (which may be NULL). Leading whitespace
+// is not skipped. Unsigned integers are plain digits, signed ones and floats may have a leading
+// + or -. Returns STAT_ERR_PARSE if chars doesn't start with a number, and STAT_ERR_RANGE
+// if an integer doesn't fit; neither is logged, as bad input is expected here. Floats that are
+// too large or small parse to infinity or zero, as with strtod.
+
+STAT_Val SPN_parse_u64(SPN_Span chars, uint64_t * o_value, size_t * o_num_consumed);
+STAT_Val SPN_parse_i64(SPN_Span chars, int64_t * o_value, size_t * o_num_consumed);
+
+// Accepts [+-]digits[.digits][(e|E)[+-]digits] with digits before or after the point, and
+// "inf", "infinity" and "nan" in any case. The result is correctly rounded.
+STAT_Val SPN_parse_f64(SPN_Span chars, double * o_value, size_t * o_num_consumed);
+
+// Appends the number to out, an array of chars. Floats are written with the fewest significant
+// digits that parse back to the same value (the closest such decimal if there are several), in %g
+// style, or as inf, -inf or nan. The digits are found directly (Schubfach), without printf.
+STAT_Val SPN_format_u64(DAR_DArray * out, uint64_t value);
+STAT_Val SPN_format_i64(DAR_DArray * out, int64_t value);
+STAT_Val SPN_format_f64(DAR_DArray * out, double value);
+
+#endif
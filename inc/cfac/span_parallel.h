@@ -0,0 +1,113 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_PARALLEL_H
+#define CFAC_SPAN_PARALLEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "darray.h"
+#include "span.h"
+#include "span_sort.h"
+#include "stat.h"
+#include "threadpool.h"
+
+// NOTE These split the span into chunks of grain_size elements, which are then handed out to the
+// threads of the pool. Spans shorter than serial_threshold are processed on the calling thread
+// without involving the pool at all. Zero-initialized options give sensible defaults and use the
+// shared pool.
+typedef struct {
+  TP_Pool * pool;             // NULL to use TP_get_shared_pool()
+  size_t    grain_size;       // elements per task, 0 for default
+  size_t    serial_threshold; // span length below which we don't parallelize, 0 for default
+} SPN_ParallelOptions;
+
+typedef void (*SPN_ForEachFn)(void * element, void * ctx);
+typedef void (*SPN_TransformFn)(const void * in, void * out, void * ctx);
+
+// folds element into acc
+typedef void (*SPN_ReduceFn)(void * acc, const void * element, void * ctx);
+// folds other_acc into acc, other_acc always holds the results for elements after those in acc
+typedef void (*SPN_CombineFn)(void * acc, const void * other_acc, void * ctx);
+
+STAT_Val SPN_parallel_for_each(SPN_MutSpan         span,
+                               SPN_ForEachFn       fn,
+                               void *              ctx,
+                               SPN_ParallelOptions opts);
+
+// out must be at least as long as in, and must not overlap it unless out.begin == in.begin
+STAT_Val SPN_parallel_transform(SPN_Span            in,
+                                SPN_MutSpan         out,
+                                SPN_TransformFn     fn,
+                                void *              ctx,
+                                SPN_ParallelOptions opts);
+
+// io_acc holds the identity value of the reduction on input (it is used as starting value for every
+// chunk), and the result on output. acc_size is the size of the accumulator in bytes.
+STAT_Val SPN_parallel_reduce(SPN_Span            span,
+                             void *              io_acc,
+                             size_t              acc_size,
+                             SPN_ReduceFn        reduce,
+                             SPN_CombineFn       combine,
+                             void *              ctx,
+                             SPN_ParallelOptions opts);
+
+STAT_Val SPN_parallel_count_if(SPN_Span            span,
+                               SPN_PredicateFn     pred,
+                               void *              ctx,
+                               size_t *            o_count,
+                               SPN_ParallelOptions opts);
+
+// finds the first (lowest index) element for which pred holds, returns STAT_OK_NOT_FOUND if none
+STAT_Val SPN_parallel_find_if(SPN_Span            span,
+                              SPN_PredicateFn     pred,
+                              void *              ctx,
+                              size_t *            o_idx,
+                              SPN_ParallelOptions opts);
+
+// Outputs the number of elements equal to element, as SPN_count.
+STAT_Val SPN_parallel_count(SPN_Span            span,
+                            const void *        element,
+                            size_t *            o_count,
+                            SPN_ParallelOptions opts);
+
+// Searches for a (non-empty) subspan with SPN_find_subspan. Chunks overlap by subspan.len - 1
+// elements, so that matches across chunk boundaries are found, and each chunk only reports the
+// matches that start in it, so none are found twice. The first and last variants output the index
+// of the first/last match, or return STAT_OK_NOT_FOUND. The all variant appends the indices of
+// all matches (including overlapping ones) to o_indices, an array of size_t, in ascending order.
+// On failure o_indices is left as it was.
+STAT_Val SPN_parallel_find_subspan(SPN_Span            span,
+                                   SPN_Span            subspan,
+                                   size_t *            o_idx,
+                                   SPN_ParallelOptions opts);
+STAT_Val SPN_parallel_find_subspan_reverse(SPN_Span            span,
+                                           SPN_Span            subspan,
+                                           size_t *            o_idx,
+                                           SPN_ParallelOptions opts);
+STAT_Val SPN_parallel_find_all_subspans(SPN_Span            span,
+                                        SPN_Span            subspan,
+                                        DAR_DArray *        o_indices,
+                                        SPN_ParallelOptions opts);
+
+// sorts chunks with SPN_sort in parallel and merges them in parallel rounds, not stable
+STAT_Val SPN_parallel_sort(SPN_MutSpan span, SPN_CompareFn cmp, SPN_ParallelOptions opts);
+
+#endif
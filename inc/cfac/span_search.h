@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_SEARCH_H
+#define CFAC_SPAN_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "span.h"
+#include "stat.h"
+
+// A needle prepared for repeated searches, using the two-way algorithm (Crochemore-Perrin) with a
+// bad-character shift on the last byte. Searching is O(n + m) in the worst case and usually
+// skips most of the haystack for longer needles. The searcher refers to the needle's memory, which
+// must outlive it, and it holds no resources, so it needs no destruction.
+//
+// Spans with elements larger than a byte are searched bytewise, only accepting matches at element
+// boundaries.
+
+typedef struct {
+  SPN_Span needle;
+  size_t   suffix;      // start of the right half of the critical factorization
+  size_t   period;      // period of the needle, if is_periodic
+  bool     is_periodic; // whether the left half repeats in the right half
+  size_t   shift_table[UINT8_MAX + 1];
+} SPN_Searcher;
+
+STAT_Val SPN_searcher_create(SPN_Searcher * this, SPN_Span needle);
+
+// Output the index of the first occurrence of the needle in haystack (at or after at_idx), or
+// return STAT_OK_NOT_FOUND. An empty needle is found at at_idx.
+STAT_Val SPN_searcher_find(const SPN_Searcher * this, SPN_Span haystack, size_t * o_idx);
+STAT_Val SPN_searcher_find_at(const SPN_Searcher * this,
+                              SPN_Span             haystack,
+                              size_t               at_idx,
+                              size_t *             o_idx);
+
+#endif
@@ -0,0 +1,218 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_SORT_H
+#define CFAC_SPAN_SORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "span.h"
+#include "stat.h"
+
+// NOTE compare functions follow the qsort convention: negative if lhs < rhs, zero if equal, and
+// positive if lhs > rhs.
+typedef int (*SPN_CompareFn)(const void * lhs, const void * rhs);
+
+// Compare functions for spans whose elements are themselves SPN_Span or SPN_KeyedSpan, ordering
+// them with SPN_compare.
+int SPN_compare_spans(const void * lhs, const void * rhs);
+int SPN_compare_keyed_spans(const void * lhs, const void * rhs);
+
+// Sorting string keys spends most of its time comparing their first few bytes, which for SPN_Span
+// means chasing a pointer per comparison. A keyed span keeps the first 8 bytes next to the span,
+// as a big endian integer padded with zeros, so comparing keys is mostly comparing integers. Only
+// keys with equal prefixes need a full SPN_compare.
+typedef struct {
+  uint64_t prefix;
+  SPN_Span span;
+} SPN_KeyedSpan;
+
+SPN_KeyedSpan SPN_to_keyed_span(SPN_Span span);
+
+// pattern-defeating quicksort; not stable, O(n log n) worst case, O(n) on (reverse) sorted input
+STAT_Val SPN_sort(SPN_MutSpan span, SPN_CompareFn cmp);
+
+// bottom-up merge sort; stable, allocates a scratch buffer the size of the span
+STAT_Val SPN_stable_sort(SPN_MutSpan span, SPN_CompareFn cmp);
+
+bool SPN_is_sorted(SPN_Span span, SPN_CompareFn cmp);
+
+// LSD radix sorts, these require the span element size to match the key type. They allocate a
+// scratch buffer the size of the span. Floats are ordered by IEEE 754 total order, i.e. -0.0 sorts
+// before +0.0 and NaNs sort to the ends depending on their sign bit.
+STAT_Val SPN_radix_sort_u32(SPN_MutSpan span);
+STAT_Val SPN_radix_sort_u64(SPN_MutSpan span);
+STAT_Val SPN_radix_sort_i32(SPN_MutSpan span);
+STAT_Val SPN_radix_sort_i64(SPN_MutSpan span);
+STAT_Val SPN_radix_sort_f32(SPN_MutSpan span);
+STAT_Val SPN_radix_sort_f64(SPN_MutSpan span);
+
+// Operations on sorted spans. Spans are expected to be sorted according to cmp; results are
+// unspecified otherwise. As with SPN_find, o_idx may be NULL for the searches below.
+
+// Bounds output the index of the first element that is not less than (lower bound), or greater
+// than (upper bound), key; span.len if there is none. These are branchless and prefetch both
+// possible next midpoints, so they are limited by memory latency rather than branch misses.
+STAT_Val SPN_lower_bound(SPN_Span span, const void * key, SPN_CompareFn cmp, size_t * o_idx);
+STAT_Val SPN_upper_bound(SPN_Span span, const void * key, SPN_CompareFn cmp, size_t * o_idx);
+
+// Returns STAT_OK and outputs the index of the first element equal to key if there is one,
+// STAT_OK_NOT_FOUND otherwise.
+STAT_Val SPN_binary_search(SPN_Span span, const void * key, SPN_CompareFn cmp, size_t * o_idx);
+
+// For large arrays (well beyond cache size), searches are faster on the Eytzinger layout, which
+// stores the implicit search tree in breadth-first order. Lookups then touch the top levels of the
+// tree over and over (which stay cached), and the descendants of a node are adjacent in memory.
+// SPN_to_eytzinger writes the layout of a sorted span to out (which must have the same length).
+// SPN_eytzinger_lower_bound outputs the index *in the eytzinger span* of the lower bound of key,
+// or span.len if there is none.
+STAT_Val SPN_to_eytzinger(SPN_Span sorted, SPN_MutSpan out);
+STAT_Val SPN_eytzinger_lower_bound(SPN_Span      eytzinger,
+                                   const void *  key,
+                                   SPN_CompareFn cmp,
+                                   size_t *      o_idx);
+
+// Merges two sorted spans into out, which must fit both and may not overlap either. Stable: of
+// equal elements, those from lhs go first.
+STAT_Val SPN_merge(SPN_Span lhs, SPN_Span rhs, SPN_MutSpan out, SPN_CompareFn cmp);
+
+// Writes the elements that are in both lhs and rhs to out (which must fit the smaller of the two,
+// and may not overlap either) and outputs how many there are. Elements are copied from lhs;
+// duplicates are matched up as in a multiset. Iterates over the smaller span and gallops
+// (exponential, then binary search) through the larger, so for very different sizes it takes
+// O(small * log(large)) rather than O(large).
+STAT_Val SPN_set_intersection(SPN_Span      lhs,
+                              SPN_Span      rhs,
+                              SPN_MutSpan   out,
+                              SPN_CompareFn cmp,
+                              size_t *      o_len);
+
+// SPN_DEFINE_SORT(name, type, is_less) defines
+//    static inline STAT_Val name(SPN_MutSpan span)
+// which sorts a span of 'type' using an introsort where 'is_less(a, b)' is expanded in place, with
+// a and b being values of 'type'. is_less may be a function-like macro or an (inline) function. As
+// the comparison is visible to the compiler, this avoids the indirect call per comparison that
+// SPN_sort and qsort have to pay.
+// e.g.
+//    #define INT_LESS(a, b) ((a) < (b))
+//    SPN_DEFINE_SORT(sort_ints, int, INT_LESS)
+#define SPN_INT_SORT_INSERTION_THRESHOLD 16
+
+#define SPN_DEFINE_SORT(name, type, is_less)                                                       \
+  static inline void name##_INT_swap(type * a, type * b) {                                         \
+    const type tmp = *a;                                                                           \
+    *a             = *b;                                                                           \
+    *b             = tmp;                                                                          \
+  }                                                                                                \
+                                                                                                   \
+  static inline void name##_INT_insertion_sort(type * begin, type * end) {                         \
+    for(type * it = begin + 1; it < end; it++) {                                                   \
+      const type tmp  = *it;                                                                       \
+      type *     hole = it;                                                                        \
+      while((hole > begin) && is_less(tmp, hole[-1])) {                                            \
+        *hole = hole[-1];                                                                          \
+        hole--;                                                                                    \
+      }                                                                                            \
+      *hole = tmp;                                                                                 \
+    }                                                                                              \
+  }                                                                                                \
+                                                                                                   \
+  static inline void name##_INT_sift_down(type * heap, size_t n, size_t idx) {                     \
+    while(true) {                                                                                  \
+      size_t       largest = idx;                                                                  \
+      const size_t left    = (2 * idx) + 1;                                                        \
+      const size_t right   = left + 1;                                                             \
+      if((left < n) && is_less(heap[largest], heap[left])) largest = left;                         \
+      if((right < n) && is_less(heap[largest], heap[right])) largest = right;                      \
+      if(largest == idx) return;                                                                   \
+      name##_INT_swap(&heap[idx], &heap[largest]);                                                 \
+      idx = largest;                                                                               \
+    }                                                                                              \
+  }                                                                                                \
+                                                                                                   \
+  static inline void name##_INT_heap_sort(type * begin, type * end) {                              \
+    const size_t n = (size_t)(end - begin);                                                        \
+    for(size_t i = n / 2; i > 0; i--) name##_INT_sift_down(begin, n, i - 1);                       \
+    for(size_t i = n; i > 1; i--) {                                                                \
+      name##_INT_swap(&begin[0], &begin[i - 1]);                                                   \
+      name##_INT_sift_down(begin, i - 1, 0);                                                       \
+    }                                                                                              \
+  }                                                                                                \
+                                                                                                   \
+  static inline void name##_INT_sort3(type * a, type * b, type * c) {                              \
+    if(is_less(*b, *a)) name##_INT_swap(a, b);                                                     \
+    if(is_less(*c, *b)) {                                                                          \
+      name##_INT_swap(b, c);                                                                       \
+      if(is_less(*b, *a)) name##_INT_swap(a, b);                                                   \
+    }                                                                                              \
+  }                                                                                                \
+                                                                                                   \
+  static inline void name##_INT_introsort(type * begin, type * end, size_t depth_limit) {          \
+    while((end - begin) > SPN_INT_SORT_INSERTION_THRESHOLD) {                                      \
+      if(depth_limit == 0) {                                                                       \
+        name##_INT_heap_sort(begin, end);                                                          \
+        return;                                                                                    \
+      }                                                                                            \
+      depth_limit--;                                                                               \
+                                                                                                   \
+      /* median of three also places sentinels at both ends for the partition loops below */       \
+      type * mid = begin + ((end - begin) / 2);                                                    \
+      name##_INT_sort3(begin, mid, end - 1);                                                       \
+      const type pivot = *mid;                                                                     \
+                                                                                                   \
+      type * lo = begin;                                                                           \
+      type * hi = end - 1;                                                                         \
+      while(true) {                                                                                \
+        do lo++;                                                                                   \
+        while(is_less(*lo, pivot));                                                                \
+        do hi--;                                                                                   \
+        while(is_less(pivot, *hi));                                                                \
+        if(lo >= hi) break;                                                                        \
+        name##_INT_swap(lo, hi);                                                                   \
+      }                                                                                            \
+                                                                                                   \
+      /* recurse into the smaller half, loop on the larger one to bound stack depth */             \
+      type * split = hi + 1;                                                                       \
+      if((split - begin) < (end - split)) {                                                        \
+        name##_INT_introsort(begin, split, depth_limit);                                           \
+        begin = split;                                                                             \
+      } else {                                                                                     \
+        name##_INT_introsort(split, end, depth_limit);                                             \
+        end = split;                                                                               \
+      }                                                                                            \
+    }                                                                                              \
+    name##_INT_insertion_sort(begin, end);                                                         \
+  }                                                                                                \
+                                                                                                   \
+  static inline STAT_Val name(SPN_MutSpan span) {                                                  \
+    if((span.begin == NULL) || (span.element_size != sizeof(type))) return STAT_ERR_ARGS;          \
+    if(span.len < 2) return STAT_OK;                                                               \
+                                                                                                   \
+    size_t depth_limit = 0;                                                                        \
+    for(size_t n = span.len; n > 1; n >>= 1) depth_limit += 2;                                     \
+                                                                                                   \
+    type * begin = (type *)span.begin;                                                             \
+    name##_INT_introsort(begin, begin + span.len, depth_limit);                                    \
+                                                                                                   \
+    return STAT_OK;                                                                                \
+  }
+
+#endif
@@ -0,0 +1,68 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_SPLIT_H
+#define CFAC_SPAN_SPLIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// Splitting a span into the parts between delimiters, without copying: the parts are subspans of
+// the original. Like most split functions, n delimiters always give n + 1 parts, so adjacent
+// delimiters give an empty part, as does a delimiter at either end (and an empty span gives one
+// empty part). The delimiter(s) must outlive the iterator.
+//
+// e.g.
+//   SPN_SplitIter it   = {0};
+//   SPN_Span      part = {0};
+//   SPN_split_by_element(&it, SPN_from_cstr("a,b,,c"), ",");
+//   while(SPN_split_next(&it, &part)) {
+//     ... // "a", "b", "", "c"
+//   }
+
+typedef enum {
+  SPN_SPLIT_BY_ELEMENT = 0, // a single element
+  SPN_SPLIT_BY_SUBSPAN,     // a sequence of elements
+  SPN_SPLIT_BY_ANY_OF,      // any element out of a set
+} SPN_SplitMode;
+
+typedef struct {
+  SPN_Span      remaining; // what is left after the parts we yielded
+  SPN_Span      delimiter;
+  SPN_SplitMode mode;
+  bool          is_done;
+  SPN_ByteSet   byte_set; // for SPN_SPLIT_BY_ANY_OF on byte spans
+} SPN_SplitIter;
+
+STAT_Val SPN_split_by_element(SPN_SplitIter * o_iter, SPN_Span span, const void * delimiter);
+STAT_Val SPN_split_by_subspan(SPN_SplitIter * o_iter, SPN_Span span, SPN_Span delimiter);
+STAT_Val SPN_split_by_any_of(SPN_SplitIter * o_iter, SPN_Span span, SPN_Span delimiters);
+
+// Outputs the next part and returns true, or returns false if there are no more parts.
+bool SPN_split_next(SPN_SplitIter * this, SPN_Span * o_part);
+
+// Appends all remaining parts (as SPN_Span) to out.
+STAT_Val SPN_split_into(DAR_DArray * out, SPN_SplitIter * iter);
+
+#endif
@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_STRIDED_H
+#define CFAC_SPAN_STRIDED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+
+// A span of elements that are stride bytes apart rather than back to back, typically one field of
+// each struct in an array of structs. This gives access to a column of records without copying
+// it out, and gathering copies it out when a contiguous span is needed after all.
+//
+// e.g.
+//   typedef struct { uint32_t id; double price; } Record;
+//   const SPN_StridedSpan prices = SPN_STRIDED_FIELD(records, Record, price);
+//   SPN_strided_gather(prices, price_array);
+
+typedef struct {
+  const void * begin;
+  size_t       len;          // len in number of elements
+  size_t       element_size; // size of an element in bytes
+  size_t       stride;       // distance between the starts of consecutive elements, in bytes
+} SPN_StridedSpan;
+
+// a view of field in each element of span, which is a span of type
+#define SPN_STRIDED_FIELD(span, type, field)                                                       \
+  SPN_strided_from_field((span), offsetof(type, field), sizeof(((type *)0)->field))
+
+// A field that doesn't fit in the elements gives an empty span with begin NULL.
+SPN_StridedSpan SPN_strided_from_span(SPN_Span span);
+SPN_StridedSpan SPN_strided_from_field(SPN_Span span, size_t offset, size_t field_size);
+
+SPN_StridedSpan SPN_strided_subspan(SPN_StridedSpan src, size_t begin_idx, size_t len);
+
+// Element-wise, so a strided span can equal a contiguous one with the same elements.
+bool SPN_strided_equals(SPN_StridedSpan lhs, SPN_StridedSpan rhs);
+
+// Outputs the index of the first element equal to element, or returns STAT_OK_NOT_FOUND. As with
+// SPN_find, elements are compared with memcmp and o_idx may be NULL.
+STAT_Val SPN_strided_find(SPN_StridedSpan span, const void * element, size_t * o_idx);
+
+// Calls fn on each element in order, until it returns false.
+STAT_Val SPN_strided_for_each(SPN_StridedSpan span, SPN_PredicateFn fn, void * ctx);
+
+// Copies the elements into out, which must hold at least span.len elements of the same size. The
+// append variant adds them to the end of an array with that element size.
+STAT_Val SPN_strided_gather(SPN_StridedSpan span, SPN_MutSpan out);
+STAT_Val SPN_strided_gather_append(DAR_DArray * out, SPN_StridedSpan span);
+
+static inline const void * SPN_strided_get(SPN_StridedSpan span, size_t idx) {
+  return &((const uint8_t *)span.begin)[idx * span.stride];
+}
+
+static inline bool SPN_strided_is_contiguous(SPN_StridedSpan span) {
+  return (span.stride == span.element_size);
+}
+
+#endif
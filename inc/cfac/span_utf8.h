@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_SPAN_UTF8_H
+#define CFAC_SPAN_UTF8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "span.h"
+#include "stat.h"
+
+// UTF-8 validation and codepoint counting on spans of bytes. Validation is strict (RFC 3629): no
+// overlong encodings, surrogates, or codepoints beyond U+10FFFF. With AVX2 or SSSE3 available, it
+// runs a vector at a time with nibble lookup tables (as in "Validating UTF-8 In Less Than One
+// Instruction Per Byte", Keiser & Lemire), skipping blocks of ASCII outright.
+
+// Returns STAT_OK_TRUE if bytes is valid UTF-8, STAT_OK_FALSE otherwise. If o_valid_len is not
+// NULL, it is set to the length of the longest valid prefix (at a codepoint boundary).
+STAT_Val SPN_utf8_validate(SPN_Span bytes, size_t * o_valid_len);
+
+// Counts the bytes that start a codepoint, i.e. all but continuation bytes. For valid UTF-8 that
+// is the number of codepoints.
+STAT_Val SPN_utf8_count_codepoints(SPN_Span bytes, size_t * o_count);
+
+// Validates a stream that arrives in chunks, which may split codepoints. Zero-initialize it to
+// start a stream.
+typedef struct {
+  uint8_t pending[4];  // start of a codepoint split by the end of the last chunk
+  size_t  num_pending; //
+  bool    is_invalid;  //
+} SPN_Utf8Validator;
+
+// Return STAT_OK_TRUE if the stream is valid so far, STAT_OK_FALSE if not. Once invalid, the
+// stream stays invalid. Finishing fails the stream if it ends in the middle of a codepoint.
+STAT_Val SPN_utf8_validator_feed(SPN_Utf8Validator * this, SPN_Span chunk);
+STAT_Val SPN_utf8_validator_finish(SPN_Utf8Validator * this);
+
+#endif
@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CFAC_THREADPOOL_H
+#define CFAC_THREADPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "stat.h"
+
+// NOTE The pool runs one job at a time, where a job is a number of independent tasks identified by
+// their index. TP_run blocks until all tasks are done, and the calling thread works on tasks too,
+// so a pool with 0 worker threads simply runs everything on the caller. Calling TP_run from inside
+// a task running on the same pool runs the nested job serially on the calling thread.
+
+typedef void (*TP_TaskFn)(void * ctx, size_t task_idx);
+
+typedef struct TP_Pool {
+  pthread_t * threads;
+  size_t      num_threads;
+
+  pthread_mutex_t run_mutex; // serializes concurrent TP_run calls from different threads
+  pthread_mutex_t mutex;
+  pthread_cond_t  work_cond;
+  pthread_cond_t  done_cond;
+
+  // current job
+  TP_TaskFn     task_fn;
+  void *        ctx;
+  size_t        num_tasks;
+  atomic_size_t next_task_idx;
+  size_t        num_busy_threads;
+  size_t        generation;
+  bool          is_shutting_down;
+} TP_Pool;
+
+STAT_Val TP_create(TP_Pool * this, size_t num_threads);
+STAT_Val TP_destroy(TP_Pool * this);
+
+STAT_Val TP_run(TP_Pool * this, TP_TaskFn task_fn, void * ctx, size_t num_tasks);
+
+// number of threads (including the caller) that work on a job
+static inline size_t TP_get_concurrency(const TP_Pool * this) {
+  return (this == NULL) ? 1 : (this->num_threads + 1);
+}
+
+// one worker thread per online processor besides the calling one
+size_t TP_get_default_num_threads(void);
+
+// process-wide pool with the default number of threads, created on first use and destroyed at exit.
+// Returns NULL if the pool could not be created.
+TP_Pool * TP_get_shared_pool(void);
+
+#endif
@@ -0,0 +1,340 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "bitset.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define WORDS_PER_BLOCK 4 // 256 bits
+#define BITS_PER_BLOCK  (WORDS_PER_BLOCK * BIT_BITS_PER_WORD)
+#define BLOCK_ALIGNMENT 32
+#define MAX_NUM_BITS    (SIZE_MAX - BITS_PER_BLOCK)
+#define ALL_BITS_SET    (~(uint64_t)0)
+
+typedef enum { OP_AND, OP_OR, OP_XOR, OP_ANDNOT } BulkOp;
+
+static size_t get_num_words_for_bits(size_t num_bits);
+static size_t get_num_blocks(const BIT_Set * this);
+static void   clear_trailing_bits(BIT_Set * this);
+
+static inline uint64_t *       get_words(BIT_Set * this) { return this->words.data; }
+static inline const uint64_t * get_const_words(const BIT_Set * this) { return this->words.data; }
+
+// =============
+// == kernels ==
+
+// The block kernels are in bitset_kernels.h, which we include once for each instruction set, like
+// span.c does for its search kernels. The widest kernels the CPU supports are picked when the
+// library is loaded.
+
+#if defined(__x86_64__)
+#define HAS_X86_KERNELS
+#endif
+
+#define KERNEL(name) name##_scalar
+#define KERNEL_TARGET
+#include "bitset_kernels.h"
+
+#if defined(HAS_X86_KERNELS)
+#define KERNEL(name)  name##_popcnt
+#define KERNEL_TARGET __attribute__((target("popcnt")))
+#include "bitset_kernels.h"
+
+#define KERNEL(name)  name##_avx2
+#define KERNEL_TARGET __attribute__((target("avx2,bmi2,popcnt")))
+#define HAS_AVX2
+#define HAS_BMI2
+#include "bitset_kernels.h"
+#endif
+
+typedef void (*CombineFn)(uint64_t * dst, const uint64_t * src, size_t num_blocks);
+
+typedef struct {
+  CombineFn combine[4]; // by BulkOp
+  size_t (*count_blocks)(const uint64_t * words, size_t num_blocks);
+  size_t (*get_rank)(const uint64_t * words, size_t idx);
+  size_t (*select_bit)(const uint64_t * words, size_t num_words, size_t n);
+} Kernels;
+
+#define KERNELS(suffix)                                                                            \
+  {                                                                                                \
+    .combine      = {[OP_AND]    = and_blocks_##suffix,                                            \
+                     [OP_OR]     = or_blocks_##suffix,                                             \
+                     [OP_XOR]    = xor_blocks_##suffix,                                            \
+                     [OP_ANDNOT] = andnot_blocks_##suffix},                                        \
+    .count_blocks = count_blocks_##suffix,                                                         \
+    .get_rank     = get_rank_##suffix,                                                             \
+    .select_bit   = select_bit_##suffix,                                                           \
+  }
+
+static const Kernels kernels_by_level[] = {
+    [BIT_INT_SIMD_NONE] = KERNELS(scalar),
+#if defined(HAS_X86_KERNELS)
+    [BIT_INT_SIMD_POPCNT] = KERNELS(popcnt),
+    [BIT_INT_SIMD_AVX2]   = KERNELS(avx2),
+#endif
+};
+
+// until the level is picked at load time, everything runs on the scalar kernels
+static BIT_INT_SimdLevel simd_level = BIT_INT_SIMD_NONE;
+static const Kernels *   kernels    = &kernels_by_level[BIT_INT_SIMD_NONE];
+
+static BIT_INT_SimdLevel get_supported_simd_level(void) {
+#if defined(HAS_X86_KERNELS)
+  __builtin_cpu_init(); // needed when called before other constructors have run
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") &&
+     __builtin_cpu_supports("popcnt")) {
+    return BIT_INT_SIMD_AVX2;
+  }
+  if(__builtin_cpu_supports("popcnt")) return BIT_INT_SIMD_POPCNT;
+#endif
+  return BIT_INT_SIMD_NONE;
+}
+
+__attribute__((constructor)) static void pick_simd_level(void) {
+  BIT_INT_set_max_simd_level(BIT_INT_SIMD_AVX2);
+}
+
+BIT_INT_SimdLevel BIT_INT_set_max_simd_level(BIT_INT_SimdLevel max_level) {
+  const BIT_INT_SimdLevel supported = get_supported_simd_level();
+
+  simd_level = (max_level < supported) ? max_level : supported;
+  kernels    = &kernels_by_level[simd_level];
+
+  return simd_level;
+}
+
+BIT_INT_SimdLevel BIT_INT_get_simd_level(void) { return simd_level; }
+
+STAT_Val BIT_create(BIT_Set * this, size_t num_bits) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(num_bits > MAX_NUM_BITS) return LOG_STAT(STAT_ERR_ARGS, "can't fit %zu bits", num_bits);
+
+  *this = (BIT_Set){0};
+
+  if(!STAT_is_OK(DAR_create_aligned(&this->words, sizeof(uint64_t), BLOCK_ALIGNMENT))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create words array");
+  }
+
+  if(!STAT_is_OK(DAR_resize_zeroed(&this->words, get_num_words_for_bits(num_bits)))) {
+    DAR_destroy(&this->words);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate %zu bits", num_bits);
+  }
+
+  this->num_bits = num_bits;
+
+  return OK;
+}
+
+STAT_Val BIT_create_from(BIT_Set * this, const BIT_Set * src) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(!BIT_is_initialized(src)) return LOG_STAT(STAT_ERR_ARGS, "src is not initialized");
+
+  *this = (BIT_Set){0};
+
+  if(!STAT_is_OK(DAR_create_from(&this->words, &src->words))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to copy words array");
+  }
+
+  this->num_bits = src->num_bits;
+
+  return OK;
+}
+
+STAT_Val BIT_destroy(BIT_Set * this) {
+  if(this == NULL) return OK;
+
+  if(!STAT_is_OK(DAR_destroy(&this->words))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to destroy words array");
+  }
+
+  *this = (BIT_Set){0};
+
+  return OK;
+}
+
+STAT_Val BIT_resize(BIT_Set * this, size_t num_bits) {
+  if(!BIT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(num_bits > MAX_NUM_BITS) return LOG_STAT(STAT_ERR_ARGS, "can't fit %zu bits", num_bits);
+
+  // bits beyond the old size are clear already, so only need to clear when shrinking
+  if(!STAT_is_OK(DAR_resize_zeroed(&this->words, get_num_words_for_bits(num_bits)))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to resize to %zu bits", num_bits);
+  }
+
+  const bool is_shrinking = (num_bits < this->num_bits);
+
+  this->num_bits = num_bits;
+
+  if(is_shrinking) clear_trailing_bits(this);
+
+  return OK;
+}
+
+void BIT_set_all(BIT_Set * this) {
+  memset(get_words(this), 0xff, this->words.size * sizeof(uint64_t));
+  clear_trailing_bits(this);
+}
+
+void BIT_clear_all(BIT_Set * this) {
+  memset(get_words(this), 0, this->words.size * sizeof(uint64_t));
+}
+
+STAT_Val BIT_set_range(BIT_Set * this, size_t first, size_t last) {
+  if(!BIT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(first > last || last > this->num_bits) {
+    return LOG_STAT(STAT_ERR_RANGE,
+                    "range [%zu, %zu) not in set of %zu bits",
+                    first,
+                    last,
+                    this->num_bits);
+  }
+  if(first == last) return OK;
+
+  uint64_t *     words      = get_words(this);
+  const size_t   first_word = first / BIT_BITS_PER_WORD;
+  const size_t   last_word  = (last - 1) / BIT_BITS_PER_WORD;
+  const size_t   last_bit   = (last - 1) % BIT_BITS_PER_WORD;
+  const uint64_t first_mask = ALL_BITS_SET << (first % BIT_BITS_PER_WORD);
+  const uint64_t last_mask  = ALL_BITS_SET >> ((BIT_BITS_PER_WORD - 1) - last_bit);
+
+  if(first_word == last_word) {
+    words[first_word] |= (first_mask & last_mask);
+    return OK;
+  }
+
+  words[first_word] |= first_mask;
+  memset(&words[first_word + 1], 0xff, (last_word - (first_word + 1)) * sizeof(uint64_t));
+  words[last_word] |= last_mask;
+
+  return OK;
+}
+
+static STAT_Val check_bulk_op_args(const BIT_Set * this, const BIT_Set * other) {
+  if(!BIT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(!BIT_is_initialized(other)) return LOG_STAT(STAT_ERR_ARGS, "other is not initialized");
+  if(this->num_bits != other->num_bits) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "sizes differ (%zu and %zu bits)",
+                    this->num_bits,
+                    other->num_bits);
+  }
+  return OK;
+}
+
+STAT_Val BIT_and(BIT_Set * this, const BIT_Set * other) {
+  if(!STAT_is_OK(check_bulk_op_args(this, other))) return LOG_STAT(STAT_ERR_ARGS, "bad args");
+  kernels->combine[OP_AND](get_words(this), get_const_words(other), get_num_blocks(this));
+  return OK;
+}
+
+STAT_Val BIT_or(BIT_Set * this, const BIT_Set * other) {
+  if(!STAT_is_OK(check_bulk_op_args(this, other))) return LOG_STAT(STAT_ERR_ARGS, "bad args");
+  kernels->combine[OP_OR](get_words(this), get_const_words(other), get_num_blocks(this));
+  return OK;
+}
+
+STAT_Val BIT_xor(BIT_Set * this, const BIT_Set * other) {
+  if(!STAT_is_OK(check_bulk_op_args(this, other))) return LOG_STAT(STAT_ERR_ARGS, "bad args");
+  kernels->combine[OP_XOR](get_words(this), get_const_words(other), get_num_blocks(this));
+  return OK;
+}
+
+STAT_Val BIT_andnot(BIT_Set * this, const BIT_Set * other) {
+  if(!STAT_is_OK(check_bulk_op_args(this, other))) return LOG_STAT(STAT_ERR_ARGS, "bad args");
+  kernels->combine[OP_ANDNOT](get_words(this), get_const_words(other), get_num_blocks(this));
+  return OK;
+}
+
+size_t BIT_count(const BIT_Set * this) {
+  return kernels->count_blocks(get_const_words(this), get_num_blocks(this));
+}
+
+size_t BIT_rank(const BIT_Set * this, size_t idx) {
+  if(idx >= this->num_bits) return BIT_count(this);
+  return kernels->get_rank(get_const_words(this), idx);
+}
+
+STAT_Val BIT_select(const BIT_Set * this, size_t n, size_t * o_idx) {
+  if(!BIT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(o_idx == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_idx is NULL");
+
+  const size_t idx = kernels->select_bit(get_const_words(this), this->words.size, n);
+  if(idx == SIZE_MAX) return STAT_OK_NOT_FOUND;
+
+  *o_idx = idx;
+
+  return OK;
+}
+
+STAT_Val BIT_find_next_set(const BIT_Set * this, size_t from, size_t * o_idx) {
+  if(!BIT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(o_idx == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_idx is NULL");
+
+  if(from >= this->num_bits) return STAT_OK_NOT_FOUND;
+
+  const uint64_t * words     = get_const_words(this);
+  const size_t     num_words = this->words.size;
+
+  size_t   w    = from / BIT_BITS_PER_WORD;
+  uint64_t word = words[w] & (ALL_BITS_SET << (from % BIT_BITS_PER_WORD));
+
+  while(word == 0) {
+    w++;
+    if(w == num_words) return STAT_OK_NOT_FOUND;
+    word = words[w];
+  }
+
+  // bits beyond the size are clear, so this is always within the set
+  *o_idx = (w * BIT_BITS_PER_WORD) + (size_t)__builtin_ctzll(word);
+
+  return OK;
+}
+
+SPN_Span BIT_to_word_span(const BIT_Set * this) {
+  return (SPN_Span){.begin        = this->words.data,
+                    .len          = (this->num_bits + (BIT_BITS_PER_WORD - 1)) / BIT_BITS_PER_WORD,
+                    .element_size = sizeof(uint64_t)};
+}
+
+static size_t get_num_words_for_bits(size_t num_bits) {
+  return ((num_bits + (BITS_PER_BLOCK - 1)) / BITS_PER_BLOCK) * WORDS_PER_BLOCK;
+}
+
+static size_t get_num_blocks(const BIT_Set * this) { return this->words.size / WORDS_PER_BLOCK; }
+
+static void clear_trailing_bits(BIT_Set * this) {
+  uint64_t *   words          = get_words(this);
+  const size_t num_words      = this->words.size;
+  const size_t num_full_words = this->num_bits / BIT_BITS_PER_WORD;
+  const size_t rest           = this->num_bits % BIT_BITS_PER_WORD;
+
+  if(num_full_words == num_words) return;
+
+  words[num_full_words] &= ((uint64_t)1 << rest) - 1;
+  memset(&words[num_full_words + 1], 0, (num_words - (num_full_words + 1)) * sizeof(uint64_t));
+}
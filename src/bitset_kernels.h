@@ -0,0 +1,168 @@
+// MIT License
+//
+// Copyright (c) 2023 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Block kernels for bitset.c, which includes this file once per instruction set, the same way
+// span.c includes span_kernels.h. Before each include, bitset.c defines KERNEL(name) and
+// KERNEL_TARGET, and HAS_AVX2 and HAS_BMI2 if the kernels may use those. All of these are
+// undefined again at the end of this file.
+
+#define combine_blocks KERNEL(combine_blocks)
+#define and_blocks     KERNEL(and_blocks)
+#define or_blocks      KERNEL(or_blocks)
+#define xor_blocks     KERNEL(xor_blocks)
+#define andnot_blocks  KERNEL(andnot_blocks)
+#define count_blocks   KERNEL(count_blocks)
+#define select_in_word KERNEL(select_in_word)
+#define get_rank       KERNEL(get_rank)
+#define select_bit     KERNEL(select_bit)
+
+// Only called with a constant op, so that once inlined the switch is resolved at compile time.
+KERNEL_TARGET static inline void combine_blocks(uint64_t *       dst,
+                                                const uint64_t * src,
+                                                size_t           num_blocks,
+                                                BulkOp           op) {
+#if defined(HAS_AVX2)
+  for(size_t b = 0; b < num_blocks; b++) {
+    __m256i *     d_ptr = (__m256i *)&dst[b * WORDS_PER_BLOCK];
+    const __m256i d     = _mm256_load_si256(d_ptr);
+    const __m256i s     = _mm256_load_si256((const __m256i *)&src[b * WORDS_PER_BLOCK]);
+    switch(op) {
+    case OP_AND: _mm256_store_si256(d_ptr, _mm256_and_si256(d, s)); break;
+    case OP_OR: _mm256_store_si256(d_ptr, _mm256_or_si256(d, s)); break;
+    case OP_XOR: _mm256_store_si256(d_ptr, _mm256_xor_si256(d, s)); break;
+    case OP_ANDNOT: _mm256_store_si256(d_ptr, _mm256_andnot_si256(s, d)); break;
+    }
+  }
+#else
+  // a block is four words, which the compiler can handle as two SSE2 vectors
+  for(size_t w = 0; w < (num_blocks * WORDS_PER_BLOCK); w++) {
+    switch(op) {
+    case OP_AND: dst[w] &= src[w]; break;
+    case OP_OR: dst[w] |= src[w]; break;
+    case OP_XOR: dst[w] ^= src[w]; break;
+    case OP_ANDNOT: dst[w] &= ~src[w]; break;
+    }
+  }
+#endif
+}
+
+KERNEL_TARGET static void and_blocks(uint64_t * dst, const uint64_t * src, size_t num_blocks) {
+  combine_blocks(dst, src, num_blocks, OP_AND);
+}
+
+KERNEL_TARGET static void or_blocks(uint64_t * dst, const uint64_t * src, size_t num_blocks) {
+  combine_blocks(dst, src, num_blocks, OP_OR);
+}
+
+KERNEL_TARGET static void xor_blocks(uint64_t * dst, const uint64_t * src, size_t num_blocks) {
+  combine_blocks(dst, src, num_blocks, OP_XOR);
+}
+
+KERNEL_TARGET static void andnot_blocks(uint64_t * dst, const uint64_t * src, size_t num_blocks) {
+  combine_blocks(dst, src, num_blocks, OP_ANDNOT);
+}
+
+KERNEL_TARGET static size_t count_blocks(const uint64_t * words, size_t num_blocks) {
+#if defined(HAS_AVX2)
+  // count bits per nibble by table lookup, then sum the bytes of each 64-bit lane
+  const __m256i lookup   = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i zero     = _mm256_setzero_si256();
+
+  __m256i sums = zero;
+  for(size_t b = 0; b < num_blocks; b++) {
+    const __m256i block = _mm256_load_si256((const __m256i *)&words[b * WORDS_PER_BLOCK]);
+    const __m256i low   = _mm256_and_si256(block, low_mask);
+    const __m256i high  = _mm256_and_si256(_mm256_srli_epi16(block, 4), low_mask);
+    const __m256i counts =
+        _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+    sums = _mm256_add_epi64(sums, _mm256_sad_epu8(counts, zero));
+  }
+
+  uint64_t lane_sums[WORDS_PER_BLOCK];
+  _mm256_storeu_si256((__m256i *)lane_sums, sums);
+  return (size_t)(lane_sums[0] + lane_sums[1] + lane_sums[2] + lane_sums[3]);
+#else
+  size_t count = 0;
+  for(size_t w = 0; w < (num_blocks * WORDS_PER_BLOCK); w++) {
+    count += (size_t)__builtin_popcountll(words[w]);
+  }
+  return count;
+#endif
+}
+
+// Index of the n-th set bit in word, n must be less than the number of set bits.
+KERNEL_TARGET static inline size_t select_in_word(uint64_t word, size_t n) {
+#if defined(HAS_BMI2)
+  return (size_t)__builtin_ctzll(_pdep_u64((uint64_t)1 << n, word));
+#else
+  for(size_t i = 0; i < n; i++) word &= (word - 1); // clear lowest set bit
+  return (size_t)__builtin_ctzll(word);
+#endif
+}
+
+// Number of set bits before idx, which must be within the words.
+KERNEL_TARGET static size_t get_rank(const uint64_t * words, size_t idx) {
+  const size_t num_blocks = idx / BITS_PER_BLOCK;
+  const size_t word_idx   = idx / BIT_BITS_PER_WORD;
+
+  size_t rank = count_blocks(words, num_blocks);
+  for(size_t w = num_blocks * WORDS_PER_BLOCK; w < word_idx; w++) {
+    rank += (size_t)__builtin_popcountll(words[w]);
+  }
+
+  const uint64_t below_idx_mask = ((uint64_t)1 << (idx % BIT_BITS_PER_WORD)) - 1;
+  return rank + (size_t)__builtin_popcountll(words[word_idx] & below_idx_mask);
+}
+
+// Index of the n-th set bit, or SIZE_MAX if there are no more than n bits set.
+KERNEL_TARGET static size_t select_bit(const uint64_t * words, size_t num_words, size_t n) {
+  // skip whole blocks first, then find the word, then the bit within the word
+  size_t w = 0;
+  for(; w < num_words; w += WORDS_PER_BLOCK) {
+    const size_t block_count = count_blocks(&words[w], 1);
+    if(n < block_count) break;
+    n -= block_count;
+  }
+  if(w == num_words) return SIZE_MAX;
+
+  for(;; w++) {
+    const size_t word_count = (size_t)__builtin_popcountll(words[w]);
+    if(n < word_count) break;
+    n -= word_count;
+  }
+
+  return (w * BIT_BITS_PER_WORD) + select_in_word(words[w], n);
+}
+
+#undef combine_blocks
+#undef and_blocks
+#undef or_blocks
+#undef xor_blocks
+#undef andnot_blocks
+#undef count_blocks
+#undef select_in_word
+#undef get_rank
+#undef select_bit
+
+#undef KERNEL
+#undef KERNEL_TARGET
+#undef HAS_AVX2
+#undef HAS_BMI2
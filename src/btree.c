@@ -0,0 +1,769 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "btree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "log.h"
+
+#define OK STAT_OK
+
+#define CACHE_LINE_SIZE  64
+#define DATA_ALIGNMENT   _Alignof(max_align_t)
+#define NODE_HEADER_SIZE offsetof(BT_INT_Node, data)
+#define MIN_CAPACITY     4
+
+static size_t round_up(size_t n, size_t to) { return ((n + (to - 1)) / to) * to; }
+
+// ============
+// == layout ==
+
+static inline size_t get_value_offset(const BT_Map * this) {
+  return round_up(this->leaf_capacity * this->key_size, DATA_ALIGNMENT);
+}
+
+static inline size_t get_children_offset(const BT_Map * this) {
+  return round_up(this->internal_capacity * this->key_size, DATA_ALIGNMENT);
+}
+
+static inline uint8_t * key_at(const BT_Map * this, const BT_INT_Node * node, size_t idx) {
+  return (uint8_t *)&node->data[idx * this->key_size];
+}
+
+static inline uint8_t * value_at(const BT_Map * this, const BT_INT_Node * node, size_t idx) {
+  return (uint8_t *)&node->data[get_value_offset(this) + (idx * this->value_size)];
+}
+
+static inline BT_INT_Node ** get_children(const BT_Map * this, const BT_INT_Node * node) {
+  return (BT_INT_Node **)&node->data[get_children_offset(this)];
+}
+
+static inline size_t get_min_keys(const BT_Map * this, const BT_INT_Node * node) {
+  return (node->is_leaf ? this->leaf_capacity : this->internal_capacity) / 2;
+}
+
+// The key that goes up to the parent after a split is kept at the start of scratch, followed by
+// room for the contents of a node with one entry too many.
+static inline uint8_t * get_split_key(const BT_Map * this) { return this->scratch; }
+static inline uint8_t * get_overflow(const BT_Map * this) {
+  return &this->scratch[round_up(this->key_size, DATA_ALIGNMENT)];
+}
+
+// ==============================
+// == searching and allocating ==
+
+static inline int compare_keys(const BT_Map * this, const void * lhs, const void * rhs) {
+  return (this->cmp != NULL) ? this->cmp(lhs, rhs) : memcmp(lhs, rhs, this->key_size);
+}
+
+// Returns the number of keys in node that are less than key, or (if is_upper) not greater.
+static size_t search_node(const BT_Map *      this,
+                          const BT_INT_Node * node,
+                          const void *        key,
+                          bool                is_upper) {
+  const int bias = is_upper ? 1 : 0;
+
+  size_t lo = 0;
+  size_t hi = node->num_keys;
+  while(lo < hi) {
+    const size_t mid = lo + ((hi - lo) / 2);
+    if(compare_keys(this, key_at(this, node, mid), key) < bias) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Keys equal to a separator are in the subtree to its right, so we go down by upper bound.
+static const BT_INT_Node * find_leaf(const BT_Map * this, const void * key) {
+  const BT_INT_Node * node = this->root;
+  while(!node->is_leaf) node = get_children(this, node)[search_node(this, node, key, true)];
+  return node;
+}
+
+static BT_INT_Node * allocate_node(const BT_Map * this, bool is_leaf) {
+  BT_INT_Node * node = aligned_alloc(CACHE_LINE_SIZE, this->node_size);
+  if(node == NULL) return NULL;
+
+  *node = (BT_INT_Node){.is_leaf = is_leaf};
+
+  return node;
+}
+
+static STAT_Val ensure_spare_nodes(BT_Map * this, size_t num_nodes) {
+  while(this->num_spare_nodes < num_nodes) {
+    BT_INT_Node * node = allocate_node(this, false);
+    if(node == NULL) return STAT_ERR_ALLOC;
+
+    node->next        = this->spare_nodes;
+    this->spare_nodes = node;
+    this->num_spare_nodes++;
+  }
+  return OK;
+}
+
+static BT_INT_Node * take_spare_node(BT_Map * this, bool is_leaf) {
+  BT_INT_Node * node = this->spare_nodes;
+  this->spare_nodes  = node->next;
+  this->num_spare_nodes--;
+
+  *node = (BT_INT_Node){.is_leaf = is_leaf};
+
+  return node;
+}
+
+static void free_nodes(BT_Map * this, BT_INT_Node * node, const BT_INT_Node * keep) {
+  if(!node->is_leaf) {
+    for(size_t i = 0; i <= node->num_keys; i++) free_nodes(this, get_children(this, node)[i], keep);
+  }
+  if(node != keep) free(node);
+}
+
+static BT_Iterator make_iterator(const BT_Map * this, const BT_INT_Node * leaf, size_t idx) {
+  if(leaf != NULL && idx >= leaf->num_keys) {
+    leaf = leaf->next;
+    idx  = 0;
+  }
+  if(leaf != NULL && leaf->num_keys == 0) leaf = NULL; // empty root
+
+  return (BT_Iterator){.leaf         = leaf,
+                       .idx          = idx,
+                       .key_size     = this->key_size,
+                       .value_offset = get_value_offset(this),
+                       .value_size   = this->value_size};
+}
+
+// ===============
+// == insertion ==
+
+// Copies a caller's value into the map; with values of size 0, value may be NULL.
+static inline void copy_value_in(uint8_t * dst, const void * value, size_t value_size) {
+  if(value_size > 0) memcpy(dst, value, value_size);
+}
+
+static void insert_into_leaf(BT_Map *      this,
+                             BT_INT_Node * leaf,
+                             const void *  key,
+                             const void *  value,
+                             BT_INT_Node ** o_right) {
+  const size_t ks  = this->key_size;
+  const size_t vs  = this->value_size;
+  const size_t n   = leaf->num_keys;
+  const size_t idx = search_node(this, leaf, key, false);
+
+  if(idx < n && compare_keys(this, key_at(this, leaf, idx), key) == 0) {
+    copy_value_in(value_at(this, leaf, idx), value, vs);
+    return;
+  }
+
+  this->size++;
+
+  if(n < this->leaf_capacity) {
+    memmove(key_at(this, leaf, idx + 1), key_at(this, leaf, idx), (n - idx) * ks);
+    memmove(value_at(this, leaf, idx + 1), value_at(this, leaf, idx), (n - idx) * vs);
+    memcpy(key_at(this, leaf, idx), key, ks);
+    copy_value_in(value_at(this, leaf, idx), value, vs);
+    leaf->num_keys++;
+    return;
+  }
+
+  // gather all entries (including the new one) in the overflow area, and split them over the
+  // leaf and a new one to its right
+  uint8_t * keys   = get_overflow(this);
+  uint8_t * values = &keys[round_up((n + 1) * ks, DATA_ALIGNMENT)];
+
+  memcpy(keys, key_at(this, leaf, 0), idx * ks);
+  memcpy(&keys[idx * ks], key, ks);
+  memcpy(&keys[(idx + 1) * ks], key_at(this, leaf, idx), (n - idx) * ks);
+  memcpy(values, value_at(this, leaf, 0), idx * vs);
+  copy_value_in(&values[idx * vs], value, vs);
+  memcpy(&values[(idx + 1) * vs], value_at(this, leaf, idx), (n - idx) * vs);
+
+  const size_t total   = n + 1;
+  const size_t left_n  = (total + 1) / 2;
+  const size_t right_n = total - left_n;
+
+  BT_INT_Node * right = take_spare_node(this, true);
+
+  memcpy(key_at(this, leaf, 0), keys, left_n * ks);
+  memcpy(value_at(this, leaf, 0), values, left_n * vs);
+  memcpy(key_at(this, right, 0), &keys[left_n * ks], right_n * ks);
+  memcpy(value_at(this, right, 0), &values[left_n * vs], right_n * vs);
+
+  leaf->num_keys  = (uint32_t)left_n;
+  right->num_keys = (uint32_t)right_n;
+  right->next     = leaf->next;
+  leaf->next      = right;
+
+  memcpy(get_split_key(this), key_at(this, right, 0), ks);
+  *o_right = right;
+}
+
+// Inserts the split key with right child at child_idx + 1.
+static void insert_child(BT_Map *       this,
+                         BT_INT_Node *  node,
+                         size_t         child_idx,
+                         BT_INT_Node *  right_child,
+                         BT_INT_Node ** o_right) {
+  const size_t   ks       = this->key_size;
+  const size_t   n        = node->num_keys;
+  BT_INT_Node ** children = get_children(this, node);
+
+  if(n < this->internal_capacity) {
+    memmove(key_at(this, node, child_idx + 1), key_at(this, node, child_idx), (n - child_idx) * ks);
+    memmove(&children[child_idx + 2],
+            &children[child_idx + 1],
+            (n - child_idx) * sizeof(BT_INT_Node *));
+    memcpy(key_at(this, node, child_idx), get_split_key(this), ks);
+    children[child_idx + 1] = right_child;
+    node->num_keys++;
+    return;
+  }
+
+  uint8_t *      keys = get_overflow(this);
+  BT_INT_Node ** kids = (BT_INT_Node **)&keys[round_up((n + 1) * ks, DATA_ALIGNMENT)];
+
+  memcpy(keys, key_at(this, node, 0), child_idx * ks);
+  memcpy(&keys[child_idx * ks], get_split_key(this), ks);
+  memcpy(&keys[(child_idx + 1) * ks], key_at(this, node, child_idx), (n - child_idx) * ks);
+  memcpy(kids, children, (child_idx + 1) * sizeof(BT_INT_Node *));
+  kids[child_idx + 1] = right_child;
+  memcpy(&kids[child_idx + 2], &children[child_idx + 1], (n - child_idx) * sizeof(BT_INT_Node *));
+
+  // the middle key goes up, the ones before it stay, the ones after it go to the new node
+  const size_t total   = n + 1;
+  const size_t mid     = total / 2;
+  const size_t right_n = total - (mid + 1);
+
+  BT_INT_Node * right = take_spare_node(this, false);
+
+  memcpy(key_at(this, node, 0), keys, mid * ks);
+  memcpy(children, kids, (mid + 1) * sizeof(BT_INT_Node *));
+  memcpy(key_at(this, right, 0), &keys[(mid + 1) * ks], right_n * ks);
+  memcpy(get_children(this, right), &kids[mid + 1], (right_n + 1) * sizeof(BT_INT_Node *));
+  memcpy(get_split_key(this), &keys[mid * ks], ks);
+
+  node->num_keys  = (uint32_t)mid;
+  right->num_keys = (uint32_t)right_n;
+
+  *o_right = right;
+}
+
+// If node is split, outputs the new node to its right (and leaves its first key in split key).
+static void insert_into(BT_Map *       this,
+                        BT_INT_Node *  node,
+                        const void *   key,
+                        const void *   value,
+                        BT_INT_Node ** o_right) {
+  *o_right = NULL;
+
+  if(node->is_leaf) {
+    insert_into_leaf(this, node, key, value, o_right);
+    return;
+  }
+
+  const size_t  child_idx   = search_node(this, node, key, true);
+  BT_INT_Node * right_child = NULL;
+  insert_into(this, get_children(this, node)[child_idx], key, value, &right_child);
+
+  if(right_child != NULL) insert_child(this, node, child_idx, right_child, o_right);
+}
+
+// ==============
+// == removal ==
+
+static void borrow_from_left(BT_Map * this, BT_INT_Node * parent, size_t child_idx) {
+  const size_t  ks    = this->key_size;
+  const size_t  vs    = this->value_size;
+  BT_INT_Node * left  = get_children(this, parent)[child_idx - 1];
+  BT_INT_Node * child = get_children(this, parent)[child_idx];
+  uint8_t *     sep   = key_at(this, parent, child_idx - 1);
+  const size_t  n     = child->num_keys;
+  const size_t  ln    = left->num_keys;
+
+  memmove(key_at(this, child, 1), key_at(this, child, 0), n * ks);
+
+  if(child->is_leaf) {
+    memmove(value_at(this, child, 1), value_at(this, child, 0), n * vs);
+    memcpy(key_at(this, child, 0), key_at(this, left, ln - 1), ks);
+    memcpy(value_at(this, child, 0), value_at(this, left, ln - 1), vs);
+    memcpy(sep, key_at(this, child, 0), ks);
+  } else {
+    BT_INT_Node ** children = get_children(this, child);
+    memmove(&children[1], &children[0], (n + 1) * sizeof(BT_INT_Node *));
+    children[0] = get_children(this, left)[ln];
+    memcpy(key_at(this, child, 0), sep, ks);
+    memcpy(sep, key_at(this, left, ln - 1), ks);
+  }
+
+  left->num_keys--;
+  child->num_keys++;
+}
+
+static void borrow_from_right(BT_Map * this, BT_INT_Node * parent, size_t child_idx) {
+  const size_t  ks    = this->key_size;
+  const size_t  vs    = this->value_size;
+  BT_INT_Node * child = get_children(this, parent)[child_idx];
+  BT_INT_Node * right = get_children(this, parent)[child_idx + 1];
+  uint8_t *     sep   = key_at(this, parent, child_idx);
+  const size_t  n     = child->num_keys;
+  const size_t  rn    = right->num_keys;
+
+  if(child->is_leaf) {
+    memcpy(key_at(this, child, n), key_at(this, right, 0), ks);
+    memcpy(value_at(this, child, n), value_at(this, right, 0), vs);
+    memmove(key_at(this, right, 0), key_at(this, right, 1), (rn - 1) * ks);
+    memmove(value_at(this, right, 0), value_at(this, right, 1), (rn - 1) * vs);
+    memcpy(sep, key_at(this, right, 0), ks);
+  } else {
+    BT_INT_Node ** right_children = get_children(this, right);
+    memcpy(key_at(this, child, n), sep, ks);
+    get_children(this, child)[n + 1] = right_children[0];
+    memcpy(sep, key_at(this, right, 0), ks);
+    memmove(key_at(this, right, 0), key_at(this, right, 1), (rn - 1) * ks);
+    memmove(&right_children[0], &right_children[1], rn * sizeof(BT_INT_Node *));
+  }
+
+  right->num_keys--;
+  child->num_keys++;
+}
+
+// Merges the child at idx + 1 into the one at idx.
+static void merge_children(BT_Map * this, BT_INT_Node * parent, size_t idx) {
+  const size_t   ks       = this->key_size;
+  BT_INT_Node ** children = get_children(this, parent);
+  BT_INT_Node *  left     = children[idx];
+  BT_INT_Node *  right    = children[idx + 1];
+  const size_t   ln       = left->num_keys;
+  const size_t   rn       = right->num_keys;
+
+  if(left->is_leaf) {
+    memcpy(key_at(this, left, ln), key_at(this, right, 0), rn * ks);
+    memcpy(value_at(this, left, ln), value_at(this, right, 0), rn * this->value_size);
+    left->num_keys = (uint32_t)(ln + rn);
+    left->next     = right->next;
+  } else {
+    // the separator comes down between the keys of both
+    memcpy(key_at(this, left, ln), key_at(this, parent, idx), ks);
+    memcpy(key_at(this, left, ln + 1), key_at(this, right, 0), rn * ks);
+    memcpy(&get_children(this, left)[ln + 1],
+           get_children(this, right),
+           (rn + 1) * sizeof(BT_INT_Node *));
+    left->num_keys = (uint32_t)(ln + 1 + rn);
+  }
+
+  free(right);
+
+  const size_t n = parent->num_keys;
+  memmove(key_at(this, parent, idx), key_at(this, parent, idx + 1), (n - idx - 1) * ks);
+  memmove(&children[idx + 1], &children[idx + 2], (n - idx - 1) * sizeof(BT_INT_Node *));
+  parent->num_keys--;
+}
+
+static void fix_underflow(BT_Map * this, BT_INT_Node * parent, size_t child_idx) {
+  BT_INT_Node ** children = get_children(this, parent);
+  BT_INT_Node *  left     = (child_idx > 0) ? children[child_idx - 1] : NULL;
+  BT_INT_Node *  right    = (child_idx < parent->num_keys) ? children[child_idx + 1] : NULL;
+
+  if(left != NULL && left->num_keys > get_min_keys(this, left)) {
+    borrow_from_left(this, parent, child_idx);
+  } else if(right != NULL && right->num_keys > get_min_keys(this, right)) {
+    borrow_from_right(this, parent, child_idx);
+  } else if(left != NULL) {
+    merge_children(this, parent, child_idx - 1);
+  } else {
+    merge_children(this, parent, child_idx);
+  }
+}
+
+static bool remove_from(BT_Map * this, BT_INT_Node * node, const void * key) {
+  if(node->is_leaf) {
+    const size_t n   = node->num_keys;
+    const size_t idx = search_node(this, node, key, false);
+    if(idx == n || compare_keys(this, key_at(this, node, idx), key) != 0) return false;
+
+    memmove(key_at(this, node, idx), key_at(this, node, idx + 1), (n - idx - 1) * this->key_size);
+    memmove(value_at(this, node, idx),
+            value_at(this, node, idx + 1),
+            (n - idx - 1) * this->value_size);
+    node->num_keys--;
+    this->size--;
+    return true;
+  }
+
+  const size_t  child_idx = search_node(this, node, key, true);
+  BT_INT_Node * child     = get_children(this, node)[child_idx];
+
+  if(!remove_from(this, child, key)) return false;
+
+  if(child->num_keys < get_min_keys(this, child)) fix_underflow(this, node, child_idx);
+
+  return true;
+}
+
+// ============================
+// == public implementations ==
+
+STAT_Val BT_create(BT_Map * this, size_t key_size, size_t value_size, SPN_CompareFn cmp) {
+  return BT_create_with_node_size(this, key_size, value_size, cmp, BT_DEFAULT_NODE_SIZE);
+}
+
+STAT_Val BT_create_with_node_size(BT_Map *      this,
+                                  size_t        key_size,
+                                  size_t        value_size,
+                                  SPN_CompareFn cmp,
+                                  size_t        node_size) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(key_size == 0) return LOG_STAT(STAT_ERR_ARGS, "key_size can't be 0");
+  if(node_size > (SIZE_MAX / 2)) return LOG_STAT(STAT_ERR_ARGS, "node_size too large");
+
+  *this = (BT_Map){.cmp        = cmp,
+                   .key_size   = key_size,
+                   .value_size = value_size,
+                   .node_size  = round_up(node_size, CACHE_LINE_SIZE),
+                   .height     = 1};
+
+  const size_t available = (this->node_size > NODE_HEADER_SIZE)
+                               ? (this->node_size - NODE_HEADER_SIZE)
+                               : 0;
+
+  // find the largest capacities for which keys and values/children fit, with padding
+  size_t leaf_capacity = available / (key_size + value_size);
+  while(leaf_capacity > 0 && (round_up(leaf_capacity * key_size, DATA_ALIGNMENT) +
+                              (leaf_capacity * value_size)) > available) {
+    leaf_capacity--;
+  }
+  size_t internal_capacity = available / (key_size + sizeof(BT_INT_Node *));
+  while(internal_capacity > 0 && (round_up(internal_capacity * key_size, DATA_ALIGNMENT) +
+                                  ((internal_capacity + 1) * sizeof(BT_INT_Node *))) > available) {
+    internal_capacity--;
+  }
+
+  if(leaf_capacity < MIN_CAPACITY || internal_capacity < MIN_CAPACITY) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "node size %zu too small for keys of %zu and values of %zu bytes",
+                    node_size,
+                    key_size,
+                    value_size);
+  }
+
+  this->leaf_capacity     = leaf_capacity;
+  this->internal_capacity = internal_capacity;
+
+  const size_t leaf_overflow_size = round_up((leaf_capacity + 1) * key_size, DATA_ALIGNMENT) +
+                                    ((leaf_capacity + 1) * value_size);
+  const size_t internal_overflow_size =
+      round_up((internal_capacity + 1) * key_size, DATA_ALIGNMENT) +
+      ((internal_capacity + 2) * sizeof(BT_INT_Node *));
+  const size_t overflow_size = (leaf_overflow_size > internal_overflow_size)
+                                   ? leaf_overflow_size
+                                   : internal_overflow_size;
+
+  this->scratch = malloc(round_up(key_size, DATA_ALIGNMENT) + overflow_size);
+  this->root    = allocate_node(this, true);
+  if(this->scratch == NULL || this->root == NULL) {
+    free(this->scratch);
+    free(this->root);
+    *this = (BT_Map){0};
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate");
+  }
+
+  this->first_leaf = this->root;
+
+  return OK;
+}
+
+STAT_Val BT_destroy(BT_Map * this) {
+  if(this == NULL) return OK;
+
+  if(this->root != NULL) free_nodes(this, this->root, NULL);
+  while(this->spare_nodes != NULL) {
+    BT_INT_Node * next = this->spare_nodes->next;
+    free(this->spare_nodes);
+    this->spare_nodes = next;
+  }
+  free(this->scratch);
+
+  *this = (BT_Map){0};
+
+  return OK;
+}
+
+STAT_Val BT_set(BT_Map * this, const void * key, const void * value) {
+  if(!BT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(key == NULL) return LOG_STAT(STAT_ERR_ARGS, "key is NULL");
+  if(value == NULL && this->value_size > 0) return LOG_STAT(STAT_ERR_ARGS, "value is NULL");
+
+  // each level may split, plus a new root
+  if(!STAT_is_OK(ensure_spare_nodes(this, this->height + 1))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate nodes");
+  }
+
+  BT_INT_Node * right = NULL;
+  insert_into(this, this->root, key, value, &right);
+
+  if(right != NULL) {
+    BT_INT_Node * new_root = take_spare_node(this, false);
+    memcpy(key_at(this, new_root, 0), get_split_key(this), this->key_size);
+    get_children(this, new_root)[0] = this->root;
+    get_children(this, new_root)[1] = right;
+    new_root->num_keys              = 1;
+
+    this->root = new_root;
+    this->height++;
+  }
+
+  return OK;
+}
+
+STAT_Val BT_remove(BT_Map * this, const void * key) {
+  if(!BT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(key == NULL) return LOG_STAT(STAT_ERR_ARGS, "key is NULL");
+
+  if(!remove_from(this, this->root, key)) return STAT_OK_NOT_FOUND;
+
+  if(!this->root->is_leaf && this->root->num_keys == 0) {
+    BT_INT_Node * old_root = this->root;
+    this->root             = get_children(this, old_root)[0];
+    this->height--;
+    free(old_root);
+  }
+
+  return OK;
+}
+
+STAT_Val BT_clear(BT_Map * this) {
+  if(!BT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  // keep the first leaf as the (empty) root
+  free_nodes(this, this->root, this->first_leaf);
+
+  this->root  = this->first_leaf;
+  *this->root = (BT_INT_Node){.is_leaf = true};
+  this->size   = 0;
+  this->height = 1;
+
+  return OK;
+}
+
+// Builds the level above nodes, which have min_keys as the least key in their subtree. Outputs the
+// parents and their least keys.
+static STAT_Val build_parent_level(BT_Map *     this,
+                                   DAR_DArray * nodes,
+                                   DAR_DArray * min_keys,
+                                   DAR_DArray * o_parents,
+                                   DAR_DArray * o_parent_min_keys) {
+  const size_t   n            = nodes->size;
+  const size_t   max_children = this->internal_capacity + 1;
+  const size_t   num_parents  = (n + (max_children - 1)) / max_children;
+  BT_INT_Node ** children     = nodes->data;
+  uint8_t **     keys         = min_keys->data;
+
+  size_t first = 0;
+  for(size_t p = 0; p < num_parents; p++) {
+    // spread the children evenly, so that none of the parents has too few
+    const size_t num_children = (n / num_parents) + ((p < (n % num_parents)) ? 1 : 0);
+
+    BT_INT_Node * parent = allocate_node(this, false);
+    if(parent == NULL) return STAT_ERR_ALLOC;
+    if(!STAT_is_OK(DAR_push_back(o_parents, &parent))) {
+      free(parent);
+      return STAT_ERR_ALLOC;
+    }
+    if(!STAT_is_OK(DAR_push_back(o_parent_min_keys, &keys[first]))) return STAT_ERR_ALLOC;
+
+    memcpy(get_children(this, parent), &children[first], num_children * sizeof(BT_INT_Node *));
+    for(size_t c = 1; c < num_children; c++) {
+      memcpy(key_at(this, parent, c - 1), keys[first + c], this->key_size);
+    }
+    parent->num_keys = (uint32_t)(num_children - 1);
+
+    first += num_children;
+  }
+
+  return OK;
+}
+
+STAT_Val BT_load_sorted(BT_Map * this, SPN_Span keys, SPN_Span values) {
+  if(!BT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(!BT_is_empty(this)) return LOG_STAT(STAT_ERR_USAGE, "map is not empty");
+  if(keys.element_size != this->key_size || values.element_size != this->value_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "element sizes don't match map");
+  }
+  if(keys.len != values.len) return LOG_STAT(STAT_ERR_ARGS, "keys and values differ in length");
+  if(keys.len > 0 && (keys.begin == NULL || (values.begin == NULL && this->value_size > 0))) {
+    return LOG_STAT(STAT_ERR_ARGS, "keys or values is NULL");
+  }
+  for(size_t i = 1; i < keys.len; i++) {
+    if(compare_keys(this, SPN_get(keys, i - 1), SPN_get(keys, i)) >= 0) {
+      return LOG_STAT(STAT_ERR_ARGS, "keys not strictly ascending at %zu", i);
+    }
+  }
+  if(keys.len == 0) return OK;
+
+  // the levels are built bottom-up, keeping track of the nodes of the current level and the least
+  // key in each of their subtrees
+  DAR_DArray levels[2][2] = {0}; // [level parity][nodes, min keys]
+  for(size_t i = 0; i < 2; i++) {
+    if(!STAT_is_OK(DAR_create(&levels[i][0], sizeof(BT_INT_Node *))) ||
+       !STAT_is_OK(DAR_create(&levels[i][1], sizeof(uint8_t *)))) {
+      for(size_t j = 0; j <= i; j++) {
+        DAR_destroy(&levels[j][0]);
+        DAR_destroy(&levels[j][1]);
+      }
+      return LOG_STAT(STAT_ERR_ALLOC, "failed to create level arrays");
+    }
+  }
+
+  STAT_Val     stat       = OK;
+  const size_t n          = keys.len;
+  const size_t num_leaves = (n + (this->leaf_capacity - 1)) / this->leaf_capacity;
+
+  BT_INT_Node * first_leaf = NULL;
+  BT_INT_Node * prev_leaf  = NULL;
+  size_t        first      = 0;
+  for(size_t l = 0; l < num_leaves && STAT_is_OK(stat); l++) {
+    const size_t  num_entries = (n / num_leaves) + ((l < (n % num_leaves)) ? 1 : 0);
+    BT_INT_Node * leaf        = allocate_node(this, true);
+    if(leaf == NULL || !STAT_is_OK(DAR_push_back(&levels[0][0], &leaf))) {
+      free(leaf);
+      stat = STAT_ERR_ALLOC;
+      break;
+    }
+
+    memcpy(key_at(this, leaf, 0), SPN_get(keys, first), num_entries * this->key_size);
+    if(this->value_size > 0) {
+      memcpy(value_at(this, leaf, 0), SPN_get(values, first), num_entries * this->value_size);
+    }
+    leaf->num_keys = (uint32_t)num_entries;
+
+    const uint8_t * min_key = key_at(this, leaf, 0);
+    stat                    = DAR_push_back(&levels[0][1], &min_key);
+
+    if(prev_leaf != NULL) prev_leaf->next = leaf;
+    if(first_leaf == NULL) first_leaf = leaf;
+    prev_leaf = leaf;
+    first += num_entries;
+  }
+
+  size_t level  = 0;
+  size_t height = 1;
+  while(STAT_is_OK(stat) && levels[level][0].size > 1) {
+    DAR_clear(&levels[1 - level][0]);
+    DAR_clear(&levels[1 - level][1]);
+    stat = build_parent_level(this,
+                              &levels[level][0],
+                              &levels[level][1],
+                              &levels[1 - level][0],
+                              &levels[1 - level][1]);
+    if(!STAT_is_OK(stat)) {
+      // the new parents don't own their children yet, free them on their own
+      for(size_t i = 0; i < levels[1 - level][0].size; i++) {
+        free(*(BT_INT_Node **)DAR_get(&levels[1 - level][0], i));
+      }
+      DAR_clear(&levels[1 - level][0]);
+      break;
+    }
+    level = 1 - level;
+    height++;
+  }
+
+  if(STAT_is_OK(stat)) {
+    free(this->root);
+    this->root       = *(BT_INT_Node **)DAR_first(&levels[level][0]);
+    this->first_leaf = first_leaf;
+    this->height = height;
+    this->size   = n;
+  } else {
+    // the current level owns everything built so far
+    for(size_t i = 0; i < levels[level][0].size; i++) {
+      free_nodes(this, *(BT_INT_Node **)DAR_get(&levels[level][0], i), NULL);
+    }
+  }
+
+  for(size_t i = 0; i < 2; i++) {
+    DAR_destroy(&levels[i][0]);
+    DAR_destroy(&levels[i][1]);
+  }
+
+  return STAT_is_OK(stat) ? OK : LOG_STAT(stat, "failed to build tree");
+}
+
+bool BT_contains(const BT_Map * this, const void * key) { return BT_get(this, key) != NULL; }
+
+void * BT_INT_get_nonconst(BT_Map * this, const void * key) {
+  return (void *)BT_INT_get_const(this, key);
+}
+
+const void * BT_INT_get_const(const BT_Map * this, const void * key) {
+  if(!BT_is_initialized(this) || key == NULL) return NULL;
+
+  const BT_INT_Node * leaf = find_leaf(this, key);
+  const size_t        idx  = search_node(this, leaf, key, false);
+  if(idx == leaf->num_keys || compare_keys(this, key_at(this, leaf, idx), key) != 0) return NULL;
+
+  return value_at(this, leaf, idx);
+}
+
+BT_Iterator BT_begin(const BT_Map * this) {
+  if(!BT_is_initialized(this)) return (BT_Iterator){0};
+  return make_iterator(this, this->first_leaf, 0);
+}
+
+BT_Iterator BT_lower_bound(const BT_Map * this, const void * key) {
+  if(!BT_is_initialized(this) || key == NULL) return (BT_Iterator){0};
+  const BT_INT_Node * leaf = find_leaf(this, key);
+  return make_iterator(this, leaf, search_node(this, leaf, key, false));
+}
+
+BT_Iterator BT_upper_bound(const BT_Map * this, const void * key) {
+  if(!BT_is_initialized(this) || key == NULL) return (BT_Iterator){0};
+  const BT_INT_Node * leaf = find_leaf(this, key);
+  return make_iterator(this, leaf, search_node(this, leaf, key, true));
+}
+
+void BT_next(BT_Iterator * it) {
+  it->idx++;
+  if(it->idx >= it->leaf->num_keys) {
+    it->leaf = it->leaf->next;
+    it->idx  = 0;
+  }
+}
+
+STAT_Val BT_scan_range(const BT_Map * this,
+                       const void *   first,
+                       const void *   last,
+                       BT_VisitFn     fn,
+                       void *         ctx) {
+  if(!BT_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(first == NULL || last == NULL) return LOG_STAT(STAT_ERR_ARGS, "first or last is NULL");
+  if(fn == NULL) return LOG_STAT(STAT_ERR_ARGS, "fn is NULL");
+
+  for(BT_Iterator it = BT_lower_bound(this, first); !BT_is_end(it); BT_next(&it)) {
+    if(compare_keys(this, BT_get_key(it), last) >= 0) break;
+    if(!fn(BT_get_key(it), BT_get_value(it), ctx)) return STAT_OK_FINISHED;
+  }
+
+  return OK;
+}
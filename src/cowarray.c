@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "cowarray.h"
+
+#include "log.h"
+
+#define OK STAT_OK
+
+static STAT_Val allocate(COW_Array * this);
+static void     release(COW_Array * this);
+
+STAT_Val COW_create(COW_Array * this, size_t element_size) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "element_size can't be 0");
+
+  if(!STAT_is_OK(allocate(this))) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate block");
+
+  if(!STAT_is_OK(DAR_create(RC_get(this->ref), element_size))) {
+    RC_release(this->ref);
+    *this = (COW_Array){0};
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create array");
+  }
+
+  return OK;
+}
+
+STAT_Val COW_create_from_span(COW_Array * this, SPN_Span span) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  if(!STAT_is_OK(allocate(this))) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate block");
+
+  if(!STAT_is_OK(DAR_create_from_span(RC_get(this->ref), span))) {
+    RC_release(this->ref);
+    *this = (COW_Array){0};
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create array from span");
+  }
+
+  return OK;
+}
+
+STAT_Val COW_copy(COW_Array * this, const COW_Array * src) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(!COW_is_initialized(src)) return LOG_STAT(STAT_ERR_ARGS, "src is NULL or uninitialized");
+
+  // take the new reference before dropping the old one, so copying an array into itself is safe
+  const RC_Ref ref = RC_copy(src->ref);
+  if(COW_is_initialized(this)) release(this);
+  this->ref = ref;
+
+  return OK;
+}
+
+STAT_Val COW_destroy(COW_Array * this) {
+  if(this == NULL || this->ref.block == NULL) return OK;
+
+  release(this);
+
+  return OK;
+}
+
+const DAR_DArray * COW_get(const COW_Array * this) {
+  if(!COW_is_initialized(this)) return NULL;
+  return RC_get(RC_as_const(this->ref));
+}
+
+STAT_Val COW_get_mut(COW_Array * this, DAR_DArray ** o_arr) {
+  if(!COW_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is NULL or uninitialized");
+  if(o_arr == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_arr is NULL");
+
+  if(COW_is_shared(this)) {
+    COW_Array unshared = {0};
+
+    if(!STAT_is_OK(allocate(&unshared))) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate");
+
+    if(!STAT_is_OK(DAR_create_from(RC_get(unshared.ref), COW_get(this)))) {
+      RC_release(unshared.ref);
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to copy shared array");
+    }
+
+    release(this); // others still hold a reference, so this only drops ours
+    *this = unshared;
+  }
+
+  *o_arr = RC_get(this->ref);
+
+  return OK;
+}
+
+static STAT_Val allocate(COW_Array * this) {
+  *this = (COW_Array){.ref = RC_allocate(sizeof(DAR_DArray))};
+  if(this->ref.block == NULL) return STAT_ERR_ALLOC;
+
+  *(DAR_DArray *)RC_get(this->ref) = (DAR_DArray){0};
+
+  return OK;
+}
+
+static void release(COW_Array * this) {
+  // the block doesn't know it holds an array, so the last one out destroys it
+  if(RC_get_ref_count(this->ref) == 1) DAR_destroy(RC_get(this->ref));
+
+  RC_release(this->ref);
+  *this = (COW_Array){0};
+}
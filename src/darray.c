@@ -17,12 +17,22 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#define _GNU_SOURCE // for mremap
+
 #include "darray.h"
 
 #include <stdlib.h>
 #include <string.h>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "log.h"
 
@@ -32,11 +42,26 @@
 #define MAX_CAPACITY_IN_BYTES          SIZE_MAX
 #define MIN_CAPACITY_IN_BYTE_GUIDELINE 32 /* NOTE actual capacity may go slightly below */
 #define MIN_CAPACITY_IN_ELEMENTS       8
+#define SIMD_BLOCK_SIZE_IN_BYTES       16
+
+struct DAR_INT_Mapping {
+  int    fd;
+  bool   is_read_only;
+  size_t length_in_bytes; // length of the mapping, which may differ from the capacity in bytes
+};
 
 static STAT_Val grow_capacity_as_needed(DAR_DArray * this, size_t num_elements_to_fit);
 static STAT_Val set_capacity(DAR_DArray * this, size_t new_capacity);
 static size_t   get_min_capacity(size_t element_size);
 static size_t   get_max_capacity(size_t element_size);
+static void *   realloc_aligned(DAR_DArray * this, size_t new_capacity_in_bytes);
+static STAT_Val set_capacity_mapped(DAR_DArray * this, size_t new_capacity);
+static STAT_Val close_mapping(DAR_DArray * this);
+static void     move_elements(DAR_DArray * this, size_t dst_idx, size_t src_idx, size_t n);
+static bool     overlaps(const DAR_DArray * this, SPN_Span span);
+static bool     is_read_only(const DAR_DArray * this);
+static STAT_Val check_range_source(const DAR_DArray * this, SPN_Span span);
+static STAT_Val splice_range(DAR_DArray * this, size_t first, size_t last, SPN_Span span);
 
 STAT_Val DAR_create(DAR_DArray * this, size_t element_size) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this arg is NULL");
@@ -51,11 +76,31 @@ STAT_Val DAR_create(DAR_DArray * this, size_t element_size) {
                          "failed to set capacity for newly create array");
 }
 
+STAT_Val DAR_create_aligned(DAR_DArray * this, size_t element_size, size_t alignment) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this arg is NULL");
+  if(element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "element_size can't be 0");
+  if(alignment == 0 || (alignment & (alignment - 1)) != 0) {
+    return LOG_STAT(STAT_ERR_ARGS, "alignment %zu is not a power of two", alignment);
+  }
+
+  *this = (DAR_DArray){0};
+
+  this->size         = 0;
+  this->element_size = element_size;
+  this->alignment    = alignment;
+
+  return LOG_STAT_IF_ERR(set_capacity(this, get_min_capacity(element_size)),
+                         "failed to set capacity for newly create array");
+}
+
 STAT_Val DAR_create_from(DAR_DArray * this, const DAR_DArray * src) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
   if(src == NULL) return LOG_STAT(STAT_ERR_ARGS, "src is NULL");
 
-  if(!STAT_is_OK(DAR_create(this, src->element_size))) {
+  const STAT_Val create_stat = (src->alignment != 0)
+                                   ? DAR_create_aligned(this, src->element_size, src->alignment)
+                                   : DAR_create(this, src->element_size);
+  if(!STAT_is_OK(create_stat)) {
     return LOG_STAT(STAT_ERR_INTERNAL, "failed to create new array");
   }
 
@@ -83,17 +128,101 @@ STAT_Val DAR_create_from_cstr(DAR_DArray * this, const char * str) {
   return OK;
 }
 
+STAT_Val DAR_open_mapped(DAR_DArray * this, const char * path, size_t element_size, int flags) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(path == NULL) return LOG_STAT(STAT_ERR_ARGS, "path is NULL");
+  if(element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "element_size can't be 0");
+
+  const bool is_read_only = ((flags & DAR_MAP_READ_WRITE) == 0);
+  const bool do_create    = ((flags & DAR_MAP_CREATE) != 0);
+  if(is_read_only && do_create) return LOG_STAT(STAT_ERR_ARGS, "can't create a read-only file");
+
+  *this = (DAR_DArray){0};
+
+  const int fd = open(path, ((is_read_only ? O_RDONLY : O_RDWR) | (do_create ? O_CREAT : 0)), 0644);
+  if(fd < 0) {
+    return LOG_STAT(STAT_ERR_IO,
+                    "failed to open '%s', errno: %d (\'%s\')",
+                    path,
+                    errno,
+                    strerror(errno));
+  }
+
+  struct stat file_stat = {0};
+  if(fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return LOG_STAT(STAT_ERR_IO, "failed to stat '%s', errno: %d", path, errno);
+  }
+
+  const size_t file_size_in_bytes = (size_t)file_stat.st_size;
+  if((file_size_in_bytes % element_size) != 0) {
+    close(fd);
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "size of '%s' (%zu) is not a multiple of element size %zu",
+                    path,
+                    file_size_in_bytes,
+                    element_size);
+  }
+
+  this->mapping = malloc(sizeof(DAR_INT_Mapping));
+  if(this->mapping == NULL) {
+    close(fd);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate mapping");
+  }
+  *this->mapping = (DAR_INT_Mapping){.fd = fd, .is_read_only = is_read_only};
+
+  this->element_size = element_size;
+  this->size         = file_size_in_bytes / element_size;
+
+  // writable arrays start out with at least the usual minimum capacity, so they grow as usual
+  const size_t min_capacity = is_read_only ? 0 : get_min_capacity(element_size);
+  const size_t capacity     = (this->size > min_capacity) ? this->size : min_capacity;
+
+  if(!STAT_is_OK(set_capacity_mapped(this, capacity))) {
+    close(fd);
+    free(this->mapping);
+    *this = (DAR_DArray){0};
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to map '%s'", path);
+  }
+
+  return OK;
+}
+
+STAT_Val DAR_sync_mapped(DAR_DArray * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(this->mapping == NULL) return LOG_STAT(STAT_ERR_USAGE, "array is not mapped");
+
+  if(this->mapping->is_read_only) return OK;
+
+  if(!STAT_is_OK(set_capacity(this, this->size))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to trim file to %zu elements", this->size);
+  }
+
+  if(this->size > 0 && msync(this->data, DAR_get_size_in_bytes(this), MS_SYNC) != 0) {
+    return LOG_STAT(STAT_ERR_IO, "failed to sync mapping, errno: %d", errno);
+  }
+
+  return OK;
+}
+
 STAT_Val DAR_destroy(DAR_DArray * this) {
   if(this == NULL) return OK;
 
-  free(this->data);
+  STAT_Val stat = OK;
+
+  if(this->mapping != NULL) {
+    stat = LOG_STAT_IF_ERR(close_mapping(this), "failed to close mapping");
+  } else {
+    free(this->data);
+  }
   *this = (DAR_DArray){0};
 
-  return OK;
+  return stat;
 }
 
 STAT_Val DAR_push_back(DAR_DArray * this, const void * element) {
   if(this == NULL || element == NULL) return LOG_STAT(STAT_ERR_ARGS, "this or element is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(this->size == MAX_SIZE) return LOG_STAT(STAT_ERR_FULL, "DAR_Array at maximum size");
 
   const size_t new_size = this->size + 1;
@@ -111,6 +240,7 @@ STAT_Val DAR_push_back(DAR_DArray * this, const void * element) {
 
 STAT_Val DAR_pop_back(DAR_DArray * this) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(this->size == 0) return LOG_STAT(STAT_ERR_EMPTY, "no element to pop");
 
   this->size--;
@@ -120,6 +250,7 @@ STAT_Val DAR_pop_back(DAR_DArray * this) {
 
 STAT_Val DAR_shrink_to_fit(DAR_DArray * this) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(this->size == this->capacity) return OK;
 
   const size_t min_capacity = get_min_capacity(this->element_size);
@@ -132,6 +263,7 @@ STAT_Val DAR_shrink_to_fit(DAR_DArray * this) {
 
 STAT_Val DAR_resize(DAR_DArray * this, size_t new_size) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
 
   if(!STAT_is_OK(grow_capacity_as_needed(this, new_size))) {
     return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow capacity for resize");
@@ -143,6 +275,7 @@ STAT_Val DAR_resize(DAR_DArray * this, size_t new_size) {
 
 STAT_Val DAR_resize_zeroed(DAR_DArray * this, size_t new_size) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
 
   const size_t old_size = this->size;
 
@@ -160,6 +293,7 @@ STAT_Val DAR_resize_zeroed(DAR_DArray * this, size_t new_size) {
 
 STAT_Val DAR_resize_with_value(DAR_DArray * this, size_t new_size, const void * value) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(value == NULL) return LOG_STAT(STAT_ERR_ARGS, "value is NULL");
 
   const size_t old_size = this->size;
@@ -177,6 +311,7 @@ STAT_Val DAR_resize_with_value(DAR_DArray * this, size_t new_size, const void *
 
 STAT_Val DAR_reserve(DAR_DArray * this, size_t num_elements) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
 
   if(!STAT_is_OK(grow_capacity_as_needed(this, num_elements))) {
     return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow capacity for reserve");
@@ -193,9 +328,14 @@ size_t DAR_get_size_in_bytes(const DAR_DArray * this) {
   if(this == NULL) return 0;
   return this->size * this->element_size;
 }
+size_t DAR_get_alignment(const DAR_DArray * this) {
+  if(this == NULL) return 0;
+  return (this->alignment != 0) ? this->alignment : _Alignof(max_align_t);
+}
 
 STAT_Val DAR_clear(DAR_DArray * this) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
 
   if(!STAT_is_OK(DAR_resize(this, 0))) {
     return LOG_STAT(STAT_ERR_INTERNAL, "failed to resize for clear");
@@ -206,6 +346,7 @@ STAT_Val DAR_clear(DAR_DArray * this) {
 
 STAT_Val DAR_clear_and_shrink(DAR_DArray * this) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
 
   if(!STAT_is_OK(DAR_clear(this))) return LOG_STAT(STAT_ERR_INTERNAL, "failed to clear");
   if(!STAT_is_OK(DAR_shrink_to_fit(this))) return LOG_STAT(STAT_ERR_INTERNAL, "failed to shrink");
@@ -241,6 +382,7 @@ STAT_Val DAR_INT_get_checked_const(const DAR_DArray * this, size_t idx, const vo
 
 STAT_Val DAR_set_checked(DAR_DArray * this, size_t idx, const void * value) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(value == NULL) return LOG_STAT(STAT_ERR_ARGS, "value is NULL");
 
   if(idx >= this->size) {
@@ -254,6 +396,7 @@ STAT_Val DAR_set_checked(DAR_DArray * this, size_t idx, const void * value) {
 
 STAT_Val DAR_push_back_array(DAR_DArray * this, const void * arr, size_t n) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(arr == NULL) return LOG_STAT(STAT_ERR_ARGS, "arr is NULL");
 
   if(n == 0) return OK;
@@ -271,6 +414,7 @@ STAT_Val DAR_push_back_array(DAR_DArray * this, const void * arr, size_t n) {
 
 STAT_Val DAR_push_back_span(DAR_DArray * this, SPN_Span span) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(this->element_size != span.element_size) {
     return LOG_STAT(STAT_ERR_ARGS,
                     "element size mismatch (%zu != %zu)",
@@ -285,6 +429,7 @@ STAT_Val DAR_push_back_span(DAR_DArray * this, SPN_Span span) {
 
 STAT_Val DAR_push_back_darray(DAR_DArray * this, const DAR_DArray * other) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(other == NULL) return LOG_STAT(STAT_ERR_ARGS, "other is NULL");
 
   return DAR_push_back_span(this, DAR_to_span(other));
@@ -292,6 +437,7 @@ STAT_Val DAR_push_back_darray(DAR_DArray * this, const DAR_DArray * other) {
 
 STAT_Val DAR_delete(DAR_DArray * this, size_t idx) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(idx >= this->size) {
     return LOG_STAT(STAT_ERR_RANGE, "idx %zu out of range (size=%zu)", idx, this->size);
   }
@@ -303,6 +449,7 @@ STAT_Val DAR_delete(DAR_DArray * this, size_t idx) {
 
 STAT_Val DAR_order_preserving_delete(DAR_DArray * this, size_t idx) {
   if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
   if(idx >= this->size) {
     return LOG_STAT(STAT_ERR_RANGE, "idx %zu out of range (size=%zu)", idx, this->size);
   }
@@ -318,6 +465,291 @@ STAT_Val DAR_order_preserving_delete(DAR_DArray * this, size_t idx) {
   return LOG_STAT_IF_ERR(DAR_resize(this, (this->size - 1)), "failed to reduce arr size by 1");
 }
 
+STAT_Val DAR_insert_span(DAR_DArray * this, size_t idx, SPN_Span span) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(idx > this->size) {
+    return LOG_STAT(STAT_ERR_RANGE, "idx %zu out of range (size=%zu)", idx, this->size);
+  }
+  if(!STAT_is_OK(check_range_source(this, span))) return LOG_STAT(STAT_ERR_ARGS, "invalid span");
+
+  return LOG_STAT_IF_ERR(splice_range(this, idx, idx, span),
+                         "failed to insert %zu elements at %zu",
+                         span.len,
+                         idx);
+}
+
+STAT_Val DAR_erase_range(DAR_DArray * this, size_t first, size_t last) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(first > last || last > this->size) {
+    return LOG_STAT(STAT_ERR_RANGE,
+                    "range [%zu, %zu) out of range (size=%zu)",
+                    first,
+                    last,
+                    this->size);
+  }
+
+  const SPN_Span nothing = {.begin = NULL, .len = 0, .element_size = this->element_size};
+
+  return LOG_STAT_IF_ERR(splice_range(this, first, last, nothing),
+                         "failed to erase range [%zu, %zu)",
+                         first,
+                         last);
+}
+
+STAT_Val DAR_replace_range(DAR_DArray * this, size_t first, size_t last, SPN_Span span) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(first > last || last > this->size) {
+    return LOG_STAT(STAT_ERR_RANGE,
+                    "range [%zu, %zu) out of range (size=%zu)",
+                    first,
+                    last,
+                    this->size);
+  }
+  if(!STAT_is_OK(check_range_source(this, span))) return LOG_STAT(STAT_ERR_ARGS, "invalid span");
+
+  return LOG_STAT_IF_ERR(splice_range(this, first, last, span),
+                         "failed to replace range [%zu, %zu) with %zu elements",
+                         first,
+                         last,
+                         span.len);
+}
+
+STAT_Val DAR_remove_if(DAR_DArray * this, SPN_PredicateFn pred, void * ctx) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(pred == NULL) return LOG_STAT(STAT_ERR_ARGS, "pred is NULL");
+
+  // kept elements are moved down a run at a time, so each one is moved at most once and
+  // consecutive kept elements share a single memmove
+  size_t write_idx = 0;
+  size_t run_begin = 0;
+
+  for(size_t read_idx = 0; read_idx < this->size; read_idx++) {
+    if(!pred(DAR_get(this, read_idx), ctx)) continue;
+
+    move_elements(this, write_idx, run_begin, (read_idx - run_begin));
+    write_idx += (read_idx - run_begin);
+    run_begin = read_idx + 1;
+  }
+
+  move_elements(this, write_idx, run_begin, (this->size - run_begin));
+  write_idx += (this->size - run_begin);
+
+  return LOG_STAT_IF_ERR(DAR_resize(this, write_idx), "failed to resize to %zu", write_idx);
+}
+
+STAT_Val DAR_filter_into(DAR_DArray * dst, SPN_Span src, SPN_PredicateFn pred, void * ctx) {
+  if(dst == NULL) return LOG_STAT(STAT_ERR_ARGS, "dst is NULL");
+  if(is_read_only(dst)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(pred == NULL) return LOG_STAT(STAT_ERR_ARGS, "pred is NULL");
+  if(dst->element_size != src.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "element size mismatch (%zu != %zu)",
+                    dst->element_size,
+                    src.element_size);
+  }
+
+  if(src.len == 0) return OK;
+
+  if(src.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "src has invalid data pointer");
+  if(overlaps(dst, src)) return LOG_STAT(STAT_ERR_ARGS, "src can't point into dst");
+
+  size_t run_begin = 0;
+
+  for(size_t idx = 0; idx <= src.len; idx++) {
+    if((idx < src.len) && pred(SPN_get(src, idx), ctx)) continue;
+
+    if(idx > run_begin) {
+      if(!STAT_is_OK(DAR_push_back_array(dst, SPN_get(src, run_begin), (idx - run_begin)))) {
+        return LOG_STAT(STAT_ERR_INTERNAL, "failed to push back %zu elements", (idx - run_begin));
+      }
+    }
+    run_begin = idx + 1;
+  }
+
+  return OK;
+}
+
+#if defined(__SSE2__)
+// Compacts one block of elements that was loaded from read_idx, given a mask (as produced by
+// _mm_movemask_epi8) in which the bytes of all elements that are to be removed are set.
+static inline void compact_block(uint8_t * data,
+                                 size_t    element_size,
+                                 size_t *  io_write_idx,
+                                 size_t    read_idx,
+                                 __m128i   block,
+                                 unsigned  mask) {
+  const size_t elements_per_block = SIMD_BLOCK_SIZE_IN_BYTES / element_size;
+
+  if(mask == 0) {
+    // nothing removed, store the whole block (if it moved at all)
+    if(*io_write_idx != read_idx) {
+      _mm_storeu_si128((__m128i *)&data[*io_write_idx * element_size], block);
+    }
+    *io_write_idx += elements_per_block;
+  } else if(mask != 0xffff) {
+    uint8_t block_bytes[SIMD_BLOCK_SIZE_IN_BYTES];
+    _mm_storeu_si128((__m128i *)block_bytes, block);
+
+    for(size_t i = 0; i < elements_per_block; i++) {
+      if((mask & (1u << (i * element_size))) != 0) continue;
+
+      memcpy(&data[*io_write_idx * element_size], &block_bytes[i * element_size], element_size);
+      (*io_write_idx)++;
+    }
+  }
+}
+
+static inline __m128i broadcast_element(const void * value, size_t element_size) {
+  switch(element_size) {
+  case 1: return _mm_set1_epi8(*(const int8_t *)value);
+  case 2: {
+    int16_t v = 0;
+    memcpy(&v, value, sizeof(v));
+    return _mm_set1_epi16(v);
+  }
+  case 4: {
+    int32_t v = 0;
+    memcpy(&v, value, sizeof(v));
+    return _mm_set1_epi32(v);
+  }
+  default: {
+    int64_t v = 0;
+    memcpy(&v, value, sizeof(v));
+    return _mm_set1_epi64x(v);
+  }
+  }
+}
+
+static inline __m128i compare_equal(__m128i lhs, __m128i rhs, size_t element_size) {
+  switch(element_size) {
+  case 1: return _mm_cmpeq_epi8(lhs, rhs);
+  case 2: return _mm_cmpeq_epi16(lhs, rhs);
+  case 4: return _mm_cmpeq_epi32(lhs, rhs);
+  default: {
+    // SSE2 has no 64-bit compare, so combine the results for both 32-bit halves
+    const __m128i halves = _mm_cmpeq_epi32(lhs, rhs);
+    return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+  }
+  }
+}
+
+// Signed 64-bit lhs < rhs. SSE2 only compares 32-bit halves, signed, so the low halves get their
+// sign bit flipped to compare them unsigned. The result is set where the high halves are less, or
+// where they are equal and the low halves are less.
+static inline __m128i compare_less_i64(__m128i lhs, __m128i rhs) {
+  const __m128i low_bias   = _mm_set_epi32(0, INT32_MIN, 0, INT32_MIN);
+  const __m128i lhs_biased = _mm_xor_si128(lhs, low_bias);
+  const __m128i rhs_biased = _mm_xor_si128(rhs, low_bias);
+  const __m128i less       = _mm_cmplt_epi32(lhs_biased, rhs_biased);
+  const __m128i equal      = _mm_cmpeq_epi32(lhs, rhs);
+
+  const __m128i low_less   = _mm_shuffle_epi32(less, _MM_SHUFFLE(2, 2, 0, 0));
+  const __m128i high_less  = _mm_shuffle_epi32(less, _MM_SHUFFLE(3, 3, 1, 1));
+  const __m128i high_equal = _mm_shuffle_epi32(equal, _MM_SHUFFLE(3, 3, 1, 1));
+  return _mm_or_si128(high_less, _mm_and_si128(high_equal, low_less));
+}
+#endif
+
+STAT_Val DAR_remove_equal(DAR_DArray * this, const void * value) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(value == NULL) return LOG_STAT(STAT_ERR_ARGS, "value is NULL");
+
+  uint8_t *    data         = this->data;
+  const size_t element_size = this->element_size;
+  size_t       read_idx     = 0;
+  size_t       write_idx    = 0;
+
+#if defined(__SSE2__)
+  if(element_size == 1 || element_size == 2 || element_size == 4 || element_size == 8) {
+    const __m128i value_vec          = broadcast_element(value, element_size);
+    const size_t  elements_per_block = SIMD_BLOCK_SIZE_IN_BYTES / element_size;
+
+    for(; (read_idx + elements_per_block) <= this->size; read_idx += elements_per_block) {
+      const __m128i  block = _mm_loadu_si128((const __m128i *)&data[read_idx * element_size]);
+      const unsigned mask =
+          (unsigned)_mm_movemask_epi8(compare_equal(block, value_vec, element_size));
+      compact_block(data, element_size, &write_idx, read_idx, block, mask);
+    }
+  }
+#endif
+
+  for(; read_idx < this->size; read_idx++) {
+    if(memcmp(&data[read_idx * element_size], value, element_size) == 0) continue;
+
+    if(write_idx != read_idx) {
+      memcpy(&data[write_idx * element_size], &data[read_idx * element_size], element_size);
+    }
+    write_idx++;
+  }
+
+  return LOG_STAT_IF_ERR(DAR_resize(this, write_idx), "failed to resize to %zu", write_idx);
+}
+
+STAT_Val DAR_remove_less_i32(DAR_DArray * this, int32_t threshold) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(this->element_size != sizeof(int32_t)) {
+    return LOG_STAT(STAT_ERR_ARGS, "element size %zu is not that of int32_t", this->element_size);
+  }
+
+  int32_t * data      = this->data;
+  size_t    read_idx  = 0;
+  size_t    write_idx = 0;
+
+#if defined(__SSE2__)
+  const __m128i threshold_vec      = _mm_set1_epi32(threshold);
+  const size_t  elements_per_block = SIMD_BLOCK_SIZE_IN_BYTES / sizeof(int32_t);
+
+  for(; (read_idx + elements_per_block) <= this->size; read_idx += elements_per_block) {
+    const __m128i  block = _mm_loadu_si128((const __m128i *)&data[read_idx]);
+    const unsigned mask  = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi32(block, threshold_vec));
+    compact_block(this->data, sizeof(int32_t), &write_idx, read_idx, block, mask);
+  }
+#endif
+
+  for(; read_idx < this->size; read_idx++) {
+    if(data[read_idx] < threshold) continue;
+    data[write_idx++] = data[read_idx];
+  }
+
+  return LOG_STAT_IF_ERR(DAR_resize(this, write_idx), "failed to resize to %zu", write_idx);
+}
+
+STAT_Val DAR_remove_less_i64(DAR_DArray * this, int64_t threshold) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(is_read_only(this)) return LOG_STAT(STAT_ERR_USAGE, "can't modify read-only mapped array");
+  if(this->element_size != sizeof(int64_t)) {
+    return LOG_STAT(STAT_ERR_ARGS, "element size %zu is not that of int64_t", this->element_size);
+  }
+
+  int64_t * data      = this->data;
+  size_t    read_idx  = 0;
+  size_t    write_idx = 0;
+
+#if defined(__SSE2__)
+  const __m128i threshold_vec      = _mm_set1_epi64x(threshold);
+  const size_t  elements_per_block = SIMD_BLOCK_SIZE_IN_BYTES / sizeof(int64_t);
+
+  for(; (read_idx + elements_per_block) <= this->size; read_idx += elements_per_block) {
+    const __m128i  block = _mm_loadu_si128((const __m128i *)&data[read_idx]);
+    const unsigned mask  = (unsigned)_mm_movemask_epi8(compare_less_i64(block, threshold_vec));
+    compact_block(this->data, sizeof(int64_t), &write_idx, read_idx, block, mask);
+  }
+#endif
+
+  for(; read_idx < this->size; read_idx++) {
+    if(data[read_idx] < threshold) continue;
+    data[write_idx++] = data[read_idx];
+  }
+
+  return LOG_STAT_IF_ERR(DAR_resize(this, write_idx), "failed to resize to %zu", write_idx);
+}
+
 bool DAR_equals(const DAR_DArray * lhs, const DAR_DArray * rhs) {
   if(lhs == NULL || rhs == NULL) return false;
   if(lhs->element_size != rhs->element_size) return false;
@@ -356,7 +788,9 @@ STAT_Val DAR_create_from_span(DAR_DArray * this, SPN_Span span) {
 static STAT_Val grow_capacity_as_needed(DAR_DArray * this, size_t num_elements_to_fit) {
   if(this->capacity >= num_elements_to_fit) return OK;
 
-  size_t new_capacity = this->capacity;
+  // capacity can be 0 for mapped arrays that were trimmed to an empty file
+  size_t new_capacity =
+      (this->capacity > 0) ? this->capacity : get_min_capacity(this->element_size);
 
   if(num_elements_to_fit > (MAX_SIZE / 2)) {
     new_capacity = MAX_SIZE;
@@ -394,9 +828,13 @@ static STAT_Val set_capacity(DAR_DArray * this, size_t new_capacity) {
                     get_max_capacity(this->element_size));
   }
 
+  if(this->mapping != NULL) return set_capacity_mapped(this, new_capacity);
+
   const size_t new_capacity_in_bytes = new_capacity * this->element_size;
 
-  void * new_data = realloc(this->data, new_capacity_in_bytes);
+  void * new_data = (this->alignment > _Alignof(max_align_t))
+                        ? realloc_aligned(this, new_capacity_in_bytes)
+                        : realloc(this->data, new_capacity_in_bytes);
   if(new_data == NULL) {
     return LOG_STAT(STAT_ERR_ALLOC,
                     "failed to reallocate for growing capacity to size %zu, errno: %d (\'%s\')",
@@ -410,3 +848,194 @@ static STAT_Val set_capacity(DAR_DArray * this, size_t new_capacity) {
 
   return OK;
 }
+
+static STAT_Val check_range_source(const DAR_DArray * this, SPN_Span span) {
+  if(this->element_size != span.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "element size mismatch (%zu != %zu)",
+                    this->element_size,
+                    span.element_size);
+  }
+  if(span.len == 0) return OK;
+  if(span.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "span has invalid data pointer");
+
+  if(overlaps(this, span)) {
+    // a span into this array is fine, as long as it lines up with its elements
+    const uintptr_t offset = (uintptr_t)span.begin - (uintptr_t)this->data;
+    if((uintptr_t)span.begin < (uintptr_t)this->data || (offset % this->element_size) != 0 ||
+       ((offset / this->element_size) + span.len) > this->size) {
+      return LOG_STAT(STAT_ERR_ARGS, "span partially overlaps array or its unused capacity");
+    }
+  }
+
+  return OK;
+}
+
+static STAT_Val splice_range(DAR_DArray * this, size_t first, size_t last, SPN_Span span) {
+  const size_t element_size = this->element_size;
+  const size_t num_removed  = last - first;
+  const size_t num_kept     = this->size - num_removed;
+
+  if(span.len > (MAX_SIZE - num_kept)) return LOG_STAT(STAT_ERR_FULL, "DAR_Array at maximum size");
+
+  const size_t new_size = num_kept + span.len;
+
+  // if span points into this array, the reallocation and the move of the tail below may move the
+  // elements it refers to, so we keep track of them by index instead
+  const bool   is_aliased = ((span.len > 0) && overlaps(this, span));
+  const size_t src_idx =
+      is_aliased ? (((uintptr_t)span.begin - (uintptr_t)this->data) / element_size) : 0;
+  uint8_t * tmp = NULL;
+
+  if(is_aliased && (num_removed > 0) && (src_idx < last) && ((src_idx + span.len) > first)) {
+    // the source overlaps the elements being replaced, so set it aside before they get overwritten
+    tmp = malloc(span.len * element_size);
+    if(tmp == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate for overlapping source");
+    memcpy(tmp, span.begin, (span.len * element_size));
+  }
+
+  if(!STAT_is_OK(grow_capacity_as_needed(this, new_size))) {
+    free(tmp);
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow capacity to fit %zu elements", new_size);
+  }
+
+  move_elements(this, (first + span.len), last, (this->size - last));
+
+  if(tmp != NULL) {
+    memcpy(DAR_get(this, first), tmp, (span.len * element_size));
+    free(tmp);
+  } else if(is_aliased) {
+    // source elements before first stayed where they were, those after last moved with the tail
+    const size_t num_before_first =
+        (src_idx >= first) ? 0 : (((first - src_idx) < span.len) ? (first - src_idx) : span.len);
+
+    memcpy(DAR_get(this, first), DAR_get(this, src_idx), (num_before_first * element_size));
+
+    if(num_before_first < span.len) {
+      const size_t moved_src_idx = ((src_idx + num_before_first) - num_removed) + span.len;
+      memcpy(DAR_get(this, (first + num_before_first)),
+             DAR_get(this, moved_src_idx),
+             ((span.len - num_before_first) * element_size));
+    }
+  } else if(span.len > 0) {
+    memcpy(DAR_get(this, first), span.begin, (span.len * element_size));
+  }
+
+  this->size = new_size;
+
+  return OK;
+}
+
+static void * realloc_aligned(DAR_DArray * this, size_t new_capacity_in_bytes) {
+  // there is no aligned realloc, so we allocate anew and copy over what is in use
+  const size_t alignment = this->alignment;
+  if(new_capacity_in_bytes > (SIZE_MAX - (alignment - 1))) return NULL;
+
+  const size_t padded_size_in_bytes =
+      ((new_capacity_in_bytes + (alignment - 1)) / alignment) * alignment;
+
+  void * new_data = aligned_alloc(alignment, padded_size_in_bytes);
+  if(new_data == NULL) return NULL;
+
+  if(this->data != NULL) {
+    const size_t size_in_bytes = DAR_get_size_in_bytes(this);
+    memcpy(new_data,
+           this->data,
+           (size_in_bytes < new_capacity_in_bytes) ? size_in_bytes : new_capacity_in_bytes);
+    free(this->data);
+  }
+
+  return new_data;
+}
+
+static STAT_Val set_capacity_mapped(DAR_DArray * this, size_t new_capacity) {
+  DAR_INT_Mapping * mapping = this->mapping;
+
+  if(mapping->is_read_only && this->data != NULL) {
+    return LOG_STAT(STAT_ERR_USAGE, "can't change capacity of read-only mapped array");
+  }
+
+  const size_t new_capacity_in_bytes = new_capacity * this->element_size;
+  const int    prot                  = mapping->is_read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+
+  // a mapping can't be empty, so map at least a byte (that is never accessed for empty arrays)
+  const size_t new_length_in_bytes = (new_capacity_in_bytes > 0) ? new_capacity_in_bytes : 1;
+  const bool   is_growing          = (new_length_in_bytes > mapping->length_in_bytes);
+
+  // the file has to cover the mapping before the mapping grows, and may shrink only after it did
+  if(!mapping->is_read_only && is_growing && ftruncate(mapping->fd, new_capacity_in_bytes) != 0) {
+    return LOG_STAT(STAT_ERR_IO, "failed to extend file to %zu bytes", new_capacity_in_bytes);
+  }
+
+  void * new_data = MAP_FAILED;
+  if(this->data == NULL) {
+    new_data = mmap(NULL, new_length_in_bytes, prot, MAP_SHARED, mapping->fd, 0);
+  } else {
+#if defined(__linux__)
+    new_data = mremap(this->data, mapping->length_in_bytes, new_length_in_bytes, MREMAP_MAYMOVE);
+#else
+    // keep the old mapping until the new one is in place, so the array stays valid on failure
+    new_data = mmap(NULL, new_length_in_bytes, prot, MAP_SHARED, mapping->fd, 0);
+    if(new_data != MAP_FAILED) munmap(this->data, mapping->length_in_bytes);
+#endif
+  }
+
+  if(new_data == MAP_FAILED) {
+    return LOG_STAT(STAT_ERR_ALLOC,
+                    "failed to map %zu bytes, errno: %d (\'%s\')",
+                    new_length_in_bytes,
+                    errno,
+                    strerror(errno));
+  }
+
+  this->data               = new_data;
+  this->capacity           = new_capacity;
+  mapping->length_in_bytes = new_length_in_bytes;
+
+  if(!mapping->is_read_only && !is_growing && ftruncate(mapping->fd, new_capacity_in_bytes) != 0) {
+    return LOG_STAT(STAT_ERR_IO, "failed to shrink file to %zu bytes", new_capacity_in_bytes);
+  }
+
+  return OK;
+}
+
+static STAT_Val close_mapping(DAR_DArray * this) {
+  DAR_INT_Mapping * mapping = this->mapping;
+  STAT_Val          stat    = OK;
+
+  if(this->data != NULL && munmap(this->data, mapping->length_in_bytes) != 0) {
+    stat = LOG_STAT(STAT_ERR_IO, "failed to unmap, errno: %d", errno);
+  }
+
+  // drop the unused capacity, so the file holds exactly the array's elements
+  if(!mapping->is_read_only && ftruncate(mapping->fd, DAR_get_size_in_bytes(this)) != 0) {
+    stat = LOG_STAT(STAT_ERR_IO, "failed to trim file, errno: %d", errno);
+  }
+
+  if(close(mapping->fd) != 0) {
+    stat = LOG_STAT(STAT_ERR_IO, "failed to close file, errno: %d", errno);
+  }
+
+  free(mapping);
+  this->mapping = NULL;
+
+  return stat;
+}
+
+static void move_elements(DAR_DArray * this, size_t dst_idx, size_t src_idx, size_t n) {
+  if(n == 0 || dst_idx == src_idx) return;
+  memmove(DAR_get(this, dst_idx), DAR_get(this, src_idx), (n * this->element_size));
+}
+
+static bool overlaps(const DAR_DArray * this, SPN_Span span) {
+  const uintptr_t this_begin = (uintptr_t)this->data;
+  const uintptr_t this_end   = this_begin + (this->capacity * this->element_size);
+  const uintptr_t span_begin = (uintptr_t)span.begin;
+  const uintptr_t span_end   = span_begin + (span.len * span.element_size);
+
+  return (span_begin < this_end) && (this_begin < span_end);
+}
+
+static bool is_read_only(const DAR_DArray * this) {
+  return (this->mapping != NULL) && this->mapping->is_read_only;
+}
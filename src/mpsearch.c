@@ -0,0 +1,425 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "mpsearch.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "log.h"
+#include "span_sort.h"
+
+#define OK STAT_OK
+
+#define ROOT_STATE  0
+#define NO_PATTERN  UINT32_MAX
+#define OUTPUT_FLAG (UINT32_C(1) << 31) // set on transitions into states in which patterns end
+#define STATE_MASK  (~OUTPUT_FLAG)
+
+// ===================
+// == match results ==
+
+typedef struct {
+  DAR_DArray * matches; // NULL if we only want the first
+  MPS_Match    first;
+  bool         has_match;
+  bool         has_failed;
+} Results;
+
+// Returns whether to keep searching.
+static inline bool add_match(Results * results, MPS_Match match) {
+  if(results->matches == NULL) {
+    results->first     = match;
+    results->has_match = true;
+    return false;
+  }
+  if(!STAT_is_OK(DAR_push_back(results->matches, &match))) {
+    results->has_failed = true;
+    return false;
+  }
+  return true;
+}
+
+static int compare_matches(const void * lhs_ptr, const void * rhs_ptr) {
+  const MPS_Match * lhs = lhs_ptr;
+  const MPS_Match * rhs = rhs_ptr;
+
+  if(lhs->end != rhs->end) return (lhs->end < rhs->end) ? -1 : 1;
+  if(lhs->begin != rhs->begin) return (lhs->begin < rhs->begin) ? -1 : 1;
+  return (lhs->pattern_idx > rhs->pattern_idx) - (lhs->pattern_idx < rhs->pattern_idx);
+}
+
+static inline const MPS_INT_Pattern * get_pattern(const MPS_Matcher * this, size_t idx) {
+  return DAR_get(&this->patterns, idx);
+}
+
+static inline const uint8_t * get_pattern_bytes(const MPS_Matcher * this, size_t idx) {
+  return DAR_get(&this->pattern_bytes, get_pattern(this, idx)->offset);
+}
+
+// ============
+// == filter ==
+
+// Candidates for each pattern are the positions where both its first and last byte match, which
+// the vector kernels find a block at a time, as span.c does when searching for a single needle.
+// The kernels are in mpsearch_kernels.h, compiled for each instruction set with a target
+// attribute; we use the ones for the instruction set span.c picked when the library was loaded.
+
+#if defined(__x86_64__)
+#define HAS_X86_KERNELS
+#endif
+
+// Checks for pattern at pos, which is known to fit in the haystack.
+static inline bool add_if_match(const MPS_Matcher * this,
+                                const uint8_t *     haystack,
+                                size_t              pos,
+                                size_t              pattern_idx,
+                                Results *           results) {
+  const size_t len = get_pattern(this, pattern_idx)->len;
+  if(memcmp(&haystack[pos], get_pattern_bytes(this, pattern_idx), len) != 0) return true;
+
+  const MPS_Match match = {.pattern_idx = pattern_idx, .begin = pos, .end = pos + len};
+
+  // candidates are found by where they begin rather than end, so keep the best one so far
+  if(results->matches == NULL) {
+    if(!results->has_match || compare_matches(&match, &results->first) < 0) {
+      results->first     = match;
+      results->has_match = true;
+    }
+    return true;
+  }
+
+  return add_match(results, match);
+}
+
+#define KERNEL(name) name##_scalar
+#define KERNEL_TARGET
+#include "mpsearch_kernels.h"
+
+#if defined(HAS_X86_KERNELS)
+#define KERNEL(name)         name##_sse2
+#define KERNEL_TARGET        __attribute__((target("sse2")))
+#define VECTOR_SIZE_IN_BYTES 16
+#include "mpsearch_kernels.h"
+
+#define KERNEL(name)         name##_avx2
+#define KERNEL_TARGET        __attribute__((target("avx2")))
+#define VECTOR_SIZE_IN_BYTES 32
+#include "mpsearch_kernels.h"
+#endif
+
+typedef void (*FilterFn)(const MPS_Matcher * this, SPN_Span haystack, Results * results);
+
+static const FilterFn filters_by_level[] = {
+    [SPN_INT_SIMD_NONE] = find_with_filter_scalar,
+#if defined(HAS_X86_KERNELS)
+    [SPN_INT_SIMD_SSE2]  = find_with_filter_sse2,
+    [SPN_INT_SIMD_SSSE3] = find_with_filter_sse2,
+    [SPN_INT_SIMD_AVX2]  = find_with_filter_avx2,
+#endif
+};
+
+static void find_with_filter(const MPS_Matcher * this, SPN_Span haystack, Results * results) {
+  filters_by_level[SPN_INT_get_simd_level()](this, haystack, results);
+}
+
+// ===============
+// == automaton ==
+
+static inline uint32_t * get_transitions(MPS_Matcher * this, uint32_t state) {
+  return DAR_get(&this->transitions, (size_t)state * this->num_classes);
+}
+
+static inline MPS_INT_State * get_state(MPS_Matcher * this, uint32_t state) {
+  return DAR_get(&this->states, state);
+}
+
+static STAT_Val add_state(MPS_Matcher * this, uint32_t * o_state) {
+  const MPS_INT_State state = {.pattern = NO_PATTERN};
+
+  if(this->states.size >= STATE_MASK) return STAT_ERR_RANGE;
+  *o_state = (uint32_t)this->states.size;
+
+  if(!STAT_is_OK(DAR_push_back(&this->states, &state))) return STAT_ERR_ALLOC;
+  return DAR_resize_zeroed(&this->transitions, this->states.size * this->num_classes);
+}
+
+// Puts all patterns in a trie, in which 0 means there is no transition (no trie edge leads to the
+// root).
+static STAT_Val build_trie(MPS_Matcher * this) {
+  bool is_used[UINT8_MAX + 1] = {0};
+  for(size_t i = 0; i < this->pattern_bytes.size; i++) {
+    is_used[*(const uint8_t *)DAR_get(&this->pattern_bytes, i)] = true;
+  }
+
+  // class 0 is for all unused bytes
+  this->num_classes = 1;
+  for(size_t b = 0; b <= UINT8_MAX; b++) {
+    this->byte_classes[b] = is_used[b] ? (uint8_t)this->num_classes++ : 0;
+  }
+
+  uint32_t root = 0;
+  STAT_Val stat = add_state(this, &root);
+  if(!STAT_is_OK(stat)) return stat;
+
+  for(size_t p = 0; p < this->patterns.size; p++) {
+    const uint8_t * bytes = get_pattern_bytes(this, p);
+    const size_t    len   = get_pattern(this, p)->len;
+
+    uint32_t state = ROOT_STATE;
+    for(size_t i = 0; i < len; i++) {
+      const uint8_t cls  = this->byte_classes[bytes[i]];
+      uint32_t      next = get_transitions(this, state)[cls];
+      if(next == ROOT_STATE) {
+        stat = add_state(this, &next);
+        if(!STAT_is_OK(stat)) return stat;
+        get_transitions(this, state)[cls] = next;
+      }
+      state = next;
+    }
+
+    // equal patterns are chained in order of their index
+    uint32_t * next_duplicate = DAR_get(&this->next_duplicate, p);
+    *next_duplicate           = NO_PATTERN;
+
+    MPS_INT_State * end_state = get_state(this, state);
+    if(end_state->pattern == NO_PATTERN) {
+      end_state->pattern = (uint32_t)p;
+    } else {
+      uint32_t last = end_state->pattern;
+      while(*(uint32_t *)DAR_get(&this->next_duplicate, last) != NO_PATTERN) {
+        last = *(uint32_t *)DAR_get(&this->next_duplicate, last);
+      }
+      *(uint32_t *)DAR_get(&this->next_duplicate, last) = (uint32_t)p;
+    }
+  }
+
+  return OK;
+}
+
+// Turns the trie into a DFA: going through the states breadth-first, each state's fail state
+// (being shallower) is complete by the time we get to it, so each missing transition is that of
+// the fail state.
+static STAT_Val build_automaton(MPS_Matcher * this) {
+  STAT_Val stat = build_trie(this);
+  if(!STAT_is_OK(stat)) return stat;
+
+  DAR_DArray queue = {0};
+  if(!STAT_is_OK(DAR_create(&queue, sizeof(uint32_t)))) return STAT_ERR_ALLOC;
+  if(!STAT_is_OK(DAR_reserve(&queue, this->states.size))) {
+    DAR_destroy(&queue);
+    return STAT_ERR_ALLOC;
+  }
+
+  // children of the root fail to the root, and missing transitions out of the root stay there
+  const uint32_t * root_transitions = get_transitions(this, ROOT_STATE);
+  for(size_t c = 0; c < this->num_classes; c++) {
+    if(root_transitions[c] != ROOT_STATE) DAR_push_back(&queue, &root_transitions[c]);
+  }
+
+  for(size_t q = 0; q < queue.size; q++) {
+    const uint32_t   state            = *(const uint32_t *)DAR_get(&queue, q);
+    const uint32_t   fail             = get_state(this, state)->fail;
+    uint32_t *       transitions      = get_transitions(this, state);
+    const uint32_t * fail_transitions = get_transitions(this, fail);
+
+    for(size_t c = 0; c < this->num_classes; c++) {
+      const uint32_t child = transitions[c];
+      if(child == ROOT_STATE) {
+        transitions[c] = fail_transitions[c];
+        continue;
+      }
+
+      MPS_INT_State *       child_state = get_state(this, child);
+      const MPS_INT_State * child_fail  = get_state(this, fail_transitions[c]);
+      child_state->fail                 = fail_transitions[c];
+      child_state->output_link          = (child_fail->pattern != NO_PATTERN)
+                                              ? child_state->fail
+                                              : child_fail->output_link;
+      DAR_push_back(&queue, &child); // can't fail, we reserved room for all states
+    }
+  }
+
+  DAR_destroy(&queue);
+
+  // mark transitions into states with output, so that searching only looks at states for those
+  uint32_t * all_transitions = this->transitions.data;
+  for(size_t i = 0; i < this->transitions.size; i++) {
+    const MPS_INT_State * target = get_state(this, all_transitions[i]);
+    if(target->pattern != NO_PATTERN || target->output_link != ROOT_STATE) {
+      all_transitions[i] |= OUTPUT_FLAG;
+    }
+  }
+
+  return OK;
+}
+
+// Reports all matches ending at end, which reached state.
+static bool add_outputs(const MPS_Matcher * this, uint32_t state, size_t end, Results * results) {
+  const MPS_INT_State * states = this->states.data;
+  const uint32_t *      dups   = this->next_duplicate.data;
+
+  if(states[state].pattern == NO_PATTERN) state = states[state].output_link;
+
+  for(; state != ROOT_STATE; state = states[state].output_link) {
+    for(uint32_t p = states[state].pattern; p != NO_PATTERN; p = dups[p]) {
+      const MPS_Match match = {.pattern_idx = p,
+                               .begin       = end - get_pattern(this, p)->len,
+                               .end         = end};
+      if(!add_match(results, match)) return false;
+    }
+  }
+
+  return true;
+}
+
+static void find_with_automaton(const MPS_Matcher * this, SPN_Span haystack, Results * results) {
+  const uint8_t *  bytes       = haystack.begin;
+  const uint32_t * transitions = this->transitions.data;
+  const size_t     num_classes = this->num_classes;
+  const uint8_t *  classes     = this->byte_classes;
+
+  uint32_t state = ROOT_STATE;
+  for(size_t i = 0; i < haystack.len; i++) {
+    const uint32_t next = transitions[((size_t)state * num_classes) + classes[bytes[i]]];
+    state               = next & STATE_MASK;
+    if((next & OUTPUT_FLAG) != 0 && !add_outputs(this, state, i + 1, results)) return;
+  }
+}
+
+// ============================
+// == public implementations ==
+
+STAT_Val MPS_create(MPS_Matcher * this, SPN_Span patterns) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(patterns.element_size != sizeof(SPN_Span) || (patterns.begin == NULL && patterns.len > 0)) {
+    return LOG_STAT(STAT_ERR_ARGS, "patterns is not a valid span of SPN_Span");
+  }
+  if(patterns.len >= NO_PATTERN) return LOG_STAT(STAT_ERR_ARGS, "too many patterns");
+  for(size_t i = 0; i < patterns.len; i++) {
+    const SPN_Span * pattern = SPN_get(patterns, i);
+    if(pattern->element_size != 1 || pattern->len == 0 || pattern->begin == NULL) {
+      return LOG_STAT(STAT_ERR_ARGS, "pattern %zu is not a non-empty span of bytes", i);
+    }
+  }
+
+  *this = (MPS_Matcher){.use_automaton = (patterns.len > MPS_FILTER_MAX_PATTERNS)};
+
+  STAT_Val stat = OK;
+  if(!STAT_is_OK(stat = DAR_create(&this->pattern_bytes, sizeof(uint8_t))) ||
+     !STAT_is_OK(stat = DAR_create(&this->patterns, sizeof(MPS_INT_Pattern))) ||
+     !STAT_is_OK(stat = DAR_create(&this->transitions, sizeof(uint32_t))) ||
+     !STAT_is_OK(stat = DAR_create(&this->states, sizeof(MPS_INT_State))) ||
+     !STAT_is_OK(stat = DAR_create(&this->next_duplicate, sizeof(uint32_t)))) {
+    MPS_destroy(this);
+    return LOG_STAT(stat, "failed to create arrays");
+  }
+
+  for(size_t i = 0; i < patterns.len && STAT_is_OK(stat); i++) {
+    const SPN_Span *      pattern = SPN_get(patterns, i);
+    const MPS_INT_Pattern entry   = {.offset = this->pattern_bytes.size, .len = pattern->len};
+    stat                          = DAR_push_back_span(&this->pattern_bytes, *pattern);
+    if(STAT_is_OK(stat)) stat = DAR_push_back(&this->patterns, &entry);
+  }
+  if(STAT_is_OK(stat) && this->use_automaton) {
+    stat = DAR_resize(&this->next_duplicate, patterns.len);
+    if(STAT_is_OK(stat)) stat = build_automaton(this);
+  }
+
+  if(!STAT_is_OK(stat)) {
+    MPS_destroy(this);
+    return LOG_STAT(stat, "failed to compile patterns");
+  }
+
+  return OK;
+}
+
+STAT_Val MPS_destroy(MPS_Matcher * this) {
+  if(this == NULL) return OK;
+
+  DAR_destroy(&this->pattern_bytes);
+  DAR_destroy(&this->patterns);
+  DAR_destroy(&this->transitions);
+  DAR_destroy(&this->states);
+  DAR_destroy(&this->next_duplicate);
+
+  *this = (MPS_Matcher){0};
+
+  return OK;
+}
+
+static STAT_Val check_find_args(const MPS_Matcher * this, SPN_Span haystack) {
+  if(this == NULL || !DAR_is_initialized(&this->patterns)) {
+    return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  }
+  if(haystack.element_size != 1 || (haystack.begin == NULL && haystack.len > 0)) {
+    return LOG_STAT(STAT_ERR_ARGS, "haystack is not a valid span of bytes");
+  }
+  return OK;
+}
+
+STAT_Val MPS_find_first(const MPS_Matcher * this, SPN_Span haystack, MPS_Match * o_match) {
+  const STAT_Val stat = check_find_args(this, haystack);
+  if(!STAT_is_OK(stat)) return stat;
+
+  Results results = {0};
+  if(this->use_automaton) {
+    find_with_automaton(this, haystack, &results);
+  } else {
+    find_with_filter(this, haystack, &results);
+  }
+
+  if(!results.has_match) return STAT_OK_NOT_FOUND;
+
+  if(o_match != NULL) *o_match = results.first;
+  return OK;
+}
+
+STAT_Val MPS_find_all(const MPS_Matcher * this, SPN_Span haystack, DAR_DArray * o_matches) {
+  const STAT_Val stat = check_find_args(this, haystack);
+  if(!STAT_is_OK(stat)) return stat;
+  if(o_matches == NULL || o_matches->element_size != sizeof(MPS_Match)) {
+    return LOG_STAT(STAT_ERR_ARGS, "o_matches is not an array of MPS_Match");
+  }
+
+  const size_t first_new = o_matches->size;
+  Results      results   = {.matches = o_matches};
+
+  if(this->use_automaton) {
+    find_with_automaton(this, haystack, &results);
+  } else {
+    find_with_filter(this, haystack, &results);
+
+    // the filter finds matches by where they begin, put them in the order of the automaton
+    const SPN_MutSpan new_matches = {.begin        = DAR_get(o_matches, first_new),
+                                     .len          = o_matches->size - first_new,
+                                     .element_size = sizeof(MPS_Match)};
+    if(!results.has_failed && new_matches.len > 1) SPN_sort(new_matches, compare_matches);
+  }
+
+  if(results.has_failed) {
+    DAR_resize(o_matches, first_new); // rather than leave only some of the matches
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to add match");
+  }
+
+  return OK;
+}
@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Filter kernel for mpsearch.c, which includes this file once per instruction set, the same way
+// span.c includes span_kernels.h. Before each include, mpsearch.c defines KERNEL(name),
+// KERNEL_TARGET and, for the vector kernels, VECTOR_SIZE_IN_BYTES. All of these are undefined
+// again at the end of this file.
+
+#define find_with_filter KERNEL(find_with_filter)
+
+#include "span_vectors.h"
+
+// Finds all matches, ordered by where they begin (per block of positions).
+KERNEL_TARGET static void find_with_filter(const MPS_Matcher * this,
+                                           SPN_Span            haystack,
+                                           Results *           results) {
+  const uint8_t * bytes        = haystack.begin;
+  const size_t    len          = haystack.len;
+  const size_t    num_patterns = this->patterns.size;
+  size_t          pos          = 0;
+
+#if defined(VECTOR_SIZE_IN_BYTES)
+  Vector first_bytes[MPS_FILTER_MAX_PATTERNS];
+  Vector last_bytes[MPS_FILTER_MAX_PATTERNS];
+  size_t max_len = 0;
+  for(size_t p = 0; p < num_patterns; p++) {
+    const size_t    pattern_len   = get_pattern(this, p)->len;
+    const uint8_t * pattern_bytes = get_pattern_bytes(this, p);
+    first_bytes[p]                = broadcast_element(pattern_bytes[0], 1);
+    last_bytes[p]                 = broadcast_element(pattern_bytes[pattern_len - 1], 1);
+    if(pattern_len > max_len) max_len = pattern_len;
+  }
+
+  // every pattern fits at every position of the block
+  for(; (pos + VECTOR_SIZE_IN_BYTES + max_len - 1) <= len; pos += VECTOR_SIZE_IN_BYTES) {
+    if(results->has_match && results->matches == NULL && pos >= results->first.end) return;
+
+    for(size_t p = 0; p < num_patterns; p++) {
+      const size_t last_offset = get_pattern(this, p)->len - 1;
+      uint32_t     candidates  = get_match_mask(&bytes[pos], first_bytes[p], 1) &
+                            get_match_mask(&bytes[pos + last_offset], last_bytes[p], 1);
+      while(candidates != 0) {
+        const size_t candidate = pos + (size_t)__builtin_ctz(candidates);
+        if(!add_if_match(this, bytes, candidate, p, results)) return;
+        candidates &= (candidates - 1);
+      }
+    }
+  }
+#endif
+
+  for(; pos < len; pos++) {
+    if(results->has_match && results->matches == NULL && pos >= results->first.end) return;
+
+    for(size_t p = 0; p < num_patterns; p++) {
+      const MPS_INT_Pattern * pattern = get_pattern(this, p);
+      if(pattern->len > (len - pos) || bytes[pos] != get_pattern_bytes(this, p)[0]) continue;
+      if(!add_if_match(this, bytes, pos, p, results)) return;
+    }
+  }
+}
+
+#undef Vector
+#undef broadcast_element
+#undef get_match_mask
+#undef find_with_filter
+
+#undef KERNEL
+#undef KERNEL_TARGET
+#undef VECTOR_SIZE_IN_BYTES
@@ -0,0 +1,383 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "pqueue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define INVALID_POSITION SIZE_MAX
+
+static STAT_Val create_empty(PQ_Heap * this, size_t element_size, size_t arity, SPN_CompareFn cmp);
+static STAT_Val acquire_handle(PQ_Heap * this, size_t position, PQ_Handle * o_handle);
+static STAT_Val release_handle(PQ_Heap * this, PQ_Handle handle);
+static size_t   sift_up(PQ_Heap * this, size_t position);
+static size_t   sift_down(PQ_Heap * this, size_t position);
+static void     remove_at(PQ_Heap * this, size_t position);
+
+static inline uint8_t * get_element(PQ_Heap * this, size_t position) {
+  return &((uint8_t *)this->elements.data)[position * this->elements.element_size];
+}
+static inline PQ_Handle * get_handles(PQ_Heap * this) { return this->handles.data; }
+static inline size_t *    get_positions(PQ_Heap * this) { return this->positions.data; }
+
+// Moves the element (and its handle) at src to dst, leaving src as a hole.
+static inline void move_element(PQ_Heap * this, size_t dst, size_t src) {
+  memcpy(get_element(this, dst), get_element(this, src), this->elements.element_size);
+
+  const PQ_Handle handle      = get_handles(this)[src];
+  get_handles(this)[dst]      = handle;
+  get_positions(this)[handle] = dst;
+}
+
+// Places the element in tmp (with handle) at position.
+static inline void place_tmp(PQ_Heap * this, size_t position, PQ_Handle handle) {
+  memcpy(get_element(this, position), this->tmp, this->elements.element_size);
+  get_handles(this)[position] = handle;
+  get_positions(this)[handle] = position;
+}
+
+STAT_Val PQ_create(PQ_Heap * this, size_t element_size, size_t arity, SPN_CompareFn cmp) {
+  return LOG_STAT_IF_ERR(create_empty(this, element_size, arity, cmp), "failed to create heap");
+}
+
+STAT_Val PQ_create_from_span(PQ_Heap * this, SPN_Span span, size_t arity, SPN_CompareFn cmp) {
+  if(span.len > 0 && span.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "span is NULL");
+
+  if(!STAT_is_OK(create_empty(this, span.element_size, arity, cmp))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create heap");
+  }
+
+  if(!STAT_is_OK(DAR_push_back_span(&this->elements, span)) ||
+     !STAT_is_OK(DAR_resize(&this->handles, span.len)) ||
+     !STAT_is_OK(DAR_resize(&this->positions, span.len))) {
+    PQ_destroy(this);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate for %zu elements", span.len);
+  }
+
+  for(size_t i = 0; i < span.len; i++) {
+    get_handles(this)[i]   = i;
+    get_positions(this)[i] = i;
+  }
+
+  // sift down every node that has children, starting at the last one
+  if(span.len > 1) {
+    for(size_t pos = ((span.len - 2) / this->arity) + 1; pos-- > 0;) sift_down(this, pos);
+  }
+
+  return OK;
+}
+
+STAT_Val PQ_destroy(PQ_Heap * this) {
+  if(this == NULL) return OK;
+
+  STAT_Val stat = OK;
+  if(!STAT_is_OK(DAR_destroy(&this->elements)) || !STAT_is_OK(DAR_destroy(&this->handles)) ||
+     !STAT_is_OK(DAR_destroy(&this->positions)) || !STAT_is_OK(DAR_destroy(&this->free_handles))) {
+    stat = LOG_STAT(STAT_ERR_INTERNAL, "failed to destroy heap arrays");
+  }
+  free(this->tmp);
+
+  *this = (PQ_Heap){0};
+
+  return stat;
+}
+
+STAT_Val PQ_push(PQ_Heap * this, const void * element, PQ_Handle * o_handle) {
+  if(!PQ_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+
+  const size_t position = this->elements.size;
+
+  PQ_Handle handle = 0;
+  if(!STAT_is_OK(DAR_push_back(&this->elements, element))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to push element");
+  }
+  if(!STAT_is_OK(DAR_push_back(&this->handles, &(PQ_Handle){0})) ||
+     !STAT_is_OK(acquire_handle(this, position, &handle))) {
+    DAR_resize(&this->elements, position);
+    DAR_resize(&this->handles, position);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to get handle");
+  }
+
+  sift_up(this, position);
+
+  if(o_handle != NULL) *o_handle = handle;
+
+  return OK;
+}
+
+STAT_Val PQ_pop(PQ_Heap * this, void * o_element) {
+  if(!PQ_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(PQ_is_empty(this)) return LOG_STAT(STAT_ERR_EMPTY, "heap is empty");
+
+  if(o_element != NULL) memcpy(o_element, get_element(this, 0), this->elements.element_size);
+
+  remove_at(this, 0);
+
+  return OK;
+}
+
+STAT_Val PQ_replace_top(PQ_Heap * this, const void * element) {
+  if(!PQ_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+  if(PQ_is_empty(this)) return LOG_STAT(STAT_ERR_EMPTY, "heap is empty");
+
+  memcpy(get_element(this, 0), element, this->elements.element_size);
+  sift_down(this, 0);
+
+  return OK;
+}
+
+STAT_Val PQ_update(PQ_Heap * this, PQ_Handle handle, const void * element) {
+  if(!PQ_is_valid_handle(this, handle)) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid handle %zu", handle);
+  }
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+
+  const size_t position = get_positions(this)[handle];
+
+  memcpy(get_element(this, position), element, this->elements.element_size);
+  sift_down(this, sift_up(this, position));
+
+  return OK;
+}
+
+STAT_Val PQ_remove(PQ_Heap * this, PQ_Handle handle, void * o_element) {
+  if(!PQ_is_valid_handle(this, handle)) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid handle %zu", handle);
+  }
+
+  const size_t position = get_positions(this)[handle];
+
+  if(o_element != NULL) {
+    memcpy(o_element, get_element(this, position), this->elements.element_size);
+  }
+
+  remove_at(this, position);
+
+  return OK;
+}
+
+STAT_Val PQ_clear(PQ_Heap * this) {
+  if(!PQ_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  if(!STAT_is_OK(DAR_clear(&this->elements)) || !STAT_is_OK(DAR_clear(&this->handles)) ||
+     !STAT_is_OK(DAR_clear(&this->positions)) || !STAT_is_OK(DAR_clear(&this->free_handles))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to clear heap arrays");
+  }
+
+  return OK;
+}
+
+bool PQ_is_valid_handle(const PQ_Heap * this, PQ_Handle handle) {
+  if(!PQ_is_initialized(this) || handle >= this->positions.size) return false;
+  return ((const size_t *)this->positions.data)[handle] != INVALID_POSITION;
+}
+
+const void * PQ_peek(const PQ_Heap * this) {
+  return PQ_is_empty(this) ? NULL : this->elements.data;
+}
+
+PQ_Handle PQ_peek_handle(const PQ_Heap * this) { return *(const PQ_Handle *)this->handles.data; }
+
+const void * PQ_get(const PQ_Heap * this, PQ_Handle handle) {
+  if(!PQ_is_valid_handle(this, handle)) return NULL;
+  return DAR_get(&this->elements, ((const size_t *)this->positions.data)[handle]);
+}
+
+STAT_Val PQ_top_k_create(PQ_TopK * this, size_t element_size, size_t k, SPN_CompareFn cmp) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(k == 0) return LOG_STAT(STAT_ERR_ARGS, "k can't be 0");
+
+  *this = (PQ_TopK){.k = k};
+
+  if(!STAT_is_OK(PQ_create(&this->heap, element_size, PQ_DEFAULT_ARITY, cmp))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create heap");
+  }
+
+  return OK;
+}
+
+STAT_Val PQ_top_k_destroy(PQ_TopK * this) {
+  if(this == NULL) return OK;
+  return LOG_STAT_IF_ERR(PQ_destroy(&this->heap), "failed to destroy heap");
+}
+
+STAT_Val PQ_top_k_push(PQ_TopK * this, const void * element) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+
+  if(PQ_get_size(&this->heap) < this->k) {
+    return LOG_STAT_IF_ERR(PQ_push(&this->heap, element, NULL), "failed to push element");
+  }
+
+  // only elements greater than the least of the ones we have can get in
+  if(this->heap.cmp(element, PQ_peek(&this->heap)) <= 0) return OK;
+
+  return LOG_STAT_IF_ERR(PQ_replace_top(&this->heap, element), "failed to replace top");
+}
+
+STAT_Val PQ_top_k_push_span(PQ_TopK * this, SPN_Span span) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(span.element_size != this->heap.elements.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "span has wrong element size");
+  }
+
+  for(size_t i = 0; i < span.len; i++) {
+    if(!STAT_is_OK(PQ_top_k_push(this, SPN_get(span, i)))) {
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to push element %zu", i);
+    }
+  }
+
+  return OK;
+}
+
+STAT_Val PQ_top_k_to_darray(const PQ_TopK * this, DAR_DArray * o_sorted) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(!DAR_is_initialized(o_sorted) ||
+     o_sorted->element_size != this->heap.elements.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "o_sorted must be an initialized array of the element type");
+  }
+
+  const size_t old_size = o_sorted->size;
+
+  if(!STAT_is_OK(DAR_push_back_darray(o_sorted, &this->heap.elements))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to append elements");
+  }
+
+  const SPN_MutSpan appended = {.begin        = DAR_get(o_sorted, old_size),
+                                .len          = o_sorted->size - old_size,
+                                .element_size = o_sorted->element_size};
+
+  return LOG_STAT_IF_ERR(SPN_sort(appended, this->heap.cmp), "failed to sort elements");
+}
+
+static STAT_Val create_empty(PQ_Heap * this, size_t element_size, size_t arity, SPN_CompareFn cmp) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "element_size can't be 0");
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+  if(arity == 1) return LOG_STAT(STAT_ERR_ARGS, "arity must be at least 2");
+
+  *this = (PQ_Heap){.cmp = cmp, .arity = (arity == 0) ? PQ_DEFAULT_ARITY : arity};
+
+  this->tmp = malloc(element_size);
+  if(this->tmp == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate scratch element");
+
+  if(!STAT_is_OK(DAR_create(&this->elements, element_size)) ||
+     !STAT_is_OK(DAR_create(&this->handles, sizeof(PQ_Handle))) ||
+     !STAT_is_OK(DAR_create(&this->positions, sizeof(size_t))) ||
+     !STAT_is_OK(DAR_create(&this->free_handles, sizeof(PQ_Handle)))) {
+    PQ_destroy(this);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to create heap arrays");
+  }
+
+  return OK;
+}
+
+static STAT_Val acquire_handle(PQ_Heap * this, size_t position, PQ_Handle * o_handle) {
+  if(!DAR_is_empty(&this->free_handles)) {
+    *o_handle = *(const PQ_Handle *)DAR_last(&this->free_handles);
+    DAR_pop_back(&this->free_handles);
+  } else {
+    *o_handle = this->positions.size;
+    if(!STAT_is_OK(DAR_push_back(&this->positions, &position))) return STAT_ERR_ALLOC;
+  }
+
+  get_handles(this)[position]    = *o_handle;
+  get_positions(this)[*o_handle] = position;
+
+  return OK;
+}
+
+static STAT_Val release_handle(PQ_Heap * this, PQ_Handle handle) {
+  get_positions(this)[handle] = INVALID_POSITION;
+  return DAR_push_back(&this->free_handles, &handle);
+}
+
+// Moves the element at position up until its parent is not greater. Returns its new position.
+static size_t sift_up(PQ_Heap * this, size_t position) {
+  const PQ_Handle handle = get_handles(this)[position];
+  memcpy(this->tmp, get_element(this, position), this->elements.element_size);
+
+  while(position > 0) {
+    const size_t parent = (position - 1) / this->arity;
+    if(this->cmp(this->tmp, get_element(this, parent)) >= 0) break;
+
+    move_element(this, position, parent);
+    position = parent;
+  }
+
+  place_tmp(this, position, handle);
+
+  return position;
+}
+
+// Moves the element at position down until none of its children are less. Returns its new
+// position.
+static size_t sift_down(PQ_Heap * this, size_t position) {
+  const size_t    n      = this->elements.size;
+  const size_t    d      = this->arity;
+  const PQ_Handle handle = get_handles(this)[position];
+  memcpy(this->tmp, get_element(this, position), this->elements.element_size);
+
+  while(true) {
+    const size_t first_child = (d * position) + 1;
+    if(first_child >= n) break;
+
+    const size_t end_child = ((n - first_child) > d) ? (first_child + d) : n;
+
+    size_t least = first_child;
+    for(size_t child = first_child + 1; child < end_child; child++) {
+      if(this->cmp(get_element(this, child), get_element(this, least)) < 0) least = child;
+    }
+
+    if(this->cmp(get_element(this, least), this->tmp) >= 0) break;
+
+    // the children of least are adjacent, and we are likely to look at them next
+    const size_t grandchild = (d * least) + 1;
+    if(grandchild < n) __builtin_prefetch(get_element(this, grandchild));
+
+    move_element(this, position, least);
+    position = least;
+  }
+
+  place_tmp(this, position, handle);
+
+  return position;
+}
+
+// Removes the element at position, filling the hole with the last element.
+static void remove_at(PQ_Heap * this, size_t position) {
+  const size_t last = this->elements.size - 1;
+
+  // releasing can only fail to keep the handle for reuse, which is no problem
+  release_handle(this, get_handles(this)[position]);
+
+  if(position != last) move_element(this, position, last);
+
+  DAR_pop_back(&this->elements);
+  DAR_pop_back(&this->handles);
+
+  if(position != last) sift_down(this, sift_up(this, position));
+}
@@ -0,0 +1,920 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "roaring.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define BITSET_NUM_WORDS (RBM_CONTAINER_NUM_VALUES / BIT_BITS_PER_WORD)
+#define BITSET_NUM_BYTES (BITSET_NUM_WORDS * sizeof(uint64_t))
+#define SERIALIZED_MAGIC 0x314d4252 // "RBM1"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t num_containers;
+} SerializedHeader;
+
+typedef struct {
+  uint16_t key;
+  uint16_t type;
+  uint32_t cardinality;
+  uint32_t num_items; // values, words or runs, depending on type
+} SerializedContainerHeader;
+
+static inline uint16_t get_key(uint32_t value) { return (uint16_t)(value >> 16); }
+static inline uint16_t get_low(uint32_t value) { return (uint16_t)(value & 0xffff); }
+
+static bool find_container(const RBM_Bitmap * this, uint16_t key, size_t * o_idx);
+
+static STAT_Val create_array_container(RBM_Container * c, uint16_t key);
+static STAT_Val copy_container(RBM_Container * dst, const RBM_Container * src);
+static void     destroy_container(RBM_Container * c);
+
+static bool     container_contains(const RBM_Container * c, uint16_t low);
+static STAT_Val container_add(RBM_Container * c, uint16_t low);
+static STAT_Val container_remove(RBM_Container * c, uint16_t low);
+static STAT_Val or_containers(RBM_Container *       dst,
+                              const RBM_Container * a,
+                              const RBM_Container * b);
+static STAT_Val and_containers(RBM_Container *       dst,
+                               const RBM_Container * a,
+                               const RBM_Container * b);
+
+static STAT_Val convert_to_bitset(RBM_Container * c);
+static STAT_Val convert_to_array(RBM_Container * c);
+static STAT_Val convert_to_runs(RBM_Container * c);
+static STAT_Val normalize(RBM_Container * c);
+static size_t   count_runs(const RBM_Container * c);
+static size_t   get_payload_size(const RBM_Container * c);
+
+static inline const uint16_t * get_values(const RBM_Container * c) { return c->array.data; }
+static inline const RBM_Run *  get_runs(const RBM_Container * c) { return c->runs.data; }
+static inline const uint64_t * get_words(const RBM_Container * c) {
+  return BIT_to_word_span(&c->bits).begin;
+}
+
+STAT_Val RBM_create(RBM_Bitmap * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  *this = (RBM_Bitmap){0};
+
+  return LOG_STAT_IF_ERR(DAR_create(&this->containers, sizeof(RBM_Container)),
+                         "failed to create containers array");
+}
+
+STAT_Val RBM_create_from(RBM_Bitmap * this, const RBM_Bitmap * src) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(!RBM_is_initialized(src)) return LOG_STAT(STAT_ERR_ARGS, "src is not initialized");
+
+  if(!STAT_is_OK(RBM_create(this))) return LOG_STAT(STAT_ERR_INTERNAL, "failed to create bitmap");
+
+  if(!STAT_is_OK(DAR_reserve(&this->containers, src->containers.size))) {
+    RBM_destroy(this);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to reserve space for containers");
+  }
+
+  for(size_t i = 0; i < src->containers.size; i++) {
+    RBM_Container c = {0};
+    if(!STAT_is_OK(copy_container(&c, DAR_get(&src->containers, i)))) {
+      RBM_destroy(this);
+      return LOG_STAT(STAT_ERR_ALLOC, "failed to copy container");
+    }
+    DAR_push_back(&this->containers, &c); // can't fail, as we reserved space
+  }
+
+  return OK;
+}
+
+STAT_Val RBM_destroy(RBM_Bitmap * this) {
+  if(this == NULL) return OK;
+
+  if(DAR_is_initialized(&this->containers)) RBM_clear(this);
+
+  if(!STAT_is_OK(DAR_destroy(&this->containers))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to destroy containers array");
+  }
+
+  return OK;
+}
+
+STAT_Val RBM_add(RBM_Bitmap * this, uint32_t value) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  size_t idx = 0;
+  if(!find_container(this, get_key(value), &idx)) {
+    RBM_Container c = {0};
+    if(!STAT_is_OK(create_array_container(&c, get_key(value)))) {
+      return LOG_STAT(STAT_ERR_ALLOC, "failed to create container");
+    }
+    const SPN_Span to_insert = {.begin = &c, .len = 1, .element_size = sizeof(RBM_Container)};
+    if(!STAT_is_OK(DAR_insert_span(&this->containers, idx, to_insert))) {
+      destroy_container(&c);
+      return LOG_STAT(STAT_ERR_ALLOC, "failed to insert container");
+    }
+  }
+
+  RBM_Container * c = DAR_get(&this->containers, idx);
+  if(!STAT_is_OK(container_add(c, get_low(value)))) {
+    if(c->cardinality == 0) {
+      destroy_container(c);
+      DAR_order_preserving_delete(&this->containers, idx);
+    }
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to add %u to container", value);
+  }
+
+  return OK;
+}
+
+STAT_Val RBM_remove(RBM_Bitmap * this, uint32_t value) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  size_t idx = 0;
+  if(!find_container(this, get_key(value), &idx)) return STAT_OK_NOT_FOUND;
+
+  RBM_Container * c = DAR_get(&this->containers, idx);
+
+  const STAT_Val stat = container_remove(c, get_low(value));
+  if(!STAT_is_OK(stat)) return LOG_STAT(stat, "failed to remove %u from container", value);
+
+  if(c->cardinality == 0) {
+    destroy_container(c);
+    DAR_order_preserving_delete(&this->containers, idx);
+  }
+
+  return stat;
+}
+
+STAT_Val RBM_clear(RBM_Bitmap * this) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  for(size_t i = 0; i < this->containers.size; i++) {
+    destroy_container(DAR_get(&this->containers, i));
+  }
+
+  return LOG_STAT_IF_ERR(DAR_clear(&this->containers), "failed to clear containers array");
+}
+
+// Containers that only this has are carried over into the result as they are, without copying.
+// Until the result replaces the containers of this, the result only owns the containers with keys
+// that other has as well, so we can back out on failure and leave this unchanged.
+STAT_Val RBM_or(RBM_Bitmap * this, const RBM_Bitmap * other) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(!RBM_is_initialized(other)) return LOG_STAT(STAT_ERR_ARGS, "other is not initialized");
+  if(this == other) return OK;
+
+  DAR_DArray result = {0};
+  if(!STAT_is_OK(DAR_create(&result, sizeof(RBM_Container))) ||
+     !STAT_is_OK(DAR_reserve(&result, this->containers.size + other->containers.size))) {
+    DAR_destroy(&result);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to create result array");
+  }
+
+  const RBM_Container * lhs     = this->containers.data;
+  const RBM_Container * rhs     = other->containers.data;
+  const size_t          lhs_len = this->containers.size;
+  const size_t          rhs_len = other->containers.size;
+
+  size_t   i    = 0;
+  size_t   j    = 0;
+  STAT_Val stat = OK;
+  while((i < lhs_len || j < rhs_len) && STAT_is_OK(stat)) {
+    RBM_Container c = {0};
+    if(j == rhs_len || (i < lhs_len && lhs[i].key < rhs[j].key)) {
+      c = lhs[i++];
+    } else if(i == lhs_len || rhs[j].key < lhs[i].key) {
+      stat = copy_container(&c, &rhs[j++]);
+    } else {
+      stat = or_containers(&c, &lhs[i++], &rhs[j++]);
+    }
+    if(STAT_is_OK(stat)) DAR_push_back(&result, &c); // can't fail, as we reserved space
+  }
+
+  // destroy the containers that were combined: in the result on failure, in this otherwise
+  DAR_DArray * to_clean_up = STAT_is_OK(stat) ? &this->containers : &result;
+  for(size_t idx = 0; idx < to_clean_up->size; idx++) {
+    RBM_Container * c = DAR_get(to_clean_up, idx);
+    if(find_container(other, c->key, &(size_t){0})) destroy_container(c);
+  }
+
+  if(!STAT_is_OK(stat)) {
+    DAR_destroy(&result);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to combine containers");
+  }
+
+  DAR_destroy(&this->containers);
+  this->containers = result;
+
+  return OK;
+}
+
+STAT_Val RBM_and(RBM_Bitmap * this, const RBM_Bitmap * other) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(!RBM_is_initialized(other)) return LOG_STAT(STAT_ERR_ARGS, "other is not initialized");
+  if(this == other) return OK;
+
+  DAR_DArray result = {0};
+  if(!STAT_is_OK(DAR_create(&result, sizeof(RBM_Container)))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to create result array");
+  }
+
+  const RBM_Container * lhs     = this->containers.data;
+  const RBM_Container * rhs     = other->containers.data;
+  const size_t          lhs_len = this->containers.size;
+  const size_t          rhs_len = other->containers.size;
+
+  size_t   i    = 0;
+  size_t   j    = 0;
+  STAT_Val stat = OK;
+  while(i < lhs_len && j < rhs_len && STAT_is_OK(stat)) {
+    if(lhs[i].key < rhs[j].key) {
+      i++;
+    } else if(rhs[j].key < lhs[i].key) {
+      j++;
+    } else {
+      RBM_Container c = {0};
+      stat            = and_containers(&c, &lhs[i++], &rhs[j++]);
+      if(!STAT_is_OK(stat)) break;
+
+      if(c.cardinality == 0) {
+        destroy_container(&c);
+      } else if(!STAT_is_OK(stat = DAR_push_back(&result, &c))) {
+        destroy_container(&c);
+      }
+    }
+  }
+
+  // destroy the containers that we don't need anymore, the old ones unless we failed
+  DAR_DArray * to_clean_up = STAT_is_OK(stat) ? &this->containers : &result;
+  for(size_t idx = 0; idx < to_clean_up->size; idx++) destroy_container(DAR_get(to_clean_up, idx));
+
+  if(!STAT_is_OK(stat)) {
+    DAR_destroy(&result);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to intersect containers");
+  }
+
+  DAR_destroy(&this->containers);
+  this->containers = result;
+
+  return OK;
+}
+
+STAT_Val RBM_run_optimize(RBM_Bitmap * this) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  for(size_t i = 0; i < this->containers.size; i++) {
+    RBM_Container * c = DAR_get(&this->containers, i);
+    if(c->type == RBM_CONTAINER_RUN) continue;
+
+    if((count_runs(c) * sizeof(RBM_Run)) < get_payload_size(c)) {
+      if(!STAT_is_OK(convert_to_runs(c))) {
+        return LOG_STAT(STAT_ERR_ALLOC, "failed to convert container to runs");
+      }
+    }
+  }
+
+  return OK;
+}
+
+bool RBM_contains(const RBM_Bitmap * this, uint32_t value) {
+  size_t idx = 0;
+  if(RBM_is_empty(this) || !find_container(this, get_key(value), &idx)) return false;
+  return container_contains(DAR_get(&this->containers, idx), get_low(value));
+}
+
+uint64_t RBM_get_cardinality(const RBM_Bitmap * this) {
+  if(RBM_is_empty(this)) return 0;
+
+  uint64_t cardinality = 0;
+  for(size_t i = 0; i < this->containers.size; i++) {
+    cardinality += ((const RBM_Container *)DAR_get(&this->containers, i))->cardinality;
+  }
+  return cardinality;
+}
+
+STAT_Val RBM_to_darray(const RBM_Bitmap * this, DAR_DArray * o_values) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(!DAR_is_initialized(o_values) || o_values->element_size != sizeof(uint32_t)) {
+    return LOG_STAT(STAT_ERR_ARGS, "o_values must be an initialized array of uint32_t");
+  }
+
+  const size_t old_size = o_values->size;
+  if(!STAT_is_OK(DAR_resize(o_values, old_size + RBM_get_cardinality(this)))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to make space for values");
+  }
+
+  uint32_t * out = DAR_get(o_values, old_size);
+
+  for(size_t i = 0; i < this->containers.size; i++) {
+    const RBM_Container * c    = DAR_get(&this->containers, i);
+    const uint32_t        high = (uint32_t)c->key << 16;
+
+    switch(c->type) {
+    case RBM_CONTAINER_ARRAY: {
+      const uint16_t * values = get_values(c);
+      for(size_t v = 0; v < c->cardinality; v++) *(out++) = high | values[v];
+      break;
+    }
+    case RBM_CONTAINER_BITSET: {
+      const uint64_t * words = get_words(c);
+      for(size_t w = 0; w < BITSET_NUM_WORDS; w++) {
+        for(uint64_t word = words[w]; word != 0; word &= (word - 1)) {
+          *(out++) = high | (uint32_t)((w * BIT_BITS_PER_WORD) + (size_t)__builtin_ctzll(word));
+        }
+      }
+      break;
+    }
+    case RBM_CONTAINER_RUN: {
+      const RBM_Run * runs = get_runs(c);
+      for(size_t r = 0; r < c->runs.size; r++) {
+        for(uint32_t v = runs[r].start; v <= ((uint32_t)runs[r].start + runs[r].length); v++) {
+          *(out++) = high | v;
+        }
+      }
+      break;
+    }
+    }
+  }
+
+  return OK;
+}
+
+size_t RBM_get_serialized_size(const RBM_Bitmap * this) {
+  if(!RBM_is_initialized(this)) return 0;
+
+  size_t size = sizeof(SerializedHeader);
+  for(size_t i = 0; i < this->containers.size; i++) {
+    size += sizeof(SerializedContainerHeader) + get_payload_size(DAR_get(&this->containers, i));
+  }
+  return size;
+}
+
+STAT_Val RBM_serialize(const RBM_Bitmap * this, SPN_MutSpan out) {
+  if(!RBM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(out.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "out is NULL");
+
+  const size_t size = RBM_get_serialized_size(this);
+  if(SPN_get_size_in_bytes(SPN_mut_to_const(out)) < size) {
+    return LOG_STAT(STAT_ERR_RANGE, "out can't fit %zu bytes", size);
+  }
+
+  uint8_t * dst = out.begin;
+
+  const SerializedHeader header = {.magic          = SERIALIZED_MAGIC,
+                                   .num_containers = (uint32_t)this->containers.size};
+  memcpy(dst, &header, sizeof(header));
+  dst += sizeof(header);
+
+  for(size_t i = 0; i < this->containers.size; i++) {
+    const RBM_Container * c            = DAR_get(&this->containers, i);
+    const size_t          payload_size = get_payload_size(c);
+
+    const SerializedContainerHeader c_header = {
+        .key         = c->key,
+        .type        = (uint16_t)c->type,
+        .cardinality = c->cardinality,
+        .num_items   = (uint32_t)((c->type == RBM_CONTAINER_ARRAY)    ? c->array.size
+                                  : (c->type == RBM_CONTAINER_BITSET) ? BITSET_NUM_WORDS
+                                                                      : c->runs.size),
+    };
+    memcpy(dst, &c_header, sizeof(c_header));
+    dst += sizeof(c_header);
+
+    const void * payload = (c->type == RBM_CONTAINER_ARRAY)    ? c->array.data
+                           : (c->type == RBM_CONTAINER_BITSET) ? (const void *)get_words(c)
+                                                               : c->runs.data;
+    memcpy(dst, payload, payload_size);
+    dst += payload_size;
+  }
+
+  return OK;
+}
+
+// Reads the payload of a container and checks that it is consistent with its header.
+static STAT_Val read_container(RBM_Container *                   c,
+                               const SerializedContainerHeader * header,
+                               const uint8_t *                   payload,
+                               size_t                            payload_size) {
+  *c = (RBM_Container){.key = header->key, .cardinality = header->cardinality};
+
+  switch(header->type) {
+  case RBM_CONTAINER_ARRAY: {
+    if(header->num_items != header->cardinality || header->cardinality == 0 ||
+       header->cardinality > RBM_ARRAY_MAX_CARDINALITY ||
+       payload_size != (header->num_items * sizeof(uint16_t))) {
+      return STAT_ERR_PARSE;
+    }
+
+    c->type = RBM_CONTAINER_ARRAY;
+    if(!STAT_is_OK(DAR_create(&c->array, sizeof(uint16_t))) ||
+       !STAT_is_OK(DAR_push_back_array(&c->array, payload, header->num_items))) {
+      return STAT_ERR_ALLOC;
+    }
+
+    const uint16_t * values = get_values(c);
+    for(size_t i = 1; i < c->array.size; i++) {
+      if(values[i - 1] >= values[i]) return STAT_ERR_PARSE;
+    }
+    return OK;
+  }
+  case RBM_CONTAINER_BITSET: {
+    if(header->num_items != BITSET_NUM_WORDS || payload_size != BITSET_NUM_BYTES) {
+      return STAT_ERR_PARSE;
+    }
+
+    c->type = RBM_CONTAINER_BITSET;
+    if(!STAT_is_OK(BIT_create(&c->bits, RBM_CONTAINER_NUM_VALUES))) return STAT_ERR_ALLOC;
+    memcpy(c->bits.words.data, payload, BITSET_NUM_BYTES);
+
+    return (BIT_count(&c->bits) == header->cardinality && header->cardinality != 0)
+               ? OK
+               : STAT_ERR_PARSE;
+  }
+  case RBM_CONTAINER_RUN: {
+    if(header->num_items == 0 || payload_size != (header->num_items * sizeof(RBM_Run))) {
+      return STAT_ERR_PARSE;
+    }
+
+    c->type = RBM_CONTAINER_RUN;
+    if(!STAT_is_OK(DAR_create(&c->runs, sizeof(RBM_Run))) ||
+       !STAT_is_OK(DAR_push_back_array(&c->runs, payload, header->num_items))) {
+      return STAT_ERR_ALLOC;
+    }
+
+    const RBM_Run * runs        = get_runs(c);
+    uint64_t        cardinality = 0;
+    for(size_t i = 0; i < c->runs.size; i++) {
+      const uint32_t end = (uint32_t)runs[i].start + runs[i].length;
+      if(end >= RBM_CONTAINER_NUM_VALUES) return STAT_ERR_PARSE;
+      if(i > 0 && runs[i].start <= ((uint32_t)runs[i - 1].start + runs[i - 1].length + 1)) {
+        return STAT_ERR_PARSE; // overlapping, touching or out of order
+      }
+      cardinality += (uint64_t)runs[i].length + 1;
+    }
+    return (cardinality == header->cardinality) ? OK : STAT_ERR_PARSE;
+  }
+  default: return STAT_ERR_PARSE;
+  }
+}
+
+STAT_Val RBM_deserialize(RBM_Bitmap * this, SPN_Span bytes) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(bytes.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "bytes is NULL");
+
+  const uint8_t *  src    = bytes.begin;
+  const uint8_t *  end    = &src[SPN_get_size_in_bytes(bytes)];
+  SerializedHeader header = {0};
+
+  if((size_t)(end - src) < sizeof(header)) return LOG_STAT(STAT_ERR_PARSE, "no header");
+  memcpy(&header, src, sizeof(header));
+  src += sizeof(header);
+
+  if(header.magic != SERIALIZED_MAGIC) return LOG_STAT(STAT_ERR_PARSE, "not a serialized bitmap");
+
+  if(!STAT_is_OK(RBM_create(this))) return LOG_STAT(STAT_ERR_INTERNAL, "failed to create bitmap");
+
+  for(uint32_t i = 0; i < header.num_containers; i++) {
+    SerializedContainerHeader c_header = {0};
+    if((size_t)(end - src) < sizeof(c_header)) {
+      RBM_destroy(this);
+      return LOG_STAT(STAT_ERR_PARSE, "container %u: truncated header", i);
+    }
+    memcpy(&c_header, src, sizeof(c_header));
+    src += sizeof(c_header);
+
+    const size_t item_size    = (c_header.type == RBM_CONTAINER_ARRAY)    ? sizeof(uint16_t)
+                                : (c_header.type == RBM_CONTAINER_BITSET) ? sizeof(uint64_t)
+                                                                          : sizeof(RBM_Run);
+    const size_t payload_size = (size_t)c_header.num_items * item_size;
+    if((size_t)(end - src) < payload_size) {
+      RBM_destroy(this);
+      return LOG_STAT(STAT_ERR_PARSE, "container %u: truncated payload", i);
+    }
+
+    const RBM_Container * last =
+        DAR_is_empty(&this->containers) ? NULL : DAR_last(&this->containers);
+    if(last != NULL && last->key >= c_header.key) {
+      RBM_destroy(this);
+      return LOG_STAT(STAT_ERR_PARSE, "container %u: keys out of order", i);
+    }
+
+    RBM_Container  c    = {0};
+    const STAT_Val stat = read_container(&c, &c_header, src, payload_size);
+    if(!STAT_is_OK(stat) || !STAT_is_OK(DAR_push_back(&this->containers, &c))) {
+      destroy_container(&c);
+      RBM_destroy(this);
+      return LOG_STAT(STAT_is_OK(stat) ? STAT_ERR_ALLOC : stat, "container %u: failed to read", i);
+    }
+    src += payload_size;
+  }
+
+  return OK;
+}
+
+static bool find_container(const RBM_Bitmap * this, uint16_t key, size_t * o_idx) {
+  const RBM_Container * containers = this->containers.data;
+
+  size_t lo = 0;
+  size_t hi = this->containers.size;
+  while(lo < hi) {
+    const size_t mid = lo + ((hi - lo) / 2);
+    if(containers[mid].key < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  *o_idx = lo;
+  return (lo < this->containers.size) && (containers[lo].key == key);
+}
+
+static size_t lower_bound_u16(const uint16_t * values, size_t n, uint16_t value) {
+  size_t lo = 0;
+  size_t hi = n;
+  while(lo < hi) {
+    const size_t mid = lo + ((hi - lo) / 2);
+    if(values[mid] < value) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static STAT_Val create_array_container(RBM_Container * c, uint16_t key) {
+  *c = (RBM_Container){.key = key, .type = RBM_CONTAINER_ARRAY};
+  return DAR_create(&c->array, sizeof(uint16_t));
+}
+
+static STAT_Val copy_container(RBM_Container * dst, const RBM_Container * src) {
+  *dst = (RBM_Container){.key = src->key, .type = src->type, .cardinality = src->cardinality};
+
+  switch(src->type) {
+  case RBM_CONTAINER_ARRAY: return DAR_create_from(&dst->array, &src->array);
+  case RBM_CONTAINER_BITSET: return BIT_create_from(&dst->bits, &src->bits);
+  case RBM_CONTAINER_RUN: return DAR_create_from(&dst->runs, &src->runs);
+  }
+  return STAT_ERR_INTERNAL;
+}
+
+static void destroy_container(RBM_Container * c) {
+  switch(c->type) {
+  case RBM_CONTAINER_ARRAY: DAR_destroy(&c->array); break;
+  case RBM_CONTAINER_BITSET: BIT_destroy(&c->bits); break;
+  case RBM_CONTAINER_RUN: DAR_destroy(&c->runs); break;
+  }
+}
+
+static bool container_contains(const RBM_Container * c, uint16_t low) {
+  switch(c->type) {
+  case RBM_CONTAINER_ARRAY: {
+    const size_t idx = lower_bound_u16(get_values(c), c->array.size, low);
+    return (idx < c->array.size) && (get_values(c)[idx] == low);
+  }
+  case RBM_CONTAINER_BITSET: return BIT_test(&c->bits, low);
+  case RBM_CONTAINER_RUN: {
+    // find the last run that starts at or before low
+    const RBM_Run * runs = get_runs(c);
+    size_t          lo   = 0;
+    size_t          hi   = c->runs.size;
+    while(lo < hi) {
+      const size_t mid = lo + ((hi - lo) / 2);
+      if(runs[mid].start <= low) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return (lo > 0) && (low <= ((uint32_t)runs[lo - 1].start + runs[lo - 1].length));
+  }
+  }
+  return false;
+}
+
+// Run containers are turned back into whatever form fits their cardinality before modifying.
+static STAT_Val convert_from_runs(RBM_Container * c) {
+  if(c->type != RBM_CONTAINER_RUN) return OK;
+  return (c->cardinality <= RBM_ARRAY_MAX_CARDINALITY) ? convert_to_array(c) : convert_to_bitset(c);
+}
+
+static STAT_Val container_add(RBM_Container * c, uint16_t low) {
+  if(!STAT_is_OK(convert_from_runs(c))) return STAT_ERR_ALLOC;
+
+  if(c->type == RBM_CONTAINER_ARRAY) {
+    const size_t idx = lower_bound_u16(get_values(c), c->array.size, low);
+    if(idx < c->array.size && get_values(c)[idx] == low) return OK;
+
+    if(c->array.size < RBM_ARRAY_MAX_CARDINALITY) {
+      const SPN_Span to_insert = {.begin = &low, .len = 1, .element_size = sizeof(uint16_t)};
+      if(!STAT_is_OK(DAR_insert_span(&c->array, idx, to_insert))) return STAT_ERR_ALLOC;
+      c->cardinality++;
+      return OK;
+    }
+
+    if(!STAT_is_OK(convert_to_bitset(c))) return STAT_ERR_ALLOC;
+  }
+
+  if(!BIT_test(&c->bits, low)) {
+    BIT_set(&c->bits, low);
+    c->cardinality++;
+  }
+
+  return OK;
+}
+
+static STAT_Val container_remove(RBM_Container * c, uint16_t low) {
+  if(!container_contains(c, low)) return STAT_OK_NOT_FOUND;
+  if(!STAT_is_OK(convert_from_runs(c))) return STAT_ERR_ALLOC;
+
+  c->cardinality--;
+
+  if(c->type == RBM_CONTAINER_ARRAY) {
+    const size_t idx = lower_bound_u16(get_values(c), c->array.size, low);
+    return DAR_order_preserving_delete(&c->array, idx);
+  }
+
+  BIT_clear(&c->bits, low);
+  return (c->cardinality <= RBM_ARRAY_MAX_CARDINALITY) ? convert_to_array(c) : OK;
+}
+
+// Sets the bits of all values in src in bits.
+static void set_bits_of(BIT_Set * bits, const RBM_Container * src) {
+  switch(src->type) {
+  case RBM_CONTAINER_ARRAY:
+    for(size_t i = 0; i < src->array.size; i++) BIT_set(bits, get_values(src)[i]);
+    break;
+  case RBM_CONTAINER_BITSET: BIT_or(bits, &src->bits); break;
+  case RBM_CONTAINER_RUN:
+    for(size_t i = 0; i < src->runs.size; i++) {
+      const RBM_Run run = get_runs(src)[i];
+      BIT_set_range(bits, run.start, (size_t)run.start + run.length + 1);
+    }
+    break;
+  }
+}
+
+static STAT_Val or_containers(RBM_Container *       dst,
+                              const RBM_Container * a,
+                              const RBM_Container * b) {
+  const bool are_arrays = (a->type == RBM_CONTAINER_ARRAY) && (b->type == RBM_CONTAINER_ARRAY);
+
+  if(are_arrays && (a->cardinality + b->cardinality) <= RBM_ARRAY_MAX_CARDINALITY) {
+    if(!STAT_is_OK(create_array_container(dst, a->key)) ||
+       !STAT_is_OK(DAR_resize(&dst->array, a->cardinality + b->cardinality))) {
+      destroy_container(dst);
+      return STAT_ERR_ALLOC;
+    }
+
+    const uint16_t * lhs = get_values(a);
+    const uint16_t * rhs = get_values(b);
+    uint16_t *       out = dst->array.data;
+    size_t           i   = 0;
+    size_t           j   = 0;
+    size_t           n   = 0;
+    while(i < a->array.size && j < b->array.size) {
+      const uint16_t l = lhs[i];
+      const uint16_t r = rhs[j];
+      out[n++]         = (l < r) ? l : r;
+      i += (l <= r) ? 1 : 0;
+      j += (r <= l) ? 1 : 0;
+    }
+    while(i < a->array.size) out[n++] = lhs[i++];
+    while(j < b->array.size) out[n++] = rhs[j++];
+
+    dst->cardinality = (uint32_t)n;
+    return DAR_resize(&dst->array, n); // shrinking, can't fail
+  }
+
+  // start from a bitset copy of the bigger one, and add the other
+  const RBM_Container * base  = (a->cardinality >= b->cardinality) ? a : b;
+  const RBM_Container * extra = (base == a) ? b : a;
+
+  if(!STAT_is_OK(copy_container(dst, base)) || !STAT_is_OK(convert_to_bitset(dst))) {
+    destroy_container(dst);
+    return STAT_ERR_ALLOC;
+  }
+  set_bits_of(&dst->bits, extra);
+
+  return normalize(dst);
+}
+
+static STAT_Val and_containers(RBM_Container *       dst,
+                               const RBM_Container * a,
+                               const RBM_Container * b) {
+  if(a->type == RBM_CONTAINER_ARRAY || b->type == RBM_CONTAINER_ARRAY) {
+    // the result can't be bigger than the array, so filter that by the other
+    const RBM_Container * array = (a->type == RBM_CONTAINER_ARRAY) ? a : b;
+    const RBM_Container * other = (array == a) ? b : a;
+
+    if(!STAT_is_OK(create_array_container(dst, a->key)) ||
+       !STAT_is_OK(DAR_resize(&dst->array, array->cardinality))) {
+      destroy_container(dst);
+      return STAT_ERR_ALLOC;
+    }
+
+    const uint16_t * values = get_values(array);
+    uint16_t *       out    = dst->array.data;
+    size_t           n      = 0;
+    for(size_t i = 0; i < array->array.size; i++) {
+      out[n] = values[i];
+      n += container_contains(other, values[i]) ? 1 : 0;
+    }
+
+    dst->cardinality = (uint32_t)n;
+    return DAR_resize(&dst->array, n); // shrinking, can't fail
+  }
+
+  if(!STAT_is_OK(copy_container(dst, a)) || !STAT_is_OK(convert_to_bitset(dst))) {
+    destroy_container(dst);
+    return STAT_ERR_ALLOC;
+  }
+
+  if(b->type == RBM_CONTAINER_BITSET) {
+    BIT_and(&dst->bits, &b->bits);
+  } else {
+    RBM_Container tmp = {0};
+    if(!STAT_is_OK(copy_container(&tmp, b)) || !STAT_is_OK(convert_to_bitset(&tmp))) {
+      destroy_container(&tmp);
+      destroy_container(dst);
+      return STAT_ERR_ALLOC;
+    }
+    BIT_and(&dst->bits, &tmp.bits);
+    destroy_container(&tmp);
+  }
+
+  return normalize(dst);
+}
+
+static STAT_Val convert_to_bitset(RBM_Container * c) {
+  if(c->type == RBM_CONTAINER_BITSET) return OK;
+
+  BIT_Set bits = {0};
+  if(!STAT_is_OK(BIT_create(&bits, RBM_CONTAINER_NUM_VALUES))) return STAT_ERR_ALLOC;
+
+  set_bits_of(&bits, c);
+  destroy_container(c);
+
+  c->type = RBM_CONTAINER_BITSET;
+  c->bits = bits;
+
+  return OK;
+}
+
+static STAT_Val convert_to_array(RBM_Container * c) {
+  if(c->type == RBM_CONTAINER_ARRAY) return OK;
+
+  DAR_DArray array = {0};
+  if(!STAT_is_OK(DAR_create(&array, sizeof(uint16_t))) ||
+     !STAT_is_OK(DAR_resize(&array, c->cardinality))) {
+    DAR_destroy(&array);
+    return STAT_ERR_ALLOC;
+  }
+
+  uint16_t * out = array.data;
+  if(c->type == RBM_CONTAINER_BITSET) {
+    const uint64_t * words = get_words(c);
+    for(size_t w = 0; w < BITSET_NUM_WORDS; w++) {
+      for(uint64_t word = words[w]; word != 0; word &= (word - 1)) {
+        *(out++) = (uint16_t)((w * BIT_BITS_PER_WORD) + (size_t)__builtin_ctzll(word));
+      }
+    }
+  } else {
+    for(size_t r = 0; r < c->runs.size; r++) {
+      const RBM_Run run = get_runs(c)[r];
+      for(uint32_t v = run.start; v <= ((uint32_t)run.start + run.length); v++) {
+        *(out++) = (uint16_t)v;
+      }
+    }
+  }
+
+  destroy_container(c);
+
+  c->type  = RBM_CONTAINER_ARRAY;
+  c->array = array;
+
+  return OK;
+}
+
+// Index of the first clear bit at or after from, or RBM_CONTAINER_NUM_VALUES if there is none.
+static size_t find_next_clear(const uint64_t * words, size_t from) {
+  size_t   w    = from / BIT_BITS_PER_WORD;
+  uint64_t word = ~words[w] & (~(uint64_t)0 << (from % BIT_BITS_PER_WORD));
+
+  while(word == 0) {
+    if(++w == BITSET_NUM_WORDS) return RBM_CONTAINER_NUM_VALUES;
+    word = ~words[w];
+  }
+
+  return (w * BIT_BITS_PER_WORD) + (size_t)__builtin_ctzll(word);
+}
+
+static STAT_Val convert_to_runs(RBM_Container * c) {
+  if(c->type == RBM_CONTAINER_RUN) return OK;
+
+  DAR_DArray runs = {0};
+  if(!STAT_is_OK(DAR_create(&runs, sizeof(RBM_Run))) ||
+     !STAT_is_OK(DAR_reserve(&runs, count_runs(c)))) {
+    DAR_destroy(&runs);
+    return STAT_ERR_ALLOC;
+  }
+
+  // as we reserved space, pushing back can't fail
+  if(c->type == RBM_CONTAINER_ARRAY) {
+    const uint16_t * values = get_values(c);
+    RBM_Run          run    = {.start = values[0]};
+    for(size_t i = 1; i < c->array.size; i++) {
+      if(values[i] == (uint32_t)values[i - 1] + 1) {
+        run.length++;
+      } else {
+        DAR_push_back(&runs, &run);
+        run = (RBM_Run){.start = values[i]};
+      }
+    }
+    DAR_push_back(&runs, &run);
+  } else {
+    size_t start = 0;
+    while(BIT_find_next_set(&c->bits, start, &start) == STAT_OK) {
+      const size_t  end = find_next_clear(get_words(c), start);
+      const RBM_Run run = {.start = (uint16_t)start, .length = (uint16_t)(end - start - 1)};
+      DAR_push_back(&runs, &run);
+      start = end;
+    }
+  }
+
+  destroy_container(c);
+
+  c->type = RBM_CONTAINER_RUN;
+  c->runs = runs;
+
+  return OK;
+}
+
+// Makes a bitset container an array container if it got small enough.
+static STAT_Val normalize(RBM_Container * c) {
+  if(c->type != RBM_CONTAINER_BITSET) return OK;
+
+  c->cardinality = (uint32_t)BIT_count(&c->bits);
+  if(c->cardinality > RBM_ARRAY_MAX_CARDINALITY) return OK;
+
+  if(!STAT_is_OK(convert_to_array(c))) {
+    destroy_container(c);
+    return STAT_ERR_ALLOC;
+  }
+  return OK;
+}
+
+static size_t count_runs(const RBM_Container * c) {
+  switch(c->type) {
+  case RBM_CONTAINER_ARRAY: {
+    const uint16_t * values = get_values(c);
+    size_t           n      = (c->array.size > 0) ? 1 : 0;
+    for(size_t i = 1; i < c->array.size; i++) {
+      n += (values[i] != (uint32_t)values[i - 1] + 1) ? 1 : 0;
+    }
+    return n;
+  }
+  case RBM_CONTAINER_BITSET: {
+    // a run starts at every set bit of which the preceding bit is clear
+    const uint64_t * words = get_words(c);
+    size_t           n     = 0;
+    uint64_t         carry = 0;
+    for(size_t w = 0; w < BITSET_NUM_WORDS; w++) {
+      n += (size_t)__builtin_popcountll(words[w] & ~((words[w] << 1) | carry));
+      carry = words[w] >> (BIT_BITS_PER_WORD - 1);
+    }
+    return n;
+  }
+  case RBM_CONTAINER_RUN: return c->runs.size;
+  }
+  return 0;
+}
+
+static size_t get_payload_size(const RBM_Container * c) {
+  switch(c->type) {
+  case RBM_CONTAINER_ARRAY: return c->array.size * sizeof(uint16_t);
+  case RBM_CONTAINER_BITSET: return BITSET_NUM_BYTES;
+  case RBM_CONTAINER_RUN: return c->runs.size * sizeof(RBM_Run);
+  }
+  return 0;
+}
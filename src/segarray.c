@@ -0,0 +1,281 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "segarray.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define DEFAULT_CHUNK_SIZE_IN_BYTES 4096
+#define CHUNK_ALIGNMENT             64 // cache line, also suits any vector width we use
+#define MAX_CHUNK_SIZE_IN_BYTES     (SIZE_MAX / 4)
+
+static size_t   get_log2_ceil(size_t n);
+static size_t   get_chunk_size_in_bytes(const SEG_Array * this);
+static size_t   get_num_elements_in_chunk(const SEG_Array * this, size_t chunk_idx);
+static STAT_Val grow_capacity_as_needed(SEG_Array * this, size_t num_elements_to_fit);
+
+STAT_Val SEG_create(SEG_Array * this, size_t element_size, size_t min_chunk_size) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "element_size can't be 0");
+
+  if(min_chunk_size == 0) {
+    min_chunk_size = (element_size >= DEFAULT_CHUNK_SIZE_IN_BYTES)
+                         ? 1
+                         : (DEFAULT_CHUNK_SIZE_IN_BYTES / element_size);
+  }
+
+  if(min_chunk_size > (MAX_CHUNK_SIZE_IN_BYTES / element_size)) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "chunk of %zu elements of size %zu is too large",
+                    min_chunk_size,
+                    element_size);
+  }
+
+  *this = (SEG_Array){0};
+
+  this->element_size    = element_size;
+  this->chunk_size_log2 = get_log2_ceil(min_chunk_size);
+
+  return LOG_STAT_IF_ERR(DAR_create(&this->chunks, sizeof(uint8_t *)),
+                         "failed to create chunk index");
+}
+
+STAT_Val SEG_destroy(SEG_Array * this) {
+  if(this == NULL) return OK;
+
+  for(size_t i = 0; i < this->chunks.size; i++) free(*(uint8_t **)DAR_get(&this->chunks, i));
+
+  if(!STAT_is_OK(DAR_destroy(&this->chunks))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to destroy chunk index");
+  }
+
+  *this = (SEG_Array){0};
+
+  return OK;
+}
+
+STAT_Val SEG_push_back(SEG_Array * this, const void * element) {
+  if(this == NULL || element == NULL) return LOG_STAT(STAT_ERR_ARGS, "this or element is NULL");
+  if(this->size == SIZE_MAX) return LOG_STAT(STAT_ERR_FULL, "SEG_Array at maximum size");
+
+  if(!STAT_is_OK(grow_capacity_as_needed(this, this->size + 1))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow capacity for push back");
+  }
+
+  memcpy(SEG_get(this, this->size), element, this->element_size);
+  this->size++;
+
+  return OK;
+}
+
+STAT_Val SEG_push_back_span(SEG_Array * this, SPN_Span span) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(this->element_size != span.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "element size mismatch (%zu != %zu)",
+                    this->element_size,
+                    span.element_size);
+  }
+
+  if(SPN_is_empty(span)) return OK;
+
+  if(span.len > (SIZE_MAX - this->size)) return LOG_STAT(STAT_ERR_FULL, "span doesn't fit");
+
+  if(!STAT_is_OK(grow_capacity_as_needed(this, this->size + span.len))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow capacity to fit span");
+  }
+
+  // copy one chunk at a time
+  const size_t    chunk_size = SEG_get_chunk_size(this);
+  const uint8_t * src        = span.begin;
+  size_t          remaining  = span.len;
+
+  while(remaining > 0) {
+    const size_t offset_in_chunk = this->size & (chunk_size - 1);
+    const size_t space_in_chunk  = chunk_size - offset_in_chunk;
+    const size_t n               = (remaining < space_in_chunk) ? remaining : space_in_chunk;
+
+    memcpy(SEG_get(this, this->size), src, (n * this->element_size));
+
+    src += n * this->element_size;
+    remaining -= n;
+    this->size += n;
+  }
+
+  return OK;
+}
+
+STAT_Val SEG_pop_back(SEG_Array * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(this->size == 0) return LOG_STAT(STAT_ERR_EMPTY, "no element to pop");
+
+  this->size--;
+
+  return OK;
+}
+
+STAT_Val SEG_resize_zeroed(SEG_Array * this, size_t new_size) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  if(!STAT_is_OK(grow_capacity_as_needed(this, new_size))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow capacity for resize");
+  }
+
+  const size_t chunk_size = SEG_get_chunk_size(this);
+
+  while(this->size < new_size) {
+    const size_t offset_in_chunk = this->size & (chunk_size - 1);
+    const size_t space_in_chunk  = chunk_size - offset_in_chunk;
+    const size_t remaining       = new_size - this->size;
+    const size_t n               = (remaining < space_in_chunk) ? remaining : space_in_chunk;
+
+    memset(SEG_get(this, this->size), 0, (n * this->element_size));
+    this->size += n;
+  }
+
+  this->size = new_size;
+
+  return OK;
+}
+
+STAT_Val SEG_reserve(SEG_Array * this, size_t num_elements) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  return LOG_STAT_IF_ERR(grow_capacity_as_needed(this, num_elements),
+                         "failed to grow capacity for reserve");
+}
+
+STAT_Val SEG_clear(SEG_Array * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  this->size = 0;
+
+  return OK;
+}
+
+STAT_Val SEG_shrink_to_fit(SEG_Array * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  const size_t num_chunks_in_use = SEG_get_num_chunks_in_use(this);
+
+  for(size_t i = num_chunks_in_use; i < this->chunks.size; i++) {
+    free(*(uint8_t **)DAR_get(&this->chunks, i));
+  }
+
+  if(!STAT_is_OK(DAR_resize(&this->chunks, num_chunks_in_use)) ||
+     !STAT_is_OK(DAR_shrink_to_fit(&this->chunks))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to shrink chunk index");
+  }
+
+  return OK;
+}
+
+STAT_Val SEG_INT_get_checked_nonconst(SEG_Array * this, size_t idx, void ** out) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(out == NULL) return LOG_STAT(STAT_ERR_ARGS, "out is NULL");
+
+  if(idx >= this->size) {
+    return LOG_STAT(STAT_ERR_RANGE, "idx %zu out of range (size=%zu)", idx, this->size);
+  }
+
+  *out = SEG_get(this, idx);
+
+  return OK;
+}
+
+STAT_Val SEG_INT_get_checked_const(const SEG_Array * this, size_t idx, const void ** out) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(out == NULL) return LOG_STAT(STAT_ERR_ARGS, "out is NULL");
+
+  if(idx >= this->size) {
+    return LOG_STAT(STAT_ERR_RANGE, "idx %zu out of range (size=%zu)", idx, this->size);
+  }
+
+  *out = SEG_get(this, idx);
+
+  return OK;
+}
+
+SPN_Span SEG_get_chunk_span(const SEG_Array * this, size_t chunk_idx) {
+  if(this == NULL || chunk_idx >= SEG_get_num_chunks_in_use(this)) return (SPN_Span){0};
+
+  return (SPN_Span){.begin        = *(uint8_t * const *)DAR_get(&this->chunks, chunk_idx),
+                    .len          = get_num_elements_in_chunk(this, chunk_idx),
+                    .element_size = this->element_size};
+}
+
+SPN_MutSpan SEG_get_chunk_mut_span(SEG_Array * this, size_t chunk_idx) {
+  if(this == NULL || chunk_idx >= SEG_get_num_chunks_in_use(this)) return (SPN_MutSpan){0};
+
+  return (SPN_MutSpan){.begin        = *(uint8_t **)DAR_get(&this->chunks, chunk_idx),
+                       .len          = get_num_elements_in_chunk(this, chunk_idx),
+                       .element_size = this->element_size};
+}
+
+static size_t get_num_elements_in_chunk(const SEG_Array * this, size_t chunk_idx) {
+  const size_t remaining  = this->size - (chunk_idx << this->chunk_size_log2);
+  const size_t chunk_size = SEG_get_chunk_size(this);
+  return (remaining < chunk_size) ? remaining : chunk_size;
+}
+
+static size_t get_log2_ceil(size_t n) {
+  size_t log2 = 0;
+  while((((size_t)1) << log2) < n) log2++;
+  return log2;
+}
+
+static size_t get_chunk_size_in_bytes(const SEG_Array * this) {
+  // chunks are rounded up to a whole number of alignment units, as aligned_alloc requires
+  const size_t size_in_bytes = SEG_get_chunk_size(this) * this->element_size;
+  return ((size_in_bytes + (CHUNK_ALIGNMENT - 1)) / CHUNK_ALIGNMENT) * CHUNK_ALIGNMENT;
+}
+
+static STAT_Val grow_capacity_as_needed(SEG_Array * this, size_t num_elements_to_fit) {
+  const size_t chunk_size = SEG_get_chunk_size(this);
+  const size_t num_chunks_needed =
+      (num_elements_to_fit / chunk_size) + (((num_elements_to_fit % chunk_size) != 0) ? 1 : 0);
+
+  if(num_chunks_needed <= this->chunks.size) return OK;
+
+  if(!STAT_is_OK(DAR_reserve(&this->chunks, num_chunks_needed))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to grow chunk index to %zu", num_chunks_needed);
+  }
+
+  // existing chunks are left where they are, we only add new ones
+  while(this->chunks.size < num_chunks_needed) {
+    uint8_t * chunk = aligned_alloc(CHUNK_ALIGNMENT, get_chunk_size_in_bytes(this));
+    if(chunk == NULL) {
+      return LOG_STAT(STAT_ERR_ALLOC,
+                      "failed to allocate chunk of %zu bytes",
+                      get_chunk_size_in_bytes(this));
+    }
+
+    if(!STAT_is_OK(DAR_push_back(&this->chunks, &chunk))) {
+      free(chunk);
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to add chunk to index");
+    }
+  }
+
+  return OK;
+}
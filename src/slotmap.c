@@ -0,0 +1,167 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "slotmap.h"
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define MAX_NUM_SLOTS ((size_t)UINT32_MAX) // UINT32_MAX itself is SLM_INT_NO_SLOT
+
+static inline SLM_INT_Slot * get_slots(SLM_SlotMap * this) { return this->slots.data; }
+static inline uint32_t *     get_slot_idxs(SLM_SlotMap * this) { return this->slot_idxs.data; }
+
+static inline SLM_Handle make_handle(uint32_t slot_idx, uint32_t generation) {
+  return ((SLM_Handle)generation << 32) | slot_idx;
+}
+
+STAT_Val SLM_create(SLM_SlotMap * this, size_t element_size) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "element_size can't be 0");
+
+  *this = (SLM_SlotMap){.free_head = SLM_INT_NO_SLOT};
+
+  if(!STAT_is_OK(DAR_create(&this->values, element_size)) ||
+     !STAT_is_OK(DAR_create(&this->slot_idxs, sizeof(uint32_t))) ||
+     !STAT_is_OK(DAR_create(&this->slots, sizeof(SLM_INT_Slot)))) {
+    SLM_destroy(this);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to create arrays");
+  }
+
+  return OK;
+}
+
+STAT_Val SLM_destroy(SLM_SlotMap * this) {
+  if(this == NULL) return OK;
+
+  STAT_Val stat = OK;
+  if(!STAT_is_OK(DAR_destroy(&this->values)) || !STAT_is_OK(DAR_destroy(&this->slot_idxs)) ||
+     !STAT_is_OK(DAR_destroy(&this->slots))) {
+    stat = LOG_STAT(STAT_ERR_INTERNAL, "failed to destroy arrays");
+  }
+
+  *this = (SLM_SlotMap){0};
+
+  return stat;
+}
+
+STAT_Val SLM_insert(SLM_SlotMap * this, const void * element, SLM_Handle * o_handle) {
+  if(!SLM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+  if(o_handle == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_handle is NULL");
+
+  // take a free slot if there is one, otherwise make a new one
+  uint32_t slot_idx = this->free_head;
+  if(slot_idx == SLM_INT_NO_SLOT) {
+    if(this->slots.size == MAX_NUM_SLOTS) return LOG_STAT(STAT_ERR_FULL, "out of slots");
+    if(!STAT_is_OK(DAR_push_back(&this->slots, &(SLM_INT_Slot){0}))) {
+      return LOG_STAT(STAT_ERR_ALLOC, "failed to add slot");
+    }
+    slot_idx = (uint32_t)(this->slots.size - 1);
+  }
+
+  const uint32_t value_idx = (uint32_t)this->values.size;
+  if(!STAT_is_OK(DAR_push_back(&this->values, element)) ||
+     !STAT_is_OK(DAR_push_back(&this->slot_idxs, &slot_idx))) {
+    DAR_resize(&this->values, value_idx);
+    if(slot_idx != this->free_head) DAR_pop_back(&this->slots); // drop the new slot
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to push element");
+  }
+
+  SLM_INT_Slot * slot = &get_slots(this)[slot_idx];
+  if(slot_idx == this->free_head) this->free_head = slot->index;
+
+  slot->generation++; // now odd, i.e. in use
+  slot->index = value_idx;
+
+  *o_handle = make_handle(slot_idx, slot->generation);
+
+  return OK;
+}
+
+STAT_Val SLM_remove(SLM_SlotMap * this, SLM_Handle handle) {
+  if(!SLM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+  if(!SLM_contains(this, handle)) return STAT_OK_NOT_FOUND;
+
+  const uint32_t slot_idx  = SLM_INT_get_slot_idx(handle);
+  SLM_INT_Slot * slot      = &get_slots(this)[slot_idx];
+  const uint32_t value_idx = slot->index;
+  const uint32_t last_idx  = (uint32_t)(this->values.size - 1);
+
+  // move the last element into the hole, and point its slot to where it is now
+  if(value_idx != last_idx) {
+    DAR_set(&this->values, value_idx, DAR_get(&this->values, last_idx));
+
+    const uint32_t moved_slot_idx         = get_slot_idxs(this)[last_idx];
+    get_slot_idxs(this)[value_idx]        = moved_slot_idx;
+    get_slots(this)[moved_slot_idx].index = value_idx;
+  }
+
+  DAR_pop_back(&this->values);
+  DAR_pop_back(&this->slot_idxs);
+
+  slot->generation++; // now even, i.e. free
+  slot->index     = this->free_head;
+  this->free_head = slot_idx;
+
+  return OK;
+}
+
+STAT_Val SLM_reserve(SLM_SlotMap * this, size_t num_elements) {
+  if(!SLM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  if(!STAT_is_OK(DAR_reserve(&this->values, num_elements)) ||
+     !STAT_is_OK(DAR_reserve(&this->slot_idxs, num_elements)) ||
+     !STAT_is_OK(DAR_reserve(&this->slots, num_elements))) {
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to reserve space for %zu elements", num_elements);
+  }
+
+  return OK;
+}
+
+STAT_Val SLM_clear(SLM_SlotMap * this) {
+  if(!SLM_is_initialized(this)) return LOG_STAT(STAT_ERR_ARGS, "this is not initialized");
+
+  // slots are kept (with their generations bumped) so that old handles stay invalid
+  for(size_t i = 0; i < this->values.size; i++) {
+    const uint32_t slot_idx = get_slot_idxs(this)[i];
+    SLM_INT_Slot * slot     = &get_slots(this)[slot_idx];
+
+    slot->generation++;
+    slot->index     = this->free_head;
+    this->free_head = slot_idx;
+  }
+
+  if(!STAT_is_OK(DAR_clear(&this->values)) || !STAT_is_OK(DAR_clear(&this->slot_idxs))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to clear arrays");
+  }
+
+  return OK;
+}
+
+SLM_Handle SLM_get_handle_at(const SLM_SlotMap * this, size_t idx) {
+  const uint32_t       slot_idx = ((const uint32_t *)this->slot_idxs.data)[idx];
+  const SLM_INT_Slot * slot     = &((const SLM_INT_Slot *)this->slots.data)[slot_idx];
+  return make_handle(slot_idx, slot->generation);
+}
+
+SPN_Span SLM_to_span(const SLM_SlotMap * this) { return DAR_to_span(&this->values); }
+
+SPN_MutSpan SLM_to_mut_span(SLM_SlotMap * this) { return DAR_to_mut_span(&this->values); }
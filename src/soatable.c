@@ -0,0 +1,267 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "soatable.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define COLUMN_ALIGNMENT 64
+
+static DAR_DArray *       get_column_array(SOA_Table * this, size_t column_idx);
+static const DAR_DArray * get_const_column_array(const SOA_Table * this, size_t column_idx);
+static const SOA_Column * get_layout(const SOA_Table * this, size_t column_idx);
+
+STAT_Val SOA_create(SOA_Table *        this,
+                    const SOA_Column * columns,
+                    size_t             num_columns,
+                    size_t             row_size) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(columns == NULL) return LOG_STAT(STAT_ERR_ARGS, "columns is NULL");
+  if(num_columns == 0) return LOG_STAT(STAT_ERR_ARGS, "need at least one column");
+  if(row_size == 0) return LOG_STAT(STAT_ERR_ARGS, "row_size can't be 0");
+
+  for(size_t i = 0; i < num_columns; i++) {
+    const SOA_Column column = columns[i];
+    if(column.size == 0 || column.size > row_size || column.offset > (row_size - column.size)) {
+      return LOG_STAT(STAT_ERR_ARGS,
+                      "column %zu (offset=%zu, size=%zu) doesn't fit in row of size %zu",
+                      i,
+                      column.offset,
+                      column.size,
+                      row_size);
+    }
+  }
+
+  *this = (SOA_Table){0};
+
+  this->row_size = row_size;
+
+  if(!STAT_is_OK(DAR_create(&this->layout, sizeof(SOA_Column))) ||
+     !STAT_is_OK(DAR_push_back_array(&this->layout, columns, num_columns)) ||
+     !STAT_is_OK(DAR_create(&this->columns, sizeof(DAR_DArray)))) {
+    SOA_destroy(this);
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create table");
+  }
+
+  for(size_t i = 0; i < num_columns; i++) {
+    DAR_DArray column = {0};
+
+    if(!STAT_is_OK(DAR_create_aligned(&column, columns[i].size, COLUMN_ALIGNMENT))) {
+      SOA_destroy(this);
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to create column %zu", i);
+    }
+
+    if(!STAT_is_OK(DAR_push_back(&this->columns, &column))) {
+      DAR_destroy(&column);
+      SOA_destroy(this);
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to add column %zu", i);
+    }
+  }
+
+  return OK;
+}
+
+STAT_Val SOA_destroy(SOA_Table * this) {
+  if(this == NULL) return OK;
+
+  if(DAR_is_initialized(&this->columns)) {
+    for(size_t i = 0; i < this->columns.size; i++) DAR_destroy(get_column_array(this, i));
+  }
+
+  DAR_destroy(&this->columns);
+  DAR_destroy(&this->layout);
+
+  *this = (SOA_Table){0};
+
+  return OK;
+}
+
+STAT_Val SOA_push_row(SOA_Table * this, const void * row) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(row == NULL) return LOG_STAT(STAT_ERR_ARGS, "row is NULL");
+
+  // reserve up front, so that we can't fail halfway through adding the fields
+  if(!STAT_is_OK(SOA_reserve(this, this->num_rows + 1))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to reserve space for row");
+  }
+
+  for(size_t i = 0; i < SOA_get_num_columns(this); i++) {
+    const uint8_t * field = &((const uint8_t *)row)[get_layout(this, i)->offset];
+    if(!STAT_is_OK(DAR_push_back(get_column_array(this, i), field))) {
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to push back field for column %zu", i);
+    }
+  }
+
+  this->num_rows++;
+
+  return OK;
+}
+
+STAT_Val SOA_push_rows(SOA_Table * this, SPN_Span rows) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(rows.element_size != this->row_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "row size mismatch (%zu != %zu)",
+                    this->row_size,
+                    rows.element_size);
+  }
+
+  if(SPN_is_empty(rows)) return OK;
+
+  const size_t new_num_rows = this->num_rows + rows.len;
+
+  if(!STAT_is_OK(SOA_reserve(this, new_num_rows))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to reserve space for %zu rows", rows.len);
+  }
+
+  // fill one column at a time, so that we write to each column contiguously
+  for(size_t i = 0; i < SOA_get_num_columns(this); i++) {
+    DAR_DArray *       column = get_column_array(this, i);
+    const SOA_Column * layout = get_layout(this, i);
+
+    if(!STAT_is_OK(DAR_resize(column, new_num_rows))) {
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to resize column %zu", i);
+    }
+
+    uint8_t *       dst = DAR_get(column, this->num_rows);
+    const uint8_t * src = &((const uint8_t *)rows.begin)[layout->offset];
+    for(size_t row = 0; row < rows.len; row++) {
+      memcpy(dst, src, layout->size);
+      dst += layout->size;
+      src += rows.element_size;
+    }
+  }
+
+  this->num_rows = new_num_rows;
+
+  return OK;
+}
+
+STAT_Val SOA_reserve(SOA_Table * this, size_t num_rows) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  for(size_t i = 0; i < SOA_get_num_columns(this); i++) {
+    if(!STAT_is_OK(DAR_reserve(get_column_array(this, i), num_rows))) {
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to reserve %zu rows for column %zu", num_rows, i);
+    }
+  }
+
+  return OK;
+}
+
+STAT_Val SOA_clear(SOA_Table * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  for(size_t i = 0; i < SOA_get_num_columns(this); i++) DAR_clear(get_column_array(this, i));
+  this->num_rows = 0;
+
+  return OK;
+}
+
+STAT_Val SOA_get_row(const SOA_Table * this, size_t row_idx, void * o_row) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(o_row == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_row is NULL");
+  if(row_idx >= this->num_rows) {
+    return LOG_STAT(STAT_ERR_RANGE, "row %zu out of range (num_rows=%zu)", row_idx, this->num_rows);
+  }
+
+  memset(o_row, 0, this->row_size);
+
+  for(size_t i = 0; i < SOA_get_num_columns(this); i++) {
+    const SOA_Column * layout = get_layout(this, i);
+    memcpy(&((uint8_t *)o_row)[layout->offset],
+           DAR_get(get_const_column_array(this, i), row_idx),
+           layout->size);
+  }
+
+  return OK;
+}
+
+SPN_Span SOA_get_column(const SOA_Table * this, size_t column_idx) {
+  if(this == NULL || column_idx >= SOA_get_num_columns(this)) return (SPN_Span){0};
+  return DAR_to_span(get_const_column_array(this, column_idx));
+}
+
+SPN_MutSpan SOA_get_mut_column(SOA_Table * this, size_t column_idx) {
+  if(this == NULL || column_idx >= SOA_get_num_columns(this)) return (SPN_MutSpan){0};
+  return DAR_to_mut_span(get_column_array(this, column_idx));
+}
+
+STAT_Val SOA_create_from_aos(SOA_Table *        this,
+                             const SOA_Column * columns,
+                             size_t             num_columns,
+                             SPN_Span           rows) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  if(!STAT_is_OK(SOA_create(this, columns, num_columns, rows.element_size))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create table");
+  }
+
+  if(!STAT_is_OK(SOA_push_rows(this, rows))) {
+    SOA_destroy(this);
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to push rows into table");
+  }
+
+  return OK;
+}
+
+STAT_Val SOA_to_aos(const SOA_Table * this, DAR_DArray * o_rows) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(o_rows == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_rows is NULL");
+
+  if(!STAT_is_OK(DAR_create(o_rows, this->row_size))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to create array");
+  }
+
+  if(!STAT_is_OK(DAR_resize_zeroed(o_rows, this->num_rows))) {
+    DAR_destroy(o_rows);
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to resize array to %zu rows", this->num_rows);
+  }
+
+  // read one column at a time, so that we read each column contiguously
+  for(size_t i = 0; i < SOA_get_num_columns(this); i++) {
+    const SOA_Column * layout = get_layout(this, i);
+    const uint8_t *    src    = DAR_first(get_const_column_array(this, i));
+    uint8_t *          dst    = &((uint8_t *)o_rows->data)[layout->offset];
+
+    for(size_t row = 0; row < this->num_rows; row++) {
+      memcpy(dst, src, layout->size);
+      dst += this->row_size;
+      src += layout->size;
+    }
+  }
+
+  return OK;
+}
+
+static DAR_DArray * get_column_array(SOA_Table * this, size_t column_idx) {
+  return DAR_get(&this->columns, column_idx);
+}
+
+static const DAR_DArray * get_const_column_array(const SOA_Table * this, size_t column_idx) {
+  return DAR_get(&this->columns, column_idx);
+}
+
+static const SOA_Column * get_layout(const SOA_Table * this, size_t column_idx) {
+  return DAR_get(&this->layout, column_idx);
+}
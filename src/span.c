@@ -24,6 +24,10 @@
 
 #include <string.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #define OK STAT_OK
 
 static bool is_valid(SPN_Span span) { return (span.begin != NULL && span.element_size != 0); }
@@ -31,6 +35,228 @@ static bool is_valid_mut(SPN_MutSpan span) {
   return (span.begin != NULL && span.element_size != 0);
 }
 
+// ====================
+// == element search ==
+
+// Finding single elements of 1, 2, 4 or 8 bytes is done a vector at a time: we compare all
+// elements in the vector at once, and turn the result into a bitmask with a bit per byte, so a
+// match of an element sets element_size consecutive bits.
+//
+// Bytes are looked up in a byte set by their nibbles: the set's table gives, for the low nibble,
+// a bit for each high nibble that is in the set with it, and a fixed table gives the bit for the
+// high nibble. With 16 high nibbles and 8 bits, there are two of each table. Both lookups are a
+// byte shuffle, so this needs SSSE3 or AVX2.
+//
+// The kernels are in span_kernels.h, which we include once for each instruction set, compiling
+// it with a target attribute rather than with -m flags, so the library runs on any x86-64 CPU.
+// When the library is loaded, we check which instruction sets the CPU supports and pick the
+// widest kernels it can run. Other architectures get the scalar kernels.
+
+#if defined(__x86_64__)
+#define HAS_X86_KERNELS
+
+static const uint8_t high_nibble_bits[2][16] = {
+    {1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, 128},
+};
+#endif
+
+static inline bool is_vector_element_size(size_t element_size) {
+  return (element_size == 1 || element_size == 2 || element_size == 4 || element_size == 8);
+}
+
+static inline uint64_t load_element(const void * element, size_t element_size) {
+  switch(element_size) {
+  case 1: return *(const uint8_t *)element;
+  case 2: {
+    uint16_t v = 0;
+    memcpy(&v, element, sizeof(v));
+    return v;
+  }
+  case 4: {
+    uint32_t v = 0;
+    memcpy(&v, element, sizeof(v));
+    return v;
+  }
+  default: {
+    uint64_t v = 0;
+    memcpy(&v, element, sizeof(v));
+    return v;
+  }
+  }
+}
+
+#define KERNEL(name) name##_scalar
+#define KERNEL_TARGET
+#include "span_kernels.h"
+
+#if defined(HAS_X86_KERNELS)
+#define KERNEL(name)         name##_sse2
+#define KERNEL_TARGET        __attribute__((target("sse2")))
+#define VECTOR_SIZE_IN_BYTES 16
+#include "span_kernels.h"
+
+#define KERNEL(name)         name##_ssse3
+#define KERNEL_TARGET        __attribute__((target("ssse3")))
+#define VECTOR_SIZE_IN_BYTES 16
+#define HAS_NIBBLE_LOOKUP
+#include "span_kernels.h"
+
+#define KERNEL(name)         name##_avx2
+#define KERNEL_TARGET        __attribute__((target("avx2")))
+#define VECTOR_SIZE_IN_BYTES 32
+#define HAS_NIBBLE_LOOKUP
+#include "span_kernels.h"
+#endif
+
+typedef struct {
+  size_t (*find_element_forward)(SPN_Span span, const void * element, size_t idx);
+  size_t (*find_element_backward)(SPN_Span span, const void * element, size_t idx);
+  size_t (*find_bytes_forward)(const uint8_t * haystack,
+                               size_t          haystack_len,
+                               const uint8_t * needle,
+                               size_t          needle_len,
+                               size_t          start,
+                               size_t          alignment);
+  size_t (*find_byte_in_set_forward)(const uint8_t *     bytes,
+                                     size_t              len,
+                                     const SPN_ByteSet * set,
+                                     bool                is_in,
+                                     size_t              idx);
+  size_t (*find_byte_in_set_backward)(const uint8_t *     bytes,
+                                      const SPN_ByteSet * set,
+                                      bool                is_in,
+                                      size_t              end);
+  size_t (*count_elements)(SPN_Span span, const void * element);
+} Kernels;
+
+#define KERNELS(suffix)                                                                            \
+  {                                                                                                \
+    .find_element_forward      = find_element_forward_##suffix,                                    \
+    .find_element_backward     = find_element_backward_##suffix,                                   \
+    .find_bytes_forward        = find_bytes_forward_##suffix,                                      \
+    .find_byte_in_set_forward  = find_byte_in_set_forward_##suffix,                                \
+    .find_byte_in_set_backward = find_byte_in_set_backward_##suffix,                               \
+    .count_elements            = count_elements_##suffix,                                          \
+  }
+
+static const Kernels kernels_by_level[] = {
+    [SPN_INT_SIMD_NONE] = KERNELS(scalar),
+#if defined(HAS_X86_KERNELS)
+    [SPN_INT_SIMD_SSE2]  = KERNELS(sse2),
+    [SPN_INT_SIMD_SSSE3] = KERNELS(ssse3),
+    [SPN_INT_SIMD_AVX2]  = KERNELS(avx2),
+#endif
+};
+
+// until the level is picked at load time, everything runs on the scalar kernels
+static SPN_INT_SimdLevel simd_level = SPN_INT_SIMD_NONE;
+static const Kernels *   kernels    = &kernels_by_level[SPN_INT_SIMD_NONE];
+
+static SPN_INT_SimdLevel get_supported_simd_level(void) {
+#if defined(HAS_X86_KERNELS)
+  __builtin_cpu_init(); // needed when called before other constructors have run
+  if(__builtin_cpu_supports("avx2")) return SPN_INT_SIMD_AVX2;
+  if(__builtin_cpu_supports("ssse3")) return SPN_INT_SIMD_SSSE3;
+  return SPN_INT_SIMD_SSE2; // part of x86-64
+#else
+  return SPN_INT_SIMD_NONE;
+#endif
+}
+
+__attribute__((constructor)) static void pick_simd_level(void) {
+  SPN_INT_set_max_simd_level(SPN_INT_SIMD_AVX2);
+}
+
+SPN_INT_SimdLevel SPN_INT_set_max_simd_level(SPN_INT_SimdLevel max_level) {
+  const SPN_INT_SimdLevel supported = get_supported_simd_level();
+
+  simd_level = (max_level < supported) ? max_level : supported;
+  kernels    = &kernels_by_level[simd_level];
+
+  return simd_level;
+}
+
+SPN_INT_SimdLevel SPN_INT_get_simd_level(void) { return simd_level; }
+
+// ================
+// == comparison ==
+
+// Short spans are compared a word at a time rather than with a call to memcmp: sizes from 8 to
+// 16 bytes take two words, one at each end, which overlap for sizes below 16. Since the bytes
+// they share are equal by the time the second word is compared, this still finds the first
+// difference. For ordering, words are loaded big endian, so integer order is byte order.
+
+#define MAX_SHORT_COMPARE_SIZE 16
+
+static inline uint64_t load_u64(const uint8_t * bytes) {
+  uint64_t word = 0;
+  memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+static inline uint32_t load_u32(const uint8_t * bytes) {
+  uint32_t word = 0;
+  memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+static inline uint64_t load_u64_big_endian(const uint8_t * bytes) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  return load_u64(bytes);
+#else
+  return __builtin_bswap64(load_u64(bytes));
+#endif
+}
+
+static inline uint32_t load_u32_big_endian(const uint8_t * bytes) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  return load_u32(bytes);
+#else
+  return __builtin_bswap32(load_u32(bytes));
+#endif
+}
+
+static inline bool is_equal_short(const uint8_t * lhs, const uint8_t * rhs, size_t size) {
+  if(size >= 8) {
+    const uint64_t head_diff = load_u64(lhs) ^ load_u64(rhs);
+    const uint64_t tail_diff = load_u64(&lhs[size - 8]) ^ load_u64(&rhs[size - 8]);
+    return (head_diff | tail_diff) == 0;
+  }
+  if(size >= 4) {
+    const uint32_t head_diff = load_u32(lhs) ^ load_u32(rhs);
+    const uint32_t tail_diff = load_u32(&lhs[size - 4]) ^ load_u32(&rhs[size - 4]);
+    return (head_diff | tail_diff) == 0;
+  }
+  for(size_t i = 0; i < size; i++) {
+    if(lhs[i] != rhs[i]) return false;
+  }
+  return true;
+}
+
+static inline int compare_short(const uint8_t * lhs, const uint8_t * rhs, size_t size) {
+  uint64_t lhs_key = 0;
+  uint64_t rhs_key = 0;
+
+  if(size >= 8) {
+    lhs_key = load_u64_big_endian(lhs);
+    rhs_key = load_u64_big_endian(rhs);
+    if(lhs_key == rhs_key) {
+      lhs_key = load_u64_big_endian(&lhs[size - 8]);
+      rhs_key = load_u64_big_endian(&rhs[size - 8]);
+    }
+  } else if(size >= 4) {
+    lhs_key = ((uint64_t)load_u32_big_endian(lhs) << 32) | load_u32_big_endian(&lhs[size - 4]);
+    rhs_key = ((uint64_t)load_u32_big_endian(rhs) << 32) | load_u32_big_endian(&rhs[size - 4]);
+  } else {
+    for(size_t i = 0; i < size; i++) {
+      if(lhs[i] != rhs[i]) return (lhs[i] < rhs[i]) ? -1 : 1;
+    }
+  }
+
+  return (lhs_key > rhs_key) - (lhs_key < rhs_key);
+}
+
 SPN_Span SPN_from_cstr(const char * cstr) {
   if(cstr == NULL) return (SPN_Span){0};
   return (SPN_Span){.begin = (const void *)cstr, .len = strlen(cstr), .element_size = 1};
@@ -51,7 +277,26 @@ bool SPN_equals(SPN_Span lhs, SPN_Span rhs) {
   if(lhs.len != rhs.len) return false;
   if(lhs.element_size != rhs.element_size) return false;
   if(lhs.begin == rhs.begin) return true;
-  return (memcmp(lhs.begin, rhs.begin, SPN_get_size_in_bytes(lhs)) == 0);
+
+  const size_t size = SPN_get_size_in_bytes(lhs);
+  if(size <= MAX_SHORT_COMPARE_SIZE) return is_equal_short(lhs.begin, rhs.begin, size);
+  return (memcmp(lhs.begin, rhs.begin, size) == 0);
+}
+
+int SPN_compare(SPN_Span lhs, SPN_Span rhs) {
+  const size_t lhs_size    = SPN_get_size_in_bytes(lhs);
+  const size_t rhs_size    = SPN_get_size_in_bytes(rhs);
+  const size_t common_size = (lhs_size < rhs_size) ? lhs_size : rhs_size;
+
+  int result = 0;
+  if(common_size <= MAX_SHORT_COMPARE_SIZE) {
+    result = compare_short(lhs.begin, rhs.begin, common_size);
+  } else if(lhs.begin != rhs.begin) {
+    result = memcmp(lhs.begin, rhs.begin, common_size);
+  }
+  if(result != 0) return result;
+
+  return (lhs_size > rhs_size) - (lhs_size < rhs_size);
 }
 
 bool SPN_contains_subspan(SPN_Span span, SPN_Span subspan) {
@@ -59,14 +304,12 @@ bool SPN_contains_subspan(SPN_Span span, SPN_Span subspan) {
   if(span.element_size != subspan.element_size) return false;
   if(span.len < subspan.len) return false;
 
-  // NOTE this could probably be faster if we did our own comparisons
-  const size_t subspan_size_bytes = SPN_get_size_in_bytes(subspan);
-
-  for(size_t i = 0; i <= (span.len - subspan.len); i++) {
-    if(memcmp(SPN_get(span, i), subspan.begin, subspan_size_bytes) == 0) return true;
-  }
-
-  return false;
+  return kernels->find_bytes_forward(span.begin,
+                                     SPN_get_size_in_bytes(span),
+                                     subspan.begin,
+                                     SPN_get_size_in_bytes(subspan),
+                                     0,
+                                     span.element_size) != SIZE_MAX;
 }
 
 STAT_Val SPN_find(SPN_Span span, const void * element, size_t * o_idx) {
@@ -77,14 +320,11 @@ STAT_Val SPN_find_at(SPN_Span span, const void * element, size_t at_idx, size_t
   if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
   if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
 
-  for(size_t i = at_idx; i < span.len; i++) {
-    if(memcmp(SPN_get(span, i), element, span.element_size) == 0) {
-      if(o_idx != NULL) *o_idx = i;
-      return OK;
-    };
-  }
+  const size_t idx = kernels->find_element_forward(span, element, at_idx);
+  if(idx == span.len) return STAT_OK_NOT_FOUND;
 
-  return STAT_OK_NOT_FOUND;
+  if(o_idx != NULL) *o_idx = idx;
+  return OK;
 }
 
 STAT_Val SPN_find_reverse(SPN_Span span, const void * element, size_t * o_idx) {
@@ -98,17 +338,11 @@ STAT_Val SPN_find_reverse_at(SPN_Span span, const void * element, size_t at_idx,
   if(span.len == 0) return STAT_OK_NOT_FOUND;
   if(at_idx >= span.len) at_idx = (span.len - 1);
 
-  // we start at +1 and then decrement at the start of the iteration
-  size_t i = at_idx + 1;
-  do {
-    i--;
-    if(memcmp(SPN_get(span, i), element, span.element_size) == 0) {
-      if(o_idx != NULL) *o_idx = i;
-      return OK;
-    }
-  } while(i != 0);
+  const size_t idx = kernels->find_element_backward(span, element, at_idx);
+  if(idx == SIZE_MAX) return STAT_OK_NOT_FOUND;
 
-  return STAT_OK_NOT_FOUND;
+  if(o_idx != NULL) *o_idx = idx;
+  return OK;
 }
 
 STAT_Val SPN_find_subspan(SPN_Span span, SPN_Span subspan, size_t * o_idx) {
@@ -123,16 +357,16 @@ STAT_Val SPN_find_subspan_at(SPN_Span span, SPN_Span subspan, size_t at_idx, siz
   }
   if((at_idx + subspan.len) > span.len) return STAT_OK_NOT_FOUND;
 
-  const size_t subsp_size_bytes = SPN_get_size_in_bytes(subspan);
-
-  for(size_t i = at_idx; i <= (span.len - subspan.len); i++) {
-    if(memcmp(SPN_get(span, i), subspan.begin, subsp_size_bytes) == 0) {
-      if(o_idx != NULL) *o_idx = i;
-      return OK;
-    }
-  }
+  const size_t pos = kernels->find_bytes_forward(span.begin,
+                                                 SPN_get_size_in_bytes(span),
+                                                 subspan.begin,
+                                                 SPN_get_size_in_bytes(subspan),
+                                                 at_idx * span.element_size,
+                                                 span.element_size);
+  if(pos == SIZE_MAX) return STAT_OK_NOT_FOUND;
 
-  return STAT_OK_NOT_FOUND;
+  if(o_idx != NULL) *o_idx = pos / span.element_size;
+  return OK;
 }
 
 STAT_Val SPN_find_subspan_reverse(SPN_Span span, SPN_Span subspan, size_t * o_idx) {
@@ -179,6 +413,76 @@ STAT_Val SPN_find_subspan_reverse_at(SPN_Span span,
   return STAT_OK_NOT_FOUND;
 }
 
+STAT_Val SPN_count(SPN_Span span, const void * element, size_t * o_count) {
+  if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+  if(o_count == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_count is NULL");
+
+  *o_count = kernels->count_elements(span, element);
+
+  return OK;
+}
+
+STAT_Val SPN_byte_set_create(SPN_ByteSet * this, SPN_Span bytes) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(bytes.element_size != 1 || (bytes.begin == NULL && bytes.len > 0)) {
+    return LOG_STAT(STAT_ERR_ARGS, "bytes is not a valid span of bytes");
+  }
+
+  *this = (SPN_ByteSet){0};
+  for(size_t i = 0; i < bytes.len; i++) SPN_byte_set_add(this, ((const uint8_t *)bytes.begin)[i]);
+
+  return OK;
+}
+
+void SPN_byte_set_add(SPN_ByteSet * this, uint8_t byte) {
+  const uint8_t high = (uint8_t)(byte >> 4);
+  const uint8_t low  = (uint8_t)(byte & 0x0f);
+
+  this->bits[byte / 64] |= (UINT64_C(1) << (byte % 64));
+  this->nibble_table[high / 8][low] |= (uint8_t)(1u << (high % 8));
+}
+
+static STAT_Val check_byte_set_args(SPN_Span span, const SPN_ByteSet * set) {
+  if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(span.element_size != 1) return LOG_STAT(STAT_ERR_ARGS, "span is not a span of bytes");
+  if(set == NULL) return LOG_STAT(STAT_ERR_ARGS, "set is NULL");
+  return OK;
+}
+
+static STAT_Val find_byte_in_set(SPN_Span            span,
+                                 const SPN_ByteSet * set,
+                                 bool                is_in,
+                                 bool                is_reverse,
+                                 size_t *            o_idx) {
+  const STAT_Val stat = check_byte_set_args(span, set);
+  if(!STAT_is_OK(stat)) return stat;
+
+  const size_t idx =
+      is_reverse ? kernels->find_byte_in_set_backward(span.begin, set, is_in, span.len)
+                 : kernels->find_byte_in_set_forward(span.begin, span.len, set, is_in, 0);
+  if(idx == SIZE_MAX || idx == span.len) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = idx;
+  return OK;
+}
+
+STAT_Val SPN_find_any_of(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx) {
+  return find_byte_in_set(span, set, true, false, o_idx);
+}
+
+STAT_Val SPN_find_any_of_reverse(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx) {
+  return find_byte_in_set(span, set, true, true, o_idx);
+}
+
+STAT_Val SPN_find_first_not_of(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx) {
+  return find_byte_in_set(span, set, false, false, o_idx);
+}
+
+STAT_Val SPN_find_last_not_of(SPN_Span span, const SPN_ByteSet * set, size_t * o_idx) {
+  return find_byte_in_set(span, set, false, true, o_idx);
+}
+
 void SPN_swap(SPN_MutSpan span, size_t idx_a, size_t idx_b) {
   if(idx_a != idx_b) {
     // we swap byte-by-byte, so that we don't need any dynamically sized allocation
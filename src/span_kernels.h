@@ -0,0 +1,358 @@
+// MIT License
+//
+// Copyright (c) 2023 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Search kernels for span.c, which includes this file once per instruction set, so there is no
+// include guard. Before each include, span.c defines:
+//  - KERNEL(name), which gives the functions in this file their name for that instruction set;
+//  - KERNEL_TARGET, the target attribute the functions are compiled with (may be empty);
+//  - VECTOR_SIZE_IN_BYTES, 16 or 32, or nothing for the scalar kernels;
+//  - HAS_NIBBLE_LOOKUP, if the instruction set has a byte shuffle.
+// All of these are undefined again at the end of this file, as are the names span_vectors.h
+// aliases.
+
+#define NibbleTables              KERNEL(NibbleTables)
+#define add_byte_matches          KERNEL(add_byte_matches)
+#define sum_byte_counts           KERNEL(sum_byte_counts)
+#define zero_vector               KERNEL(zero_vector)
+#define load_nibble_tables        KERNEL(load_nibble_tables)
+#define get_byte_set_mask         KERNEL(get_byte_set_mask)
+#define find_element_forward      KERNEL(find_element_forward)
+#define find_element_backward     KERNEL(find_element_backward)
+#define find_bytes_forward        KERNEL(find_bytes_forward)
+#define find_byte_in_set_forward  KERNEL(find_byte_in_set_forward)
+#define find_byte_in_set_backward KERNEL(find_byte_in_set_backward)
+#define count_elements            KERNEL(count_elements)
+
+#include "span_vectors.h"
+
+#if defined(VECTOR_SIZE_IN_BYTES) && (VECTOR_SIZE_IN_BYTES == 32)
+// Adds 1 to the byte counters in counts for each byte that matches needle. Counters overflow
+// after 255 additions.
+KERNEL_TARGET static inline Vector add_byte_matches(Vector          counts,
+                                                    const uint8_t * bytes,
+                                                    Vector          needle) {
+  const __m256i block = _mm256_loadu_si256((const __m256i *)bytes);
+  return _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(block, needle));
+}
+
+KERNEL_TARGET static inline uint64_t sum_byte_counts(Vector counts) {
+  const __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+  return (uint64_t)_mm256_extract_epi64(sums, 0) + (uint64_t)_mm256_extract_epi64(sums, 1) +
+         (uint64_t)_mm256_extract_epi64(sums, 2) + (uint64_t)_mm256_extract_epi64(sums, 3);
+}
+
+KERNEL_TARGET static inline Vector zero_vector(void) { return _mm256_setzero_si256(); }
+
+typedef struct {
+  __m256i set_table[2];
+  __m256i high_table[2];
+} NibbleTables;
+
+KERNEL_TARGET static inline NibbleTables load_nibble_tables(const SPN_ByteSet * set) {
+  NibbleTables tables = {0};
+  for(size_t i = 0; i < 2; i++) {
+    tables.set_table[i] =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->nibble_table[i]));
+    tables.high_table[i] =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)high_nibble_bits[i]));
+  }
+  return tables;
+}
+
+// Returns a bitmask with a bit set for each byte that is in the set.
+KERNEL_TARGET static inline uint32_t get_byte_set_mask(const uint8_t *      bytes,
+                                                       const NibbleTables * tables) {
+  const __m256i block  = _mm256_loadu_si256((const __m256i *)bytes);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i low    = _mm256_and_si256(block, nibble);
+  const __m256i high   = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+  const __m256i hits   = _mm256_or_si256(
+      _mm256_and_si256(_mm256_shuffle_epi8(tables->set_table[0], low),
+                       _mm256_shuffle_epi8(tables->high_table[0], high)),
+      _mm256_and_si256(_mm256_shuffle_epi8(tables->set_table[1], low),
+                       _mm256_shuffle_epi8(tables->high_table[1], high)));
+  return ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hits, _mm256_setzero_si256()));
+}
+#elif defined(VECTOR_SIZE_IN_BYTES) && (VECTOR_SIZE_IN_BYTES == 16)
+// Adds 1 to the byte counters in counts for each byte that matches needle. Counters overflow
+// after 255 additions.
+KERNEL_TARGET static inline Vector add_byte_matches(Vector          counts,
+                                                    const uint8_t * bytes,
+                                                    Vector          needle) {
+  const __m128i block = _mm_loadu_si128((const __m128i *)bytes);
+  return _mm_sub_epi8(counts, _mm_cmpeq_epi8(block, needle));
+}
+
+KERNEL_TARGET static inline uint64_t sum_byte_counts(Vector counts) {
+  const __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+  return (uint64_t)_mm_cvtsi128_si64(sums) +
+         (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+}
+
+KERNEL_TARGET static inline Vector zero_vector(void) { return _mm_setzero_si128(); }
+
+#if defined(HAS_NIBBLE_LOOKUP)
+typedef struct {
+  __m128i set_table[2];
+  __m128i high_table[2];
+} NibbleTables;
+
+KERNEL_TARGET static inline NibbleTables load_nibble_tables(const SPN_ByteSet * set) {
+  NibbleTables tables = {0};
+  for(size_t i = 0; i < 2; i++) {
+    tables.set_table[i]  = _mm_loadu_si128((const __m128i *)set->nibble_table[i]);
+    tables.high_table[i] = _mm_loadu_si128((const __m128i *)high_nibble_bits[i]);
+  }
+  return tables;
+}
+
+// Returns a bitmask with a bit set for each byte that is in the set.
+KERNEL_TARGET static inline uint32_t get_byte_set_mask(const uint8_t *      bytes,
+                                                       const NibbleTables * tables) {
+  const __m128i block  = _mm_loadu_si128((const __m128i *)bytes);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i low    = _mm_and_si128(block, nibble);
+  const __m128i high   = _mm_and_si128(_mm_srli_epi16(block, 4), nibble);
+  const __m128i hits =
+      _mm_or_si128(_mm_and_si128(_mm_shuffle_epi8(tables->set_table[0], low),
+                                 _mm_shuffle_epi8(tables->high_table[0], high)),
+                   _mm_and_si128(_mm_shuffle_epi8(tables->set_table[1], low),
+                                 _mm_shuffle_epi8(tables->high_table[1], high)));
+  return (~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hits, _mm_setzero_si128()))) & 0xffff;
+}
+#endif
+#endif
+
+// Returns the index of the first element at or after idx that equals element, or span.len if
+// there is none.
+KERNEL_TARGET static size_t find_element_forward(SPN_Span span, const void * element, size_t idx) {
+  const uint8_t * bytes        = span.begin;
+  const size_t    element_size = span.element_size;
+
+  if(idx >= span.len) return span.len;
+
+  if(element_size == 1) {
+    // the C library's memchr is already vectorized (and picks the widest kernel at runtime)
+    const uint8_t * match = memchr(&bytes[idx], *(const uint8_t *)element, span.len - idx);
+    return (match == NULL) ? span.len : (size_t)(match - bytes);
+  }
+
+#if defined(VECTOR_SIZE_IN_BYTES)
+  if(is_vector_element_size(element_size)) {
+    const Vector needle             = broadcast_element(load_element(element, element_size),
+                                            element_size);
+    const size_t elements_per_block = VECTOR_SIZE_IN_BYTES / element_size;
+
+    for(; (idx + elements_per_block) <= span.len; idx += elements_per_block) {
+      const uint32_t mask = get_match_mask(&bytes[idx * element_size], needle, element_size);
+      if(mask != 0) return idx + ((size_t)__builtin_ctz(mask) / element_size);
+    }
+  }
+#endif
+
+  for(; idx < span.len; idx++) {
+    if(memcmp(&bytes[idx * element_size], element, element_size) == 0) return idx;
+  }
+
+  return span.len;
+}
+
+// Returns the index of the last element at or before idx (which must be in range) that equals
+// element, or SIZE_MAX if there is none.
+KERNEL_TARGET static size_t find_element_backward(SPN_Span     span,
+                                                  const void * element,
+                                                  size_t       idx) {
+  const uint8_t * bytes        = span.begin;
+  const size_t    element_size = span.element_size;
+  size_t          end          = idx + 1; // exclusive
+
+#if defined(VECTOR_SIZE_IN_BYTES)
+  if(is_vector_element_size(element_size)) {
+    const Vector needle             = broadcast_element(load_element(element, element_size),
+                                            element_size);
+    const size_t elements_per_block = VECTOR_SIZE_IN_BYTES / element_size;
+
+    for(; end >= elements_per_block; end -= elements_per_block) {
+      const size_t   block_begin = end - elements_per_block;
+      const uint32_t mask =
+          get_match_mask(&bytes[block_begin * element_size], needle, element_size);
+      if(mask != 0) return block_begin + ((size_t)(31 - __builtin_clz(mask)) / element_size);
+    }
+  }
+#endif
+
+  while(end > 0) {
+    end--;
+    if(memcmp(&bytes[end * element_size], element, element_size) == 0) return end;
+  }
+
+  return SIZE_MAX;
+}
+
+// Returns the byte index of the first occurrence of needle in haystack at or after start (which
+// must be aligned), only counting occurrences at multiples of alignment, or SIZE_MAX if there is
+// none. Candidates are those positions where both the first and last byte of needle match, which
+// we find a vector at a time; only those are compared in full.
+KERNEL_TARGET static size_t find_bytes_forward(const uint8_t * haystack,
+                                               size_t          haystack_len,
+                                               const uint8_t * needle,
+                                               size_t          needle_len,
+                                               size_t          start,
+                                               size_t          alignment) {
+  if(needle_len == 0) return (start <= haystack_len) ? start : SIZE_MAX;
+  if(haystack_len < needle_len || start > (haystack_len - needle_len)) return SIZE_MAX;
+
+  const size_t last = haystack_len - needle_len; // last position at which needle fits
+  size_t       pos  = start;
+
+#if defined(VECTOR_SIZE_IN_BYTES)
+  const Vector first_byte = broadcast_element(needle[0], 1);
+  const Vector last_byte  = broadcast_element(needle[needle_len - 1], 1);
+
+  for(; (pos + VECTOR_SIZE_IN_BYTES) <= (last + 1); pos += VECTOR_SIZE_IN_BYTES) {
+    uint32_t candidates = get_match_mask(&haystack[pos], first_byte, 1) &
+                          get_match_mask(&haystack[pos + needle_len - 1], last_byte, 1);
+    while(candidates != 0) {
+      const size_t candidate = pos + (size_t)__builtin_ctz(candidates);
+      if((candidate % alignment) == 0 &&
+         memcmp(&haystack[candidate], needle, needle_len) == 0) {
+        return candidate;
+      }
+      candidates &= (candidates - 1);
+    }
+  }
+#endif
+
+  for(; pos <= last; pos++) {
+    if((pos % alignment) == 0 && haystack[pos] == needle[0] &&
+       memcmp(&haystack[pos], needle, needle_len) == 0) {
+      return pos;
+    }
+  }
+
+  return SIZE_MAX;
+}
+
+// Returns the index of the first byte at or after idx that is in set (or, if !is_in, that is not),
+// or len if there is none.
+KERNEL_TARGET static size_t find_byte_in_set_forward(const uint8_t *     bytes,
+                                                     size_t              len,
+                                                     const SPN_ByteSet * set,
+                                                     bool                is_in,
+                                                     size_t              idx) {
+#if defined(HAS_NIBBLE_LOOKUP)
+  const NibbleTables tables = load_nibble_tables(set);
+  const uint32_t     flip   = is_in ? 0 : UINT32_MAX;
+
+  for(; (idx + VECTOR_SIZE_IN_BYTES) <= len; idx += VECTOR_SIZE_IN_BYTES) {
+    uint32_t mask = get_byte_set_mask(&bytes[idx], &tables) ^ flip;
+    mask &= (uint32_t)(((uint64_t)1 << VECTOR_SIZE_IN_BYTES) - 1);
+    if(mask != 0) return idx + (size_t)__builtin_ctz(mask);
+  }
+#endif
+
+  for(; idx < len; idx++) {
+    if(SPN_byte_set_contains(set, bytes[idx]) == is_in) return idx;
+  }
+
+  return len;
+}
+
+// Returns the index of the last byte before end that is in set (or, if !is_in, that is not), or
+// SIZE_MAX if there is none.
+KERNEL_TARGET static size_t find_byte_in_set_backward(const uint8_t *     bytes,
+                                                      const SPN_ByteSet * set,
+                                                      bool                is_in,
+                                                      size_t              end) {
+#if defined(HAS_NIBBLE_LOOKUP)
+  const NibbleTables tables = load_nibble_tables(set);
+  const uint32_t     flip   = is_in ? 0 : UINT32_MAX;
+
+  for(; end >= VECTOR_SIZE_IN_BYTES; end -= VECTOR_SIZE_IN_BYTES) {
+    const size_t block_begin = end - VECTOR_SIZE_IN_BYTES;
+    uint32_t     mask        = get_byte_set_mask(&bytes[block_begin], &tables) ^ flip;
+    mask &= (uint32_t)(((uint64_t)1 << VECTOR_SIZE_IN_BYTES) - 1);
+    if(mask != 0) return block_begin + (size_t)(31 - __builtin_clz(mask));
+  }
+#endif
+
+  while(end > 0) {
+    end--;
+    if(SPN_byte_set_contains(set, bytes[end]) == is_in) return end;
+  }
+
+  return SIZE_MAX;
+}
+
+KERNEL_TARGET static size_t count_elements(SPN_Span span, const void * element) {
+  const uint8_t * bytes        = span.begin;
+  const size_t    element_size = span.element_size;
+  size_t          idx          = 0;
+  size_t          count        = 0;
+
+#if defined(VECTOR_SIZE_IN_BYTES)
+  if(element_size == 1) {
+    // count in byte counters, which we add up before they can overflow
+    const Vector needle = broadcast_element(*(const uint8_t *)element, 1);
+    while((idx + VECTOR_SIZE_IN_BYTES) <= span.len) {
+      Vector counts = zero_vector();
+      for(size_t i = 0; i < UINT8_MAX && (idx + VECTOR_SIZE_IN_BYTES) <= span.len; i++) {
+        counts = add_byte_matches(counts, &bytes[idx], needle);
+        idx += VECTOR_SIZE_IN_BYTES;
+      }
+      count += (size_t)sum_byte_counts(counts);
+    }
+  } else if(is_vector_element_size(element_size)) {
+    const Vector needle = broadcast_element(load_element(element, element_size), element_size);
+    const size_t elements_per_block = VECTOR_SIZE_IN_BYTES / element_size;
+
+    for(; (idx + elements_per_block) <= span.len; idx += elements_per_block) {
+      const uint32_t mask = get_match_mask(&bytes[idx * element_size], needle, element_size);
+      count += (size_t)__builtin_popcount(mask) / element_size;
+    }
+  }
+#endif
+
+  for(; idx < span.len; idx++) {
+    if(memcmp(&bytes[idx * element_size], element, element_size) == 0) count++;
+  }
+
+  return count;
+}
+
+#undef Vector
+#undef NibbleTables
+#undef broadcast_element
+#undef get_match_mask
+#undef add_byte_matches
+#undef sum_byte_counts
+#undef zero_vector
+#undef load_nibble_tables
+#undef get_byte_set_mask
+#undef find_element_forward
+#undef find_element_backward
+#undef find_bytes_forward
+#undef find_byte_in_set_forward
+#undef find_byte_in_set_backward
+#undef count_elements
+
+#undef KERNEL
+#undef KERNEL_TARGET
+#undef VECTOR_SIZE_IN_BYTES
+#undef HAS_NIBBLE_LOOKUP
@@ -0,0 +1,695 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "span_parallel.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+#define DEFAULT_MIN_GRAIN_SIZE   4096
+#define DEFAULT_SERIAL_THRESHOLD (1 << 15)
+#define TASKS_PER_THREAD         4
+
+typedef struct {
+  TP_Pool * pool; // NULL if we run serially
+  size_t    len;
+  size_t    grain_size;
+  size_t    num_chunks;
+} Plan;
+
+static size_t div_round_up(size_t num, size_t den) {
+  return (num / den) + (((num % den) != 0) ? 1 : 0);
+}
+
+static Plan make_plan(size_t len, SPN_ParallelOptions opts, size_t tasks_per_thread) {
+  TP_Pool *    pool      = (opts.pool != NULL) ? opts.pool : TP_get_shared_pool();
+  const size_t threshold =
+      (opts.serial_threshold != 0) ? opts.serial_threshold : DEFAULT_SERIAL_THRESHOLD;
+
+  if((pool == NULL) || (len < threshold) || (TP_get_concurrency(pool) == 1)) {
+    return (Plan){.pool = NULL, .len = len, .grain_size = len, .num_chunks = (len > 0) ? 1 : 0};
+  }
+
+  size_t grain_size = opts.grain_size;
+  if(grain_size == 0) {
+    grain_size = div_round_up(len, TP_get_concurrency(pool) * tasks_per_thread);
+    if(grain_size < DEFAULT_MIN_GRAIN_SIZE) grain_size = DEFAULT_MIN_GRAIN_SIZE;
+  }
+
+  return (Plan){.pool       = pool,
+                .len        = len,
+                .grain_size = grain_size,
+                .num_chunks = div_round_up(len, grain_size)};
+}
+
+static void get_chunk(const Plan * plan, size_t chunk_idx, size_t * o_first, size_t * o_last) {
+  *o_first = chunk_idx * plan->grain_size;
+  *o_last  = ((plan->len - *o_first) < plan->grain_size) ? plan->len
+                                                          : (*o_first + plan->grain_size);
+}
+
+static STAT_Val run_plan(const Plan * plan, TP_TaskFn task_fn, void * job, size_t num_tasks) {
+  if(plan->pool == NULL) {
+    for(size_t i = 0; i < num_tasks; i++) task_fn(job, i);
+    return OK;
+  }
+  return LOG_STAT_IF_ERR(TP_run(plan->pool, task_fn, job, num_tasks),
+                         "failed to run tasks on pool");
+}
+
+// ==============
+// == for each ==
+
+typedef struct {
+  Plan          plan;
+  SPN_MutSpan   span;
+  SPN_ForEachFn fn;
+  void *        ctx;
+} ForEachJob;
+
+static void for_each_task(void * job_p, size_t chunk_idx) {
+  const ForEachJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  for(size_t i = first; i < last; i++) job->fn(SPN_get(job->span, i), job->ctx);
+}
+
+STAT_Val SPN_parallel_for_each(SPN_MutSpan         span,
+                               SPN_ForEachFn       fn,
+                               void *              ctx,
+                               SPN_ParallelOptions opts) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(fn == NULL) return LOG_STAT(STAT_ERR_ARGS, "fn is NULL");
+
+  ForEachJob job = {
+      .plan = make_plan(span.len, opts, TASKS_PER_THREAD), .span = span, .fn = fn, .ctx = ctx};
+
+  return run_plan(&job.plan, for_each_task, &job, job.plan.num_chunks);
+}
+
+// ===============
+// == transform ==
+
+typedef struct {
+  Plan            plan;
+  SPN_Span        in;
+  SPN_MutSpan     out;
+  SPN_TransformFn fn;
+  void *          ctx;
+} TransformJob;
+
+static void transform_task(void * job_p, size_t chunk_idx) {
+  const TransformJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  for(size_t i = first; i < last; i++) job->fn(SPN_get(job->in, i), SPN_get(job->out, i), job->ctx);
+}
+
+STAT_Val SPN_parallel_transform(SPN_Span            in,
+                                SPN_MutSpan         out,
+                                SPN_TransformFn     fn,
+                                void *              ctx,
+                                SPN_ParallelOptions opts) {
+  if(in.begin == NULL || in.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "in not valid");
+  if(out.begin == NULL || out.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "out not valid");
+  if(out.len < in.len) {
+    return LOG_STAT(STAT_ERR_ARGS, "out too short (%zu < %zu)", out.len, in.len);
+  }
+  if(fn == NULL) return LOG_STAT(STAT_ERR_ARGS, "fn is NULL");
+
+  TransformJob job = {.plan = make_plan(in.len, opts, TASKS_PER_THREAD),
+                      .in   = in,
+                      .out  = out,
+                      .fn   = fn,
+                      .ctx  = ctx};
+
+  return run_plan(&job.plan, transform_task, &job, job.plan.num_chunks);
+}
+
+// ============
+// == reduce ==
+
+typedef struct {
+  Plan          plan;
+  SPN_Span      span;
+  SPN_ReduceFn  reduce;
+  void *        ctx;
+  const void *  identity;
+  uint8_t *     chunk_accs;
+  size_t        acc_size;
+} ReduceJob;
+
+static void reduce_task(void * job_p, size_t chunk_idx) {
+  const ReduceJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  void * acc = &job->chunk_accs[chunk_idx * job->acc_size];
+  memcpy(acc, job->identity, job->acc_size);
+
+  for(size_t i = first; i < last; i++) job->reduce(acc, SPN_get(job->span, i), job->ctx);
+}
+
+STAT_Val SPN_parallel_reduce(SPN_Span            span,
+                             void *              io_acc,
+                             size_t              acc_size,
+                             SPN_ReduceFn        reduce,
+                             SPN_CombineFn       combine,
+                             void *              ctx,
+                             SPN_ParallelOptions opts) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(io_acc == NULL || acc_size == 0) return LOG_STAT(STAT_ERR_ARGS, "bad accumulator");
+  if(reduce == NULL || combine == NULL) return LOG_STAT(STAT_ERR_ARGS, "reduce or combine is NULL");
+
+  const Plan plan = make_plan(span.len, opts, TASKS_PER_THREAD);
+
+  if(plan.pool == NULL) {
+    for(size_t i = 0; i < span.len; i++) reduce(io_acc, SPN_get(span, i), ctx);
+    return OK;
+  }
+
+  uint8_t * chunk_accs = malloc(plan.num_chunks * acc_size);
+  if(chunk_accs == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate chunk accumulators");
+
+  ReduceJob job = {.plan       = plan,
+                   .span       = span,
+                   .reduce     = reduce,
+                   .ctx        = ctx,
+                   .identity   = io_acc,
+                   .chunk_accs = chunk_accs,
+                   .acc_size   = acc_size};
+
+  const STAT_Val stat = run_plan(&job.plan, reduce_task, &job, plan.num_chunks);
+
+  if(STAT_is_OK(stat)) {
+    memcpy(io_acc, chunk_accs, acc_size);
+    for(size_t i = 1; i < plan.num_chunks; i++) combine(io_acc, &chunk_accs[i * acc_size], ctx);
+  }
+
+  free(chunk_accs);
+
+  return LOG_STAT_IF_ERR(stat, "failed to reduce chunks");
+}
+
+// ==============
+// == count if ==
+
+typedef struct {
+  Plan            plan;
+  SPN_Span        span;
+  SPN_PredicateFn pred;
+  void *          ctx;
+  atomic_size_t   count;
+} CountIfJob;
+
+static void count_if_task(void * job_p, size_t chunk_idx) {
+  CountIfJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  size_t count = 0;
+  for(size_t i = first; i < last; i++) count += job->pred(SPN_get(job->span, i), job->ctx) ? 1 : 0;
+
+  atomic_fetch_add(&job->count, count);
+}
+
+STAT_Val SPN_parallel_count_if(SPN_Span            span,
+                               SPN_PredicateFn     pred,
+                               void *              ctx,
+                               size_t *            o_count,
+                               SPN_ParallelOptions opts) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(pred == NULL) return LOG_STAT(STAT_ERR_ARGS, "pred is NULL");
+  if(o_count == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_count is NULL");
+
+  CountIfJob job = {.plan = make_plan(span.len, opts, TASKS_PER_THREAD),
+                    .span = span,
+                    .pred = pred,
+                    .ctx  = ctx};
+  atomic_init(&job.count, 0);
+
+  const STAT_Val stat = run_plan(&job.plan, count_if_task, &job, job.plan.num_chunks);
+  if(!STAT_is_OK(stat)) return LOG_STAT(STAT_ERR_INTERNAL, "failed to count chunks");
+
+  *o_count = atomic_load(&job.count);
+
+  return OK;
+}
+
+// =============
+// == find if ==
+
+typedef struct {
+  Plan            plan;
+  SPN_Span        span;
+  SPN_PredicateFn pred;
+  void *          ctx;
+  atomic_size_t   found_idx; // lowest index found so far, SIZE_MAX if none
+} FindIfJob;
+
+static void find_if_task(void * job_p, size_t chunk_idx) {
+  FindIfJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  for(size_t i = first; i < last; i++) {
+    // no use looking further if a chunk before us already found something
+    if(atomic_load_explicit(&job->found_idx, memory_order_relaxed) < i) return;
+
+    if(job->pred(SPN_get(job->span, i), job->ctx)) {
+      size_t found = atomic_load(&job->found_idx);
+      while((i < found) && !atomic_compare_exchange_weak(&job->found_idx, &found, i)) {}
+      return;
+    }
+  }
+}
+
+STAT_Val SPN_parallel_find_if(SPN_Span            span,
+                              SPN_PredicateFn     pred,
+                              void *              ctx,
+                              size_t *            o_idx,
+                              SPN_ParallelOptions opts) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(pred == NULL) return LOG_STAT(STAT_ERR_ARGS, "pred is NULL");
+
+  FindIfJob job = {.plan = make_plan(span.len, opts, TASKS_PER_THREAD),
+                   .span = span,
+                   .pred = pred,
+                   .ctx  = ctx};
+  atomic_init(&job.found_idx, SIZE_MAX);
+
+  const STAT_Val stat = run_plan(&job.plan, find_if_task, &job, job.plan.num_chunks);
+  if(!STAT_is_OK(stat)) return LOG_STAT(STAT_ERR_INTERNAL, "failed to search chunks");
+
+  const size_t found_idx = atomic_load(&job.found_idx);
+  if(found_idx == SIZE_MAX) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = found_idx;
+
+  return OK;
+}
+
+// ===========
+// == count ==
+
+typedef struct {
+  Plan          plan;
+  SPN_Span      span;
+  const void *  element;
+  atomic_size_t count;
+} CountJob;
+
+static void count_task(void * job_p, size_t chunk_idx) {
+  CountJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  size_t count = 0;
+  SPN_count(SPN_subspan(job->span, first, last - first), job->element, &count);
+
+  atomic_fetch_add(&job->count, count);
+}
+
+STAT_Val SPN_parallel_count(SPN_Span            span,
+                            const void *        element,
+                            size_t *            o_count,
+                            SPN_ParallelOptions opts) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+  if(o_count == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_count is NULL");
+
+  CountJob job = {.plan    = make_plan(span.len, opts, TASKS_PER_THREAD),
+                  .span    = span,
+                  .element = element};
+  atomic_init(&job.count, 0);
+
+  const STAT_Val stat = run_plan(&job.plan, count_task, &job, job.plan.num_chunks);
+  if(!STAT_is_OK(stat)) return LOG_STAT(STAT_ERR_INTERNAL, "failed to count chunks");
+
+  *o_count = atomic_load(&job.count);
+
+  return OK;
+}
+
+// ====================
+// == subspan search ==
+
+// The plan splits the positions at which a match can start, and each chunk searches the part of
+// the span that matches starting there can cover.
+
+typedef struct {
+  Plan     plan;
+  SPN_Span span;
+  SPN_Span subspan;
+
+  atomic_size_t found_idx;     // first: lowest index so far, SIZE_MAX if none
+  atomic_size_t found_end;     // last: highest index + 1 so far, 0 if none
+  DAR_DArray *  chunk_matches; // all: the indices found by each chunk
+  atomic_bool   has_failed;
+} SubspanJob;
+
+static STAT_Val check_subspan_args(SPN_Span span, SPN_Span subspan) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(subspan.begin == NULL || subspan.len == 0) {
+    return LOG_STAT(STAT_ERR_ARGS, "subspan not valid or empty");
+  }
+  if(span.element_size != subspan.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "span and subspan have different element sizes");
+  }
+  return OK;
+}
+
+static size_t get_num_starts(SPN_Span span, SPN_Span subspan) {
+  return (span.len < subspan.len) ? 0 : (span.len - subspan.len + 1);
+}
+
+// Outputs the range of starts of the chunk, and returns the part of the span to search.
+static SPN_Span get_search_chunk(const SubspanJob * job,
+                                 size_t             chunk_idx,
+                                 size_t *           o_first,
+                                 size_t *           o_last) {
+  get_chunk(&job->plan, chunk_idx, o_first, o_last);
+  return SPN_subspan(job->span, *o_first, (*o_last - *o_first) + job->subspan.len - 1);
+}
+
+static void find_first_subspan_task(void * job_p, size_t chunk_idx) {
+  SubspanJob * job = job_p;
+
+  size_t         first = 0;
+  size_t         last  = 0;
+  const SPN_Span chunk = get_search_chunk(job, chunk_idx, &first, &last);
+
+  // no use looking if a chunk before us already found something
+  if(atomic_load_explicit(&job->found_idx, memory_order_relaxed) < first) return;
+
+  size_t idx = 0;
+  if(SPN_find_subspan(chunk, job->subspan, &idx) != OK) return;
+  idx += first;
+
+  size_t found = atomic_load(&job->found_idx);
+  while((idx < found) && !atomic_compare_exchange_weak(&job->found_idx, &found, idx)) {}
+}
+
+static void find_last_subspan_task(void * job_p, size_t chunk_idx) {
+  SubspanJob * job = job_p;
+
+  size_t         first = 0;
+  size_t         last  = 0;
+  const SPN_Span chunk = get_search_chunk(job, chunk_idx, &first, &last);
+
+  // no use looking if a chunk after us already found something
+  if(atomic_load_explicit(&job->found_end, memory_order_relaxed) > last) return;
+
+  size_t idx = 0;
+  if(SPN_find_subspan_reverse(chunk, job->subspan, &idx) != OK) return;
+  const size_t end = first + idx + 1;
+
+  size_t found = atomic_load(&job->found_end);
+  while((end > found) && !atomic_compare_exchange_weak(&job->found_end, &found, end)) {}
+}
+
+static void find_all_subspans_task(void * job_p, size_t chunk_idx) {
+  SubspanJob * job = job_p;
+
+  size_t         first = 0;
+  size_t         last  = 0;
+  const SPN_Span chunk = get_search_chunk(job, chunk_idx, &first, &last);
+
+  size_t at_idx = 0;
+  size_t idx    = 0;
+  while(SPN_find_subspan_at(chunk, job->subspan, at_idx, &idx) == OK) {
+    const size_t match_idx = first + idx;
+    if(!STAT_is_OK(DAR_push_back(&job->chunk_matches[chunk_idx], &match_idx))) {
+      atomic_store(&job->has_failed, true);
+      return;
+    }
+    at_idx = idx + 1;
+  }
+}
+
+static SubspanJob make_subspan_job(SPN_Span span, SPN_Span subspan, SPN_ParallelOptions opts) {
+  SubspanJob job = {.plan    = make_plan(get_num_starts(span, subspan), opts, TASKS_PER_THREAD),
+                    .span    = span,
+                    .subspan = subspan};
+  atomic_init(&job.found_idx, SIZE_MAX);
+  atomic_init(&job.found_end, 0);
+  atomic_init(&job.has_failed, false);
+  return job;
+}
+
+STAT_Val SPN_parallel_find_subspan(SPN_Span            span,
+                                   SPN_Span            subspan,
+                                   size_t *            o_idx,
+                                   SPN_ParallelOptions opts) {
+  const STAT_Val arg_stat = check_subspan_args(span, subspan);
+  if(!STAT_is_OK(arg_stat)) return arg_stat;
+
+  SubspanJob job = make_subspan_job(span, subspan, opts);
+
+  const STAT_Val stat = run_plan(&job.plan, find_first_subspan_task, &job, job.plan.num_chunks);
+  if(!STAT_is_OK(stat)) return LOG_STAT(STAT_ERR_INTERNAL, "failed to search chunks");
+
+  const size_t found_idx = atomic_load(&job.found_idx);
+  if(found_idx == SIZE_MAX) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = found_idx;
+
+  return OK;
+}
+
+STAT_Val SPN_parallel_find_subspan_reverse(SPN_Span            span,
+                                           SPN_Span            subspan,
+                                           size_t *            o_idx,
+                                           SPN_ParallelOptions opts) {
+  const STAT_Val arg_stat = check_subspan_args(span, subspan);
+  if(!STAT_is_OK(arg_stat)) return arg_stat;
+
+  SubspanJob job = make_subspan_job(span, subspan, opts);
+
+  const STAT_Val stat = run_plan(&job.plan, find_last_subspan_task, &job, job.plan.num_chunks);
+  if(!STAT_is_OK(stat)) return LOG_STAT(STAT_ERR_INTERNAL, "failed to search chunks");
+
+  const size_t found_end = atomic_load(&job.found_end);
+  if(found_end == 0) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = found_end - 1;
+
+  return OK;
+}
+
+STAT_Val SPN_parallel_find_all_subspans(SPN_Span            span,
+                                        SPN_Span            subspan,
+                                        DAR_DArray *        o_indices,
+                                        SPN_ParallelOptions opts) {
+  const STAT_Val arg_stat = check_subspan_args(span, subspan);
+  if(!STAT_is_OK(arg_stat)) return arg_stat;
+  if(o_indices == NULL || !DAR_is_initialized(o_indices)) {
+    return LOG_STAT(STAT_ERR_ARGS, "o_indices is NULL or not initialized");
+  }
+  if(o_indices->element_size != sizeof(size_t)) {
+    return LOG_STAT(STAT_ERR_ARGS, "o_indices is not an array of size_t");
+  }
+
+  SubspanJob job = make_subspan_job(span, subspan, opts);
+  if(job.plan.num_chunks == 0) return OK;
+
+  const size_t old_size = o_indices->size;
+
+  job.chunk_matches = calloc(job.plan.num_chunks, sizeof(DAR_DArray));
+  if(job.chunk_matches == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate chunk results");
+
+  // all that can fail below, apart from running the tasks, is allocation
+  STAT_Val stat = OK;
+  for(size_t i = 0; i < job.plan.num_chunks && STAT_is_OK(stat); i++) {
+    if(!STAT_is_OK(DAR_create(&job.chunk_matches[i], sizeof(size_t)))) stat = STAT_ERR_ALLOC;
+  }
+
+  if(STAT_is_OK(stat)) {
+    stat = run_plan(&job.plan, find_all_subspans_task, &job, job.plan.num_chunks);
+  }
+  if(STAT_is_OK(stat) && atomic_load(&job.has_failed)) stat = STAT_ERR_ALLOC;
+
+  // chunks are in order, and so are the matches within them
+  for(size_t i = 0; i < job.plan.num_chunks && STAT_is_OK(stat); i++) {
+    if(!STAT_is_OK(DAR_push_back_darray(o_indices, &job.chunk_matches[i]))) stat = STAT_ERR_ALLOC;
+  }
+
+  for(size_t i = 0; i < job.plan.num_chunks; i++) {
+    if(DAR_is_initialized(&job.chunk_matches[i])) DAR_destroy(&job.chunk_matches[i]);
+  }
+  free(job.chunk_matches);
+
+  // leave o_indices as it was, rather than with the matches of only some of the chunks
+  if(!STAT_is_OK(stat)) DAR_resize(o_indices, old_size);
+
+  return LOG_STAT_IF_ERR(stat, "failed to find all matches");
+}
+
+// ==========
+// == sort ==
+
+typedef struct {
+  Plan          plan;
+  SPN_MutSpan   span;
+  SPN_CompareFn cmp;
+  atomic_bool   has_failed;
+
+  // merge round state
+  const uint8_t * src;
+  uint8_t *       dst;
+  size_t          run_len;
+  size_t          pieces_per_merge;
+} SortJob;
+
+static void sort_chunk_task(void * job_p, size_t chunk_idx) {
+  SortJob * job = job_p;
+
+  size_t first = 0;
+  size_t last  = 0;
+  get_chunk(&job->plan, chunk_idx, &first, &last);
+
+  const SPN_MutSpan chunk = {.begin        = SPN_get(job->span, first),
+                             .len          = last - first,
+                             .element_size = job->span.element_size};
+
+  if(!STAT_is_OK(SPN_sort(chunk, job->cmp))) atomic_store(&job->has_failed, true);
+}
+
+// Every merge of two runs is split into pieces that can be merged independently, so that all
+// threads have work to do even in the last rounds where there are only a few (large) merges left.
+// A piece is defined by a range in the left run, the matching range in the right run is found by
+// binary search (lower bound of the first left element of the piece, and of the next piece).
+static void merge_task(void * job_p, size_t task_idx) {
+  SortJob * job = job_p;
+
+  const size_t es     = job->span.element_size;
+  const size_t len    = job->span.len;
+  const size_t pieces = job->pieces_per_merge;
+  const size_t piece  = task_idx % pieces;
+  const size_t first  = (task_idx / pieces) * 2 * job->run_len;
+
+  if(first >= len) return;
+
+  const size_t left_n  = ((len - first) < job->run_len) ? (len - first) : job->run_len;
+  const size_t rest    = len - (first + left_n);
+  const size_t right_n = (rest < job->run_len) ? rest : job->run_len;
+
+  const SPN_Span left  = {.begin = &job->src[first * es], .len = left_n, .element_size = es};
+  const SPN_Span right = {.begin        = &job->src[(first + left_n) * es],
+                          .len          = right_n,
+                          .element_size = es};
+
+  const size_t left_begin = (piece * left_n) / pieces;
+  const size_t left_end   = ((piece + 1) * left_n) / pieces;
+
+  size_t right_begin = 0;
+  size_t right_end   = right_n;
+  if(piece != 0 && !STAT_is_OK(SPN_lower_bound(right,
+                                               SPN_get(left, left_begin),
+                                               job->cmp,
+                                               &right_begin))) {
+    atomic_store(&job->has_failed, true);
+    return;
+  }
+  if(piece != (pieces - 1) &&
+     !STAT_is_OK(SPN_lower_bound(right, SPN_get(left, left_end), job->cmp, &right_end))) {
+    atomic_store(&job->has_failed, true);
+    return;
+  }
+
+  const SPN_MutSpan out = {.begin        = &job->dst[(first + left_begin + right_begin) * es],
+                           .len          = (left_end - left_begin) + (right_end - right_begin),
+                           .element_size = es};
+
+  if(!STAT_is_OK(SPN_merge(SPN_subspan(left, left_begin, left_end - left_begin),
+                           SPN_subspan(right, right_begin, right_end - right_begin),
+                           out,
+                           job->cmp))) {
+    atomic_store(&job->has_failed, true);
+  }
+}
+
+STAT_Val SPN_parallel_sort(SPN_MutSpan span, SPN_CompareFn cmp, SPN_ParallelOptions opts) {
+  if(span.begin == NULL || span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+
+  // one chunk per thread by default, the merge rounds are split up further as needed
+  SortJob job = {.plan = make_plan(span.len, opts, 1), .span = span, .cmp = cmp};
+  atomic_init(&job.has_failed, false);
+
+  if(job.plan.pool == NULL || job.plan.num_chunks == 1) {
+    return LOG_STAT_IF_ERR(SPN_sort(span, cmp), "failed to sort serially");
+  }
+
+  if(!STAT_is_OK(run_plan(&job.plan, sort_chunk_task, &job, job.plan.num_chunks)) ||
+     atomic_load(&job.has_failed)) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to sort chunks");
+  }
+
+  const size_t es     = span.element_size;
+  uint8_t *    buffer = malloc(span.len * es);
+  if(buffer == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate merge buffer");
+
+  const size_t target_num_tasks = TP_get_concurrency(job.plan.pool) * TASKS_PER_THREAD;
+
+  job.src = span.begin;
+  job.dst = buffer;
+
+  STAT_Val stat = OK;
+  for(job.run_len = job.plan.grain_size; job.run_len < span.len; job.run_len *= 2) {
+    const size_t num_merges = div_round_up(span.len, 2 * job.run_len);
+
+    job.pieces_per_merge = div_round_up(target_num_tasks, num_merges);
+
+    stat = run_plan(&job.plan, merge_task, &job, num_merges * job.pieces_per_merge);
+    if(STAT_is_OK(stat) && atomic_load(&job.has_failed)) stat = STAT_ERR_INTERNAL;
+    if(!STAT_is_OK(stat)) break;
+
+    const uint8_t * tmp = job.src;
+    job.src             = job.dst;
+    job.dst             = (uint8_t *)tmp;
+  }
+
+  // src holds the result of the last complete round, so even on failure span keeps its elements
+  if(job.src != span.begin) memcpy(span.begin, job.src, span.len * es);
+
+  free(buffer);
+
+  return LOG_STAT_IF_ERR(stat, "failed to merge sorted chunks");
+}
@@ -0,0 +1,213 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "span_search.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+// Computes the critical factorization of needle, outputting the (local) period of the right half,
+// and returning the index at which the right half starts. We compute the maximal suffix for both
+// orderings of the alphabet, and take the shorter of the two.
+// NOTE max_suffix starts at SIZE_MAX (i.e. -1), and max_suffix + k is intended to wrap around.
+static size_t get_critical_factorization(const uint8_t * needle, size_t len, size_t * o_period) {
+  if(len < 3) {
+    *o_period = 1;
+    return len - 1;
+  }
+
+  size_t max_suffix = SIZE_MAX;
+  size_t j          = 0;
+  size_t k          = 1;
+  size_t p          = 1;
+  while((j + k) < len) {
+    const uint8_t a = needle[j + k];
+    const uint8_t b = needle[max_suffix + k];
+    if(a < b) {
+      // suffix is smaller, period is the entire prefix so far
+      j += k;
+      k = 1;
+      p = j - max_suffix;
+    } else if(a == b) {
+      // advance through the repetition of the current period
+      if(k != p) {
+        k++;
+      } else {
+        j += p;
+        k = 1;
+      }
+    } else {
+      // suffix is larger, start over from here
+      max_suffix = j++;
+      k = p = 1;
+    }
+  }
+  const size_t period = p;
+
+  size_t max_suffix_rev = SIZE_MAX;
+  j                     = 0;
+  k                     = 1;
+  p                     = 1;
+  while((j + k) < len) {
+    const uint8_t a = needle[j + k];
+    const uint8_t b = needle[max_suffix_rev + k];
+    if(b < a) {
+      j += k;
+      k = 1;
+      p = j - max_suffix_rev;
+    } else if(a == b) {
+      if(k != p) {
+        k++;
+      } else {
+        j += p;
+        k = 1;
+      }
+    } else {
+      max_suffix_rev = j++;
+      k = p = 1;
+    }
+  }
+
+  if((max_suffix_rev + 1) < (max_suffix + 1)) {
+    *o_period = period;
+    return max_suffix + 1;
+  }
+  *o_period = p;
+  return max_suffix_rev + 1;
+}
+
+STAT_Val SPN_searcher_create(SPN_Searcher * this, SPN_Span needle) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(needle.begin == NULL || needle.element_size == 0) {
+    return LOG_STAT(STAT_ERR_ARGS, "needle not valid");
+  }
+
+  const uint8_t * bytes = needle.begin;
+  const size_t    len   = SPN_get_size_in_bytes(needle);
+
+  *this = (SPN_Searcher){.needle = needle};
+
+  if(len == 0) return OK;
+
+  this->suffix = get_critical_factorization(bytes, len, &this->period);
+
+  // the needle is periodic if the left half occurs at the period, otherwise the halves are
+  // distinct, and a mismatch lets us shift by more than the larger half
+  this->is_periodic = (memcmp(bytes, &bytes[this->period], this->suffix) == 0);
+  if(!this->is_periodic) {
+    const size_t right_len = len - this->suffix;
+    this->period           = ((this->suffix > right_len) ? this->suffix : right_len) + 1;
+  }
+
+  // distance from the last occurrence of each byte (before the very end) to the end of the needle
+  for(size_t i = 0; i <= UINT8_MAX; i++) this->shift_table[i] = len;
+  for(size_t i = 0; i < len; i++) this->shift_table[bytes[i]] = len - i - 1;
+
+  return OK;
+}
+
+// Returns the byte index of the first occurrence at or after start, or SIZE_MAX if there is none.
+static size_t find_two_way(const SPN_Searcher * this,
+                           const uint8_t *      haystack,
+                           size_t               haystack_len,
+                           size_t               start) {
+  const uint8_t * needle = this->needle.begin;
+  const size_t    len    = SPN_get_size_in_bytes(this->needle);
+  const size_t    suffix = this->suffix;
+  const size_t    period = this->period;
+
+  if(haystack_len < len) return SIZE_MAX;
+
+  size_t j      = start;
+  size_t memory = 0; // length of the needle's prefix known to match (periodic needles only)
+  while(j <= (haystack_len - len)) {
+    // check the last byte first; if it doesn't match, shift to where it could
+    size_t shift = this->shift_table[haystack[j + len - 1]];
+    if(shift > 0) {
+      // a periodic needle with its last period out of place can't match until past that point
+      if(memory != 0 && shift < period) shift = len - period;
+      memory = 0;
+      j += shift;
+      continue;
+    }
+
+    // match the right half (the last byte already matched)
+    size_t i = (suffix > memory) ? suffix : memory;
+    while(i < (len - 1) && needle[i] == haystack[i + j]) i++;
+
+    if(i < (len - 1)) {
+      j += i - suffix + 1;
+      memory = 0;
+      continue;
+    }
+
+    // match the left half, down to what is known to match
+    i = suffix - 1;
+    while((memory < (i + 1)) && needle[i] == haystack[i + j]) i--;
+    if((i + 1) < (memory + 1)) return j;
+
+    j += period;
+    if(this->is_periodic) memory = len - period;
+  }
+
+  return SIZE_MAX;
+}
+
+STAT_Val SPN_searcher_find(const SPN_Searcher * this, SPN_Span haystack, size_t * o_idx) {
+  return SPN_searcher_find_at(this, haystack, 0, o_idx);
+}
+
+STAT_Val SPN_searcher_find_at(const SPN_Searcher * this,
+                              SPN_Span             haystack,
+                              size_t               at_idx,
+                              size_t *             o_idx) {
+  if(this == NULL || this->needle.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "this not valid");
+  if(haystack.begin == NULL || haystack.element_size == 0) {
+    return LOG_STAT(STAT_ERR_ARGS, "haystack not valid");
+  }
+  if(haystack.element_size != this->needle.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "haystack and needle have different element sizes");
+  }
+  if(at_idx > haystack.len || (haystack.len - at_idx) < this->needle.len) {
+    return STAT_OK_NOT_FOUND;
+  }
+
+  const size_t element_size = haystack.element_size;
+
+  if(this->needle.len == 0) {
+    if(o_idx != NULL) *o_idx = at_idx;
+    return OK;
+  }
+
+  const uint8_t * bytes = haystack.begin;
+  const size_t    len   = SPN_get_size_in_bytes(haystack);
+
+  // a bytewise match that is not at an element boundary is skipped, and we continue right after
+  size_t pos = find_two_way(this, bytes, len, at_idx * element_size);
+  while(pos != SIZE_MAX && (pos % element_size) != 0) {
+    pos = find_two_way(this, bytes, len, pos + 1);
+  }
+  if(pos == SIZE_MAX) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = pos / element_size;
+  return OK;
+}
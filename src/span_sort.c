@@ -0,0 +1,811 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "span_sort.h"
+
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OK STAT_OK
+
+#define INSERTION_SORT_THRESHOLD     24
+#define NINTHER_THRESHOLD            128
+#define PARTIAL_INSERTION_SORT_LIMIT 8
+#define STACK_ELEMENT_BUFFER_SIZE    256
+#define STABLE_SORT_RUN_LEN          32
+
+#define EYTZINGER_PREFETCH_LEVELS 4
+
+#define RADIX_BITS        8
+#define RADIX_NUM_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MASK        (RADIX_NUM_BUCKETS - 1)
+
+typedef struct {
+  uint8_t *     base;
+  size_t        element_size;
+  SPN_CompareFn cmp;
+  uint8_t *     tmp; // scratch space for a single element
+} Sorter;
+
+static bool is_valid_mut(SPN_MutSpan span) {
+  return (span.begin != NULL && span.element_size != 0);
+}
+
+static size_t log2_floor(size_t n) {
+  size_t log = 0;
+  while(n > 1) {
+    n >>= 1;
+    log++;
+  }
+  return log;
+}
+
+static inline uint8_t * at(const Sorter * s, size_t idx) {
+  return &s->base[idx * s->element_size];
+}
+
+static inline int compare_at(const Sorter * s, size_t a, size_t b) {
+  return s->cmp(at(s, a), at(s, b));
+}
+
+#define SWAP_FIXED_SIZE(a, b, type)                                                                \
+  do {                                                                                             \
+    type tmp_a = 0;                                                                                \
+    type tmp_b = 0;                                                                                \
+    memcpy(&tmp_a, (a), sizeof(type));                                                             \
+    memcpy(&tmp_b, (b), sizeof(type));                                                             \
+    memcpy((a), &tmp_b, sizeof(type));                                                             \
+    memcpy((b), &tmp_a, sizeof(type));                                                             \
+  } while(false)
+
+static inline void swap_bytes(uint8_t * a, uint8_t * b, size_t n) {
+  // the common element sizes get a fixed size swap, which compiles down to plain loads and stores
+  switch(n) {
+  case sizeof(uint32_t): SWAP_FIXED_SIZE(a, b, uint32_t); return;
+  case sizeof(uint64_t): SWAP_FIXED_SIZE(a, b, uint64_t); return;
+  default: break;
+  }
+
+  // otherwise swap in word-sized chunks where we can
+  for(; n >= sizeof(uint64_t); n -= sizeof(uint64_t)) {
+    SWAP_FIXED_SIZE(a, b, uint64_t);
+    a += sizeof(uint64_t);
+    b += sizeof(uint64_t);
+  }
+  for(; n > 0; n--) {
+    const uint8_t tmp = *a;
+    *a++              = *b;
+    *b++              = tmp;
+  }
+}
+
+static inline void copy_element(uint8_t * dst, const uint8_t * src, size_t n) {
+  switch(n) {
+  case sizeof(uint32_t): memcpy(dst, src, sizeof(uint32_t)); return;
+  case sizeof(uint64_t): memcpy(dst, src, sizeof(uint64_t)); return;
+  default: memcpy(dst, src, n); return;
+  }
+}
+
+static inline void swap_at(const Sorter * s, size_t a, size_t b) {
+  swap_bytes(at(s, a), at(s, b), s->element_size);
+}
+
+static inline void sort2(const Sorter * s, size_t a, size_t b) {
+  if(compare_at(s, b, a) < 0) swap_at(s, a, b);
+}
+
+// sorts a, b, c such that the median ends up in b
+static inline void sort3(const Sorter * s, size_t a, size_t b, size_t c) {
+  sort2(s, a, b);
+  sort2(s, b, c);
+  sort2(s, a, b);
+}
+
+// moves element at idx down to its sorted position in [first, idx], assumes [first, idx) is sorted
+// and returns the number of positions moved
+static inline size_t insert_at(const Sorter * s, size_t first, size_t idx) {
+  if(compare_at(s, idx, idx - 1) >= 0) return 0;
+
+  copy_element(s->tmp, at(s, idx), s->element_size);
+
+  size_t hole = idx - 1;
+  while((hole > first) && (s->cmp(s->tmp, at(s, hole - 1)) < 0)) hole--;
+
+  memmove(at(s, hole + 1), at(s, hole), (idx - hole) * s->element_size);
+  copy_element(at(s, hole), s->tmp, s->element_size);
+
+  return idx - hole;
+}
+
+static void insertion_sort(const Sorter * s, size_t first, size_t last) {
+  for(size_t i = first + 1; i < last; i++) insert_at(s, first, i);
+}
+
+// attempts an insertion sort, but bails out when more than PARTIAL_INSERTION_SORT_LIMIT elements
+// had to be moved. Returns whether the range ended up sorted.
+static bool partial_insertion_sort(const Sorter * s, size_t first, size_t last) {
+  size_t num_moved = 0;
+  for(size_t i = first + 1; i < last; i++) {
+    num_moved += insert_at(s, first, i);
+    if(num_moved > PARTIAL_INSERTION_SORT_LIMIT) return false;
+  }
+  return true;
+}
+
+static void sift_down(const Sorter * s, size_t first, size_t n, size_t idx) {
+  while(true) {
+    size_t       largest = idx;
+    const size_t left    = (2 * idx) + 1;
+    const size_t right   = left + 1;
+
+    if((left < n) && (compare_at(s, first + largest, first + left) < 0)) largest = left;
+    if((right < n) && (compare_at(s, first + largest, first + right) < 0)) largest = right;
+    if(largest == idx) return;
+
+    swap_at(s, first + idx, first + largest);
+    idx = largest;
+  }
+}
+
+static void heap_sort(const Sorter * s, size_t first, size_t last) {
+  const size_t n = last - first;
+  for(size_t i = n / 2; i > 0; i--) sift_down(s, first, n, i - 1);
+  for(size_t i = n; i > 1; i--) {
+    swap_at(s, first, first + i - 1);
+    sift_down(s, first, i - 1, 0);
+  }
+}
+
+// partitions [first, last) around the pivot at first, such that elements less than the pivot end
+// up left of it and elements greater than or equal to it end up right of it. Returns the final
+// position of the pivot.
+static size_t partition_right(const Sorter * s,
+                              size_t         first,
+                              size_t         last,
+                              bool *         o_was_partitioned) {
+  size_t i = first + 1;
+  size_t j = last - 1;
+
+  while((i <= j) && (compare_at(s, i, first) < 0)) i++;
+  while((i <= j) && (compare_at(s, j, first) >= 0)) j--;
+
+  *o_was_partitioned = (i > j);
+
+  while(i < j) {
+    swap_at(s, i, j);
+    i++;
+    j--;
+    while((i <= j) && (compare_at(s, i, first) < 0)) i++;
+    while((i <= j) && (compare_at(s, j, first) >= 0)) j--;
+  }
+
+  const size_t pivot_idx = i - 1;
+  swap_at(s, first, pivot_idx);
+
+  return pivot_idx;
+}
+
+// like partition_right, but puts elements equal to the pivot left of it. Used when we know the
+// pivot to be equal to an earlier pivot, in which case everything left of the returned position is
+// equal to the pivot and doesn't need further sorting.
+static size_t partition_left(const Sorter * s, size_t first, size_t last) {
+  size_t i = first + 1;
+  size_t j = last - 1;
+
+  while((i <= j) && (compare_at(s, first, j) < 0)) j--;
+  while((i <= j) && (compare_at(s, first, i) >= 0)) i++;
+
+  while(i < j) {
+    swap_at(s, i, j);
+    i++;
+    j--;
+    while((i <= j) && (compare_at(s, first, j) < 0)) j--;
+    while((i <= j) && (compare_at(s, first, i) >= 0)) i++;
+  }
+
+  swap_at(s, first, j);
+
+  return j;
+}
+
+static void break_patterns(const Sorter * s, size_t first, size_t last) {
+  // swap some elements around to get rid of patterns that cause bad partitions
+  const size_t n       = last - first;
+  const size_t quarter = n / 4;
+
+  if(n < INSERTION_SORT_THRESHOLD) return;
+
+  swap_at(s, first, first + quarter);
+  swap_at(s, last - 1, last - quarter);
+
+  if(n > NINTHER_THRESHOLD) {
+    swap_at(s, first + 1, first + quarter + 1);
+    swap_at(s, first + 2, first + quarter + 2);
+    swap_at(s, last - 2, last - (quarter + 1));
+    swap_at(s, last - 3, last - (quarter + 2));
+  }
+}
+
+static void pdq_sort(const Sorter * s,
+                     size_t         first,
+                     size_t         last,
+                     size_t         bad_allowed,
+                     bool           leftmost) {
+  while(true) {
+    const size_t n = last - first;
+
+    if(n < INSERTION_SORT_THRESHOLD) {
+      insertion_sort(s, first, last);
+      return;
+    }
+
+    // choose pivot as median of 3 or pseudomedian of 9, and move it to first
+    const size_t half = n / 2;
+    if(n > NINTHER_THRESHOLD) {
+      sort3(s, first, first + half, last - 1);
+      sort3(s, first + 1, first + half - 1, last - 2);
+      sort3(s, first + 2, first + half + 1, last - 3);
+      sort3(s, first + half - 1, first + half, first + half + 1);
+      swap_at(s, first, first + half);
+    } else {
+      sort3(s, first + half, first, last - 1);
+    }
+
+    // if the element before this range (a previous pivot) is equal to our pivot, all elements equal
+    // to the pivot can be put left of it and are done; this makes many duplicates cheap
+    if(!leftmost && (compare_at(s, first - 1, first) >= 0)) {
+      first = partition_left(s, first, last) + 1;
+      continue;
+    }
+
+    bool         was_partitioned = false;
+    const size_t pivot_idx       = partition_right(s, first, last, &was_partitioned);
+
+    const size_t left_n  = pivot_idx - first;
+    const size_t right_n = last - (pivot_idx + 1);
+
+    const bool is_highly_unbalanced = (left_n < (n / 8)) || (right_n < (n / 8));
+
+    if(is_highly_unbalanced) {
+      // after too many bad partitions we fall back to heap sort to guarantee O(n log n)
+      if(--bad_allowed == 0) {
+        heap_sort(s, first, last);
+        return;
+      }
+      break_patterns(s, first, pivot_idx);
+      break_patterns(s, pivot_idx + 1, last);
+    } else if(was_partitioned && partial_insertion_sort(s, first, pivot_idx) &&
+              partial_insertion_sort(s, pivot_idx + 1, last)) {
+      // the input was already (nearly) sorted
+      return;
+    }
+
+    pdq_sort(s, first, pivot_idx, bad_allowed, leftmost);
+    first    = pivot_idx + 1;
+    leftmost = false;
+  }
+}
+
+STAT_Val SPN_sort(SPN_MutSpan span, SPN_CompareFn cmp) {
+  if(!is_valid_mut(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+
+  if(span.len < 2) return OK;
+
+  uint8_t   stack_tmp[STACK_ELEMENT_BUFFER_SIZE];
+  uint8_t * tmp = stack_tmp;
+  if(span.element_size > sizeof(stack_tmp)) {
+    tmp = malloc(span.element_size);
+    if(tmp == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate element scratch space");
+  }
+
+  const Sorter sorter = {
+      .base = span.begin, .element_size = span.element_size, .cmp = cmp, .tmp = tmp};
+
+  pdq_sort(&sorter, 0, span.len, log2_floor(span.len), true);
+
+  if(tmp != stack_tmp) free(tmp);
+
+  return OK;
+}
+
+static void merge(const Sorter * s,
+                  const uint8_t * left,
+                  size_t          left_n,
+                  const uint8_t * right,
+                  size_t          right_n,
+                  uint8_t *       out) {
+  const size_t    es        = s->element_size;
+  const uint8_t * left_end  = left + (left_n * es);
+  const uint8_t * right_end = right + (right_n * es);
+
+  // the runs being in order already is common enough in practice to be worth checking for
+  if((left_n == 0) || (right_n == 0) || (s->cmp(right, left_end - es) >= 0)) {
+    memcpy(out, left, left_n * es);
+    memcpy(out + (left_n * es), right, right_n * es);
+    return;
+  }
+
+  while((left < left_end) && (right < right_end)) {
+    // take from the right only if strictly less, this is what keeps the sort stable
+    if(s->cmp(right, left) < 0) {
+      copy_element(out, right, es);
+      right += es;
+    } else {
+      copy_element(out, left, es);
+      left += es;
+    }
+    out += es;
+  }
+
+  memcpy(out, left, (size_t)(left_end - left));
+  out += (left_end - left);
+  memcpy(out, right, (size_t)(right_end - right));
+}
+
+STAT_Val SPN_stable_sort(SPN_MutSpan span, SPN_CompareFn cmp) {
+  if(!is_valid_mut(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+
+  if(span.len < 2) return OK;
+
+  const size_t es = span.element_size;
+
+  uint8_t * buffer = malloc((span.len * es) + es); // + es for the insertion scratch element
+  if(buffer == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate merge buffer");
+
+  Sorter sorter = {
+      .base = span.begin, .element_size = es, .cmp = cmp, .tmp = &buffer[span.len * es]};
+
+  for(size_t first = 0; first < span.len; first += STABLE_SORT_RUN_LEN) {
+    const size_t last = first + STABLE_SORT_RUN_LEN;
+    insertion_sort(&sorter, first, (last < span.len) ? last : span.len);
+  }
+
+  uint8_t * src = span.begin;
+  uint8_t * dst = buffer;
+
+  for(size_t width = STABLE_SORT_RUN_LEN; width < span.len; width *= 2) {
+    for(size_t first = 0; first < span.len; first += (2 * width)) {
+      const size_t left_n  = ((span.len - first) < width) ? (span.len - first) : width;
+      const size_t rest    = span.len - (first + left_n);
+      const size_t right_n = (rest < width) ? rest : width;
+
+      merge(&sorter,
+            &src[first * es],
+            left_n,
+            &src[(first + left_n) * es],
+            right_n,
+            &dst[first * es]);
+    }
+
+    uint8_t * tmp = src;
+    src           = dst;
+    dst           = tmp;
+  }
+
+  if(src != span.begin) memcpy(span.begin, src, span.len * es);
+
+  free(buffer);
+
+  return OK;
+}
+
+bool SPN_is_sorted(SPN_Span span, SPN_CompareFn cmp) {
+  if(cmp == NULL || span.len < 2) return true;
+
+  for(size_t i = 1; i < span.len; i++) {
+    if(cmp(SPN_get(span, i), SPN_get(span, i - 1)) < 0) return false;
+  }
+
+  return true;
+}
+
+// Radix sorts work on unsigned keys, signed and floating point keys are mapped onto unsigned keys
+// with the same ordering before sorting, and mapped back afterwards.
+
+static inline uint32_t i32_to_key(uint32_t bits) { return bits ^ ((uint32_t)1 << 31); }
+static inline uint64_t i64_to_key(uint64_t bits) { return bits ^ ((uint64_t)1 << 63); }
+
+static inline uint32_t f32_to_key(uint32_t bits) {
+  return (bits & ((uint32_t)1 << 31)) ? ~bits : (bits | ((uint32_t)1 << 31));
+}
+static inline uint32_t key_to_f32(uint32_t key) {
+  return (key & ((uint32_t)1 << 31)) ? (key & ~((uint32_t)1 << 31)) : ~key;
+}
+static inline uint64_t f64_to_key(uint64_t bits) {
+  return (bits & ((uint64_t)1 << 63)) ? ~bits : (bits | ((uint64_t)1 << 63));
+}
+static inline uint64_t key_to_f64(uint64_t key) {
+  return (key & ((uint64_t)1 << 63)) ? (key & ~((uint64_t)1 << 63)) : ~key;
+}
+
+#define DEFINE_RADIX_SORT(name, type)                                                              \
+  static STAT_Val name(type * data, size_t n) {                                                    \
+    enum { NUM_DIGITS = sizeof(type) };                                                            \
+                                                                                                   \
+    type * buffer = malloc(n * sizeof(type));                                                      \
+    if(buffer == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate radix sort buffer");   \
+                                                                                                   \
+    /* count all digits in a single pass over the data */                                          \
+    size_t(*counts)[RADIX_NUM_BUCKETS] = calloc(NUM_DIGITS, sizeof(*counts));                      \
+    if(counts == NULL) {                                                                           \
+      free(buffer);                                                                                \
+      return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate radix sort histogram");                  \
+    }                                                                                              \
+    for(size_t i = 0; i < n; i++) {                                                                \
+      for(size_t d = 0; d < NUM_DIGITS; d++) {                                                     \
+        counts[d][(data[i] >> (d * RADIX_BITS)) & RADIX_MASK]++;                                   \
+      }                                                                                            \
+    }                                                                                              \
+                                                                                                   \
+    type * src = data;                                                                             \
+    type * dst = buffer;                                                                           \
+    for(size_t d = 0; d < NUM_DIGITS; d++) {                                                       \
+      const unsigned shift = (unsigned)(d * RADIX_BITS);                                           \
+                                                                                                   \
+      /* if all keys share this digit, the pass wouldn't change anything */                        \
+      if(counts[d][(src[0] >> shift) & RADIX_MASK] == n) continue;                                 \
+                                                                                                   \
+      size_t offsets[RADIX_NUM_BUCKETS];                                                           \
+      size_t sum = 0;                                                                              \
+      for(size_t b = 0; b < RADIX_NUM_BUCKETS; b++) {                                              \
+        offsets[b] = sum;                                                                          \
+        sum += counts[d][b];                                                                       \
+      }                                                                                            \
+                                                                                                   \
+      for(size_t i = 0; i < n; i++) dst[offsets[(src[i] >> shift) & RADIX_MASK]++] = src[i];      \
+                                                                                                   \
+      type * tmp = src;                                                                            \
+      src        = dst;                                                                            \
+      dst        = tmp;                                                                            \
+    }                                                                                              \
+                                                                                                   \
+    if(src != data) memcpy(data, src, n * sizeof(type));                                           \
+                                                                                                   \
+    free(counts);                                                                                  \
+    free(buffer);                                                                                  \
+                                                                                                   \
+    return OK;                                                                                     \
+  }
+
+DEFINE_RADIX_SORT(radix_sort_u32, uint32_t)
+DEFINE_RADIX_SORT(radix_sort_u64, uint64_t)
+
+static STAT_Val check_radix_span(SPN_MutSpan span, size_t key_size) {
+  if(!is_valid_mut(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(span.element_size != key_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "element size %zu doesn't match key size %zu",
+                    span.element_size,
+                    key_size);
+  }
+  return OK;
+}
+
+STAT_Val SPN_radix_sort_u32(SPN_MutSpan span) {
+  if(!STAT_is_OK(check_radix_span(span, sizeof(uint32_t)))) {
+    return LOG_STAT(STAT_ERR_ARGS, "bad span for u32 radix sort");
+  }
+  if(span.len < 2) return OK;
+
+  return LOG_STAT_IF_ERR(radix_sort_u32(span.begin, span.len), "failed to radix sort");
+}
+
+STAT_Val SPN_radix_sort_u64(SPN_MutSpan span) {
+  if(!STAT_is_OK(check_radix_span(span, sizeof(uint64_t)))) {
+    return LOG_STAT(STAT_ERR_ARGS, "bad span for u64 radix sort");
+  }
+  if(span.len < 2) return OK;
+
+  return LOG_STAT_IF_ERR(radix_sort_u64(span.begin, span.len), "failed to radix sort");
+}
+
+// NOTE the key mapping is its own inverse for the signed integer keys, not so for the float keys
+#define DEFINE_MAPPED_RADIX_SORT(fn_name, bits_type, sort_fn, to_key, from_key)                    \
+  STAT_Val fn_name(SPN_MutSpan span) {                                                             \
+    if(!STAT_is_OK(check_radix_span(span, sizeof(bits_type)))) {                                   \
+      return LOG_STAT(STAT_ERR_ARGS, "bad span for radix sort");                                   \
+    }                                                                                              \
+    if(span.len < 2) return OK;                                                                    \
+                                                                                                   \
+    bits_type * keys = span.begin;                                                                 \
+    for(size_t i = 0; i < span.len; i++) keys[i] = to_key(keys[i]);                                \
+                                                                                                   \
+    const STAT_Val stat = sort_fn(keys, span.len);                                                 \
+                                                                                                   \
+    for(size_t i = 0; i < span.len; i++) keys[i] = from_key(keys[i]);                              \
+                                                                                                   \
+    return LOG_STAT_IF_ERR(stat, "failed to radix sort");                                          \
+  }
+
+DEFINE_MAPPED_RADIX_SORT(SPN_radix_sort_i32, uint32_t, radix_sort_u32, i32_to_key, i32_to_key)
+DEFINE_MAPPED_RADIX_SORT(SPN_radix_sort_i64, uint64_t, radix_sort_u64, i64_to_key, i64_to_key)
+DEFINE_MAPPED_RADIX_SORT(SPN_radix_sort_f32, uint32_t, radix_sort_u32, f32_to_key, key_to_f32)
+DEFINE_MAPPED_RADIX_SORT(SPN_radix_sort_f64, uint64_t, radix_sort_u64, f64_to_key, key_to_f64)
+
+static STAT_Val check_sorted_span(SPN_Span span, const char * name) {
+  if(span.element_size == 0) return LOG_STAT(STAT_ERR_ARGS, "%s has element size 0", name);
+  if(span.len > 0 && span.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "%s is NULL", name);
+  return OK;
+}
+
+// Finds the first element for which (cmp(element, key) < bias) is false, i.e. the lower bound for
+// bias 0 and the upper bound for bias 1. The range is halved every iteration regardless of the
+// comparison, and the new base is selected with a conditional move instead of a branch.
+static size_t find_bound(const uint8_t * begin,
+                         size_t          n,
+                         size_t          es,
+                         const void *    key,
+                         SPN_CompareFn   cmp,
+                         int             bias) {
+  if(n == 0) return 0;
+
+  const uint8_t * base = begin;
+
+  while(n > 1) {
+    const size_t half = n / 2;
+
+    // we don't know which half we'll continue in, so prefetch the next midpoint of both
+    __builtin_prefetch(&base[(half / 2) * es]);
+    __builtin_prefetch(&base[(half + (half / 2)) * es]);
+
+    base = (cmp(&base[half * es], key) < bias) ? &base[half * es] : base;
+    n -= half;
+  }
+
+  return ((size_t)(base - begin) / es) + ((cmp(base, key) < bias) ? 1 : 0);
+}
+
+static STAT_Val check_search_args(SPN_Span span, const void * key, SPN_CompareFn cmp) {
+  if(key == NULL) return LOG_STAT(STAT_ERR_ARGS, "key is NULL");
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+  return check_sorted_span(span, "span");
+}
+
+STAT_Val SPN_lower_bound(SPN_Span span, const void * key, SPN_CompareFn cmp, size_t * o_idx) {
+  if(!STAT_is_OK(check_search_args(span, key, cmp))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid arguments");
+  }
+
+  if(o_idx != NULL) *o_idx = find_bound(span.begin, span.len, span.element_size, key, cmp, 0);
+
+  return OK;
+}
+
+STAT_Val SPN_upper_bound(SPN_Span span, const void * key, SPN_CompareFn cmp, size_t * o_idx) {
+  if(!STAT_is_OK(check_search_args(span, key, cmp))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid arguments");
+  }
+
+  if(o_idx != NULL) *o_idx = find_bound(span.begin, span.len, span.element_size, key, cmp, 1);
+
+  return OK;
+}
+
+STAT_Val SPN_binary_search(SPN_Span span, const void * key, SPN_CompareFn cmp, size_t * o_idx) {
+  if(!STAT_is_OK(check_search_args(span, key, cmp))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid arguments");
+  }
+
+  const size_t idx = find_bound(span.begin, span.len, span.element_size, key, cmp, 0);
+  if(idx == span.len || cmp(SPN_get(span, idx), key) != 0) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = idx;
+
+  return OK;
+}
+
+// Fills the eytzinger layout by an in-order traversal of the implicit tree, in which node k
+// (1-based) has children 2k and 2k+1. Returns the next index into sorted.
+static size_t build_eytzinger(const uint8_t * sorted,
+                              uint8_t *       out,
+                              size_t          n,
+                              size_t          es,
+                              size_t          sorted_idx,
+                              size_t          k) {
+  if(k > n) return sorted_idx;
+
+  sorted_idx = build_eytzinger(sorted, out, n, es, sorted_idx, 2 * k);
+  memcpy(&out[(k - 1) * es], &sorted[sorted_idx * es], es);
+  return build_eytzinger(sorted, out, n, es, sorted_idx + 1, (2 * k) + 1);
+}
+
+STAT_Val SPN_to_eytzinger(SPN_Span sorted, SPN_MutSpan out) {
+  if(!STAT_is_OK(check_sorted_span(sorted, "sorted")) ||
+     !STAT_is_OK(check_sorted_span(SPN_mut_to_const(out), "out"))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid spans");
+  }
+  if(sorted.len != out.len || sorted.element_size != out.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "sorted and out differ in length or element size");
+  }
+  if(sorted.len > 0 && sorted.begin == out.begin) {
+    return LOG_STAT(STAT_ERR_ARGS, "can't build layout in place");
+  }
+
+  build_eytzinger(sorted.begin, out.begin, sorted.len, sorted.element_size, 0, 1);
+
+  return OK;
+}
+
+STAT_Val SPN_eytzinger_lower_bound(SPN_Span      eytzinger,
+                                   const void *  key,
+                                   SPN_CompareFn cmp,
+                                   size_t *      o_idx) {
+  if(!STAT_is_OK(check_search_args(eytzinger, key, cmp))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid arguments");
+  }
+
+  const uint8_t * base = eytzinger.begin;
+  const size_t    es   = eytzinger.element_size;
+  const size_t    n    = eytzinger.len;
+
+  size_t k = 1;
+  while(k <= n) {
+    // the descendants a few levels down are contiguous, so we can fetch them well in advance
+    const size_t prefetch_k = k << EYTZINGER_PREFETCH_LEVELS;
+    if(prefetch_k <= n) __builtin_prefetch(&base[(prefetch_k - 1) * es]);
+
+    k = (2 * k) + ((cmp(&base[(k - 1) * es], key) < 0) ? 1 : 0);
+  }
+
+  // every 1 bit at the end of k is a step right (past an element less than key), after the last
+  // step left (onto an element not less than key); undo those steps to get back to that element
+  k >>= (__builtin_ctzll(~(unsigned long long)k) + 1);
+
+  if(o_idx != NULL) *o_idx = (k == 0) ? n : (k - 1);
+
+  return OK;
+}
+
+STAT_Val SPN_merge(SPN_Span lhs, SPN_Span rhs, SPN_MutSpan out, SPN_CompareFn cmp) {
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+  if(!STAT_is_OK(check_sorted_span(lhs, "lhs")) || !STAT_is_OK(check_sorted_span(rhs, "rhs")) ||
+     !STAT_is_OK(check_sorted_span(SPN_mut_to_const(out), "out"))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid spans");
+  }
+  if(lhs.element_size != rhs.element_size || lhs.element_size != out.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "element sizes differ");
+  }
+  if(out.len < (lhs.len + rhs.len)) {
+    return LOG_STAT(STAT_ERR_ARGS, "out (len=%zu) can't fit merged spans", out.len);
+  }
+
+  const size_t    es        = lhs.element_size;
+  const uint8_t * left      = lhs.begin;
+  const uint8_t * left_end  = &left[lhs.len * es];
+  const uint8_t * right     = rhs.begin;
+  const uint8_t * right_end = &right[rhs.len * es];
+  uint8_t *       dst       = out.begin;
+
+  while((left < left_end) && (right < right_end)) {
+    if(cmp(right, left) < 0) {
+      copy_element(dst, right, es);
+      right += es;
+    } else {
+      copy_element(dst, left, es);
+      left += es;
+    }
+    dst += es;
+  }
+
+  // at most one of these is non-empty
+  if(left < left_end) memcpy(dst, left, (size_t)(left_end - left));
+  if(right < right_end) memcpy(dst, right, (size_t)(right_end - right));
+
+  return OK;
+}
+
+// Finds the lower bound of key at or after first, by doubling the step until we pass it and then
+// searching the last step. Cheap when the bound is close to first.
+static size_t gallop_lower_bound(const uint8_t * base,
+                                 size_t          first,
+                                 size_t          n,
+                                 size_t          es,
+                                 const void *    key,
+                                 SPN_CompareFn   cmp) {
+  size_t lo   = first;
+  size_t hi   = first;
+  size_t step = 1;
+
+  while((hi < n) && (cmp(&base[hi * es], key) < 0)) {
+    lo = hi + 1;
+    hi = ((n - hi) > step) ? (hi + step) : n;
+    step *= 2;
+  }
+
+  // everything before lo is less than key, and the element at hi (if any) is not
+  return lo + find_bound(&base[lo * es], hi - lo, es, key, cmp, 0);
+}
+
+STAT_Val SPN_set_intersection(SPN_Span      lhs,
+                              SPN_Span      rhs,
+                              SPN_MutSpan   out,
+                              SPN_CompareFn cmp,
+                              size_t *      o_len) {
+  if(cmp == NULL) return LOG_STAT(STAT_ERR_ARGS, "cmp is NULL");
+  if(o_len == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_len is NULL");
+  if(!STAT_is_OK(check_sorted_span(lhs, "lhs")) || !STAT_is_OK(check_sorted_span(rhs, "rhs")) ||
+     !STAT_is_OK(check_sorted_span(SPN_mut_to_const(out), "out"))) {
+    return LOG_STAT(STAT_ERR_ARGS, "invalid spans");
+  }
+  if(lhs.element_size != rhs.element_size || lhs.element_size != out.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "element sizes differ");
+  }
+
+  const bool     is_lhs_smaller = (lhs.len <= rhs.len);
+  const SPN_Span small          = is_lhs_smaller ? lhs : rhs;
+  const SPN_Span large          = is_lhs_smaller ? rhs : lhs;
+  const size_t   es             = lhs.element_size;
+
+  if(out.len < small.len) {
+    return LOG_STAT(STAT_ERR_ARGS, "out (len=%zu) can't fit intersection", out.len);
+  }
+
+  uint8_t * dst       = out.begin;
+  size_t    len       = 0;
+  size_t    large_idx = 0;
+
+  for(size_t small_idx = 0; small_idx < small.len; small_idx++) {
+    const uint8_t * key = SPN_get(small, small_idx);
+
+    large_idx = gallop_lower_bound(large.begin, large_idx, large.len, es, key, cmp);
+    if(large_idx == large.len) break;
+
+    const uint8_t * match = SPN_get(large, large_idx);
+    if(cmp(match, key) != 0) continue;
+
+    copy_element(&dst[len * es], (is_lhs_smaller ? key : match), es);
+    len++;
+    large_idx++; // each element of large matches at most once
+  }
+
+  *o_len = len;
+
+  return OK;
+}
+
+int SPN_compare_spans(const void * lhs, const void * rhs) {
+  return SPN_compare(*(const SPN_Span *)lhs, *(const SPN_Span *)rhs);
+}
+
+int SPN_compare_keyed_spans(const void * lhs, const void * rhs) {
+  const SPN_KeyedSpan * l = lhs;
+  const SPN_KeyedSpan * r = rhs;
+
+  // zero padding keeps prefix order consistent with SPN_compare: where a padding byte differs
+  // from a real byte, the real byte is nonzero and the padded span is a prefix of the other
+  if(l->prefix != r->prefix) return (l->prefix > r->prefix) ? 1 : -1;
+  return SPN_compare(l->span, r->span);
+}
+
+SPN_KeyedSpan SPN_to_keyed_span(SPN_Span span) {
+  const uint8_t * bytes  = span.begin;
+  const size_t    size   = SPN_get_size_in_bytes(span);
+  uint64_t        prefix = 0;
+
+  for(size_t i = 0; i < sizeof(prefix); i++) {
+    prefix = (prefix << 8) | ((i < size) ? bytes[i] : 0);
+  }
+
+  return (SPN_KeyedSpan){.prefix = prefix, .span = span};
+}
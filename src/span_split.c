@@ -0,0 +1,154 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "span_split.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+static bool is_valid_input(SPN_Span span) {
+  return (span.element_size != 0) && (span.begin != NULL || span.len == 0);
+}
+
+STAT_Val SPN_split_by_element(SPN_SplitIter * o_iter, SPN_Span span, const void * delimiter) {
+  if(o_iter == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_iter is NULL");
+  if(!is_valid_input(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(delimiter == NULL) return LOG_STAT(STAT_ERR_ARGS, "delimiter is NULL");
+
+  *o_iter = (SPN_SplitIter){
+      .remaining = span,
+      .delimiter = {.begin = delimiter, .len = 1, .element_size = span.element_size},
+      .mode      = SPN_SPLIT_BY_ELEMENT,
+  };
+
+  return OK;
+}
+
+STAT_Val SPN_split_by_subspan(SPN_SplitIter * o_iter, SPN_Span span, SPN_Span delimiter) {
+  if(o_iter == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_iter is NULL");
+  if(!is_valid_input(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(delimiter.begin == NULL || delimiter.len == 0) {
+    return LOG_STAT(STAT_ERR_ARGS, "delimiter is empty");
+  }
+  if(delimiter.element_size != span.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "span and delimiter have different element sizes");
+  }
+
+  *o_iter = (SPN_SplitIter){
+      .remaining = span,
+      .delimiter = delimiter,
+      .mode      = SPN_SPLIT_BY_SUBSPAN,
+  };
+
+  return OK;
+}
+
+STAT_Val SPN_split_by_any_of(SPN_SplitIter * o_iter, SPN_Span span, SPN_Span delimiters) {
+  if(o_iter == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_iter is NULL");
+  if(!is_valid_input(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(delimiters.begin == NULL || delimiters.len == 0) {
+    return LOG_STAT(STAT_ERR_ARGS, "delimiters is empty");
+  }
+  if(delimiters.element_size != span.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS, "span and delimiters have different element sizes");
+  }
+
+  *o_iter = (SPN_SplitIter){
+      .remaining = span,
+      .delimiter = delimiters,
+      .mode      = SPN_SPLIT_BY_ANY_OF,
+  };
+
+  if(span.element_size == 1) {
+    return LOG_STAT_IF_ERR(SPN_byte_set_create(&o_iter->byte_set, delimiters),
+                           "failed to create byte set");
+  }
+
+  return OK;
+}
+
+// Returns the index of the first delimiter in span, or span.len if there is none.
+static size_t find_any_of(const SPN_SplitIter * this, SPN_Span span) {
+  if(span.element_size == 1) {
+    size_t idx = span.len;
+    return (SPN_find_any_of(span, &this->byte_set, &idx) == OK) ? idx : span.len;
+  }
+
+  for(size_t i = 0; i < span.len; i++) {
+    for(size_t d = 0; d < this->delimiter.len; d++) {
+      if(memcmp(SPN_get(span, i), SPN_get(this->delimiter, d), span.element_size) == 0) return i;
+    }
+  }
+  return span.len;
+}
+
+// Returns the index of the first delimiter in span, or span.len if there is none.
+static size_t find_delimiter(const SPN_SplitIter * this, SPN_Span span) {
+  if(span.len == 0) return 0;
+
+  size_t   idx  = span.len;
+  STAT_Val stat = STAT_OK_NOT_FOUND;
+
+  switch(this->mode) {
+  case SPN_SPLIT_BY_ELEMENT: stat = SPN_find(span, this->delimiter.begin, &idx); break;
+  case SPN_SPLIT_BY_SUBSPAN: stat = SPN_find_subspan(span, this->delimiter, &idx); break;
+  case SPN_SPLIT_BY_ANY_OF: return find_any_of(this, span);
+  }
+
+  return (stat == OK) ? idx : span.len;
+}
+
+bool SPN_split_next(SPN_SplitIter * this, SPN_Span * o_part) {
+  if(this == NULL || this->is_done) return false;
+
+  const SPN_Span remaining = this->remaining;
+  const size_t   idx       = find_delimiter(this, remaining);
+
+  if(idx == remaining.len) {
+    if(o_part != NULL) *o_part = remaining;
+    this->is_done = true;
+  } else {
+    if(o_part != NULL) *o_part = SPN_subspan(remaining, 0, idx);
+
+    const size_t delimiter_len = (this->mode == SPN_SPLIT_BY_SUBSPAN) ? this->delimiter.len : 1;
+    this->remaining            = SPN_subspan(remaining, idx + delimiter_len, remaining.len);
+  }
+
+  return true;
+}
+
+STAT_Val SPN_split_into(DAR_DArray * out, SPN_SplitIter * iter) {
+  if(out == NULL) return LOG_STAT(STAT_ERR_ARGS, "out is NULL");
+  if(iter == NULL) return LOG_STAT(STAT_ERR_ARGS, "iter is NULL");
+  if(out->element_size != sizeof(SPN_Span)) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "out element size %zu is not that of SPN_Span",
+                    out->element_size);
+  }
+
+  SPN_Span part = {0};
+  while(SPN_split_next(iter, &part)) {
+    if(!STAT_is_OK(DAR_push_back(out, &part))) return LOG_STAT(STAT_ERR_ALLOC, "failed to push");
+  }
+
+  return OK;
+}
@@ -0,0 +1,235 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "span_strided.h"
+
+#include "log.h"
+#include "stat.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define OK STAT_OK
+
+static bool is_valid(SPN_StridedSpan span) {
+  return (span.begin != NULL && span.element_size != 0);
+}
+
+// ========================
+// == element operations ==
+
+// Each operation walks the elements one by one. For the common element sizes, the size is passed
+// as a constant to inlined helpers, so that each memcpy or memcmp becomes a single move.
+
+static inline bool is_equal(const uint8_t * lhs, const uint8_t * rhs, size_t element_size) {
+  return (memcmp(lhs, rhs, element_size) == 0);
+}
+
+static inline size_t find_element(const uint8_t * bytes,
+                                  size_t          len,
+                                  size_t          stride,
+                                  const uint8_t * element,
+                                  size_t          element_size) {
+  for(size_t idx = 0; idx < len; idx++) {
+    if(is_equal(&bytes[idx * stride], element, element_size)) return idx;
+  }
+  return SIZE_MAX;
+}
+
+static size_t find_element_by_size(SPN_StridedSpan span, const void * element) {
+  const uint8_t * bytes = span.begin;
+  switch(span.element_size) {
+  case 1: return find_element(bytes, span.len, span.stride, element, 1);
+  case 2: return find_element(bytes, span.len, span.stride, element, 2);
+  case 4: return find_element(bytes, span.len, span.stride, element, 4);
+  case 8: return find_element(bytes, span.len, span.stride, element, 8);
+  default: return find_element(bytes, span.len, span.stride, element, span.element_size);
+  }
+}
+
+static inline void copy_elements(uint8_t *       dst,
+                                 const uint8_t * src,
+                                 size_t          idx,
+                                 size_t          len,
+                                 size_t          stride,
+                                 size_t          element_size) {
+  for(; idx < len; idx++) {
+    memcpy(&dst[idx * element_size], &src[idx * stride], element_size);
+  }
+}
+
+#if defined(__x86_64__)
+// With AVX2, elements of 4 and 8 bytes are gathered a vector at a time, as long as the offsets
+// within a vector fit the 32 bit indices of the gather instructions. Returns the number of
+// elements gathered, the rest is left to the caller. This is only called if the CPU has AVX2, as
+// picked by span.c when the library is loaded.
+__attribute__((target("avx2"))) static size_t gather_vectors_avx2(uint8_t *       dst,
+                                                                  SPN_StridedSpan span) {
+  const uint8_t * src    = span.begin;
+  const size_t    stride = span.stride;
+  size_t          idx    = 0;
+
+  if(span.element_size == 4 && stride <= (INT32_MAX / 8)) {
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32((int)stride));
+    for(; (idx + 8) <= span.len; idx += 8) {
+      const __m256i values = _mm256_i32gather_epi32((const int *)&src[idx * stride], offsets, 1);
+      _mm256_storeu_si256((__m256i *)&dst[idx * 4], values);
+    }
+  } else if(span.element_size == 8 && stride <= (INT32_MAX / 4)) {
+    const __m128i offsets =
+        _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32((int)stride));
+    for(; (idx + 4) <= span.len; idx += 4) {
+      const __m256i values =
+          _mm256_i32gather_epi64((const long long *)&src[idx * stride], offsets, 1);
+      _mm256_storeu_si256((__m256i *)&dst[idx * 8], values);
+    }
+  }
+
+  return idx;
+}
+#endif
+
+static void gather_elements(uint8_t * dst, SPN_StridedSpan span) {
+  const uint8_t * src    = span.begin;
+  const size_t    stride = span.stride;
+  size_t          idx    = 0;
+
+#if defined(__x86_64__)
+  if(SPN_INT_get_simd_level() >= SPN_INT_SIMD_AVX2) idx = gather_vectors_avx2(dst, span);
+#endif
+
+  switch(span.element_size) {
+  case 1: copy_elements(dst, src, idx, span.len, stride, 1); break;
+  case 2: copy_elements(dst, src, idx, span.len, stride, 2); break;
+  case 4: copy_elements(dst, src, idx, span.len, stride, 4); break;
+  case 8: copy_elements(dst, src, idx, span.len, stride, 8); break;
+  default: copy_elements(dst, src, idx, span.len, stride, span.element_size); break;
+  }
+}
+
+// ======================
+// == public functions ==
+
+SPN_StridedSpan SPN_strided_from_span(SPN_Span span) {
+  return (SPN_StridedSpan){.begin        = span.begin,
+                           .len          = span.len,
+                           .element_size = span.element_size,
+                           .stride       = span.element_size};
+}
+
+SPN_StridedSpan SPN_strided_from_field(SPN_Span span, size_t offset, size_t field_size) {
+  if(span.begin == NULL || field_size == 0 || (offset + field_size) > span.element_size) {
+    return (SPN_StridedSpan){0};
+  }
+
+  return (SPN_StridedSpan){.begin        = &((const uint8_t *)span.begin)[offset],
+                           .len          = span.len,
+                           .element_size = field_size,
+                           .stride       = span.element_size};
+}
+
+SPN_StridedSpan SPN_strided_subspan(SPN_StridedSpan src, size_t begin_idx, size_t len) {
+  if(begin_idx > src.len) begin_idx = src.len;
+  if(begin_idx + len > src.len) len = (src.len - begin_idx);
+  return (SPN_StridedSpan){.begin        = SPN_strided_get(src, begin_idx),
+                           .len          = len,
+                           .element_size = src.element_size,
+                           .stride       = src.stride};
+}
+
+bool SPN_strided_equals(SPN_StridedSpan lhs, SPN_StridedSpan rhs) {
+  if(lhs.len != rhs.len) return false;
+  if(lhs.element_size != rhs.element_size) return false;
+  if(lhs.begin == rhs.begin && lhs.stride == rhs.stride) return true;
+
+  if(SPN_strided_is_contiguous(lhs) && SPN_strided_is_contiguous(rhs)) {
+    return (memcmp(lhs.begin, rhs.begin, lhs.len * lhs.element_size) == 0);
+  }
+
+  for(size_t idx = 0; idx < lhs.len; idx++) {
+    if(!is_equal(SPN_strided_get(lhs, idx), SPN_strided_get(rhs, idx), lhs.element_size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+STAT_Val SPN_strided_find(SPN_StridedSpan span, const void * element, size_t * o_idx) {
+  if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(element == NULL) return LOG_STAT(STAT_ERR_ARGS, "element is NULL");
+
+  const size_t idx = find_element_by_size(span, element);
+  if(idx == SIZE_MAX) return STAT_OK_NOT_FOUND;
+
+  if(o_idx != NULL) *o_idx = idx;
+  return OK;
+}
+
+STAT_Val SPN_strided_for_each(SPN_StridedSpan span, SPN_PredicateFn fn, void * ctx) {
+  if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(fn == NULL) return LOG_STAT(STAT_ERR_ARGS, "fn is NULL");
+
+  for(size_t idx = 0; idx < span.len; idx++) {
+    if(!fn(SPN_strided_get(span, idx), ctx)) break;
+  }
+
+  return OK;
+}
+
+STAT_Val SPN_strided_gather(SPN_StridedSpan span, SPN_MutSpan out) {
+  if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(out.begin == NULL) return LOG_STAT(STAT_ERR_ARGS, "out.begin is NULL");
+  if(out.element_size != span.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "element size mismatch (%zu != %zu)",
+                    out.element_size,
+                    span.element_size);
+  }
+  if(out.len < span.len) {
+    return LOG_STAT(STAT_ERR_RANGE, "out can't fit %zu elements (len=%zu)", span.len, out.len);
+  }
+
+  gather_elements(out.begin, span);
+  return OK;
+}
+
+STAT_Val SPN_strided_gather_append(DAR_DArray * out, SPN_StridedSpan span) {
+  if(out == NULL) return LOG_STAT(STAT_ERR_ARGS, "out is NULL");
+  if(!DAR_is_initialized(out)) return LOG_STAT(STAT_ERR_ARGS, "out is not initialized");
+  if(!is_valid(span)) return LOG_STAT(STAT_ERR_ARGS, "span not valid");
+  if(out->element_size != span.element_size) {
+    return LOG_STAT(STAT_ERR_ARGS,
+                    "element size mismatch (%zu != %zu)",
+                    out->element_size,
+                    span.element_size);
+  }
+  if(span.len == 0) return OK;
+
+  const size_t old_size = out->size;
+  if(!STAT_is_OK(DAR_resize(out, old_size + span.len))) {
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to resize out to %zu", old_size + span.len);
+  }
+
+  gather_elements(DAR_get(out, old_size), span);
+  return OK;
+}
@@ -0,0 +1,305 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "span_utf8.h"
+
+#include "log.h"
+#include "stat.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define OK STAT_OK
+
+static bool is_valid_byte_span(SPN_Span span) {
+  return (span.begin != NULL && span.element_size == 1);
+}
+
+static bool is_continuation(uint8_t byte) { return (byte & 0xc0) == 0x80; }
+
+// Returns the length of the sequence started by lead, or 0 if lead can't start one.
+static size_t get_sequence_len(uint8_t lead) {
+  if(lead < 0x80) return 1;
+  if(lead >= 0xc2 && lead <= 0xdf) return 2;
+  if(lead >= 0xe0 && lead <= 0xef) return 3;
+  if(lead >= 0xf0 && lead <= 0xf4) return 4;
+  return 0;
+}
+
+// ===================
+// == scalar checks ==
+
+// Returns the length of the longest valid prefix of bytes. A sequence cut off by the end of bytes
+// is not part of it.
+static size_t get_valid_prefix_len(const uint8_t * bytes, size_t len) {
+  size_t idx = 0;
+  while(idx < len) {
+    if((idx + sizeof(uint64_t)) <= len) {
+      uint64_t word = 0;
+      memcpy(&word, &bytes[idx], sizeof(word));
+      if((word & 0x8080808080808080ull) == 0) {
+        idx += sizeof(word);
+        continue;
+      }
+    }
+
+    const uint8_t lead    = bytes[idx];
+    const size_t  seq_len = get_sequence_len(lead);
+    if(seq_len == 0 || (idx + seq_len) > len) return idx;
+
+    if(seq_len > 1) {
+      // the second byte is where overlong encodings, surrogates and values past U+10FFFF show
+      uint8_t min = 0x80;
+      uint8_t max = 0xbf;
+      if(lead == 0xe0) min = 0xa0;
+      if(lead == 0xed) max = 0x9f;
+      if(lead == 0xf0) min = 0x90;
+      if(lead == 0xf4) max = 0x8f;
+      if(bytes[idx + 1] < min || bytes[idx + 1] > max) return idx;
+
+      for(size_t i = 2; i < seq_len; i++) {
+        if(!is_continuation(bytes[idx + i])) return idx;
+      }
+    }
+
+    idx += seq_len;
+  }
+
+  return len;
+}
+
+// ===================
+// == vector checks ==
+
+// Each byte is checked against the byte before it with three table lookups, one for each nibble
+// of the previous byte and one for the high nibble of the byte itself. Each table entry holds a
+// bit per kind of error that the nibble is compatible with, so the lookups ANDed together are
+// nonzero only where all three agree on an error. That catches every error within two bytes; what
+// remains is whether continuation bytes 3 and 4 are where the lead bytes say they should be.
+//
+// This needs a byte shuffle for the lookups, so SSSE3 or AVX2. Without, we check a codepoint at a
+// time, skipping ASCII a word at a time.
+//
+// As in span.c, the kernels are in span_utf8_kernels.h, which we include once for each
+// instruction set, and we use the widest ones for the level that span.c picked at load time.
+
+#if defined(__x86_64__)
+#define HAS_X86_KERNELS
+
+enum {
+  TOO_SHORT      = 1 << 0, // lead byte or ASCII after lead byte
+  TOO_LONG       = 1 << 1, // continuation after ASCII
+  OVERLONG_3     = 1 << 2, // 11100000 100_____
+  TOO_LARGE      = 1 << 3, // 11110100 1001____, 11110100 101_____, 11110101+ 1001____ etc.
+  SURROGATE      = 1 << 4, // 11101101 101_____
+  OVERLONG_2     = 1 << 5, // 1100000_ 10______
+  TOO_LARGE_1000 = 1 << 6, // 11110101+ 1000____
+  OVERLONG_4     = 1 << 6, // 11110000 1000____
+  TWO_CONTS      = 1 << 7, // continuation after continuation (checked against lead bytes later)
+  CARRY          = TOO_SHORT | TOO_LONG | TWO_CONTS,
+};
+
+static const uint8_t prev_high_table[16] = {
+    TOO_LONG,
+    TOO_LONG,
+    TOO_LONG,
+    TOO_LONG,
+    TOO_LONG,
+    TOO_LONG,
+    TOO_LONG,
+    TOO_LONG,
+    TWO_CONTS,
+    TWO_CONTS,
+    TWO_CONTS,
+    TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+static const uint8_t prev_low_table[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+static const uint8_t high_table[16] = {
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+    TOO_SHORT,
+};
+#endif
+
+#define KERNEL(name) name##_scalar
+#define KERNEL_TARGET
+#include "span_utf8_kernels.h"
+
+#if defined(HAS_X86_KERNELS)
+#define KERNEL(name)         name##_sse2
+#define KERNEL_TARGET        __attribute__((target("sse2")))
+#define VECTOR_SIZE_IN_BYTES 16
+#include "span_utf8_kernels.h"
+
+#define KERNEL(name)         name##_ssse3
+#define KERNEL_TARGET        __attribute__((target("ssse3")))
+#define VECTOR_SIZE_IN_BYTES 16
+#define HAS_VECTOR_LOOKUP
+#include "span_utf8_kernels.h"
+
+#define KERNEL(name)         name##_avx2
+#define KERNEL_TARGET        __attribute__((target("avx2")))
+#define VECTOR_SIZE_IN_BYTES 32
+#define HAS_VECTOR_LOOKUP
+#include "span_utf8_kernels.h"
+#endif
+
+typedef struct {
+  bool (*is_valid_utf8)(const uint8_t * bytes, size_t len);
+  size_t (*count_codepoints)(const uint8_t * bytes, size_t len);
+} Kernels;
+
+#define KERNELS(suffix)                                                                            \
+  {                                                                                                \
+    .is_valid_utf8    = is_valid_utf8_##suffix,                                                    \
+    .count_codepoints = count_codepoints_##suffix,                                                 \
+  }
+
+static const Kernels kernels_by_level[] = {
+    [SPN_INT_SIMD_NONE] = KERNELS(scalar),
+#if defined(HAS_X86_KERNELS)
+    [SPN_INT_SIMD_SSE2]  = KERNELS(sse2),
+    [SPN_INT_SIMD_SSSE3] = KERNELS(ssse3),
+    [SPN_INT_SIMD_AVX2]  = KERNELS(avx2),
+#endif
+};
+
+static const Kernels * get_kernels(void) { return &kernels_by_level[SPN_INT_get_simd_level()]; }
+
+// ======================
+// == public functions ==
+
+STAT_Val SPN_utf8_validate(SPN_Span bytes, size_t * o_valid_len) {
+  if(!is_valid_byte_span(bytes)) return LOG_STAT(STAT_ERR_ARGS, "bad span");
+
+  const uint8_t * begin = bytes.begin;
+
+  if(get_kernels()->is_valid_utf8(begin, bytes.len)) {
+    if(o_valid_len != NULL) *o_valid_len = bytes.len;
+    return STAT_OK_TRUE;
+  }
+
+  // invalid input should be the rare case, so we only now find where it goes wrong
+  if(o_valid_len != NULL) *o_valid_len = get_valid_prefix_len(begin, bytes.len);
+  return STAT_OK_FALSE;
+}
+
+STAT_Val SPN_utf8_count_codepoints(SPN_Span bytes, size_t * o_count) {
+  if(!is_valid_byte_span(bytes)) return LOG_STAT(STAT_ERR_ARGS, "bad span");
+  if(o_count == NULL) return LOG_STAT(STAT_ERR_ARGS, "o_count is NULL");
+
+  *o_count = get_kernels()->count_codepoints(bytes.begin, bytes.len);
+  return OK;
+}
+
+// ==========================
+// == streaming validation ==
+
+static STAT_Val fail_stream(SPN_Utf8Validator * this) {
+  this->is_invalid  = true;
+  this->num_pending = 0;
+  return STAT_OK_FALSE;
+}
+
+STAT_Val SPN_utf8_validator_feed(SPN_Utf8Validator * this, SPN_Span chunk) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(!is_valid_byte_span(chunk)) return LOG_STAT(STAT_ERR_ARGS, "bad span");
+  if(this->is_invalid) return STAT_OK_FALSE;
+
+  const uint8_t * bytes = chunk.begin;
+  size_t          idx   = 0;
+
+  if(this->num_pending > 0) {
+    // finish the codepoint that the last chunk cut off
+    const size_t seq_len = get_sequence_len(this->pending[0]);
+    const size_t missing = seq_len - this->num_pending;
+    const size_t to_copy = (missing < chunk.len) ? missing : chunk.len;
+
+    memcpy(&this->pending[this->num_pending], bytes, to_copy);
+    this->num_pending += to_copy;
+    idx = to_copy;
+
+    if(this->num_pending < seq_len) return STAT_OK_TRUE;
+    if(get_valid_prefix_len(this->pending, seq_len) != seq_len) return fail_stream(this);
+    this->num_pending = 0;
+  }
+
+  // hold back a codepoint that this chunk cuts off, which starts in the last 3 bytes
+  size_t end = chunk.len;
+  for(size_t i = 1; i <= 3 && i <= (chunk.len - idx); i++) {
+    const uint8_t byte = bytes[chunk.len - i];
+    if(is_continuation(byte)) continue;
+
+    if(get_sequence_len(byte) > i) end = chunk.len - i;
+    break;
+  }
+
+  if(!get_kernels()->is_valid_utf8(&bytes[idx], end - idx)) return fail_stream(this);
+
+  this->num_pending = chunk.len - end;
+  memcpy(this->pending, &bytes[end], this->num_pending);
+
+  return STAT_OK_TRUE;
+}
+
+STAT_Val SPN_utf8_validator_finish(SPN_Utf8Validator * this) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  if(this->is_invalid || this->num_pending > 0) return fail_stream(this);
+  return STAT_OK_TRUE;
+}
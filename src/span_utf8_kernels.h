@@ -0,0 +1,278 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// UTF-8 kernels for span_utf8.c, which includes this file once per instruction set, the same way
+// span.c includes span_kernels.h. Before each include, span_utf8.c defines KERNEL(name),
+// KERNEL_TARGET and VECTOR_SIZE_IN_BYTES (16, 32 or nothing), and HAS_VECTOR_LOOKUP if the
+// instruction set has a byte shuffle. All of these are undefined again at the end of this file.
+
+#define Vector               KERNEL(Vector)
+#define BlockChecker         KERNEL(BlockChecker)
+#define load_vector          KERNEL(load_vector)
+#define get_high_bit_mask    KERNEL(get_high_bit_mask)
+#define get_lead_mask        KERNEL(get_lead_mask)
+#define zero_vector          KERNEL(zero_vector)
+#define or_vectors           KERNEL(or_vectors)
+#define and_vectors          KERNEL(and_vectors)
+#define xor_vectors          KERNEL(xor_vectors)
+#define is_zero              KERNEL(is_zero)
+#define load_table           KERNEL(load_table)
+#define lookup               KERNEL(lookup)
+#define get_high_nibbles     KERNEL(get_high_nibbles)
+#define get_low_nibbles      KERNEL(get_low_nibbles)
+#define saturating_sub       KERNEL(saturating_sub)
+#define broadcast_byte       KERNEL(broadcast_byte)
+#define get_incomplete       KERNEL(get_incomplete)
+#define create_block_checker KERNEL(create_block_checker)
+#define check_block          KERNEL(check_block)
+#define has_error            KERNEL(has_error)
+#define is_valid_utf8        KERNEL(is_valid_utf8)
+#define count_codepoints     KERNEL(count_codepoints)
+
+#if defined(VECTOR_SIZE_IN_BYTES) && (VECTOR_SIZE_IN_BYTES == 32)
+typedef __m256i Vector;
+
+KERNEL_TARGET static inline Vector load_vector(const uint8_t * bytes) {
+  return _mm256_loadu_si256((const __m256i *)bytes);
+}
+KERNEL_TARGET static inline uint32_t get_high_bit_mask(Vector v) {
+  return (uint32_t)_mm256_movemask_epi8(v);
+}
+
+// Returns a bitmask of the bytes that are not continuation bytes.
+KERNEL_TARGET static inline uint32_t get_lead_mask(Vector v) {
+  return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)0xbf)));
+}
+
+KERNEL_TARGET static inline Vector zero_vector(void) { return _mm256_setzero_si256(); }
+KERNEL_TARGET static inline Vector or_vectors(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+KERNEL_TARGET static inline bool   is_zero(Vector v) { return _mm256_testz_si256(v, v) != 0; }
+
+KERNEL_TARGET static inline Vector load_table(const uint8_t table[16]) {
+  return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+KERNEL_TARGET static inline Vector lookup(Vector table, Vector nibbles) {
+  return _mm256_shuffle_epi8(table, nibbles);
+}
+KERNEL_TARGET static inline Vector get_high_nibbles(Vector v) {
+  return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+}
+KERNEL_TARGET static inline Vector get_low_nibbles(Vector v) {
+  return _mm256_and_si256(v, _mm256_set1_epi8(0x0f));
+}
+
+// Returns the bytes shifted by n, with the last n bytes of prev shifted in.
+#define SHIFT_IN(v, prev, n)                                                                       \
+  _mm256_alignr_epi8((v), _mm256_permute2x128_si256((prev), (v), 0x21), 16 - (n))
+
+KERNEL_TARGET static inline Vector and_vectors(Vector a, Vector b) {
+  return _mm256_and_si256(a, b);
+}
+KERNEL_TARGET static inline Vector xor_vectors(Vector a, Vector b) {
+  return _mm256_xor_si256(a, b);
+}
+KERNEL_TARGET static inline Vector saturating_sub(Vector v, uint8_t n) {
+  return _mm256_subs_epu8(v, _mm256_set1_epi8((char)n));
+}
+KERNEL_TARGET static inline Vector broadcast_byte(uint8_t b) {
+  return _mm256_set1_epi8((char)b);
+}
+
+// Returns nonzero bytes where a sequence runs past the end of v: the last byte leads a sequence
+// of at least 2, the one before of at least 3, or the one before that of 4.
+KERNEL_TARGET static inline Vector get_incomplete(Vector v) {
+  const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                       -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                       (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+  return _mm256_subs_epu8(v, max);
+}
+#elif defined(VECTOR_SIZE_IN_BYTES) && (VECTOR_SIZE_IN_BYTES == 16)
+typedef __m128i Vector;
+
+KERNEL_TARGET static inline Vector load_vector(const uint8_t * bytes) {
+  return _mm_loadu_si128((const __m128i *)bytes);
+}
+KERNEL_TARGET static inline uint32_t get_high_bit_mask(Vector v) {
+  return (uint32_t)_mm_movemask_epi8(v);
+}
+
+KERNEL_TARGET static inline uint32_t get_lead_mask(Vector v) {
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)0xbf)));
+}
+
+#if defined(HAS_VECTOR_LOOKUP)
+KERNEL_TARGET static inline Vector zero_vector(void) { return _mm_setzero_si128(); }
+KERNEL_TARGET static inline Vector or_vectors(Vector a, Vector b) { return _mm_or_si128(a, b); }
+KERNEL_TARGET static inline bool   is_zero(Vector v) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+}
+
+KERNEL_TARGET static inline Vector load_table(const uint8_t table[16]) {
+  return _mm_loadu_si128((const __m128i *)table);
+}
+KERNEL_TARGET static inline Vector lookup(Vector table, Vector nibbles) {
+  return _mm_shuffle_epi8(table, nibbles);
+}
+KERNEL_TARGET static inline Vector get_high_nibbles(Vector v) {
+  return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+}
+KERNEL_TARGET static inline Vector get_low_nibbles(Vector v) {
+  return _mm_and_si128(v, _mm_set1_epi8(0x0f));
+}
+
+#define SHIFT_IN(v, prev, n) _mm_alignr_epi8((v), (prev), 16 - (n))
+
+KERNEL_TARGET static inline Vector and_vectors(Vector a, Vector b) { return _mm_and_si128(a, b); }
+KERNEL_TARGET static inline Vector xor_vectors(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+KERNEL_TARGET static inline Vector saturating_sub(Vector v, uint8_t n) {
+  return _mm_subs_epu8(v, _mm_set1_epi8((char)n));
+}
+KERNEL_TARGET static inline Vector broadcast_byte(uint8_t b) { return _mm_set1_epi8((char)b); }
+
+KERNEL_TARGET static inline Vector get_incomplete(Vector v) {
+  const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                    (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+  return _mm_subs_epu8(v, max);
+}
+#endif
+#endif
+
+#if defined(HAS_VECTOR_LOOKUP)
+typedef struct {
+  Vector prev_high_table;
+  Vector prev_low_table;
+  Vector high_table;
+  Vector prev;       // previous block
+  Vector incomplete; // whether prev ends in the middle of a sequence
+  Vector error;      // accumulated errors, nonzero if any
+} BlockChecker;
+
+KERNEL_TARGET static BlockChecker create_block_checker(void) {
+  BlockChecker checker = {
+      .prev_high_table = load_table(prev_high_table),
+      .prev_low_table  = load_table(prev_low_table),
+      .high_table      = load_table(high_table),
+      .prev            = zero_vector(),
+      .incomplete      = zero_vector(),
+      .error           = zero_vector(),
+  };
+  return checker;
+}
+
+KERNEL_TARGET static inline void check_block(BlockChecker * checker, Vector block) {
+  if(get_high_bit_mask(block) == 0) {
+    // all ASCII, so only an unfinished sequence from the last block can be wrong
+    checker->error = or_vectors(checker->error, checker->incomplete);
+  } else {
+    const Vector prev1 = SHIFT_IN(block, checker->prev, 1);
+    const Vector prev2 = SHIFT_IN(block, checker->prev, 2);
+    const Vector prev3 = SHIFT_IN(block, checker->prev, 3);
+
+    const Vector special =
+        and_vectors(and_vectors(lookup(checker->prev_high_table, get_high_nibbles(prev1)),
+                                lookup(checker->prev_low_table, get_low_nibbles(prev1))),
+                    lookup(checker->high_table, get_high_nibbles(block)));
+
+    // bytes 3 and 4 of a sequence must be continuations, i.e. flagged TWO_CONTS above, and only
+    // those may be; subtracting makes the high bit set only for a lead of 3 (4) bytes back
+    const Vector is_third  = saturating_sub(prev2, 0xe0 - 0x80);
+    const Vector is_fourth = saturating_sub(prev3, 0xf0 - 0x80);
+    const Vector must_be_cont =
+        and_vectors(or_vectors(is_third, is_fourth), broadcast_byte(0x80));
+
+    checker->error      = or_vectors(checker->error, xor_vectors(must_be_cont, special));
+    checker->incomplete = get_incomplete(block);
+  }
+  checker->prev = block;
+}
+
+KERNEL_TARGET static bool has_error(const BlockChecker * checker) {
+  return !is_zero(checker->error);
+}
+
+// Returns whether bytes is valid UTF-8, given that the stream ends after it.
+KERNEL_TARGET static bool is_valid_utf8(const uint8_t * bytes, size_t len) {
+  BlockChecker checker = create_block_checker();
+  size_t       idx     = 0;
+
+  for(; (idx + VECTOR_SIZE_IN_BYTES) <= len; idx += VECTOR_SIZE_IN_BYTES) {
+    check_block(&checker, load_vector(&bytes[idx]));
+  }
+
+  if(idx < len) {
+    // pad with ASCII, which ends any sequence, so a truncated one shows as an error
+    uint8_t tail[VECTOR_SIZE_IN_BYTES] = {0};
+    memcpy(tail, &bytes[idx], len - idx);
+    check_block(&checker, load_vector(tail));
+  }
+  checker.error = or_vectors(checker.error, checker.incomplete);
+
+  return !has_error(&checker);
+}
+#else
+KERNEL_TARGET static bool is_valid_utf8(const uint8_t * bytes, size_t len) {
+  return get_valid_prefix_len(bytes, len) == len;
+}
+#endif
+
+KERNEL_TARGET static size_t count_codepoints(const uint8_t * bytes, size_t len) {
+  size_t idx   = 0;
+  size_t count = 0;
+
+#if defined(VECTOR_SIZE_IN_BYTES)
+  for(; (idx + VECTOR_SIZE_IN_BYTES) <= len; idx += VECTOR_SIZE_IN_BYTES) {
+    count += (size_t)__builtin_popcount(get_lead_mask(load_vector(&bytes[idx])));
+  }
+#endif
+
+  for(; idx < len; idx++) {
+    if(!is_continuation(bytes[idx])) count++;
+  }
+
+  return count;
+}
+
+#undef Vector
+#undef BlockChecker
+#undef load_vector
+#undef get_high_bit_mask
+#undef get_lead_mask
+#undef zero_vector
+#undef or_vectors
+#undef and_vectors
+#undef xor_vectors
+#undef is_zero
+#undef load_table
+#undef lookup
+#undef get_high_nibbles
+#undef get_low_nibbles
+#undef saturating_sub
+#undef broadcast_byte
+#undef get_incomplete
+#undef create_block_checker
+#undef check_block
+#undef has_error
+#undef is_valid_utf8
+#undef count_codepoints
+#undef SHIFT_IN
+
+#undef KERNEL
+#undef KERNEL_TARGET
+#undef VECTOR_SIZE_IN_BYTES
+#undef HAS_VECTOR_LOOKUP
@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2023 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Vector compares shared by the kernel files (span_kernels.h and mpsearch_kernels.h), which
+// include this file once per instruction set, so there is no include guard. It uses the KERNEL,
+// KERNEL_TARGET and VECTOR_SIZE_IN_BYTES of the including kernel file, and declares nothing when
+// VECTOR_SIZE_IN_BYTES is not defined. The names it aliases with KERNEL are undefined again by
+// the including kernel file, together with its own.
+
+#define Vector            KERNEL(Vector)
+#define broadcast_element KERNEL(broadcast_element)
+#define get_match_mask    KERNEL(get_match_mask)
+
+#if defined(VECTOR_SIZE_IN_BYTES) && (VECTOR_SIZE_IN_BYTES == 32)
+typedef __m256i Vector;
+
+KERNEL_TARGET static inline Vector broadcast_element(uint64_t value, size_t element_size) {
+  switch(element_size) {
+  case 1: return _mm256_set1_epi8((char)value);
+  case 2: return _mm256_set1_epi16((short)value);
+  case 4: return _mm256_set1_epi32((int)value);
+  default: return _mm256_set1_epi64x((long long)value);
+  }
+}
+
+KERNEL_TARGET static inline uint32_t get_match_mask(const uint8_t * bytes,
+                                                    Vector          needle,
+                                                    size_t          element_size) {
+  const __m256i block = _mm256_loadu_si256((const __m256i *)bytes);
+  switch(element_size) {
+  case 1: return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+  case 2: return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(block, needle));
+  case 4: return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(block, needle));
+  default: return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi64(block, needle));
+  }
+}
+#elif defined(VECTOR_SIZE_IN_BYTES) && (VECTOR_SIZE_IN_BYTES == 16)
+typedef __m128i Vector;
+
+KERNEL_TARGET static inline Vector broadcast_element(uint64_t value, size_t element_size) {
+  switch(element_size) {
+  case 1: return _mm_set1_epi8((char)value);
+  case 2: return _mm_set1_epi16((short)value);
+  case 4: return _mm_set1_epi32((int)value);
+  default: return _mm_set1_epi64x((long long)value);
+  }
+}
+
+KERNEL_TARGET static inline uint32_t get_match_mask(const uint8_t * bytes,
+                                                    Vector          needle,
+                                                    size_t          element_size) {
+  const __m128i block = _mm_loadu_si128((const __m128i *)bytes);
+  switch(element_size) {
+  case 1: return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+  case 2: return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(block, needle));
+  case 4: return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(block, needle));
+  default: {
+    // SSE2 has no 64-bit compare, so combine the results for both 32-bit halves
+    const __m128i halves = _mm_cmpeq_epi32(block, needle);
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1))));
+  }
+  }
+}
+#endif
@@ -0,0 +1,214 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "threadpool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define OK STAT_OK
+
+static _Thread_local const TP_Pool * g_current_pool = NULL;
+
+static TP_Pool        g_shared_pool;
+static bool           g_shared_pool_is_created = false;
+static pthread_once_t g_shared_pool_once       = PTHREAD_ONCE_INIT;
+
+static void run_tasks(TP_Pool * this) {
+  const TP_Pool * prev_pool = g_current_pool;
+  g_current_pool            = this;
+
+  while(true) {
+    const size_t task_idx = atomic_fetch_add(&this->next_task_idx, 1);
+    if(task_idx >= this->num_tasks) break;
+    this->task_fn(this->ctx, task_idx);
+  }
+
+  g_current_pool = prev_pool;
+}
+
+static void * worker_main(void * arg) {
+  TP_Pool * this            = arg;
+  size_t    seen_generation = 0;
+
+  while(true) {
+    pthread_mutex_lock(&this->mutex);
+    while(!this->is_shutting_down && (this->generation == seen_generation)) {
+      pthread_cond_wait(&this->work_cond, &this->mutex);
+    }
+    if(this->is_shutting_down) {
+      pthread_mutex_unlock(&this->mutex);
+      return NULL;
+    }
+    seen_generation = this->generation;
+    pthread_mutex_unlock(&this->mutex);
+
+    run_tasks(this);
+
+    pthread_mutex_lock(&this->mutex);
+    this->num_busy_threads--;
+    if(this->num_busy_threads == 0) pthread_cond_signal(&this->done_cond);
+    pthread_mutex_unlock(&this->mutex);
+  }
+}
+
+static void shut_down_threads(TP_Pool * this, size_t num_started) {
+  pthread_mutex_lock(&this->mutex);
+  this->is_shutting_down = true;
+  pthread_cond_broadcast(&this->work_cond);
+  pthread_mutex_unlock(&this->mutex);
+
+  for(size_t i = 0; i < num_started; i++) pthread_join(this->threads[i], NULL);
+}
+
+static void destroy_sync_primitives(TP_Pool * this) {
+  pthread_cond_destroy(&this->done_cond);
+  pthread_cond_destroy(&this->work_cond);
+  pthread_mutex_destroy(&this->mutex);
+  pthread_mutex_destroy(&this->run_mutex);
+}
+
+// Initializes the primitives one at a time, so that on failure only those that were initialized
+// are destroyed again.
+static bool init_sync_primitives(TP_Pool * this) {
+  if(pthread_mutex_init(&this->run_mutex, NULL) != 0) return false;
+
+  if(pthread_mutex_init(&this->mutex, NULL) != 0) {
+    pthread_mutex_destroy(&this->run_mutex);
+    return false;
+  }
+
+  if(pthread_cond_init(&this->work_cond, NULL) != 0) {
+    pthread_mutex_destroy(&this->mutex);
+    pthread_mutex_destroy(&this->run_mutex);
+    return false;
+  }
+
+  if(pthread_cond_init(&this->done_cond, NULL) != 0) {
+    pthread_cond_destroy(&this->work_cond);
+    pthread_mutex_destroy(&this->mutex);
+    pthread_mutex_destroy(&this->run_mutex);
+    return false;
+  }
+
+  return true;
+}
+
+STAT_Val TP_create(TP_Pool * this, size_t num_threads) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+
+  *this = (TP_Pool){0};
+  atomic_init(&this->next_task_idx, 0);
+
+  if(!init_sync_primitives(this)) {
+    *this = (TP_Pool){0};
+    return LOG_STAT(STAT_ERR_INTERNAL, "failed to initialize synchronization primitives");
+  }
+
+  if(num_threads == 0) return OK;
+
+  this->threads = calloc(num_threads, sizeof(pthread_t));
+  if(this->threads == NULL) {
+    destroy_sync_primitives(this);
+    return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate for %zu threads", num_threads);
+  }
+
+  for(size_t i = 0; i < num_threads; i++) {
+    if(pthread_create(&this->threads[i], NULL, worker_main, this) != 0) {
+      shut_down_threads(this, i);
+      destroy_sync_primitives(this);
+      free(this->threads);
+      *this = (TP_Pool){0};
+      return LOG_STAT(STAT_ERR_INTERNAL, "failed to start thread %zu", i);
+    }
+  }
+
+  this->num_threads = num_threads;
+
+  return OK;
+}
+
+STAT_Val TP_destroy(TP_Pool * this) {
+  if(this == NULL) return OK;
+
+  shut_down_threads(this, this->num_threads);
+  destroy_sync_primitives(this);
+  free(this->threads);
+
+  *this = (TP_Pool){0};
+
+  return OK;
+}
+
+STAT_Val TP_run(TP_Pool * this, TP_TaskFn task_fn, void * ctx, size_t num_tasks) {
+  if(this == NULL) return LOG_STAT(STAT_ERR_ARGS, "this is NULL");
+  if(task_fn == NULL) return LOG_STAT(STAT_ERR_ARGS, "task_fn is NULL");
+
+  if(num_tasks == 0) return OK;
+
+  // nested jobs, single tasks and pools without threads are all just run right here
+  if((g_current_pool == this) || (num_tasks == 1) || (this->num_threads == 0)) {
+    for(size_t i = 0; i < num_tasks; i++) task_fn(ctx, i);
+    return OK;
+  }
+
+  pthread_mutex_lock(&this->run_mutex);
+
+  pthread_mutex_lock(&this->mutex);
+  this->task_fn          = task_fn;
+  this->ctx              = ctx;
+  this->num_tasks        = num_tasks;
+  this->num_busy_threads = this->num_threads;
+  atomic_store(&this->next_task_idx, 0);
+  this->generation++;
+  pthread_cond_broadcast(&this->work_cond);
+  pthread_mutex_unlock(&this->mutex);
+
+  run_tasks(this);
+
+  pthread_mutex_lock(&this->mutex);
+  while(this->num_busy_threads > 0) pthread_cond_wait(&this->done_cond, &this->mutex);
+  pthread_mutex_unlock(&this->mutex);
+
+  pthread_mutex_unlock(&this->run_mutex);
+
+  return OK;
+}
+
+size_t TP_get_default_num_threads(void) {
+  const long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+  return (num_processors > 1) ? (size_t)(num_processors - 1) : 0;
+}
+
+static void destroy_shared_pool(void) { TP_destroy(&g_shared_pool); }
+
+static void create_shared_pool(void) {
+  if(STAT_is_OK(TP_create(&g_shared_pool, TP_get_default_num_threads()))) {
+    g_shared_pool_is_created = true;
+    atexit(destroy_shared_pool);
+  }
+}
+
+TP_Pool * TP_get_shared_pool(void) {
+  pthread_once(&g_shared_pool_once, create_shared_pool);
+  return g_shared_pool_is_created ? &g_shared_pool : NULL;
+}
@@ -0,0 +1,337 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "bitset.h"
+
+#define OK STAT_OK
+
+// sizes around word and block boundaries
+static const size_t sizes[] = {0, 1, 63, 64, 65, 255, 256, 257, 1000, 4096, 10007};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static void fill_random(BIT_Set * set, bool * expect, int percent_set) {
+  for(size_t i = 0; i < BIT_get_size(set); i++) {
+    expect[i] = (rand() % 100) < percent_set;
+    BIT_assign(set, i, expect[i]);
+  }
+}
+
+static Result tst_create_destroy(void) {
+  Result  r   = PASS;
+  BIT_Set set = {0};
+
+  EXPECT_OK(&r, BIT_create(&set, 100));
+  EXPECT_TRUE(&r, BIT_is_initialized(&set));
+  EXPECT_EQ(&r, 100, BIT_get_size(&set));
+  EXPECT_EQ(&r, 0, BIT_count(&set));
+  EXPECT_EQ(&r, 2, BIT_to_word_span(&set).len);
+  EXPECT_EQ(&r, 0, ((uintptr_t)BIT_to_word_span(&set).begin) % 32);
+  EXPECT_OK(&r, BIT_destroy(&set));
+  EXPECT_FALSE(&r, BIT_is_initialized(&set));
+
+  EXPECT_OK(&r, BIT_create(&set, 0));
+  EXPECT_EQ(&r, 0, BIT_count(&set));
+  EXPECT_OK(&r, BIT_destroy(&set));
+
+  EXPECT_NOK(&r, BIT_create(NULL, 10));
+  EXPECT_NOK(&r, BIT_create(&set, SIZE_MAX));
+  EXPECT_OK(&r, BIT_destroy(NULL));
+
+  return r;
+}
+
+static Result tst_set_test_clear(void) {
+  Result r = PASS;
+
+  for(size_t s = 0; s < NUM_SIZES; s++) {
+    const size_t n      = sizes[s];
+    bool *       expect = calloc(n + 1, sizeof(bool));
+    BIT_Set      set    = {0};
+    EXPECT_NE(&r, NULL, expect);
+    EXPECT_OK(&r, BIT_create(&set, n));
+    if(HAS_FAILED(&r)) return r;
+
+    fill_random(&set, expect, 50);
+    for(size_t i = 0; i < n; i += 3) {
+      BIT_set(&set, i);
+      expect[i] = true;
+    }
+    for(size_t i = 0; i < n; i += 5) {
+      BIT_clear(&set, i);
+      expect[i] = false;
+    }
+
+    size_t count = 0;
+    for(size_t i = 0; i < n; i++) {
+      EXPECT_EQ(&r, expect[i], BIT_test(&set, i));
+      count += expect[i] ? 1 : 0;
+    }
+    EXPECT_EQ(&r, count, BIT_count(&set));
+
+    BIT_set_all(&set);
+    EXPECT_EQ(&r, n, BIT_count(&set));
+    BIT_clear_all(&set);
+    EXPECT_EQ(&r, 0, BIT_count(&set));
+
+    EXPECT_OK(&r, BIT_destroy(&set));
+    free(expect);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_resize_and_copy(void) {
+  Result  r   = PASS;
+  BIT_Set set = {0};
+
+  EXPECT_OK(&r, BIT_create(&set, 300));
+  if(HAS_FAILED(&r)) return r;
+
+  BIT_set_all(&set);
+
+  // shrinking drops the bits beyond the size, so they come back clear when growing again
+  EXPECT_OK(&r, BIT_resize(&set, 70));
+  EXPECT_EQ(&r, 70, BIT_count(&set));
+  EXPECT_OK(&r, BIT_resize(&set, 1000));
+  EXPECT_EQ(&r, 70, BIT_count(&set));
+  EXPECT_TRUE(&r, BIT_test(&set, 69));
+  EXPECT_FALSE(&r, BIT_test(&set, 70));
+  EXPECT_FALSE(&r, BIT_test(&set, 299));
+
+  BIT_Set copy = {0};
+  EXPECT_OK(&r, BIT_create_from(&copy, &set));
+  EXPECT_EQ(&r, 1000, BIT_get_size(&copy));
+  EXPECT_EQ(&r, 70, BIT_count(&copy));
+  BIT_clear(&copy, 0);
+  EXPECT_TRUE(&r, BIT_test(&set, 0));
+
+  EXPECT_OK(&r, BIT_destroy(&copy));
+  EXPECT_OK(&r, BIT_destroy(&set));
+
+  EXPECT_NOK(&r, BIT_resize(&set, 10));
+  EXPECT_NOK(&r, BIT_create_from(&copy, &set));
+
+  return r;
+}
+
+static Result tst_set_range(void) {
+  Result  r   = PASS;
+  BIT_Set set = {0};
+
+  EXPECT_OK(&r, BIT_create(&set, 1000));
+  if(HAS_FAILED(&r)) return r;
+
+  const size_t ranges[][2] = {{0, 0}, {3, 4}, {10, 64}, {64, 128}, {100, 700}, {999, 1000}};
+  for(size_t i = 0; i < (sizeof(ranges) / sizeof(ranges[0])); i++) {
+    const size_t first = ranges[i][0];
+    const size_t last  = ranges[i][1];
+
+    BIT_clear_all(&set);
+    EXPECT_OK(&r, BIT_set_range(&set, first, last));
+    EXPECT_EQ(&r, last - first, BIT_count(&set));
+    for(size_t idx = 0; idx < 1000; idx++) {
+      EXPECT_EQ(&r, (idx >= first && idx < last), BIT_test(&set, idx));
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+
+  EXPECT_EQ(&r, STAT_ERR_RANGE, BIT_set_range(&set, 10, 1001));
+  EXPECT_EQ(&r, STAT_ERR_RANGE, BIT_set_range(&set, 11, 10));
+
+  EXPECT_OK(&r, BIT_destroy(&set));
+
+  return r;
+}
+
+static Result tst_rank_select_find_next(void) {
+  Result r = PASS;
+
+  const int percentages[] = {0, 1, 50, 99, 100};
+
+  for(size_t s = 0; s < NUM_SIZES; s++) {
+    for(size_t p = 0; p < (sizeof(percentages) / sizeof(percentages[0])); p++) {
+      const size_t n      = sizes[s];
+      bool *       expect = calloc(n + 1, sizeof(bool));
+      BIT_Set      set    = {0};
+      EXPECT_NE(&r, NULL, expect);
+      EXPECT_OK(&r, BIT_create(&set, n));
+      if(HAS_FAILED(&r)) return r;
+
+      fill_random(&set, expect, percentages[p]);
+
+      size_t rank = 0;
+      size_t next = 0;
+      for(size_t i = 0; i <= n; i++) {
+        EXPECT_EQ(&r, rank, BIT_rank(&set, i));
+
+        // find_next from any index lands on the next set bit
+        while(next < n && (next < i || !expect[next])) next++;
+        size_t found = SIZE_MAX;
+        if(next < n) {
+          EXPECT_OK(&r, BIT_find_next_set(&set, i, &found));
+          EXPECT_EQ(&r, next, found);
+        } else {
+          EXPECT_EQ(&r, STAT_OK_NOT_FOUND, BIT_find_next_set(&set, i, &found));
+        }
+
+        if(i < n && expect[i]) {
+          size_t selected = SIZE_MAX;
+          EXPECT_OK(&r, BIT_select(&set, rank, &selected));
+          EXPECT_EQ(&r, i, selected);
+          rank++;
+        }
+        if(HAS_FAILED(&r)) break;
+      }
+
+      size_t idx = 0;
+      EXPECT_EQ(&r, STAT_OK_NOT_FOUND, BIT_select(&set, rank, &idx));
+      EXPECT_EQ(&r, rank, BIT_count(&set));
+      EXPECT_EQ(&r, rank, BIT_rank(&set, SIZE_MAX));
+
+      EXPECT_OK(&r, BIT_destroy(&set));
+      free(expect);
+      if(HAS_FAILED(&r)) return r;
+    }
+  }
+
+  return r;
+}
+
+static Result tst_bulk_operations(void) {
+  Result r = PASS;
+
+  for(size_t s = 0; s < NUM_SIZES; s++) {
+    const size_t n      = sizes[s];
+    bool *       lhs    = calloc(n + 1, sizeof(bool));
+    bool *       rhs    = calloc(n + 1, sizeof(bool));
+    BIT_Set      a      = {0};
+    BIT_Set      b      = {0};
+    BIT_Set      result = {0};
+    EXPECT_NE(&r, NULL, lhs);
+    EXPECT_NE(&r, NULL, rhs);
+    EXPECT_OK(&r, BIT_create(&a, n));
+    EXPECT_OK(&r, BIT_create(&b, n));
+    if(HAS_FAILED(&r)) return r;
+
+    fill_random(&a, lhs, 50);
+    fill_random(&b, rhs, 50);
+
+    for(int op = 0; op < 4; op++) {
+      EXPECT_OK(&r, BIT_create_from(&result, &a));
+      if(HAS_FAILED(&r)) return r;
+
+      switch(op) {
+      case 0: EXPECT_OK(&r, BIT_and(&result, &b)); break;
+      case 1: EXPECT_OK(&r, BIT_or(&result, &b)); break;
+      case 2: EXPECT_OK(&r, BIT_xor(&result, &b)); break;
+      case 3: EXPECT_OK(&r, BIT_andnot(&result, &b)); break;
+      }
+
+      size_t count = 0;
+      for(size_t i = 0; i < n; i++) {
+        bool expect = false;
+        switch(op) {
+        case 0: expect = lhs[i] && rhs[i]; break;
+        case 1: expect = lhs[i] || rhs[i]; break;
+        case 2: expect = lhs[i] != rhs[i]; break;
+        case 3: expect = lhs[i] && !rhs[i]; break;
+        }
+        EXPECT_EQ(&r, expect, BIT_test(&result, i));
+        count += expect ? 1 : 0;
+      }
+      EXPECT_EQ(&r, count, BIT_count(&result));
+
+      EXPECT_OK(&r, BIT_destroy(&result));
+      if(HAS_FAILED(&r)) return r;
+    }
+
+    EXPECT_OK(&r, BIT_destroy(&a));
+    EXPECT_OK(&r, BIT_destroy(&b));
+    free(lhs);
+    free(rhs);
+  }
+
+  // sizes must match
+  BIT_Set a = {0};
+  BIT_Set b = {0};
+  EXPECT_OK(&r, BIT_create(&a, 100));
+  EXPECT_OK(&r, BIT_create(&b, 101));
+  EXPECT_NOK(&r, BIT_and(&a, &b));
+  EXPECT_NOK(&r, BIT_or(&a, &b));
+  EXPECT_NOK(&r, BIT_xor(&a, &b));
+  EXPECT_NOK(&r, BIT_andnot(&a, &b));
+  EXPECT_NOK(&r, BIT_and(&a, NULL));
+  EXPECT_OK(&r, BIT_destroy(&a));
+  EXPECT_OK(&r, BIT_destroy(&b));
+
+  return r;
+}
+
+static Result tst_at_each_simd_level(void) {
+  Result r = PASS;
+
+  // the kernels for each level the CPU supports, not just the widest one
+  const Test checks[] = {
+      tst_set_range,
+      tst_rank_select_find_next,
+      tst_bulk_operations,
+  };
+
+  for(BIT_INT_SimdLevel level = BIT_INT_SIMD_NONE; level <= BIT_INT_SIMD_AVX2; level++) {
+    const BIT_INT_SimdLevel used = BIT_INT_set_max_simd_level(level);
+    EXPECT_TRUE(&r, used <= level);
+    EXPECT_EQ(&r, used, BIT_INT_get_simd_level());
+
+    for(size_t i = 0; i < (sizeof(checks) / sizeof(checks[0])); i++) {
+      EXPECT_EQ(&r, PASS, checks[i]());
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+
+  BIT_INT_set_max_simd_level(BIT_INT_SIMD_AVX2);
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_create_destroy,
+      tst_set_test_clear,
+      tst_resize_and_copy,
+      tst_set_range,
+      tst_rank_select_find_next,
+      tst_bulk_operations,
+      tst_at_each_simd_level,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
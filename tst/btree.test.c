@@ -0,0 +1,457 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "darray.h"
+#include "span.h"
+#include "stat.h"
+#include "test_utils.h"
+
+#include "btree.h"
+
+#define OK STAT_OK
+
+#define SMALL_NODE_SIZE 128 // forces deep trees with few entries
+
+static int compare_u32(const void * lhs, const void * rhs) {
+  const uint32_t l = *(const uint32_t *)lhs;
+  const uint32_t r = *(const uint32_t *)rhs;
+  return (l > r) - (l < r);
+}
+
+// Checks that iterating the map gives exactly the keys in present (in order), with their values.
+static Result check_against_reference(const BT_Map *   map,
+                                      const bool *     present,
+                                      const uint32_t * values,
+                                      uint32_t         universe) {
+  Result r = PASS;
+
+  BT_Iterator it       = BT_begin(map);
+  size_t      num_seen = 0;
+  for(uint32_t k = 0; k < universe; k++) {
+    if(!present[k]) continue;
+
+    EXPECT_FALSE(&r, BT_is_end(it));
+    if(HAS_FAILED(&r)) return r;
+    EXPECT_EQ(&r, k, *(const uint32_t *)BT_get_key(it));
+    EXPECT_EQ(&r, values[k], *(const uint32_t *)BT_get_value(it));
+    if(HAS_FAILED(&r)) return r;
+
+    BT_next(&it);
+    num_seen++;
+  }
+  EXPECT_TRUE(&r, BT_is_end(it));
+  EXPECT_EQ(&r, num_seen, BT_get_size(map));
+
+  return r;
+}
+
+static Result tst_create_destroy(void) {
+  Result r   = PASS;
+  BT_Map map = {0};
+
+  EXPECT_OK(&r, BT_create(&map, sizeof(uint32_t), sizeof(uint32_t), compare_u32));
+  EXPECT_TRUE(&r, BT_is_initialized(&map));
+  EXPECT_TRUE(&r, BT_is_empty(&map));
+  EXPECT_TRUE(&r, BT_is_end(BT_begin(&map)));
+  EXPECT_TRUE(&r, BT_is_end(BT_lower_bound(&map, &(uint32_t){0})));
+  EXPECT_EQ(&r, NULL, BT_get(&map, &(uint32_t){0}));
+  EXPECT_OK(&r, BT_destroy(&map));
+  EXPECT_FALSE(&r, BT_is_initialized(&map));
+
+  EXPECT_NOK(&r, BT_create(NULL, sizeof(uint32_t), sizeof(uint32_t), compare_u32));
+  EXPECT_NOK(&r, BT_create(&map, 0, sizeof(uint32_t), compare_u32));
+  EXPECT_NOK(&r, BT_create_with_node_size(&map, 256, 256, NULL, 512)); // can't fit 4 entries
+  EXPECT_NOK(&r, BT_set(&map, &(uint32_t){0}, &(uint32_t){0}));
+  EXPECT_OK(&r, BT_destroy(NULL));
+
+  return r;
+}
+
+static Result tst_set_get_remove(void) {
+  Result r   = PASS;
+  BT_Map map = {0};
+
+  EXPECT_OK(&r, BT_create(&map, sizeof(uint32_t), sizeof(uint32_t), compare_u32));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, BT_set(&map, &(uint32_t){5}, &(uint32_t){50}));
+  EXPECT_OK(&r, BT_set(&map, &(uint32_t){3}, &(uint32_t){30}));
+  EXPECT_OK(&r, BT_set(&map, &(uint32_t){5}, &(uint32_t){55})); // overwrite
+  EXPECT_EQ(&r, 2, BT_get_size(&map));
+  if(HAS_FAILED(&r)) return r;
+
+  uint32_t * value = BT_get(&map, &(uint32_t){5});
+  EXPECT_NE(&r, NULL, value);
+  if(HAS_FAILED(&r)) return r;
+  EXPECT_EQ(&r, 55, *value);
+  *value = 56;
+  EXPECT_EQ(&r, 56, *(const uint32_t *)BT_get((const BT_Map *)&map, &(uint32_t){5}));
+
+  EXPECT_TRUE(&r, BT_contains(&map, &(uint32_t){3}));
+  EXPECT_FALSE(&r, BT_contains(&map, &(uint32_t){4}));
+
+  EXPECT_OK(&r, BT_remove(&map, &(uint32_t){3}));
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, BT_remove(&map, &(uint32_t){3}));
+  EXPECT_FALSE(&r, BT_contains(&map, &(uint32_t){3}));
+  EXPECT_EQ(&r, 1, BT_get_size(&map));
+
+  EXPECT_NOK(&r, BT_set(&map, NULL, &(uint32_t){0}));
+  EXPECT_NOK(&r, BT_set(&map, &(uint32_t){0}, NULL));
+  EXPECT_NOK(&r, BT_remove(&map, NULL));
+
+  EXPECT_OK(&r, BT_clear(&map));
+  EXPECT_TRUE(&r, BT_is_empty(&map));
+  EXPECT_TRUE(&r, BT_is_end(BT_begin(&map)));
+  EXPECT_OK(&r, BT_set(&map, &(uint32_t){1}, &(uint32_t){10}));
+  EXPECT_EQ(&r, 1, BT_get_size(&map));
+
+  EXPECT_OK(&r, BT_destroy(&map));
+
+  return r;
+}
+
+static Result tst_many_random_operations(void) {
+  Result r = PASS;
+
+  enum { UNIVERSE = 2000, NUM_OPS = 20000 };
+
+  bool     present[UNIVERSE] = {0};
+  uint32_t values[UNIVERSE]  = {0};
+  size_t   size              = 0;
+
+  BT_Map map = {0};
+  EXPECT_OK(&r,
+            BT_create_with_node_size(&map,
+                                     sizeof(uint32_t),
+                                     sizeof(uint32_t),
+                                     compare_u32,
+                                     SMALL_NODE_SIZE));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t op = 0; op < NUM_OPS; op++) {
+    const uint32_t key = (uint32_t)(rand() % UNIVERSE);
+
+    // grow for the first half, then shrink, so that we go through both splits and merges
+    const bool do_insert = (rand() % 4) < ((op < (NUM_OPS / 2)) ? 3 : 1);
+
+    if(do_insert) {
+      const uint32_t value = (uint32_t)rand();
+      EXPECT_OK(&r, BT_set(&map, &key, &value));
+      if(!present[key]) size++;
+      present[key] = true;
+      values[key]  = value;
+    } else {
+      EXPECT_EQ(&r, present[key] ? OK : STAT_OK_NOT_FOUND, BT_remove(&map, &key));
+      if(present[key]) size--;
+      present[key] = false;
+    }
+    EXPECT_EQ(&r, size, BT_get_size(&map));
+    if(HAS_FAILED(&r)) break;
+
+    if((op % 1000) == 0) {
+      r = check_against_reference(&map, present, values, UNIVERSE);
+      if(HAS_FAILED(&r)) break;
+    }
+  }
+
+  if(!HAS_FAILED(&r)) r = check_against_reference(&map, present, values, UNIVERSE);
+
+  // remove everything, in random order
+  for(size_t i = 0; i < (UNIVERSE * 4) && !HAS_FAILED(&r); i++) {
+    const uint32_t key = (uint32_t)(rand() % UNIVERSE);
+    EXPECT_EQ(&r, present[key] ? OK : STAT_OK_NOT_FOUND, BT_remove(&map, &key));
+    present[key] = false;
+  }
+  for(uint32_t key = 0; key < UNIVERSE && !HAS_FAILED(&r); key++) {
+    EXPECT_EQ(&r, present[key] ? OK : STAT_OK_NOT_FOUND, BT_remove(&map, &key));
+  }
+  EXPECT_TRUE(&r, BT_is_empty(&map));
+  EXPECT_EQ(&r, 1, map.height);
+  EXPECT_TRUE(&r, BT_is_end(BT_begin(&map)));
+
+  EXPECT_OK(&r, BT_destroy(&map));
+
+  return r;
+}
+
+typedef struct {
+  uint32_t keys[16];
+  size_t   num_keys;
+  size_t   max_keys;
+} ScanCtx;
+
+static bool collect_key(const void * key, const void * value, void * ctx) {
+  (void)value;
+  ScanCtx * scan = ctx;
+
+  scan->keys[scan->num_keys++] = *(const uint32_t *)key;
+
+  return scan->num_keys < scan->max_keys;
+}
+
+static Result tst_bounds_and_scan(void) {
+  Result r   = PASS;
+  BT_Map map = {0};
+
+  EXPECT_OK(&r,
+            BT_create_with_node_size(&map,
+                                     sizeof(uint32_t),
+                                     sizeof(uint32_t),
+                                     compare_u32,
+                                     SMALL_NODE_SIZE));
+  if(HAS_FAILED(&r)) return r;
+
+  // even keys only
+  for(uint32_t k = 0; k < 1000; k += 2) EXPECT_OK(&r, BT_set(&map, &k, &(uint32_t){k * 10}));
+  EXPECT_GE(&r, map.height, 3);
+  if(HAS_FAILED(&r)) return r;
+
+  BT_Iterator it = BT_lower_bound(&map, &(uint32_t){501});
+  EXPECT_FALSE(&r, BT_is_end(it));
+  if(HAS_FAILED(&r)) return r;
+  EXPECT_EQ(&r, 502, *(const uint32_t *)BT_get_key(it));
+  EXPECT_EQ(&r, 5020, *(const uint32_t *)BT_get_value(it));
+
+  it = BT_lower_bound(&map, &(uint32_t){502});
+  EXPECT_EQ(&r, 502, *(const uint32_t *)BT_get_key(it));
+  it = BT_upper_bound(&map, &(uint32_t){502});
+  EXPECT_EQ(&r, 504, *(const uint32_t *)BT_get_key(it));
+
+  EXPECT_TRUE(&r, BT_is_end(BT_lower_bound(&map, &(uint32_t){999})));
+  EXPECT_TRUE(&r, BT_is_end(BT_upper_bound(&map, &(uint32_t){998})));
+  EXPECT_EQ(&r, 0, *(const uint32_t *)BT_get_key(BT_lower_bound(&map, &(uint32_t){0})));
+
+  // [100, 110) has 100 .. 108
+  ScanCtx scan = {.max_keys = 16};
+  EXPECT_OK(&r, BT_scan_range(&map, &(uint32_t){99}, &(uint32_t){110}, collect_key, &scan));
+  EXPECT_EQ(&r, 5, scan.num_keys);
+  for(size_t i = 0; i < scan.num_keys; i++) EXPECT_EQ(&r, 100 + (2 * i), scan.keys[i]);
+
+  // stopping early
+  scan = (ScanCtx){.max_keys = 3};
+  EXPECT_EQ(&r,
+            STAT_OK_FINISHED,
+            BT_scan_range(&map, &(uint32_t){0}, &(uint32_t){1000}, collect_key, &scan));
+  EXPECT_EQ(&r, 3, scan.num_keys);
+  EXPECT_EQ(&r, 4, scan.keys[2]);
+
+  // empty range
+  scan = (ScanCtx){.max_keys = 16};
+  EXPECT_OK(&r, BT_scan_range(&map, &(uint32_t){10}, &(uint32_t){10}, collect_key, &scan));
+  EXPECT_EQ(&r, 0, scan.num_keys);
+
+  EXPECT_NOK(&r, BT_scan_range(&map, NULL, &(uint32_t){10}, collect_key, &scan));
+  EXPECT_NOK(&r, BT_scan_range(&map, &(uint32_t){0}, &(uint32_t){10}, NULL, &scan));
+
+  EXPECT_OK(&r, BT_destroy(&map));
+
+  return r;
+}
+
+static Result tst_load_sorted(void) {
+  Result r = PASS;
+
+  enum { UNIVERSE = 5000 };
+
+  bool     present[UNIVERSE] = {0};
+  uint32_t values[UNIVERSE]  = {0};
+
+  DAR_DArray keys_arr   = {0};
+  DAR_DArray values_arr = {0};
+  EXPECT_OK(&r, DAR_create(&keys_arr, sizeof(uint32_t)));
+  EXPECT_OK(&r, DAR_create(&values_arr, sizeof(uint32_t)));
+  if(HAS_FAILED(&r)) return r;
+
+  // try several sizes, so that we get trees of various heights and partially filled levels
+  const size_t sizes[] = {0, 1, 7, 100, 1234, UNIVERSE};
+  for(size_t s = 0; s < (sizeof(sizes) / sizeof(sizes[0])) && !HAS_FAILED(&r); s++) {
+    DAR_clear(&keys_arr);
+    DAR_clear(&values_arr);
+    memset(present, 0, sizeof(present));
+
+    for(uint32_t k = 0; k < UNIVERSE && keys_arr.size < sizes[s]; k++) {
+      if(sizes[s] < UNIVERSE && (rand() % 3) != 0) continue;
+      values[k]  = (uint32_t)rand();
+      present[k] = true;
+      EXPECT_OK(&r, DAR_push_back(&keys_arr, &k));
+      EXPECT_OK(&r, DAR_push_back(&values_arr, &values[k]));
+    }
+
+    BT_Map map = {0};
+    EXPECT_OK(&r,
+              BT_create_with_node_size(&map,
+                                       sizeof(uint32_t),
+                                       sizeof(uint32_t),
+                                       compare_u32,
+                                       SMALL_NODE_SIZE));
+    if(HAS_FAILED(&r)) break;
+
+    EXPECT_OK(&r, BT_load_sorted(&map, DAR_to_span(&keys_arr), DAR_to_span(&values_arr)));
+    if(!HAS_FAILED(&r)) r = check_against_reference(&map, present, values, UNIVERSE);
+
+    // the loaded tree must remain valid under modification
+    for(size_t i = 0; i < 2000 && !HAS_FAILED(&r); i++) {
+      const uint32_t key = (uint32_t)(rand() % UNIVERSE);
+      if(rand() % 2) {
+        values[key] = (uint32_t)rand();
+        EXPECT_OK(&r, BT_set(&map, &key, &values[key]));
+        present[key] = true;
+      } else {
+        EXPECT_EQ(&r, present[key] ? OK : STAT_OK_NOT_FOUND, BT_remove(&map, &key));
+        present[key] = false;
+      }
+    }
+    if(!HAS_FAILED(&r)) r = check_against_reference(&map, present, values, UNIVERSE);
+
+    // only an empty map can be loaded
+    if(!BT_is_empty(&map)) {
+      EXPECT_NOK(&r, BT_load_sorted(&map, DAR_to_span(&keys_arr), DAR_to_span(&values_arr)));
+    }
+
+    EXPECT_OK(&r, BT_destroy(&map));
+  }
+
+  // unsorted and duplicate keys are rejected
+  BT_Map map = {0};
+  EXPECT_OK(&r, BT_create(&map, sizeof(uint32_t), sizeof(uint32_t), compare_u32));
+  const uint32_t unsorted[] = {1, 3, 2};
+  const uint32_t dupes[]    = {1, 2, 2};
+  const uint32_t vals[]     = {0, 0, 0};
+  const SPN_Span vals_span  = {.begin = vals, .len = 3, .element_size = sizeof(uint32_t)};
+  EXPECT_NOK(&r,
+             BT_load_sorted(&map,
+                            (SPN_Span){.begin = unsorted, .len = 3, .element_size = 4},
+                            vals_span));
+  EXPECT_NOK(&r,
+             BT_load_sorted(&map,
+                            (SPN_Span){.begin = dupes, .len = 3, .element_size = 4},
+                            vals_span));
+  EXPECT_NOK(&r,
+             BT_load_sorted(&map,
+                            (SPN_Span){.begin = dupes, .len = 2, .element_size = 4},
+                            vals_span));
+  EXPECT_TRUE(&r, BT_is_empty(&map));
+  EXPECT_OK(&r, BT_destroy(&map));
+
+  DAR_destroy(&keys_arr);
+  DAR_destroy(&values_arr);
+
+  return r;
+}
+
+static Result tst_key_only(void) {
+  Result r   = PASS;
+  BT_Map map = {0};
+
+  enum { NUM_KEYS = 1000 };
+
+  // a set: values have no size, so they may be NULL
+  EXPECT_OK(&r, BT_create_with_node_size(&map, sizeof(uint32_t), 0, compare_u32, SMALL_NODE_SIZE));
+  if(HAS_FAILED(&r)) return r;
+
+  // in a scrambled order, so that leaves split in the middle as well as at the end
+  for(uint32_t i = 0; i < NUM_KEYS; i++) {
+    EXPECT_OK(&r, BT_set(&map, &(uint32_t){(i * 7919) % NUM_KEYS}, NULL));
+  }
+  EXPECT_OK(&r, BT_set(&map, &(uint32_t){500}, NULL)); // already there
+  EXPECT_EQ(&r, NUM_KEYS, BT_get_size(&map));
+
+  uint32_t expect = 0;
+  for(BT_Iterator it = BT_begin(&map); !BT_is_end(it) && !HAS_FAILED(&r); BT_next(&it)) {
+    EXPECT_EQ(&r, expect++, *(const uint32_t *)BT_get_key(it));
+  }
+  EXPECT_EQ(&r, NUM_KEYS, expect);
+
+  for(uint32_t k = 0; k < NUM_KEYS; k += 2) EXPECT_OK(&r, BT_remove(&map, &k));
+  EXPECT_EQ(&r, NUM_KEYS / 2, BT_get_size(&map));
+  EXPECT_FALSE(&r, BT_contains(&map, &(uint32_t){500}));
+  EXPECT_TRUE(&r, BT_contains(&map, &(uint32_t){501}));
+
+  // loading needs no values either
+  uint32_t keys[NUM_KEYS];
+  for(uint32_t k = 0; k < NUM_KEYS; k++) keys[k] = k;
+  EXPECT_OK(&r, BT_clear(&map));
+  EXPECT_OK(&r,
+            BT_load_sorted(&map,
+                           (SPN_Span){.begin = keys, .len = NUM_KEYS, .element_size = 4},
+                           (SPN_Span){.begin = NULL, .len = NUM_KEYS, .element_size = 0}));
+  EXPECT_EQ(&r, NUM_KEYS, BT_get_size(&map));
+  EXPECT_TRUE(&r, BT_contains(&map, &(uint32_t){NUM_KEYS - 1}));
+
+  EXPECT_OK(&r, BT_destroy(&map));
+
+  return r;
+}
+
+static Result tst_memcmp_string_keys(void) {
+  Result r   = PASS;
+  BT_Map map = {0};
+
+  enum { KEY_SIZE = 8 };
+
+  // without cmp, keys are ordered as byte strings, which suits fixed-width (padded) strings
+  EXPECT_OK(&r, BT_create(&map, KEY_SIZE, sizeof(int), NULL));
+  if(HAS_FAILED(&r)) return r;
+
+  const char words[][KEY_SIZE] = {"pear", "apple", "fig", "banana", "cherry", "apricot"};
+  const char sorted[][KEY_SIZE] = {"apple", "apricot", "banana", "cherry", "fig", "pear"};
+  const size_t num_words        = sizeof(words) / sizeof(words[0]);
+
+  for(size_t i = 0; i < num_words; i++) EXPECT_OK(&r, BT_set(&map, words[i], &(int){(int)i}));
+  EXPECT_EQ(&r, num_words, BT_get_size(&map));
+  if(HAS_FAILED(&r)) return r;
+
+  size_t idx = 0;
+  for(BT_Iterator it = BT_begin(&map); !BT_is_end(it); BT_next(&it)) {
+    EXPECT_EQ(&r, 0, memcmp(sorted[idx], BT_get_key(it), KEY_SIZE));
+    idx++;
+  }
+  EXPECT_EQ(&r, num_words, idx);
+
+  const char prefix[KEY_SIZE] = "b";
+  EXPECT_EQ(&r, 0, memcmp(sorted[2], BT_get_key(BT_lower_bound(&map, prefix)), KEY_SIZE));
+  EXPECT_EQ(&r, 3, *(const int *)BT_get(&map, "banana\0"));
+
+  EXPECT_OK(&r, BT_destroy(&map));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_create_destroy,
+      tst_set_get_remove,
+      tst_many_random_operations,
+      tst_bounds_and_scan,
+      tst_load_sorted,
+      tst_key_only,
+      tst_memcmp_string_keys,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "cowarray.h"
+
+#define OK STAT_OK
+
+static Result tst_create_destroy(void) {
+  Result    r   = PASS;
+  COW_Array arr = {0};
+
+  EXPECT_FALSE(&r, COW_is_initialized(&arr));
+  EXPECT_EQ(&r, OK, COW_create(&arr, sizeof(int)));
+  EXPECT_TRUE(&r, COW_is_initialized(&arr));
+  EXPECT_FALSE(&r, COW_is_shared(&arr));
+  EXPECT_EQ(&r, 0, COW_get_size(&arr));
+  EXPECT_EQ(&r, sizeof(int), COW_get(&arr)->element_size);
+  EXPECT_EQ(&r, OK, COW_destroy(&arr));
+  EXPECT_FALSE(&r, COW_is_initialized(&arr));
+
+  EXPECT_EQ(&r, OK, COW_create_from_span(&arr, SPN_from_cstr("hello")));
+  EXPECT_EQ(&r, 5, COW_get_size(&arr));
+  EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr("hello"), COW_to_span(&arr)));
+  EXPECT_EQ(&r, OK, COW_destroy(&arr));
+
+  EXPECT_EQ(&r, OK, COW_destroy(&arr));
+  EXPECT_EQ(&r, OK, COW_destroy(NULL));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_create(NULL, sizeof(int)));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_create(&arr, 0));
+  EXPECT_NOK(&r, COW_create_from_span(&arr, (SPN_Span){0}));
+  EXPECT_FALSE(&r, COW_is_initialized(&arr));
+
+  return r;
+}
+
+static Result tst_copy_shares(void) {
+  Result    r    = PASS;
+  COW_Array arr  = {0};
+  COW_Array copy = {0};
+
+  const size_t num_vals = 1000;
+
+  EXPECT_EQ(&r, OK, COW_create(&arr, sizeof(int)));
+  if(HAS_FAILED(&r)) return r;
+
+  DAR_DArray * mut = NULL;
+  EXPECT_EQ(&r, OK, COW_get_mut(&arr, &mut));
+  if(HAS_FAILED(&r)) return r;
+  for(int i = 0; i < (int)num_vals; i++) EXPECT_EQ(&r, OK, DAR_push_back(mut, &i));
+
+  // copying shares the same storage
+  EXPECT_EQ(&r, OK, COW_copy(&copy, &arr));
+  EXPECT_TRUE(&r, COW_is_shared(&arr));
+  EXPECT_TRUE(&r, COW_is_shared(&copy));
+  EXPECT_EQ(&r, COW_get(&arr), COW_get(&copy));
+  EXPECT_EQ(&r, COW_get(&arr)->data, COW_get(&copy)->data);
+
+  // destroying one of them leaves the other intact
+  EXPECT_EQ(&r, OK, COW_destroy(&arr));
+  EXPECT_FALSE(&r, COW_is_shared(&copy));
+  EXPECT_EQ(&r, num_vals, COW_get_size(&copy));
+  EXPECT_EQ(&r, 999, *(const int *)DAR_last(COW_get(&copy)));
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_copy(&arr, NULL));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_copy(NULL, &copy));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_copy(&copy, &arr));
+
+  EXPECT_EQ(&r, OK, COW_destroy(&copy));
+
+  return r;
+}
+
+static Result tst_copy_into_live_array(void) {
+  Result    r     = PASS;
+  COW_Array arr   = {0};
+  COW_Array other = {0};
+  COW_Array copy  = {0};
+
+  EXPECT_EQ(&r, OK, COW_create_from_span(&arr, SPN_from_cstr("hello")));
+  EXPECT_EQ(&r, OK, COW_create_from_span(&other, SPN_from_cstr("world!")));
+  EXPECT_EQ(&r, OK, COW_copy(&copy, &other));
+  if(HAS_FAILED(&r)) return r;
+
+  // arr's storage is released (or the leak check fails), other's is now shared by three
+  EXPECT_EQ(&r, OK, COW_copy(&arr, &other));
+  EXPECT_EQ(&r, COW_get(&other), COW_get(&arr));
+  EXPECT_EQ(&r, 3, RC_get_ref_count(other.ref));
+  EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr("world!"), COW_to_span(&arr)));
+
+  // copying an array into itself, or into a copy of itself, keeps its storage
+  EXPECT_EQ(&r, OK, COW_copy(&arr, &arr));
+  EXPECT_EQ(&r, OK, COW_copy(&copy, &arr));
+  EXPECT_EQ(&r, 3, RC_get_ref_count(other.ref));
+  EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr("world!"), COW_to_span(&arr)));
+
+  // the last reference going away through a copy destroys the array
+  EXPECT_EQ(&r, OK, COW_destroy(&other));
+  EXPECT_EQ(&r, OK, COW_destroy(&copy));
+  EXPECT_EQ(&r, OK, COW_create(&copy, sizeof(int)));
+  EXPECT_EQ(&r, OK, COW_copy(&arr, &copy));
+  EXPECT_EQ(&r, 0, COW_get_size(&arr));
+
+  EXPECT_EQ(&r, OK, COW_destroy(&arr));
+  EXPECT_EQ(&r, OK, COW_destroy(&copy));
+
+  return r;
+}
+
+static Result tst_write_copies(void) {
+  Result    r      = PASS;
+  COW_Array arr    = {0};
+  COW_Array copy_a = {0};
+  COW_Array copy_b = {0};
+
+  EXPECT_EQ(&r, OK, COW_create_from_span(&arr, SPN_from_cstr("abcdef")));
+  EXPECT_EQ(&r, OK, COW_copy(&copy_a, &arr));
+  EXPECT_EQ(&r, OK, COW_copy(&copy_b, &copy_a));
+  EXPECT_EQ(&r, 3, RC_get_ref_count(arr.ref));
+  if(HAS_FAILED(&r)) return r;
+
+  // the first write through a shared handle gives that handle its own copy
+  DAR_DArray * mut      = NULL;
+  const char   val      = 'X';
+  const void * old_data = COW_get(&arr)->data;
+
+  EXPECT_EQ(&r, OK, COW_get_mut(&copy_a, &mut));
+  EXPECT_NE(&r, old_data, mut->data);
+  EXPECT_EQ(&r, OK, DAR_set_checked(mut, 0, &val));
+  EXPECT_EQ(&r, OK, DAR_push_back(mut, &val));
+
+  EXPECT_FALSE(&r, COW_is_shared(&copy_a));
+  EXPECT_TRUE(&r, COW_is_shared(&arr));
+  EXPECT_EQ(&r, 2, RC_get_ref_count(arr.ref));
+  EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr("XbcdefX"), COW_to_span(&copy_a)));
+  EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr("abcdef"), COW_to_span(&arr)));
+  EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr("abcdef"), COW_to_span(&copy_b)));
+
+  // further writes to an unshared handle don't copy
+  DAR_DArray * mut_again = NULL;
+  EXPECT_EQ(&r, OK, COW_get_mut(&copy_a, &mut_again));
+  EXPECT_EQ(&r, mut, mut_again);
+
+  // once the other copies are gone, writing to the last one doesn't copy either
+  EXPECT_EQ(&r, OK, COW_destroy(&copy_b));
+  EXPECT_FALSE(&r, COW_is_shared(&arr));
+  EXPECT_EQ(&r, OK, COW_get_mut(&arr, &mut));
+  EXPECT_EQ(&r, old_data, mut->data);
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_get_mut(&arr, NULL));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, COW_get_mut(&copy_b, &mut));
+
+  EXPECT_EQ(&r, OK, COW_destroy(&arr));
+  EXPECT_EQ(&r, OK, COW_destroy(&copy_a));
+
+  return r;
+}
+
+int main(void) {
+  Test tests[] = {
+      tst_create_destroy,
+      tst_copy_shares,
+      tst_copy_into_live_array,
+      tst_write_copies,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -23,6 +23,9 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "stat.h"
 #include "test_utils.h"
 
@@ -879,12 +882,572 @@ static Result tst_to_span(void * env) {
   return r;
 }
 
+static Result tst_create_aligned(void) {
+  Result r = PASS;
+
+  const size_t alignments[] = {16, 64, 256, 4096};
+
+  for(size_t a = 0; a < (sizeof(alignments) / sizeof(size_t)) && !HAS_FAILED(&r); a++) {
+    DAR_DArray arr    = {0};
+    DAR_DArray copy   = {0};
+    const char val[3] = {'a', 'b', 'c'};
+
+    // an odd element size, to make sure the padding is done in bytes rather than elements
+    EXPECT_EQ(&r, OK, DAR_create_aligned(&arr, sizeof(val), alignments[a]));
+    EXPECT_EQ(&r, alignments[a], DAR_get_alignment(&arr));
+    if(HAS_FAILED(&r)) return r;
+
+    // alignment is kept as the array grows
+    for(size_t i = 0; i < 1000; i++) {
+      EXPECT_EQ(&r, OK, DAR_push_back(&arr, val));
+      EXPECT_TRUE(&r, SPN_is_aligned(DAR_to_span(&arr), alignments[a]));
+    }
+    EXPECT_EQ(&r, 0, memcmp(DAR_get(&arr, 999), val, sizeof(val)));
+
+    EXPECT_EQ(&r, OK, DAR_resize(&arr, 10));
+    EXPECT_EQ(&r, OK, DAR_shrink_to_fit(&arr));
+    EXPECT_EQ(&r, 10, DAR_get_capacity(&arr));
+    EXPECT_TRUE(&r, SPN_is_aligned(DAR_to_span(&arr), alignments[a]));
+    EXPECT_TRUE(&r, SPN_get_alignment(DAR_to_span(&arr)) >= alignments[a]);
+    EXPECT_EQ(&r, 0, memcmp(DAR_get(&arr, 9), val, sizeof(val)));
+
+    EXPECT_EQ(&r, OK, DAR_create_from(&copy, &arr));
+    EXPECT_EQ(&r, alignments[a], DAR_get_alignment(&copy));
+    EXPECT_TRUE(&r, SPN_is_aligned(DAR_to_span(&copy), alignments[a]));
+    EXPECT_TRUE(&r, DAR_equals(&arr, &copy));
+
+    EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+    EXPECT_EQ(&r, OK, DAR_destroy(&copy));
+  }
+
+  DAR_DArray arr = {0};
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_create_aligned(&arr, sizeof(int), 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_create_aligned(&arr, sizeof(int), 48));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_create_aligned(&arr, 0, 64));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_create_aligned(NULL, sizeof(int), 64));
+
+  // a regular array reports the alignment malloc guarantees
+  EXPECT_EQ(&r, OK, DAR_create(&arr, sizeof(int)));
+  EXPECT_EQ(&r, _Alignof(max_align_t), DAR_get_alignment(&arr));
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+
+  return r;
+}
+
+static Result get_file_size(const char * path, size_t * o_size) {
+  Result      r         = PASS;
+  struct stat file_stat = {0};
+
+  EXPECT_EQ(&r, 0, stat(path, &file_stat));
+  *o_size = (size_t)file_stat.st_size;
+
+  return r;
+}
+
+static bool is_divisible_by(const void * element, void * ctx) {
+  return ((*(const int *)element % *(const int *)ctx) == 0);
+}
+
+static Result tst_mapped(void) {
+  Result     r         = PASS;
+  DAR_DArray arr       = {0};
+  DAR_DArray copy      = {0};
+  size_t     file_size = 0;
+  char       path[]    = "/tmp/cfac_darray_test_XXXXXX";
+
+  const int fd = mkstemp(path);
+  EXPECT_NE(&r, -1, fd);
+  if(HAS_FAILED(&r)) return r;
+  close(fd);
+  remove(path);
+
+  const size_t num_vals = 10000;
+
+  EXPECT_EQ(&r, STAT_ERR_IO, DAR_open_mapped(&arr, path, sizeof(int), DAR_MAP_READ_ONLY));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_open_mapped(&arr, path, sizeof(int), DAR_MAP_CREATE));
+  EXPECT_FALSE(&r, DAR_is_mapped(&arr));
+
+  // create a new file and grow it well beyond the initial mapping
+  EXPECT_EQ(&r,
+            OK,
+            DAR_open_mapped(&arr, path, sizeof(int), (DAR_MAP_READ_WRITE | DAR_MAP_CREATE)));
+  EXPECT_TRUE(&r, DAR_is_mapped(&arr));
+  EXPECT_TRUE(&r, DAR_is_empty(&arr));
+  if(HAS_FAILED(&r)) return r;
+
+  for(int i = 0; i < (int)num_vals; i++) EXPECT_EQ(&r, OK, DAR_push_back(&arr, &i));
+
+  // after a checkpoint the file holds exactly the array
+  EXPECT_EQ(&r, OK, DAR_sync_mapped(&arr));
+  EXPECT_PASS(&r, get_file_size(path, &file_size));
+  EXPECT_EQ(&r, num_vals * sizeof(int), file_size);
+
+  // range operations work as usual, and the array keeps growing after a checkpoint
+  EXPECT_EQ(&r, OK, DAR_erase_range(&arr, 0, 10));
+  for(int i = 0; i < 10; i++) EXPECT_EQ(&r, OK, DAR_push_back(&arr, &i));
+
+  // a heap copy of a mapped array is an ordinary array
+  EXPECT_EQ(&r, OK, DAR_create_from(&copy, &arr));
+  EXPECT_FALSE(&r, DAR_is_mapped(&copy));
+  EXPECT_TRUE(&r, DAR_equals(&arr, &copy));
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+  EXPECT_FALSE(&r, DAR_is_mapped(&arr));
+  EXPECT_PASS(&r, get_file_size(path, &file_size));
+  EXPECT_EQ(&r, num_vals * sizeof(int), file_size);
+
+  // read back without copying
+  EXPECT_EQ(&r, OK, DAR_open_mapped(&arr, path, sizeof(int), DAR_MAP_READ_ONLY));
+  EXPECT_TRUE(&r, DAR_equals(&arr, &copy));
+  EXPECT_EQ(&r, 10, *(const int *)DAR_get(&arr, 0));
+  EXPECT_EQ(&r, 9, *(const int *)DAR_last(&arr));
+
+  // read-only arrays can't be modified in any way
+  const int      val      = 0;
+  int            divisor  = 2;
+  const SPN_Span val_span = {.begin = &val, .len = 1, .element_size = sizeof(int)};
+  DAR_DArray     dst      = {0};
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_push_back(&arr, &val));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_pop_back(&arr));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_shrink_to_fit(&arr));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_resize(&arr, 1));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_resize_zeroed(&arr, 1));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_resize_with_value(&arr, 1, &val));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_reserve(&arr, 2 * num_vals));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_clear(&arr));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_clear_and_shrink(&arr));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_set_checked(&arr, 0, &val));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_push_back_array(&arr, &val, 1));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_push_back_span(&arr, val_span));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_push_back_darray(&arr, &copy));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_delete(&arr, 0));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_order_preserving_delete(&arr, 0));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_insert_span(&arr, 0, val_span));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_erase_range(&arr, 0, 1));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_replace_range(&arr, 0, 1, val_span));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_remove_if(&arr, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_remove_equal(&arr, &val));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_remove_less_i32(&arr, 5));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_filter_into(&arr, val_span, is_divisible_by, &divisor));
+  EXPECT_TRUE(&r, DAR_equals(&arr, &copy));
+
+  // a read-only int64 array, as DAR_remove_less_i64 checks element size first
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+  EXPECT_EQ(&r, OK, DAR_open_mapped(&arr, path, sizeof(int64_t), DAR_MAP_READ_ONLY));
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_remove_less_i64(&arr, 5));
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+  EXPECT_EQ(&r, OK, DAR_open_mapped(&arr, path, sizeof(int), DAR_MAP_READ_ONLY));
+
+  // but they can be read from, and copied into other arrays
+  EXPECT_EQ(&r, OK, DAR_create(&dst, sizeof(int)));
+  EXPECT_EQ(&r, OK, DAR_push_back_darray(&dst, &arr));
+  EXPECT_TRUE(&r, DAR_equals(&dst, &copy));
+  EXPECT_EQ(&r, OK, DAR_destroy(&dst));
+  EXPECT_EQ(&r, OK, DAR_sync_mapped(&arr));
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+
+  // the file is left alone by read-only arrays
+  EXPECT_PASS(&r, get_file_size(path, &file_size));
+  EXPECT_EQ(&r, num_vals * sizeof(int), file_size);
+
+  // file size has to be a multiple of the element size
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_open_mapped(&arr, path, 3, DAR_MAP_READ_ONLY));
+
+  // an emptied file can be mapped and grown again
+  EXPECT_EQ(&r, OK, DAR_open_mapped(&arr, path, sizeof(int), DAR_MAP_READ_WRITE));
+  EXPECT_EQ(&r, OK, DAR_clear(&arr));
+  EXPECT_EQ(&r, OK, DAR_sync_mapped(&arr));
+  EXPECT_PASS(&r, get_file_size(path, &file_size));
+  EXPECT_EQ(&r, 0, file_size);
+  EXPECT_EQ(&r, OK, DAR_push_back(&arr, &val));
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+
+  EXPECT_EQ(&r, OK, DAR_open_mapped(&arr, path, sizeof(int), DAR_MAP_READ_ONLY));
+  EXPECT_EQ(&r, 1, arr.size);
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+
+  EXPECT_EQ(&r, STAT_ERR_USAGE, DAR_sync_mapped(&copy));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_open_mapped(&arr, NULL, sizeof(int), DAR_MAP_READ_ONLY));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_open_mapped(&arr, path, 0, DAR_MAP_READ_ONLY));
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&copy));
+  remove(path);
+
+  return r;
+}
+
+static bool is_equal_to(const void * element, void * ctx) {
+  const SPN_Span * value = ctx;
+  return (memcmp(element, value->begin, value->element_size) == 0);
+}
+
+static bool is_less_than_i32(const void * element, void * ctx) {
+  return (*(const int32_t *)element < *(const int32_t *)ctx);
+}
+
+static bool is_less_than_i64(const void * element, void * ctx) {
+  return (*(const int64_t *)element < *(const int64_t *)ctx);
+}
+
+static Result tst_remove_if(void) {
+  Result     r   = PASS;
+  DAR_DArray arr = {0};
+
+  const size_t num_vals = 1000;
+  int          divisor  = 3;
+
+  EXPECT_EQ(&r, OK, DAR_create(&arr, sizeof(int)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(int i = 0; i < (int)num_vals; i++) EXPECT_EQ(&r, OK, DAR_push_back(&arr, &i));
+
+  EXPECT_EQ(&r, OK, DAR_remove_if(&arr, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, (num_vals - ((num_vals + 2) / 3)), arr.size);
+
+  // remaining elements should be exactly the non-multiples of 3, in order
+  for(int i = 0, j = 0; (i < (int)num_vals) && !HAS_FAILED(&r); i++) {
+    if((i % divisor) == 0) continue;
+    EXPECT_EQ(&r, i, *(int *)DAR_get(&arr, j++));
+  }
+
+  // removing nothing leaves the array untouched
+  divisor = (int)num_vals + 1;
+  EXPECT_EQ(&r, OK, DAR_remove_if(&arr, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, (num_vals - ((num_vals + 2) / 3)), arr.size);
+  EXPECT_EQ(&r, 1, *(int *)DAR_first(&arr));
+
+  // removing everything leaves an empty array
+  divisor = 1;
+  EXPECT_EQ(&r, OK, DAR_remove_if(&arr, is_divisible_by, &divisor));
+  EXPECT_TRUE(&r, DAR_is_empty(&arr));
+  EXPECT_EQ(&r, OK, DAR_remove_if(&arr, is_divisible_by, &divisor));
+  EXPECT_TRUE(&r, DAR_is_empty(&arr));
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_remove_if(NULL, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_remove_if(&arr, NULL, &divisor));
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+
+  return r;
+}
+
+static Result tst_filter_into(void) {
+  Result     r   = PASS;
+  DAR_DArray dst = {0};
+
+  const int vals[]   = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  const int evens[]  = {-1, 2, 4, 6, 8, 10, 12};
+  const int thirds[] = {3, 6, 9, 12};
+  int       divisor  = 2;
+
+  const SPN_Span src = {
+      .begin = vals, .len = (sizeof(vals) / sizeof(int)), .element_size = sizeof(int)};
+
+  EXPECT_EQ(&r, OK, DAR_create(&dst, sizeof(int)));
+  EXPECT_EQ(&r, OK, DAR_push_back(&dst, &evens[0]));
+  if(HAS_FAILED(&r)) return r;
+
+  // filtered elements are appended to whatever dst already holds
+  EXPECT_EQ(&r, OK, DAR_filter_into(&dst, src, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, (sizeof(evens) / sizeof(int)), dst.size);
+  if(!HAS_FAILED(&r)) EXPECT_EQ(&r, 0, memcmp(dst.data, evens, sizeof(evens)));
+
+  divisor = 3;
+  EXPECT_EQ(&r, OK, DAR_clear(&dst));
+  EXPECT_EQ(&r, OK, DAR_filter_into(&dst, src, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, (sizeof(thirds) / sizeof(int)), dst.size);
+  if(!HAS_FAILED(&r)) EXPECT_EQ(&r, 0, memcmp(dst.data, thirds, sizeof(thirds)));
+
+  EXPECT_EQ(&r, OK, DAR_filter_into(&dst, SPN_subspan(src, 0, 0), is_divisible_by, &divisor));
+  EXPECT_EQ(&r, (sizeof(thirds) / sizeof(int)), dst.size);
+
+  // src may not alias dst, as pushing into dst may reallocate it
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_filter_into(&dst, DAR_to_span(&dst), is_divisible_by, &divisor));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_filter_into(NULL, src, is_divisible_by, &divisor));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_filter_into(&dst, src, NULL, &divisor));
+  EXPECT_EQ(&r,
+            STAT_ERR_ARGS,
+            DAR_filter_into(&dst, SPN_from_cstr("abc"), is_divisible_by, &divisor));
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&dst));
+
+  return r;
+}
+
+static Result tst_remove_equal(void) {
+  Result r = PASS;
+
+  // covers all vectorized element sizes as well as the scalar fallback
+  const size_t element_sizes[] = {1, 2, 3, 4, 8, 16};
+  const size_t num_vals        = 1037;
+
+  for(size_t s = 0; s < (sizeof(element_sizes) / sizeof(size_t)) && !HAS_FAILED(&r); s++) {
+    const size_t element_size = element_sizes[s];
+    DAR_DArray   arr          = {0};
+    DAR_DArray   expected     = {0};
+    uint8_t      value[16]    = {0};
+
+    EXPECT_EQ(&r, OK, DAR_create(&arr, element_size));
+    EXPECT_EQ(&r, OK, DAR_create(&expected, element_size));
+    EXPECT_EQ(&r, OK, DAR_resize_zeroed(&arr, num_vals));
+    if(HAS_FAILED(&r)) return r;
+
+    // make elements differ from value in just one byte, to make sure whole elements are compared
+    memset(value, 0xaa, sizeof(value));
+    for(size_t i = 0; i < num_vals; i++) {
+      uint8_t * element = DAR_get(&arr, i);
+      memcpy(element, value, element_size);
+      if((rand() % 4) != 0) element[rand() % element_size] = (uint8_t)(rand() % 0xaa);
+    }
+
+    SPN_Span value_span = {.begin = value, .len = 1, .element_size = element_size};
+    EXPECT_EQ(&r, OK, DAR_filter_into(&expected, DAR_to_span(&arr), is_equal_to, &value_span));
+    EXPECT_EQ(&r, OK, DAR_remove_equal(&arr, value));
+
+    EXPECT_EQ(&r, num_vals - expected.size, arr.size);
+    for(size_t i = 0; (i < arr.size) && !HAS_FAILED(&r); i++) {
+      EXPECT_NE(&r, 0, memcmp(DAR_get(&arr, i), value, element_size));
+    }
+
+    EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+    EXPECT_EQ(&r, OK, DAR_destroy(&expected));
+  }
+
+  return r;
+}
+
+static Result tst_remove_less(void) {
+  Result     r            = PASS;
+  DAR_DArray arr_i32      = {0};
+  DAR_DArray arr_i64      = {0};
+  DAR_DArray expected_i32 = {0};
+  DAR_DArray expected_i64 = {0};
+
+  const size_t num_vals      = 1037;
+  int32_t      threshold_i32 = 0;
+  int64_t      threshold_i64 = 0;
+
+  EXPECT_EQ(&r, OK, DAR_create(&arr_i32, sizeof(int32_t)));
+  EXPECT_EQ(&r, OK, DAR_create(&arr_i64, sizeof(int64_t)));
+  EXPECT_EQ(&r, OK, DAR_create(&expected_i32, sizeof(int32_t)));
+  EXPECT_EQ(&r, OK, DAR_create(&expected_i64, sizeof(int64_t)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < num_vals; i++) {
+    const int32_t val_i32 = (rand() % 2000) - 1000;
+    const int64_t val_i64 = (int64_t)val_i32 * ((int64_t)1 << 40);
+    EXPECT_EQ(&r, OK, DAR_push_back(&arr_i32, &val_i32));
+    EXPECT_EQ(&r, OK, DAR_push_back(&arr_i64, &val_i64));
+  }
+  if(HAS_FAILED(&r)) return r;
+
+  // the reference keeps elements that are not less than the threshold, which is what should remain
+  threshold_i32 = 100;
+  threshold_i64 = (int64_t)threshold_i32 * ((int64_t)1 << 40);
+  EXPECT_EQ(&r, OK, DAR_push_back_darray(&expected_i32, &arr_i32));
+  EXPECT_EQ(&r, OK, DAR_push_back_darray(&expected_i64, &arr_i64));
+  EXPECT_EQ(&r, OK, DAR_remove_if(&expected_i32, is_less_than_i32, &threshold_i32));
+  EXPECT_EQ(&r, OK, DAR_remove_if(&expected_i64, is_less_than_i64, &threshold_i64));
+
+  EXPECT_EQ(&r, OK, DAR_remove_less_i32(&arr_i32, threshold_i32));
+  EXPECT_EQ(&r, OK, DAR_remove_less_i64(&arr_i64, threshold_i64));
+  EXPECT_TRUE(&r, DAR_equals(&expected_i32, &arr_i32));
+  EXPECT_TRUE(&r, DAR_equals(&expected_i64, &arr_i64));
+
+  EXPECT_EQ(&r, OK, DAR_remove_less_i32(&arr_i32, INT32_MAX));
+  EXPECT_EQ(&r, OK, DAR_remove_less_i64(&arr_i64, INT64_MAX));
+  EXPECT_TRUE(&r, DAR_is_empty(&arr_i32));
+  EXPECT_TRUE(&r, DAR_is_empty(&arr_i64));
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_remove_less_i32(&arr_i64, 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_remove_less_i64(&arr_i32, 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_remove_less_i32(NULL, 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_remove_equal(&arr_i32, NULL));
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr_i32));
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr_i64));
+  EXPECT_EQ(&r, OK, DAR_destroy(&expected_i32));
+  EXPECT_EQ(&r, OK, DAR_destroy(&expected_i64));
+
+  return r;
+}
+
+static Result tst_remove_less_i64_full_range(void) {
+  Result     r        = PASS;
+  DAR_DArray arr      = {0};
+  DAR_DArray expected = {0};
+
+  // values that differ in the low halves too, and share their high half with the threshold
+  const int64_t thresholds[] = {0, -1, 1, INT64_MIN, INT64_MAX, (int64_t)0x7fffffff80000000ll,
+                                -(int64_t)0x100000000ll};
+
+  for(size_t t = 0; t < (sizeof(thresholds) / sizeof(thresholds[0])); t++) {
+    int64_t threshold = thresholds[t];
+
+    EXPECT_EQ(&r, OK, DAR_create(&arr, sizeof(int64_t)));
+    EXPECT_EQ(&r, OK, DAR_create(&expected, sizeof(int64_t)));
+    if(HAS_FAILED(&r)) return r;
+
+    for(size_t i = 0; i < 517; i++) {
+      const uint64_t high = (rand() % 2 == 0) ? ((uint64_t)threshold >> 32) : (uint64_t)rand();
+      const uint64_t low  = ((uint64_t)rand() << 16) ^ (uint64_t)rand();
+      const int64_t  val  = (int64_t)((high << 32) | (low & 0xffffffffu));
+      EXPECT_EQ(&r, OK, DAR_push_back(&arr, &val));
+    }
+
+    EXPECT_EQ(&r, OK, DAR_push_back_darray(&expected, &arr));
+    EXPECT_EQ(&r, OK, DAR_remove_if(&expected, is_less_than_i64, &threshold));
+    EXPECT_EQ(&r, OK, DAR_remove_less_i64(&arr, threshold));
+    EXPECT_TRUE(&r, DAR_equals(&expected, &arr));
+
+    EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+    EXPECT_EQ(&r, OK, DAR_destroy(&expected));
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_range_operations(void) {
+  Result     r   = PASS;
+  DAR_DArray arr = {0};
+
+  EXPECT_EQ(&r, OK, DAR_create_from_cstr(&arr, "hello world"));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_EQ(&r, OK, DAR_insert_span(&arr, 5, SPN_from_cstr(", big")));
+  EXPECT_STREQ(&r, "hello, big world", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_insert_span(&arr, 0, SPN_from_cstr(">> ")));
+  EXPECT_STREQ(&r, ">> hello, big world", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_insert_span(&arr, (arr.size - 1), SPN_from_cstr("!")));
+  EXPECT_STREQ(&r, ">> hello, big world!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_erase_range(&arr, 8, 13));
+  EXPECT_STREQ(&r, ">> hello world!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_erase_range(&arr, 0, 3));
+  EXPECT_STREQ(&r, "hello world!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_erase_range(&arr, 4, 4));
+  EXPECT_STREQ(&r, "hello world!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_replace_range(&arr, 6, 11, SPN_from_cstr("there")));
+  EXPECT_STREQ(&r, "hello there!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_replace_range(&arr, 0, 5, SPN_from_cstr("hi")));
+  EXPECT_STREQ(&r, "hi there!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_replace_range(&arr, 3, 8, SPN_from_cstr("everybody")));
+  EXPECT_STREQ(&r, "hi everybody!", arr.data);
+
+  // source spans may point into the array itself
+  EXPECT_EQ(&r, OK, DAR_insert_span(&arr, 2, SPN_subspan(DAR_to_span(&arr), 2, 10)));
+  EXPECT_STREQ(&r, "hi everybody everybody!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_insert_span(&arr, 1, SPN_subspan(DAR_to_span(&arr), 0, 3)));
+  EXPECT_STREQ(&r, "hhi i everybody everybody!", arr.data);
+
+  EXPECT_EQ(&r, OK, DAR_replace_range(&arr, 0, 6, SPN_subspan(DAR_to_span(&arr), 3, 12)));
+  EXPECT_STREQ(&r, " i everybodyeverybody everybody!", arr.data);
+
+  EXPECT_EQ(&r, STAT_ERR_RANGE, DAR_insert_span(&arr, (arr.size + 1), SPN_from_cstr("x")));
+  EXPECT_EQ(&r, STAT_ERR_RANGE, DAR_erase_range(&arr, 2, 1));
+  EXPECT_EQ(&r, STAT_ERR_RANGE, DAR_erase_range(&arr, 0, (arr.size + 1)));
+  EXPECT_EQ(&r, STAT_ERR_RANGE, DAR_replace_range(&arr, 0, (arr.size + 1), SPN_from_cstr("x")));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, DAR_insert_span(NULL, 0, SPN_from_cstr("x")));
+  EXPECT_EQ(&r,
+            STAT_ERR_ARGS,
+            DAR_insert_span(&arr, 0, (SPN_Span){.begin = NULL, .len = 1, .element_size = 1}));
+  EXPECT_EQ(&r,
+            STAT_ERR_ARGS,
+            DAR_insert_span(&arr, 0, (SPN_Span){.begin = "ab", .len = 1, .element_size = 2}));
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+
+  return r;
+}
+
+static Result tst_many_random_range_operations(void) {
+  Result     r         = PASS;
+  DAR_DArray arr       = {0};
+  DAR_DArray reference = {0};
+  DAR_DArray source    = {0};
+
+  const size_t num_iterations = 500;
+  const size_t max_len        = 64;
+
+  EXPECT_EQ(&r, OK, DAR_create(&arr, sizeof(int)));
+  EXPECT_EQ(&r, OK, DAR_create(&reference, sizeof(int)));
+  EXPECT_EQ(&r, OK, DAR_create(&source, sizeof(int)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; (i < num_iterations) && !HAS_FAILED(&r); i++) {
+    const size_t first = (arr.size == 0) ? 0 : ((size_t)rand() % (arr.size + 1));
+    const size_t last  = first + ((size_t)rand() % (arr.size - first + 1));
+
+    // take the replacement either from a separate array or from the array itself
+    EXPECT_EQ(&r, OK, DAR_clear(&source));
+    SPN_Span span = {0};
+    if(arr.size > 0 && (rand() % 2) == 0) {
+      const size_t src_first = (size_t)rand() % arr.size;
+      span = SPN_subspan(DAR_to_span(&arr), src_first, ((size_t)rand() % (arr.size - src_first)));
+      EXPECT_EQ(&r, OK, DAR_push_back_span(&source, span));
+    } else {
+      const size_t len = (size_t)rand() % max_len;
+      for(size_t j = 0; j < len; j++) {
+        const int val = rand();
+        EXPECT_EQ(&r, OK, DAR_push_back(&source, &val));
+      }
+      span = DAR_to_span(&source);
+    }
+
+    // build the expected result element by element
+    EXPECT_EQ(&r, OK, DAR_clear(&reference));
+    EXPECT_EQ(&r, OK, DAR_push_back_array(&reference, arr.data, first));
+    EXPECT_EQ(&r, OK, DAR_push_back_darray(&reference, &source));
+    EXPECT_EQ(&r, OK, DAR_push_back_array(&reference, DAR_get(&arr, last), (arr.size - last)));
+
+    switch(rand() % 3) {
+    case 0:
+      EXPECT_EQ(&r, OK, DAR_replace_range(&arr, first, last, span));
+      break;
+    case 1:
+      EXPECT_EQ(&r, OK, DAR_insert_span(&arr, last, DAR_to_span(&source)));
+      EXPECT_EQ(&r, OK, DAR_erase_range(&arr, first, last));
+      break;
+    default:
+      EXPECT_EQ(&r, OK, DAR_erase_range(&arr, first, last));
+      EXPECT_EQ(&r, OK, DAR_insert_span(&arr, first, DAR_to_span(&source)));
+      break;
+    }
+
+    EXPECT_TRUE(&r, DAR_equals(&reference, &arr));
+  }
+
+  EXPECT_EQ(&r, OK, DAR_destroy(&arr));
+  EXPECT_EQ(&r, OK, DAR_destroy(&reference));
+  EXPECT_EQ(&r, OK, DAR_destroy(&source));
+
+  return r;
+}
+
 int main(int argc, const char ** argv) {
   Test tests[] = {
       tst_create_destroy,
       tst_create_from_cstr,
       tst_create_from_span,
       tst_large_elements,
+      tst_create_aligned,
+      tst_mapped,
+      tst_remove_if,
+      tst_filter_into,
+      tst_remove_equal,
+      tst_remove_less,
+      tst_remove_less_i64_full_range,
+      tst_range_operations,
+      tst_many_random_range_operations,
   };
 
   TestWithFixture tests_with_fixture[] = {
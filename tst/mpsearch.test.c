@@ -0,0 +1,257 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "mpsearch.h"
+#include "span.h"
+
+#define OK STAT_OK
+
+// Appends all matches in the documented order: by end, then longest first, then by index.
+static Result find_all_naive(SPN_Span haystack, SPN_Span patterns, DAR_DArray * o_matches) {
+  Result r = PASS;
+
+  const char * bytes = haystack.begin;
+  for(size_t end = 1; end <= haystack.len; end++) {
+    for(size_t len = end; len > 0; len--) {
+      for(size_t p = 0; p < patterns.len; p++) {
+        const SPN_Span * pattern = SPN_get(patterns, p);
+        if(pattern->len != len || memcmp(&bytes[end - len], pattern->begin, len) != 0) continue;
+
+        const MPS_Match match = {.pattern_idx = p, .begin = end - len, .end = end};
+        EXPECT_OK(&r, DAR_push_back(o_matches, &match));
+      }
+    }
+  }
+
+  return r;
+}
+
+static Result tst_basic(void) {
+  Result      r       = PASS;
+  MPS_Matcher matcher = {0};
+
+  const SPN_Span patterns[] = {SPN_from_cstr("he"),
+                               SPN_from_cstr("she"),
+                               SPN_from_cstr("his"),
+                               SPN_from_cstr("hers")};
+  EXPECT_OK(&r,
+            MPS_create(&matcher,
+                       (SPN_Span){.begin = patterns, .len = 4, .element_size = sizeof(SPN_Span)}));
+  if(HAS_FAILED(&r)) return r;
+  EXPECT_EQ(&r, 4, MPS_get_num_patterns(&matcher));
+
+  MPS_Match match = {0};
+  EXPECT_OK(&r, MPS_find_first(&matcher, SPN_from_cstr("ushers"), &match));
+  EXPECT_EQ(&r, 1, match.pattern_idx); // "she" and "he" both end at 4, "she" is longer
+  EXPECT_EQ(&r, 1, match.begin);
+  EXPECT_EQ(&r, 4, match.end);
+
+  DAR_DArray matches = {0};
+  EXPECT_OK(&r, DAR_create(&matches, sizeof(MPS_Match)));
+  EXPECT_OK(&r, MPS_find_all(&matcher, SPN_from_cstr("ushers"), &matches));
+  EXPECT_EQ(&r, 3, matches.size);
+  if(HAS_FAILED(&r)) return r;
+  EXPECT_EQ(&r, 1, ((MPS_Match *)DAR_get(&matches, 0))->pattern_idx);
+  EXPECT_EQ(&r, 0, ((MPS_Match *)DAR_get(&matches, 1))->pattern_idx);
+  EXPECT_EQ(&r, 3, ((MPS_Match *)DAR_get(&matches, 2))->pattern_idx);
+
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, MPS_find_first(&matcher, SPN_from_cstr("nothing"), &match));
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, MPS_find_first(&matcher, SPN_from_cstr(""), &match));
+
+  EXPECT_OK(&r, DAR_destroy(&matches));
+  EXPECT_OK(&r, MPS_destroy(&matcher));
+
+  return r;
+}
+
+static Result tst_matches_naive(void) {
+  Result r = PASS;
+
+  enum { MAX_PATTERNS = 40, MAX_PATTERN_LEN = 6, MAX_HAYSTACK_LEN = 400 };
+
+  char     pattern_bytes[MAX_PATTERNS][MAX_PATTERN_LEN];
+  SPN_Span patterns[MAX_PATTERNS];
+  char     haystack[MAX_HAYSTACK_LEN];
+
+  DAR_DArray expected = {0};
+  DAR_DArray actual   = {0};
+  EXPECT_OK(&r, DAR_create(&expected, sizeof(MPS_Match)));
+  EXPECT_OK(&r, DAR_create(&actual, sizeof(MPS_Match)));
+  if(HAS_FAILED(&r)) return r;
+
+  // pattern counts on both sides of MPS_FILTER_MAX_PATTERNS, so that both engines are checked
+  for(size_t iteration = 0; iteration < 300 && !HAS_FAILED(&r); iteration++) {
+    const size_t num_patterns = 1 + ((size_t)rand() % MAX_PATTERNS);
+    const size_t alphabet     = 2 + ((size_t)rand() % 3);
+    const size_t haystack_len = (size_t)rand() % MAX_HAYSTACK_LEN;
+
+    for(size_t p = 0; p < num_patterns; p++) {
+      const size_t len = 1 + ((size_t)rand() % MAX_PATTERN_LEN);
+      for(size_t i = 0; i < len; i++) pattern_bytes[p][i] = (char)('a' + (rand() % alphabet));
+      patterns[p] = (SPN_Span){.begin = pattern_bytes[p], .len = len, .element_size = 1};
+    }
+    if(num_patterns > 1) patterns[num_patterns - 1] = patterns[0]; // a duplicate
+    for(size_t i = 0; i < haystack_len; i++) haystack[i] = (char)('a' + (rand() % alphabet));
+
+    const SPN_Span pattern_span = {.begin        = patterns,
+                                   .len          = num_patterns,
+                                   .element_size = sizeof(SPN_Span)};
+    const SPN_Span haystack_span = {.begin = haystack, .len = haystack_len, .element_size = 1};
+
+    MPS_Matcher matcher = {0};
+    EXPECT_OK(&r, MPS_create(&matcher, pattern_span));
+    if(HAS_FAILED(&r)) break;
+
+    DAR_clear(&expected);
+    DAR_clear(&actual);
+    EXPECT_PASS(&r, find_all_naive(haystack_span, pattern_span, &expected));
+    EXPECT_OK(&r, MPS_find_all(&matcher, haystack_span, &actual));
+    EXPECT_EQ(&r, expected.size, actual.size);
+    if(!HAS_FAILED(&r)) {
+      EXPECT_ARREQ(&r, uint8_t, expected.data, actual.data, expected.size * sizeof(MPS_Match));
+    }
+
+    MPS_Match first = {0};
+    EXPECT_EQ(&r,
+              (expected.size > 0) ? OK : STAT_OK_NOT_FOUND,
+              MPS_find_first(&matcher, haystack_span, &first));
+    if(expected.size > 0) {
+      EXPECT_EQ(&r, 0, memcmp(DAR_first(&expected), &first, sizeof(MPS_Match)));
+    }
+
+    EXPECT_OK(&r, MPS_destroy(&matcher));
+  }
+
+  EXPECT_OK(&r, DAR_destroy(&expected));
+  EXPECT_OK(&r, DAR_destroy(&actual));
+
+  return r;
+}
+
+static Result tst_matches_naive_at_each_simd_level(void) {
+  Result r = PASS;
+
+  // the filter's vector kernels follow the level span picked, check each one the CPU has
+  const SPN_INT_SimdLevel levels[] = {SPN_INT_SIMD_NONE, SPN_INT_SIMD_SSE2, SPN_INT_SIMD_AVX2};
+  for(size_t i = 0; i < (sizeof(levels) / sizeof(levels[0])); i++) {
+    EXPECT_TRUE(&r, SPN_INT_set_max_simd_level(levels[i]) <= levels[i]);
+    EXPECT_EQ(&r, PASS, tst_matches_naive());
+    if(HAS_FAILED(&r)) break;
+  }
+
+  SPN_INT_set_max_simd_level(SPN_INT_SIMD_AVX2);
+
+  return r;
+}
+
+static Result tst_many_keywords(void) {
+  Result r = PASS;
+
+  enum { NUM_KEYWORDS = 1000 };
+
+  // keywords "k0;" .. "k999;", of which we put a few in a line
+  char       keyword_bytes[NUM_KEYWORDS][8];
+  SPN_Span   keywords[NUM_KEYWORDS];
+  DAR_DArray matches = {0};
+  for(size_t i = 0; i < NUM_KEYWORDS; i++) {
+    snprintf(keyword_bytes[i], sizeof(keyword_bytes[i]), "k%zu;", i);
+    keywords[i] = SPN_from_cstr(keyword_bytes[i]);
+  }
+
+  MPS_Matcher matcher = {0};
+  EXPECT_OK(&r,
+            MPS_create(&matcher,
+                       (SPN_Span){.begin        = keywords,
+                                  .len          = NUM_KEYWORDS,
+                                  .element_size = sizeof(SPN_Span)}));
+  EXPECT_OK(&r, DAR_create(&matches, sizeof(MPS_Match)));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, MPS_find_all(&matcher, SPN_from_cstr("xx k12; yy k999; zz k1000;"), &matches));
+  EXPECT_EQ(&r, 2, matches.size);
+  if(HAS_FAILED(&r)) return r;
+  EXPECT_EQ(&r, 12, ((MPS_Match *)DAR_get(&matches, 0))->pattern_idx);
+  EXPECT_EQ(&r, 3, ((MPS_Match *)DAR_get(&matches, 0))->begin);
+  EXPECT_EQ(&r, 999, ((MPS_Match *)DAR_get(&matches, 1))->pattern_idx);
+
+  EXPECT_OK(&r, DAR_destroy(&matches));
+  EXPECT_OK(&r, MPS_destroy(&matcher));
+
+  return r;
+}
+
+static Result tst_bad_args(void) {
+  Result      r       = PASS;
+  MPS_Matcher matcher = {0};
+  MPS_Match   match   = {0};
+
+  const SPN_Span good[]  = {SPN_from_cstr("abc")};
+  const SPN_Span empty[] = {SPN_from_cstr("abc"), SPN_from_cstr("")};
+  const int      ints[]  = {1, 2};
+  const SPN_Span wide[]  = {{.begin = ints, .len = 2, .element_size = sizeof(int)}};
+
+  EXPECT_NOK(&r, MPS_create(NULL, (SPN_Span){.begin = good, .len = 1, .element_size = 24}));
+  EXPECT_NOK(&r, MPS_create(&matcher, SPN_from_cstr("abc")));
+  EXPECT_NOK(&r,
+             MPS_create(&matcher,
+                        (SPN_Span){.begin = empty, .len = 2, .element_size = sizeof(SPN_Span)}));
+  EXPECT_NOK(&r,
+             MPS_create(&matcher,
+                        (SPN_Span){.begin = wide, .len = 1, .element_size = sizeof(SPN_Span)}));
+  EXPECT_NOK(&r, MPS_find_first(&matcher, SPN_from_cstr("abc"), &match)); // not created
+
+  // no patterns is allowed, and never matches
+  EXPECT_OK(&r, MPS_create(&matcher, (SPN_Span){.element_size = sizeof(SPN_Span)}));
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, MPS_find_first(&matcher, SPN_from_cstr("abc"), &match));
+  EXPECT_NOK(&r, MPS_find_all(&matcher, SPN_from_cstr("abc"), NULL));
+  EXPECT_NOK(&r,
+             MPS_find_first(&matcher,
+                            (SPN_Span){.begin = ints, .len = 2, .element_size = sizeof(int)},
+                            &match));
+  EXPECT_OK(&r, MPS_destroy(&matcher));
+  EXPECT_OK(&r, MPS_destroy(NULL));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_basic,
+      tst_matches_naive,
+      tst_matches_naive_at_each_simd_level,
+      tst_many_keywords,
+      tst_bad_args,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "pqueue.h"
+#include "span_sort.h"
+
+#define OK STAT_OK
+
+static int compare_ints(const void * lhs, const void * rhs) {
+  const int l = *(const int *)lhs;
+  const int r = *(const int *)rhs;
+  return (l > r) - (l < r);
+}
+
+static Result tst_create_destroy(void) {
+  Result  r    = PASS;
+  PQ_Heap heap = {0};
+
+  EXPECT_OK(&r, PQ_create(&heap, sizeof(int), 0, compare_ints));
+  EXPECT_TRUE(&r, PQ_is_initialized(&heap));
+  EXPECT_TRUE(&r, PQ_is_empty(&heap));
+  EXPECT_EQ(&r, PQ_DEFAULT_ARITY, heap.arity);
+  EXPECT_EQ(&r, NULL, PQ_peek(&heap));
+  EXPECT_EQ(&r, STAT_ERR_EMPTY, PQ_pop(&heap, NULL));
+  EXPECT_FALSE(&r, PQ_is_valid_handle(&heap, 0));
+  EXPECT_OK(&r, PQ_destroy(&heap));
+  EXPECT_FALSE(&r, PQ_is_initialized(&heap));
+
+  EXPECT_NOK(&r, PQ_create(NULL, sizeof(int), 0, compare_ints));
+  EXPECT_NOK(&r, PQ_create(&heap, 0, 0, compare_ints));
+  EXPECT_NOK(&r, PQ_create(&heap, sizeof(int), 1, compare_ints));
+  EXPECT_NOK(&r, PQ_create(&heap, sizeof(int), 0, NULL));
+  EXPECT_NOK(&r, PQ_push(&heap, &(int){1}, NULL));
+  EXPECT_OK(&r, PQ_destroy(NULL));
+
+  return r;
+}
+
+static Result tst_push_pop(void) {
+  Result r = PASS;
+
+  const size_t arities[] = {2, 3, 4, 8};
+  const size_t n         = 2000;
+
+  int * expect = malloc(n * sizeof(int));
+  EXPECT_NE(&r, NULL, expect);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t a = 0; a < (sizeof(arities) / sizeof(arities[0])); a++) {
+    PQ_Heap heap = {0};
+    EXPECT_OK(&r, PQ_create(&heap, sizeof(int), arities[a], compare_ints));
+    if(HAS_FAILED(&r)) break;
+
+    for(size_t i = 0; i < n; i++) {
+      expect[i] = (rand() % 1000) - 500;
+      EXPECT_OK(&r, PQ_push(&heap, &expect[i], NULL));
+      EXPECT_LE(&r, *(const int *)PQ_peek(&heap), expect[i]);
+    }
+    EXPECT_EQ(&r, n, PQ_get_size(&heap));
+
+    EXPECT_OK(&r, SPN_sort((SPN_MutSpan){expect, n, sizeof(int)}, compare_ints));
+    for(size_t i = 0; i < n; i++) {
+      int popped = 0;
+      EXPECT_OK(&r, PQ_pop(&heap, &popped));
+      EXPECT_EQ(&r, expect[i], popped);
+      if(HAS_FAILED(&r)) break;
+    }
+    EXPECT_TRUE(&r, PQ_is_empty(&heap));
+
+    EXPECT_OK(&r, PQ_destroy(&heap));
+    if(HAS_FAILED(&r)) break;
+  }
+
+  free(expect);
+
+  return r;
+}
+
+static Result tst_create_from_span(void) {
+  Result r = PASS;
+
+  for(size_t n = 0; n < 100; n++) {
+    int values[100];
+    for(size_t i = 0; i < n; i++) values[i] = rand() % 50;
+
+    PQ_Heap heap = {0};
+    EXPECT_OK(&r, PQ_create_from_span(&heap, (SPN_Span){values, n, sizeof(int)}, 3, compare_ints));
+    if(HAS_FAILED(&r)) return r;
+
+    // handles are the indices in the span
+    for(size_t i = 0; i < n; i++) EXPECT_EQ(&r, values[i], *(const int *)PQ_get(&heap, i));
+
+    SPN_sort((SPN_MutSpan){values, n, sizeof(int)}, compare_ints);
+    for(size_t i = 0; i < n; i++) {
+      int popped = 0;
+      EXPECT_OK(&r, PQ_pop(&heap, &popped));
+      EXPECT_EQ(&r, values[i], popped);
+    }
+
+    EXPECT_OK(&r, PQ_destroy(&heap));
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_handles(void) {
+  Result r = PASS;
+
+  // reference: value of each handle, and whether it is in the heap
+  enum { MAX_HANDLES = 300 };
+  int  values[MAX_HANDLES] = {0};
+  bool alive[MAX_HANDLES]  = {0};
+
+  PQ_Heap heap = {0};
+  EXPECT_OK(&r, PQ_create(&heap, sizeof(int), 4, compare_ints));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < 20000; i++) {
+    const int action = rand() % 5;
+    const int value  = rand() % 10000;
+
+    if(action <= 1 && PQ_get_size(&heap) < (MAX_HANDLES / 2)) {
+      PQ_Handle handle = 0;
+      EXPECT_OK(&r, PQ_push(&heap, &value, &handle));
+      EXPECT_LT(&r, handle, MAX_HANDLES);
+      if(HAS_FAILED(&r)) break;
+      EXPECT_FALSE(&r, alive[handle]); // handles in use aren't handed out again
+      values[handle] = value;
+      alive[handle]  = true;
+    } else if(!PQ_is_empty(&heap)) {
+      // pick some live handle
+      PQ_Handle handle = (PQ_Handle)(rand() % MAX_HANDLES);
+      while(!alive[handle]) handle = (handle + 1) % MAX_HANDLES;
+
+      if(action == 2) {
+        EXPECT_OK(&r, PQ_update(&heap, handle, &value));
+        values[handle] = value;
+      } else if(action == 3) {
+        int removed = 0;
+        EXPECT_OK(&r, PQ_remove(&heap, handle, &removed));
+        EXPECT_EQ(&r, values[handle], removed);
+        alive[handle] = false;
+        EXPECT_FALSE(&r, PQ_is_valid_handle(&heap, handle));
+        EXPECT_NOK(&r, PQ_update(&heap, handle, &value));
+      } else {
+        const PQ_Handle top = PQ_peek_handle(&heap);
+        int             popped = 0;
+        EXPECT_OK(&r, PQ_pop(&heap, &popped));
+        EXPECT_EQ(&r, values[top], popped);
+        alive[top] = false;
+
+        // nothing left is less than what we popped
+        for(size_t h = 0; h < MAX_HANDLES; h++) {
+          if(alive[h]) EXPECT_LE(&r, popped, values[h]);
+        }
+      }
+    }
+
+    size_t num_alive = 0;
+    for(size_t h = 0; h < MAX_HANDLES; h++) {
+      if(!alive[h]) continue;
+      num_alive++;
+      EXPECT_EQ(&r, values[h], *(const int *)PQ_get(&heap, h));
+    }
+    EXPECT_EQ(&r, num_alive, PQ_get_size(&heap));
+    if(HAS_FAILED(&r)) break;
+  }
+
+  // replacing the top keeps its handle
+  EXPECT_OK(&r, PQ_clear(&heap));
+  PQ_Handle handle = 0;
+  EXPECT_OK(&r, PQ_push(&heap, &(int){1}, &handle));
+  EXPECT_OK(&r, PQ_push(&heap, &(int){5}, NULL));
+  EXPECT_OK(&r, PQ_replace_top(&heap, &(int){10}));
+  EXPECT_EQ(&r, 5, *(const int *)PQ_peek(&heap));
+  EXPECT_EQ(&r, 10, *(const int *)PQ_get(&heap, handle));
+
+  EXPECT_OK(&r, PQ_destroy(&heap));
+
+  return r;
+}
+
+static Result tst_top_k(void) {
+  Result r = PASS;
+
+  const size_t n      = 10000;
+  int *        values = malloc(n * sizeof(int));
+  EXPECT_NE(&r, NULL, values);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < n; i++) values[i] = rand();
+
+  const size_t ks[] = {1, 10, 1000, n + 5};
+  for(size_t k_idx = 0; k_idx < (sizeof(ks) / sizeof(ks[0])); k_idx++) {
+    const size_t k        = ks[k_idx];
+    const size_t expect_n = (k < n) ? k : n;
+
+    PQ_TopK    top    = {0};
+    DAR_DArray result = {0};
+    EXPECT_OK(&r, PQ_top_k_create(&top, sizeof(int), k, compare_ints));
+    EXPECT_OK(&r, DAR_create(&result, sizeof(int)));
+    if(HAS_FAILED(&r)) break;
+
+    // half one at a time, half as a span
+    for(size_t i = 0; i < (n / 2); i++) EXPECT_OK(&r, PQ_top_k_push(&top, &values[i]));
+    EXPECT_OK(&r, PQ_top_k_push_span(&top, (SPN_Span){&values[n / 2], n - (n / 2), sizeof(int)}));
+    EXPECT_OK(&r, PQ_top_k_to_darray(&top, &result));
+
+    EXPECT_EQ(&r, expect_n, result.size);
+    if(!HAS_FAILED(&r)) {
+      int * sorted = malloc(n * sizeof(int));
+      EXPECT_NE(&r, NULL, sorted);
+      if(!HAS_FAILED(&r)) {
+        memcpy(sorted, values, n * sizeof(int));
+        SPN_sort((SPN_MutSpan){sorted, n, sizeof(int)}, compare_ints);
+        EXPECT_ARREQ(&r, int, &sorted[n - expect_n], result.data, expect_n);
+      }
+      free(sorted);
+    }
+
+    EXPECT_OK(&r, PQ_top_k_destroy(&top));
+    EXPECT_OK(&r, DAR_destroy(&result));
+    if(HAS_FAILED(&r)) break;
+  }
+
+  PQ_TopK top = {0};
+  EXPECT_NOK(&r, PQ_top_k_create(&top, sizeof(int), 0, compare_ints));
+
+  free(values);
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_create_destroy,
+      tst_push_pop,
+      tst_create_from_span,
+      tst_handles,
+      tst_top_k,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
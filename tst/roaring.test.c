@@ -0,0 +1,337 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "roaring.h"
+
+#define OK STAT_OK
+
+#define UNIVERSE (5 * RBM_CONTAINER_NUM_VALUES)
+
+// Fills bitmap and reference with values in [0, UNIVERSE), with each container getting a different
+// density: empty, sparse, dense, and consecutive ranges.
+static Result fill_mixed(RBM_Bitmap * bitmap, bool * reference) {
+  Result r = PASS;
+
+  memset(reference, 0, UNIVERSE * sizeof(bool));
+
+  for(uint32_t v = RBM_CONTAINER_NUM_VALUES; v < (2 * RBM_CONTAINER_NUM_VALUES); v++) {
+    reference[v] = (rand() % 100) == 0;
+  }
+  for(uint32_t v = (2 * RBM_CONTAINER_NUM_VALUES); v < (3 * RBM_CONTAINER_NUM_VALUES); v++) {
+    reference[v] = (rand() % 2) == 0;
+  }
+  for(uint32_t v = (3 * RBM_CONTAINER_NUM_VALUES); (v + 1000) <= UNIVERSE; v += 1000) {
+    const uint32_t len = (uint32_t)(rand() % 900);
+    for(uint32_t i = 0; i < len; i++) reference[v + i] = true;
+  }
+
+  for(uint32_t v = 0; v < UNIVERSE; v++) {
+    if(reference[v]) EXPECT_OK(&r, RBM_add(bitmap, v));
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result check_matches(const RBM_Bitmap * bitmap, const bool * reference) {
+  Result r = PASS;
+
+  DAR_DArray values = {0};
+  EXPECT_OK(&r, DAR_create(&values, sizeof(uint32_t)));
+  EXPECT_OK(&r, RBM_to_darray(bitmap, &values));
+  if(HAS_FAILED(&r)) return r;
+
+  size_t idx = 0;
+  for(uint32_t v = 0; v < UNIVERSE; v++) {
+    EXPECT_EQ(&r, reference[v], RBM_contains(bitmap, v));
+    if(reference[v]) {
+      EXPECT_LT(&r, idx, values.size);
+      if(HAS_FAILED(&r)) break;
+      EXPECT_EQ(&r, v, *(uint32_t *)DAR_get(&values, idx));
+      idx++;
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+  EXPECT_EQ(&r, idx, values.size);
+  EXPECT_EQ(&r, idx, RBM_get_cardinality(bitmap));
+
+  EXPECT_OK(&r, DAR_destroy(&values));
+
+  return r;
+}
+
+static Result tst_create_destroy(void) {
+  Result     r      = PASS;
+  RBM_Bitmap bitmap = {0};
+
+  EXPECT_OK(&r, RBM_create(&bitmap));
+  EXPECT_TRUE(&r, RBM_is_initialized(&bitmap));
+  EXPECT_TRUE(&r, RBM_is_empty(&bitmap));
+  EXPECT_EQ(&r, 0, RBM_get_cardinality(&bitmap));
+  EXPECT_FALSE(&r, RBM_contains(&bitmap, 0));
+  EXPECT_OK(&r, RBM_destroy(&bitmap));
+  EXPECT_FALSE(&r, RBM_is_initialized(&bitmap));
+
+  EXPECT_NOK(&r, RBM_create(NULL));
+  EXPECT_NOK(&r, RBM_add(&bitmap, 1));
+  EXPECT_OK(&r, RBM_destroy(NULL));
+
+  return r;
+}
+
+static Result tst_add_remove(void) {
+  Result     r      = PASS;
+  RBM_Bitmap bitmap = {0};
+
+  EXPECT_OK(&r, RBM_create(&bitmap));
+  if(HAS_FAILED(&r)) return r;
+
+  // values at the edges of the key space end up in their own containers
+  const uint32_t edges[] = {0, 65535, 65536, UINT32_MAX, UINT32_MAX - 65536};
+  for(size_t i = 0; i < 5; i++) EXPECT_OK(&r, RBM_add(&bitmap, edges[i]));
+  for(size_t i = 0; i < 5; i++) EXPECT_OK(&r, RBM_add(&bitmap, edges[i])); // already in there
+  EXPECT_EQ(&r, 5, RBM_get_cardinality(&bitmap));
+  EXPECT_EQ(&r, 4, RBM_get_num_containers(&bitmap));
+  for(size_t i = 0; i < 5; i++) EXPECT_TRUE(&r, RBM_contains(&bitmap, edges[i]));
+  EXPECT_FALSE(&r, RBM_contains(&bitmap, 1));
+
+  for(size_t i = 0; i < 5; i++) EXPECT_OK(&r, RBM_remove(&bitmap, edges[i]));
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, RBM_remove(&bitmap, 0));
+  EXPECT_TRUE(&r, RBM_is_empty(&bitmap));
+
+  // a container becomes a bitset when it gets too big for an array, and back when it shrinks
+  for(uint32_t v = 0; v < RBM_ARRAY_MAX_CARDINALITY; v++) EXPECT_OK(&r, RBM_add(&bitmap, v * 2));
+  const RBM_Container * c = DAR_first(&bitmap.containers);
+  EXPECT_EQ(&r, RBM_CONTAINER_ARRAY, c->type);
+  EXPECT_OK(&r, RBM_add(&bitmap, 1));
+  c = DAR_first(&bitmap.containers);
+  EXPECT_EQ(&r, RBM_CONTAINER_BITSET, c->type);
+  EXPECT_EQ(&r, RBM_ARRAY_MAX_CARDINALITY + 1, RBM_get_cardinality(&bitmap));
+  EXPECT_OK(&r, RBM_remove(&bitmap, 2));
+  c = DAR_first(&bitmap.containers);
+  EXPECT_EQ(&r, RBM_CONTAINER_ARRAY, c->type);
+  EXPECT_TRUE(&r, RBM_contains(&bitmap, 1));
+  EXPECT_FALSE(&r, RBM_contains(&bitmap, 2));
+
+  EXPECT_OK(&r, RBM_clear(&bitmap));
+  EXPECT_TRUE(&r, RBM_is_empty(&bitmap));
+
+  // and against a reference, with all kinds of containers
+  bool * reference = malloc(UNIVERSE * sizeof(bool));
+  EXPECT_NE(&r, NULL, reference);
+  if(HAS_FAILED(&r)) return r;
+
+  r = fill_mixed(&bitmap, reference);
+  if(!HAS_FAILED(&r)) r = check_matches(&bitmap, reference);
+
+  for(size_t i = 0; i < 20000 && !HAS_FAILED(&r); i++) {
+    const uint32_t v = (uint32_t)(rand() % UNIVERSE);
+    EXPECT_EQ(&r, (reference[v] ? OK : STAT_OK_NOT_FOUND), RBM_remove(&bitmap, v));
+    reference[v] = false;
+  }
+  if(!HAS_FAILED(&r)) r = check_matches(&bitmap, reference);
+
+  free(reference);
+  EXPECT_OK(&r, RBM_destroy(&bitmap));
+
+  return r;
+}
+
+static Result tst_or_and(void) {
+  Result r = PASS;
+
+  bool * lhs_ref = malloc(UNIVERSE * sizeof(bool));
+  bool * rhs_ref = malloc(UNIVERSE * sizeof(bool));
+  bool * expect  = malloc(UNIVERSE * sizeof(bool));
+  EXPECT_NE(&r, NULL, lhs_ref);
+  EXPECT_NE(&r, NULL, rhs_ref);
+  EXPECT_NE(&r, NULL, expect);
+  if(HAS_FAILED(&r)) return r;
+
+  RBM_Bitmap lhs = {0};
+  RBM_Bitmap rhs = {0};
+  EXPECT_OK(&r, RBM_create(&lhs));
+  EXPECT_OK(&r, RBM_create(&rhs));
+  if(!HAS_FAILED(&r)) r = fill_mixed(&lhs, lhs_ref);
+  if(!HAS_FAILED(&r)) r = fill_mixed(&rhs, rhs_ref);
+
+  // make the first container rhs-only, and the second lhs-only
+  for(uint32_t v = 0; v < 1000 && !HAS_FAILED(&r); v++) {
+    EXPECT_OK(&r, RBM_add(&rhs, v * 7));
+    rhs_ref[v * 7] = true;
+  }
+  for(uint32_t v = RBM_CONTAINER_NUM_VALUES; v < (2 * RBM_CONTAINER_NUM_VALUES); v++) {
+    if(rhs_ref[v]) EXPECT_OK(&r, RBM_remove(&rhs, v));
+    rhs_ref[v] = false;
+  }
+
+  // once as they are, once with run containers in the mix on either side
+  for(int round = 0; round < 3 && !HAS_FAILED(&r); round++) {
+    if(round == 1) EXPECT_OK(&r, RBM_run_optimize(&lhs));
+    if(round == 2) EXPECT_OK(&r, RBM_run_optimize(&rhs));
+
+    RBM_Bitmap result = {0};
+
+    EXPECT_OK(&r, RBM_create_from(&result, &lhs));
+    EXPECT_OK(&r, RBM_or(&result, &rhs));
+    for(uint32_t v = 0; v < UNIVERSE; v++) expect[v] = lhs_ref[v] || rhs_ref[v];
+    if(!HAS_FAILED(&r)) r = check_matches(&result, expect);
+    EXPECT_OK(&r, RBM_destroy(&result));
+
+    EXPECT_OK(&r, RBM_create_from(&result, &lhs));
+    EXPECT_OK(&r, RBM_and(&result, &rhs));
+    for(uint32_t v = 0; v < UNIVERSE; v++) expect[v] = lhs_ref[v] && rhs_ref[v];
+    if(!HAS_FAILED(&r)) r = check_matches(&result, expect);
+    EXPECT_OK(&r, RBM_destroy(&result));
+  }
+
+  // with itself
+  EXPECT_OK(&r, RBM_or(&lhs, &lhs));
+  EXPECT_OK(&r, RBM_and(&lhs, &lhs));
+  if(!HAS_FAILED(&r)) r = check_matches(&lhs, lhs_ref);
+
+  EXPECT_OK(&r, RBM_destroy(&lhs));
+  EXPECT_OK(&r, RBM_destroy(&rhs));
+  free(lhs_ref);
+  free(rhs_ref);
+  free(expect);
+
+  return r;
+}
+
+static Result tst_run_optimize(void) {
+  Result     r      = PASS;
+  RBM_Bitmap bitmap = {0};
+
+  EXPECT_OK(&r, RBM_create(&bitmap));
+  for(uint32_t v = 100; v < 200000; v++) EXPECT_OK(&r, RBM_add(&bitmap, v));
+  EXPECT_OK(&r, RBM_add(&bitmap, 300000));
+  if(HAS_FAILED(&r)) return r;
+
+  const size_t size_before = RBM_get_serialized_size(&bitmap);
+  EXPECT_OK(&r, RBM_run_optimize(&bitmap));
+  EXPECT_LT(&r, RBM_get_serialized_size(&bitmap), size_before / 100);
+
+  // the single value is cheaper as an array
+  const RBM_Container * containers = bitmap.containers.data;
+  EXPECT_EQ(&r, 5, RBM_get_num_containers(&bitmap));
+  EXPECT_EQ(&r, RBM_CONTAINER_RUN, containers[0].type);
+  EXPECT_EQ(&r, RBM_CONTAINER_RUN, containers[3].type);
+  EXPECT_EQ(&r, RBM_CONTAINER_ARRAY, containers[4].type);
+
+  EXPECT_EQ(&r, (200000 - 100) + 1, RBM_get_cardinality(&bitmap));
+  EXPECT_FALSE(&r, RBM_contains(&bitmap, 99));
+  EXPECT_TRUE(&r, RBM_contains(&bitmap, 100));
+  EXPECT_TRUE(&r, RBM_contains(&bitmap, 65535));
+  EXPECT_TRUE(&r, RBM_contains(&bitmap, 65536));
+  EXPECT_TRUE(&r, RBM_contains(&bitmap, 199999));
+  EXPECT_FALSE(&r, RBM_contains(&bitmap, 200000));
+
+  // modifying turns runs back into a bitset
+  EXPECT_OK(&r, RBM_remove(&bitmap, 1000));
+  containers = bitmap.containers.data;
+  EXPECT_EQ(&r, RBM_CONTAINER_BITSET, containers[0].type);
+  EXPECT_FALSE(&r, RBM_contains(&bitmap, 1000));
+  EXPECT_EQ(&r, (200000 - 100), RBM_get_cardinality(&bitmap));
+
+  EXPECT_OK(&r, RBM_destroy(&bitmap));
+
+  return r;
+}
+
+static Result tst_serialization(void) {
+  Result r = PASS;
+
+  bool *     reference = malloc(UNIVERSE * sizeof(bool));
+  RBM_Bitmap bitmap    = {0};
+  RBM_Bitmap copy      = {0};
+  DAR_DArray bytes     = {0};
+  EXPECT_NE(&r, NULL, reference);
+  EXPECT_OK(&r, RBM_create(&bitmap));
+  EXPECT_OK(&r, DAR_create(&bytes, sizeof(uint8_t)));
+  if(!HAS_FAILED(&r)) r = fill_mixed(&bitmap, reference);
+  EXPECT_OK(&r, RBM_run_optimize(&bitmap));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, DAR_resize(&bytes, RBM_get_serialized_size(&bitmap)));
+  EXPECT_OK(&r, RBM_serialize(&bitmap, DAR_to_mut_span(&bytes)));
+  EXPECT_OK(&r, RBM_deserialize(&copy, DAR_to_span(&bytes)));
+  if(!HAS_FAILED(&r)) r = check_matches(&copy, reference);
+  EXPECT_EQ(&r, RBM_get_num_containers(&bitmap), RBM_get_num_containers(&copy));
+  EXPECT_OK(&r, RBM_destroy(&copy));
+
+  // an empty bitmap is just a header
+  RBM_Bitmap empty = {0};
+  uint8_t    small[8];
+  EXPECT_OK(&r, RBM_create(&empty));
+  EXPECT_EQ(&r, sizeof(small), RBM_get_serialized_size(&empty));
+  EXPECT_OK(&r, RBM_serialize(&empty, (SPN_MutSpan){small, sizeof(small), 1}));
+  EXPECT_OK(&r, RBM_deserialize(&copy, (SPN_Span){small, sizeof(small), 1}));
+  EXPECT_TRUE(&r, RBM_is_empty(&copy));
+  EXPECT_OK(&r, RBM_destroy(&copy));
+
+  // out too small
+  EXPECT_EQ(&r, STAT_ERR_RANGE, RBM_serialize(&bitmap, (SPN_MutSpan){small, sizeof(small), 1}));
+
+  // truncated and corrupted input is rejected
+  SPN_Span truncated = DAR_to_span(&bytes);
+  truncated.len -= 1;
+  EXPECT_EQ(&r, STAT_ERR_PARSE, RBM_deserialize(&copy, truncated));
+  EXPECT_FALSE(&r, RBM_is_initialized(&copy));
+
+  ((uint8_t *)bytes.data)[0] ^= 0xff;
+  EXPECT_EQ(&r, STAT_ERR_PARSE, RBM_deserialize(&copy, DAR_to_span(&bytes)));
+  ((uint8_t *)bytes.data)[0] ^= 0xff;
+
+  // cardinality in the first container header doesn't match its contents
+  ((uint8_t *)bytes.data)[12] ^= 0x01;
+  EXPECT_EQ(&r, STAT_ERR_PARSE, RBM_deserialize(&copy, DAR_to_span(&bytes)));
+
+  EXPECT_OK(&r, RBM_destroy(&empty));
+  EXPECT_OK(&r, RBM_destroy(&bitmap));
+  EXPECT_OK(&r, DAR_destroy(&bytes));
+  free(reference);
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_create_destroy,
+      tst_add_remove,
+      tst_or_and,
+      tst_run_optimize,
+      tst_serialization,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "segarray.h"
+
+#define OK STAT_OK
+
+static Result tst_create_destroy(void) {
+  Result    r   = PASS;
+  SEG_Array arr = {0};
+
+  EXPECT_EQ(&r, OK, SEG_create(&arr, sizeof(int), 5));
+  EXPECT_TRUE(&r, SEG_is_initialized(&arr));
+  EXPECT_TRUE(&r, SEG_is_empty(&arr));
+  EXPECT_EQ(&r, 8, SEG_get_chunk_size(&arr)); // rounded up to power of two
+  EXPECT_EQ(&r, 0, SEG_get_capacity(&arr));
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+  EXPECT_FALSE(&r, SEG_is_initialized(&arr));
+
+  // default chunk size is about a page
+  EXPECT_EQ(&r, OK, SEG_create(&arr, sizeof(int), 0));
+  EXPECT_EQ(&r, 1024, SEG_get_chunk_size(&arr));
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+
+  EXPECT_EQ(&r, OK, SEG_create(&arr, 10000, 0));
+  EXPECT_EQ(&r, 1, SEG_get_chunk_size(&arr));
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SEG_create(NULL, sizeof(int), 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SEG_create(&arr, 0, 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SEG_create(&arr, sizeof(int), SIZE_MAX));
+  EXPECT_EQ(&r, OK, SEG_destroy(NULL));
+
+  return r;
+}
+
+static Result tst_push_back_get(void) {
+  Result    r   = PASS;
+  SEG_Array arr = {0};
+
+  const size_t num_vals = 1000;
+  int *        ptrs[1000];
+
+  EXPECT_EQ(&r, OK, SEG_create(&arr, sizeof(int), 16));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < num_vals; i++) {
+    const int val = (int)i;
+    EXPECT_EQ(&r, OK, SEG_push_back(&arr, &val));
+    EXPECT_EQ(&r, i + 1, arr.size);
+    ptrs[i] = SEG_get(&arr, i);
+  }
+  EXPECT_TRUE(&r, SEG_get_capacity(&arr) >= num_vals);
+  EXPECT_EQ(&r, (num_vals + 15) / 16, SEG_get_num_chunks_in_use(&arr));
+
+  // growing never moves elements, so all earlier pointers remain valid
+  for(size_t i = 0; i < num_vals; i++) {
+    EXPECT_EQ(&r, ptrs[i], SEG_get(&arr, i));
+    EXPECT_EQ(&r, (int)i, *ptrs[i]);
+  }
+
+  const SEG_Array * const_arr = &arr;
+  const void *            out = NULL;
+  EXPECT_EQ(&r, OK, SEG_get_checked(const_arr, 500, &out));
+  EXPECT_EQ(&r, 500, *(const int *)out);
+  EXPECT_EQ(&r, STAT_ERR_RANGE, SEG_get_checked(const_arr, num_vals, &out));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SEG_get_checked(const_arr, 0, (const void **)NULL));
+
+  EXPECT_EQ(&r, OK, SEG_pop_back(&arr));
+  EXPECT_EQ(&r, num_vals - 1, arr.size);
+  EXPECT_EQ(&r, OK, SEG_clear(&arr));
+  EXPECT_TRUE(&r, SEG_is_empty(&arr));
+  EXPECT_EQ(&r, STAT_ERR_EMPTY, SEG_pop_back(&arr));
+
+  // clearing keeps chunks around until shrinking
+  EXPECT_TRUE(&r, SEG_get_capacity(&arr) >= num_vals);
+  EXPECT_EQ(&r, OK, SEG_shrink_to_fit(&arr));
+  EXPECT_EQ(&r, 0, SEG_get_capacity(&arr));
+
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+
+  return r;
+}
+
+static Result tst_push_back_span(void) {
+  Result    r   = PASS;
+  SEG_Array arr = {0};
+
+  const size_t num_vals = 100;
+  double       vals[100];
+  for(size_t i = 0; i < num_vals; i++) vals[i] = (double)i * 0.5;
+
+  const SPN_Span span = {.begin = vals, .len = num_vals, .element_size = sizeof(double)};
+
+  EXPECT_EQ(&r, OK, SEG_create(&arr, sizeof(double), 8));
+  if(HAS_FAILED(&r)) return r;
+
+  // start with an offset so that copies straddle chunk boundaries
+  EXPECT_EQ(&r, OK, SEG_push_back(&arr, &vals[0]));
+  EXPECT_EQ(&r, OK, SEG_push_back_span(&arr, span));
+  EXPECT_EQ(&r, OK, SEG_push_back_span(&arr, SPN_subspan(span, 3, 11)));
+  EXPECT_EQ(&r, 1 + num_vals + 11, arr.size);
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_EQ(&r, vals[0], *(double *)SEG_get(&arr, 0));
+  for(size_t i = 0; i < num_vals; i++) EXPECT_EQ(&r, vals[i], *(double *)SEG_get(&arr, 1 + i));
+  for(size_t i = 0; i < 11; i++) {
+    EXPECT_EQ(&r, vals[3 + i], *(double *)SEG_get(&arr, 1 + num_vals + i));
+  }
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SEG_push_back_span(&arr, SPN_from_cstr("abc")));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SEG_push_back_span(NULL, span));
+
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+
+  return r;
+}
+
+static Result tst_resize_zeroed_reserve(void) {
+  Result    r   = PASS;
+  SEG_Array arr = {0};
+
+  EXPECT_EQ(&r, OK, SEG_create(&arr, sizeof(uint16_t), 32));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_EQ(&r, OK, SEG_reserve(&arr, 100));
+  EXPECT_EQ(&r, 128, SEG_get_capacity(&arr));
+  EXPECT_TRUE(&r, SEG_is_empty(&arr));
+
+  // dirty the memory first, to make sure zeroing actually happens
+  const uint16_t val = 0xffff;
+  for(size_t i = 0; i < 100; i++) EXPECT_EQ(&r, OK, SEG_push_back(&arr, &val));
+  EXPECT_EQ(&r, OK, SEG_resize_zeroed(&arr, 5));
+  EXPECT_EQ(&r, 5, arr.size);
+  EXPECT_EQ(&r, OK, SEG_resize_zeroed(&arr, 300));
+  EXPECT_EQ(&r, 300, arr.size);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < 300; i++) EXPECT_EQ(&r, ((i < 5) ? val : 0), *(uint16_t *)SEG_get(&arr, i));
+
+  EXPECT_EQ(&r, OK, SEG_resize_zeroed(&arr, 40));
+  EXPECT_EQ(&r, OK, SEG_shrink_to_fit(&arr));
+  EXPECT_EQ(&r, 64, SEG_get_capacity(&arr));
+
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+
+  return r;
+}
+
+static Result tst_chunk_spans(void) {
+  Result    r   = PASS;
+  SEG_Array arr = {0};
+
+  const size_t num_vals = 1000;
+
+  EXPECT_EQ(&r, OK, SEG_create(&arr, sizeof(int64_t), 64));
+  if(HAS_FAILED(&r)) return r;
+
+  int64_t expected_sum = 0;
+  for(size_t i = 0; i < num_vals; i++) {
+    const int64_t val = (int64_t)(rand() % 1000);
+    EXPECT_EQ(&r, OK, SEG_push_back(&arr, &val));
+    expected_sum += val;
+  }
+
+  // double every element through mutable chunk spans, then sum through const chunk spans
+  for(size_t c = 0; c < SEG_get_num_chunks_in_use(&arr); c++) {
+    const SPN_MutSpan chunk = SEG_get_chunk_mut_span(&arr, c);
+    EXPECT_EQ(&r, 0, ((uintptr_t)chunk.begin % 64));
+    for(size_t i = 0; i < chunk.len; i++) ((int64_t *)chunk.begin)[i] *= 2;
+  }
+
+  int64_t sum        = 0;
+  size_t  num_summed = 0;
+  for(size_t c = 0; c < SEG_get_num_chunks_in_use(&arr); c++) {
+    const SPN_Span chunk = SEG_get_chunk_span(&arr, c);
+    EXPECT_EQ(&r, ((c + 1) < SEG_get_num_chunks_in_use(&arr)) ? 64 : (num_vals % 64), chunk.len);
+    for(size_t i = 0; i < chunk.len; i++) sum += ((const int64_t *)chunk.begin)[i];
+    num_summed += chunk.len;
+  }
+  EXPECT_EQ(&r, num_vals, num_summed);
+  EXPECT_EQ(&r, 2 * expected_sum, sum);
+
+  EXPECT_TRUE(&r, SPN_is_empty(SEG_get_chunk_span(&arr, SEG_get_num_chunks_in_use(&arr))));
+
+  EXPECT_EQ(&r, OK, SEG_destroy(&arr));
+
+  return r;
+}
+
+int main(void) {
+  Test tests[] = {
+      tst_create_destroy,
+      tst_push_back_get,
+      tst_push_back_span,
+      tst_resize_zeroed_reserve,
+      tst_chunk_spans,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
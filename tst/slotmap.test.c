@@ -0,0 +1,176 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "slotmap.h"
+
+#define OK STAT_OK
+
+typedef struct {
+  int    id;
+  double payload;
+} Entity;
+
+static Result tst_create_destroy(void) {
+  Result      r   = PASS;
+  SLM_SlotMap map = {0};
+
+  EXPECT_OK(&r, SLM_create(&map, sizeof(Entity)));
+  EXPECT_TRUE(&r, SLM_is_initialized(&map));
+  EXPECT_TRUE(&r, SLM_is_empty(&map));
+  EXPECT_FALSE(&r, SLM_contains(&map, SLM_NULL_HANDLE));
+  EXPECT_EQ(&r, NULL, SLM_get(&map, SLM_NULL_HANDLE));
+  EXPECT_OK(&r, SLM_destroy(&map));
+  EXPECT_FALSE(&r, SLM_is_initialized(&map));
+
+  SLM_Handle handle = SLM_NULL_HANDLE;
+  EXPECT_NOK(&r, SLM_create(NULL, sizeof(Entity)));
+  EXPECT_NOK(&r, SLM_create(&map, 0));
+  EXPECT_NOK(&r, SLM_insert(&map, &(Entity){0}, &handle));
+  EXPECT_OK(&r, SLM_destroy(NULL));
+
+  return r;
+}
+
+static Result tst_insert_remove_get(void) {
+  Result      r   = PASS;
+  SLM_SlotMap map = {0};
+
+  EXPECT_OK(&r, SLM_create(&map, sizeof(Entity)));
+  if(HAS_FAILED(&r)) return r;
+
+  SLM_Handle handles[3] = {0};
+  for(int i = 0; i < 3; i++) {
+    EXPECT_OK(&r, SLM_insert(&map, &(Entity){.id = i, .payload = i * 0.5}, &handles[i]));
+    EXPECT_NE(&r, SLM_NULL_HANDLE, handles[i]);
+  }
+  EXPECT_EQ(&r, 3, SLM_get_size(&map));
+  if(HAS_FAILED(&r)) return r;
+
+  // removing the first moves the last into its place, but handles keep pointing to the right one
+  EXPECT_OK(&r, SLM_remove(&map, handles[0]));
+  EXPECT_EQ(&r, 2, SLM_get_size(&map));
+  EXPECT_FALSE(&r, SLM_contains(&map, handles[0]));
+  EXPECT_EQ(&r, NULL, SLM_get(&map, handles[0]));
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, SLM_remove(&map, handles[0]));
+  EXPECT_EQ(&r, 1, ((const Entity *)SLM_get(&map, handles[1]))->id);
+  EXPECT_EQ(&r, 2, ((const Entity *)SLM_get(&map, handles[2]))->id);
+  EXPECT_EQ(&r, 2, ((const Entity *)SPN_first(SLM_to_span(&map)))->id);
+  EXPECT_EQ(&r, handles[2], SLM_get_handle_at(&map, 0));
+
+  // the slot is reused, but the old handle stays invalid
+  SLM_Handle reused = SLM_NULL_HANDLE;
+  EXPECT_OK(&r, SLM_insert(&map, &(Entity){.id = 3}, &reused));
+  EXPECT_NE(&r, handles[0], reused);
+  EXPECT_EQ(&r, (uint32_t)handles[0], (uint32_t)reused);
+  EXPECT_EQ(&r, NULL, SLM_get(&map, handles[0]));
+  EXPECT_EQ(&r, 3, ((const Entity *)SLM_get(&map, reused))->id);
+
+  // modify through a handle
+  ((Entity *)SLM_get(&map, handles[1]))->payload = 42.0;
+  EXPECT_EQ(&r, 42.0, ((const Entity *)SLM_get((const SLM_SlotMap *)&map, handles[1]))->payload);
+
+  // handles with slots that were never used, and garbage handles
+  EXPECT_FALSE(&r, SLM_contains(&map, handles[1] + 1000));
+  EXPECT_FALSE(&r, SLM_contains(&map, handles[1] + ((SLM_Handle)2 << 32)));
+
+  EXPECT_OK(&r, SLM_clear(&map));
+  EXPECT_TRUE(&r, SLM_is_empty(&map));
+  EXPECT_FALSE(&r, SLM_contains(&map, handles[1]));
+  EXPECT_FALSE(&r, SLM_contains(&map, reused));
+
+  EXPECT_OK(&r, SLM_destroy(&map));
+
+  return r;
+}
+
+static Result tst_many_random_operations(void) {
+  Result      r   = PASS;
+  SLM_SlotMap map = {0};
+
+  enum { MAX_LIVE = 500 };
+  SLM_Handle live[MAX_LIVE] = {0};
+  int        ids[MAX_LIVE]  = {0};
+  size_t     num_live       = 0;
+  SLM_Handle dead[MAX_LIVE] = {0};
+  size_t     num_dead       = 0;
+  int        next_id        = 0;
+
+  EXPECT_OK(&r, SLM_create(&map, sizeof(Entity)));
+  EXPECT_OK(&r, SLM_reserve(&map, MAX_LIVE));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < 50000; i++) {
+    if((rand() % 2) == 0 && num_live < MAX_LIVE) {
+      EXPECT_OK(&r, SLM_insert(&map, &(Entity){.id = next_id}, &live[num_live]));
+      ids[num_live++] = next_id++;
+    } else if(num_live > 0) {
+      const size_t idx = (size_t)rand() % num_live;
+      EXPECT_OK(&r, SLM_remove(&map, live[idx]));
+      dead[num_dead++ % MAX_LIVE] = live[idx];
+      live[idx]                   = live[num_live - 1];
+      ids[idx]                    = ids[num_live - 1];
+      num_live--;
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+
+  EXPECT_EQ(&r, num_live, SLM_get_size(&map));
+  for(size_t i = 0; i < num_live; i++) {
+    const Entity * e = SLM_get(&map, live[i]);
+    EXPECT_NE(&r, NULL, e);
+    if(HAS_FAILED(&r)) break;
+    EXPECT_EQ(&r, ids[i], e->id);
+  }
+  for(size_t i = 0; i < ((num_dead < MAX_LIVE) ? num_dead : MAX_LIVE); i++) {
+    EXPECT_FALSE(&r, SLM_contains(&map, dead[i]));
+  }
+
+  // iterating the dense storage gives every element once, with its handle
+  const SPN_Span values = SLM_to_span(&map);
+  for(size_t i = 0; i < values.len; i++) {
+    const Entity * e = SPN_get(values, i);
+    EXPECT_EQ(&r, e, SLM_get(&map, SLM_get_handle_at(&map, i)));
+  }
+
+  EXPECT_OK(&r, SLM_destroy(&map));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_create_destroy,
+      tst_insert_remove_get,
+      tst_many_random_operations,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "soatable.h"
+
+#define OK STAT_OK
+
+typedef struct {
+  uint32_t id;
+  double   price;
+  uint8_t  flags;
+  int64_t  timestamp;
+} Record;
+
+static const SOA_Column g_record_columns[] = {
+    SOA_COLUMN(Record, id),
+    SOA_COLUMN(Record, price),
+    SOA_COLUMN(Record, flags),
+    SOA_COLUMN(Record, timestamp),
+};
+#define NUM_RECORD_COLUMNS (sizeof(g_record_columns) / sizeof(SOA_Column))
+
+static Record make_record(size_t i) {
+  Record record = {0}; // NOTE zeroes padding too, so records can be compared with memcmp
+  record.id        = (uint32_t)i;
+  record.price     = (double)i * 1.25;
+  record.flags     = (uint8_t)(i % 7);
+  record.timestamp = -(int64_t)i * 1000;
+  return record;
+}
+
+static Result tst_create_destroy(void) {
+  Result    r     = PASS;
+  SOA_Table table = {0};
+
+  EXPECT_EQ(&r, OK, SOA_create(&table, g_record_columns, NUM_RECORD_COLUMNS, sizeof(Record)));
+  EXPECT_EQ(&r, NUM_RECORD_COLUMNS, SOA_get_num_columns(&table));
+  EXPECT_EQ(&r, 0, SOA_get_num_rows(&table));
+  EXPECT_EQ(&r, sizeof(double), SOA_get_column(&table, 1).element_size);
+  EXPECT_EQ(&r, OK, SOA_destroy(&table));
+  EXPECT_EQ(&r, OK, SOA_destroy(NULL));
+
+  const SOA_Column too_far[] = {{.offset = sizeof(Record) - 4, .size = 8}};
+  const SOA_Column empty[]   = {{.offset = 0, .size = 0}};
+
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_create(&table, too_far, 1, sizeof(Record)));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_create(&table, empty, 1, sizeof(Record)));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_create(&table, g_record_columns, 0, sizeof(Record)));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_create(&table, NULL, 1, sizeof(Record)));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_create(&table, g_record_columns, NUM_RECORD_COLUMNS, 0));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_create(NULL, g_record_columns, 1, sizeof(Record)));
+
+  return r;
+}
+
+static Result tst_push_and_get_rows(void) {
+  Result    r     = PASS;
+  SOA_Table table = {0};
+
+  const size_t num_rows = 1000;
+
+  EXPECT_EQ(&r, OK, SOA_create(&table, g_record_columns, NUM_RECORD_COLUMNS, sizeof(Record)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < num_rows; i++) {
+    const Record record = make_record(i);
+    EXPECT_EQ(&r, OK, SOA_push_row(&table, &record));
+  }
+  EXPECT_EQ(&r, num_rows, SOA_get_num_rows(&table));
+
+  for(size_t i = 0; (i < num_rows) && !HAS_FAILED(&r); i++) {
+    const Record expected = make_record(i);
+    Record       record   = {0};
+    EXPECT_EQ(&r, OK, SOA_get_row(&table, i, &record));
+    EXPECT_EQ(&r, 0, memcmp(&expected, &record, sizeof(Record)));
+  }
+
+  Record record = {0};
+  EXPECT_EQ(&r, STAT_ERR_RANGE, SOA_get_row(&table, num_rows, &record));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_get_row(&table, 0, NULL));
+  EXPECT_EQ(&r, STAT_ERR_ARGS, SOA_push_row(&table, NULL));
+
+  EXPECT_EQ(&r, OK, SOA_clear(&table));
+  EXPECT_EQ(&r, 0, SOA_get_num_rows(&table));
+  EXPECT_EQ(&r, 0, SOA_get_column(&table, 0).len);
+
+  EXPECT_EQ(&r, OK, SOA_destroy(&table));
+
+  return r;
+}
+
+static Result tst_columns(void) {
+  Result    r     = PASS;
+  SOA_Table table = {0};
+
+  const size_t num_rows = 100;
+
+  EXPECT_EQ(&r, OK, SOA_create(&table, g_record_columns, NUM_RECORD_COLUMNS, sizeof(Record)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < num_rows; i++) {
+    const Record record = make_record(i);
+    EXPECT_EQ(&r, OK, SOA_push_row(&table, &record));
+  }
+
+  // each column is a contiguous, aligned array of just that field
+  const SPN_Span prices = SOA_get_column(&table, 1);
+  EXPECT_EQ(&r, num_rows, prices.len);
+  EXPECT_EQ(&r, sizeof(double), prices.element_size);
+  EXPECT_TRUE(&r, SPN_is_aligned(prices, 64));
+
+  double sum = 0.0;
+  for(size_t i = 0; i < prices.len; i++) sum += ((const double *)prices.begin)[i];
+  EXPECT_EQ(&r, 1.25 * (double)(num_rows * (num_rows - 1) / 2), sum);
+
+  // changes through a mutable column show up in the rows
+  const SPN_MutSpan flags = SOA_get_mut_column(&table, 2);
+  for(size_t i = 0; i < flags.len; i++) ((uint8_t *)flags.begin)[i] = 0xff;
+
+  Record record = {0};
+  EXPECT_EQ(&r, OK, SOA_get_row(&table, 42, &record));
+  EXPECT_EQ(&r, 0xff, record.flags);
+  EXPECT_EQ(&r, 42, record.id);
+
+  EXPECT_TRUE(&r, SPN_is_empty(SOA_get_column(&table, NUM_RECORD_COLUMNS)));
+  EXPECT_TRUE(&r, SPN_is_empty(SPN_mut_to_const(SOA_get_mut_column(NULL, 0))));
+
+  EXPECT_EQ(&r, OK, SOA_destroy(&table));
+
+  return r;
+}
+
+static Result tst_aos_conversion(void) {
+  Result     r     = PASS;
+  SOA_Table  table = {0};
+  DAR_DArray aos   = {0};
+  DAR_DArray back  = {0};
+
+  const size_t num_rows = 777;
+
+  EXPECT_EQ(&r, OK, DAR_create(&aos, sizeof(Record)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < num_rows; i++) {
+    const Record record = make_record(i);
+    EXPECT_EQ(&r, OK, DAR_push_back(&aos, &record));
+  }
+
+  EXPECT_EQ(&r,
+            OK,
+            SOA_create_from_aos(&table, g_record_columns, NUM_RECORD_COLUMNS, DAR_to_span(&aos)));
+  EXPECT_EQ(&r, num_rows, SOA_get_num_rows(&table));
+
+  // appending in bulk works on a non-empty table too
+  EXPECT_EQ(&r, OK, SOA_push_rows(&table, SPN_subspan(DAR_to_span(&aos), 10, 5)));
+  EXPECT_EQ(&r, num_rows + 5, SOA_get_num_rows(&table));
+
+  EXPECT_EQ(&r, OK, SOA_to_aos(&table, &back));
+  EXPECT_EQ(&r, num_rows + 5, back.size);
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_EQ(&r, 0, memcmp(aos.data, back.data, DAR_get_size_in_bytes(&aos)));
+  EXPECT_EQ(&r, 0, memcmp(DAR_get(&aos, 10), DAR_get(&back, num_rows), 5 * sizeof(Record)));
+
+  // only the fields covered by columns survive a round trip, the rest is zeroed
+  SOA_Table  partial = {0};
+  DAR_DArray ids     = {0};
+  EXPECT_EQ(&r, OK, SOA_create_from_aos(&partial, g_record_columns, 1, DAR_to_span(&aos)));
+  EXPECT_EQ(&r, OK, SOA_to_aos(&partial, &ids));
+  EXPECT_EQ(&r, num_rows, ids.size);
+  if(!HAS_FAILED(&r)) {
+    const Record * record = DAR_get(&ids, 3);
+    EXPECT_EQ(&r, 3, record->id);
+    EXPECT_EQ(&r, 0.0, record->price);
+    EXPECT_EQ(&r, 0, record->timestamp);
+  }
+
+  EXPECT_EQ(&r,
+            STAT_ERR_ARGS,
+            SOA_push_rows(&table, (SPN_Span){.begin = aos.data, .len = 1, .element_size = 1}));
+
+  EXPECT_EQ(&r, OK, SOA_destroy(&table));
+  EXPECT_EQ(&r, OK, SOA_destroy(&partial));
+  EXPECT_EQ(&r, OK, DAR_destroy(&aos));
+  EXPECT_EQ(&r, OK, DAR_destroy(&back));
+  EXPECT_EQ(&r, OK, DAR_destroy(&ids));
+
+  return r;
+}
+
+int main(void) {
+  Test tests[] = {
+      tst_create_destroy,
+      tst_push_and_get_rows,
+      tst_columns,
+      tst_aos_conversion,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -21,6 +21,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "stat.h"
 #include "test_utils.h"
@@ -798,6 +799,252 @@ static Result tst_find_at_likely_usage(void) {
   return r;
 }
 
+static Result tst_find_all_element_sizes(void) {
+  Result r = PASS;
+
+  enum { MAX_LEN = 100, MAX_ELEMENT_SIZE = 8 };
+
+  // sizes with and without vectorized search, on lengths around the vector sizes
+  const size_t element_sizes[] = {1, 2, 3, 4, 8};
+  uint8_t      data[MAX_LEN * MAX_ELEMENT_SIZE];
+  uint8_t      needle[MAX_ELEMENT_SIZE];
+
+  for(size_t s = 0; s < (sizeof(element_sizes) / sizeof(element_sizes[0])); s++) {
+    const size_t element_size = element_sizes[s];
+
+    for(size_t len = 1; len <= MAX_LEN; len++) {
+      // few distinct byte values, so that we get matches as well as partial matches
+      for(size_t i = 0; i < (len * element_size); i++) data[i] = (uint8_t)(rand() % 2);
+      for(size_t i = 0; i < element_size; i++) needle[i] = (uint8_t)(rand() % 2);
+
+      const SPN_Span span = {.begin = data, .len = len, .element_size = element_size};
+
+      for(size_t at = 0; at < len; at++) {
+        size_t expect_fwd = len;
+        for(size_t i = at; i < len && expect_fwd == len; i++) {
+          if(memcmp(&data[i * element_size], needle, element_size) == 0) expect_fwd = i;
+        }
+        size_t expect_bwd = len;
+        for(size_t i = at + 1; i > 0 && expect_bwd == len; i--) {
+          if(memcmp(&data[(i - 1) * element_size], needle, element_size) == 0) expect_bwd = i - 1;
+        }
+
+        size_t idx = len;
+        EXPECT_EQ(&r,
+                  (expect_fwd == len) ? STAT_OK_NOT_FOUND : OK,
+                  SPN_find_at(span, needle, at, &idx));
+        EXPECT_EQ(&r, expect_fwd, idx);
+
+        idx = len;
+        EXPECT_EQ(&r,
+                  (expect_bwd == len) ? STAT_OK_NOT_FOUND : OK,
+                  SPN_find_reverse_at(span, needle, at, &idx));
+        EXPECT_EQ(&r, expect_bwd, idx);
+
+        if(HAS_FAILED(&r)) return r;
+      }
+    }
+  }
+
+  return r;
+}
+
+static Result tst_byte_set_find(void) {
+  Result r = PASS;
+
+  enum { MAX_LEN = 100 };
+
+  uint8_t data[MAX_LEN];
+
+  for(size_t iteration = 0; iteration < 200; iteration++) {
+    // sets from sparse to dense, and data that uses all byte values
+    SPN_ByteSet  set      = {0};
+    const size_t set_size = (size_t)rand() % 256;
+    EXPECT_OK(&r, SPN_byte_set_create(&set, SPN_from_cstr("")));
+    for(size_t i = 0; i < set_size; i++) SPN_byte_set_add(&set, (uint8_t)rand());
+
+    const size_t len = (size_t)rand() % MAX_LEN;
+    for(size_t i = 0; i < len; i++) data[i] = (uint8_t)rand();
+    if(iteration % 4 == 0 && len > 0) {
+      // a run of bytes that are all in, or all not in, the set
+      const bool is_in = (rand() % 2) == 0;
+      for(size_t i = 0; i < len; i++) {
+        while(SPN_byte_set_contains(&set, data[i]) != is_in && set_size > 0 && set_size < 200) {
+          data[i] = (uint8_t)rand();
+        }
+      }
+    }
+
+    size_t first_in  = SIZE_MAX;
+    size_t last_in   = SIZE_MAX;
+    size_t first_out = SIZE_MAX;
+    size_t last_out  = SIZE_MAX;
+    for(size_t i = 0; i < len; i++) {
+      if(SPN_byte_set_contains(&set, data[i])) {
+        if(first_in == SIZE_MAX) first_in = i;
+        last_in = i;
+      } else {
+        if(first_out == SIZE_MAX) first_out = i;
+        last_out = i;
+      }
+    }
+
+    const SPN_Span span = {.begin = data, .len = len, .element_size = 1};
+    size_t         idx  = SIZE_MAX;
+
+    EXPECT_EQ(&r,
+              (first_in == SIZE_MAX) ? STAT_OK_NOT_FOUND : OK,
+              SPN_find_any_of(span, &set, &idx));
+    EXPECT_EQ(&r, first_in, idx);
+    idx = SIZE_MAX;
+    EXPECT_EQ(&r,
+              (last_in == SIZE_MAX) ? STAT_OK_NOT_FOUND : OK,
+              SPN_find_any_of_reverse(span, &set, &idx));
+    EXPECT_EQ(&r, last_in, idx);
+    idx = SIZE_MAX;
+    EXPECT_EQ(&r,
+              (first_out == SIZE_MAX) ? STAT_OK_NOT_FOUND : OK,
+              SPN_find_first_not_of(span, &set, &idx));
+    EXPECT_EQ(&r, first_out, idx);
+    idx = SIZE_MAX;
+    EXPECT_EQ(&r,
+              (last_out == SIZE_MAX) ? STAT_OK_NOT_FOUND : OK,
+              SPN_find_last_not_of(span, &set, &idx));
+    EXPECT_EQ(&r, last_out, idx);
+
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  // likely usage: trimming whitespace
+  SPN_ByteSet whitespace = {0};
+  EXPECT_OK(&r, SPN_byte_set_create(&whitespace, SPN_from_cstr(" \t\r\n")));
+  const SPN_Span line  = SPN_from_cstr("  \t key = value\r\n");
+  size_t         first = 0;
+  size_t         last  = 0;
+  EXPECT_OK(&r, SPN_find_first_not_of(line, &whitespace, &first));
+  EXPECT_OK(&r, SPN_find_last_not_of(line, &whitespace, &last));
+  EXPECT_TRUE(&r,
+              SPN_equals(SPN_from_cstr("key = value"), SPN_subspan(line, first, last - first + 1)));
+
+  EXPECT_NOK(&r, SPN_byte_set_create(NULL, SPN_from_cstr("abc")));
+  EXPECT_NOK(&r, SPN_find_any_of(line, NULL, &first));
+  EXPECT_NOK(&r,
+             SPN_find_any_of((SPN_Span){.begin = "ab", .len = 1, .element_size = 2},
+                             &whitespace,
+                             &first));
+
+  return r;
+}
+
+static Result tst_count(void) {
+  Result r = PASS;
+
+  enum { MAX_LEN = 300, MAX_ELEMENT_SIZE = 8 };
+
+  static uint8_t data[MAX_LEN * MAX_ELEMENT_SIZE];
+  uint8_t        element[MAX_ELEMENT_SIZE];
+
+  const size_t element_sizes[] = {1, 2, 3, 4, 8};
+  for(size_t s = 0; s < (sizeof(element_sizes) / sizeof(element_sizes[0])); s++) {
+    const size_t element_size = element_sizes[s];
+    for(size_t len = 0; len <= MAX_LEN; len += 1 + (len / 8)) {
+      for(size_t i = 0; i < (len * element_size); i++) data[i] = (uint8_t)(rand() % 2);
+      for(size_t i = 0; i < element_size; i++) element[i] = (uint8_t)(rand() % 2);
+
+      size_t expect = 0;
+      for(size_t i = 0; i < len; i++) {
+        if(memcmp(&data[i * element_size], element, element_size) == 0) expect++;
+      }
+
+      size_t         count = SIZE_MAX;
+      const SPN_Span span  = {.begin = data, .len = len, .element_size = element_size};
+      EXPECT_OK(&r, SPN_count(span, element, &count));
+      EXPECT_EQ(&r, expect, count);
+      if(HAS_FAILED(&r)) return r;
+    }
+  }
+
+  // long enough for the byte counters to have to be added up several times
+  static char lines[100000];
+  memset(lines, '\n', sizeof(lines));
+  size_t count = 0;
+  EXPECT_OK(&r,
+            SPN_count((SPN_Span){.begin = lines, .len = sizeof(lines), .element_size = 1},
+                      "\n",
+                      &count));
+  EXPECT_EQ(&r, sizeof(lines), count);
+
+  EXPECT_NOK(&r, SPN_count((SPN_Span){0}, "\n", &count));
+  EXPECT_NOK(&r, SPN_count(SPN_from_cstr("abc"), NULL, &count));
+  EXPECT_NOK(&r, SPN_count(SPN_from_cstr("abc"), "a", NULL));
+
+  return r;
+}
+
+static int reference_compare(const uint8_t * lhs,
+                             size_t          lhs_len,
+                             const uint8_t * rhs,
+                             size_t          rhs_len) {
+  const int result = memcmp(lhs, rhs, (lhs_len < rhs_len) ? lhs_len : rhs_len);
+  if(result != 0) return result;
+  return (lhs_len > rhs_len) - (lhs_len < rhs_len);
+}
+
+static int get_sign(int value) { return (value > 0) - (value < 0); }
+
+static Result tst_compare_and_equals(void) {
+  Result r = PASS;
+
+  EXPECT_EQ(&r, 0, SPN_compare(SPN_from_cstr("abc"), SPN_from_cstr("abc")));
+  EXPECT_TRUE(&r, SPN_compare(SPN_from_cstr("ab"), SPN_from_cstr("abc")) < 0);
+  EXPECT_TRUE(&r, SPN_compare(SPN_from_cstr("abd"), SPN_from_cstr("abc")) > 0);
+  EXPECT_TRUE(&r, SPN_compare(SPN_from_cstr(""), SPN_from_cstr("a")) < 0);
+  EXPECT_EQ(&r, 0, SPN_compare(SPN_from_cstr(""), SPN_from_cstr("")));
+  EXPECT_EQ(&r, 0, SPN_compare((SPN_Span){0}, SPN_from_cstr("")));
+  EXPECT_TRUE(&r, SPN_compare(SPN_from_cstr("\xff"), SPN_from_cstr("\x01")) > 0); // unsigned
+
+  // a single difference at every position, of spans of every size around the word sizes
+  uint8_t lhs[40];
+  uint8_t rhs[40];
+  for(size_t len = 0; len <= 40; len++) {
+    for(size_t i = 0; i < len; i++) lhs[i] = (uint8_t)rand();
+    memcpy(rhs, lhs, len);
+
+    const SPN_Span lhs_span = {.begin = lhs, .len = len, .element_size = 1};
+    const SPN_Span rhs_span = {.begin = rhs, .len = len, .element_size = 1};
+    EXPECT_TRUE(&r, SPN_equals(lhs_span, rhs_span));
+    EXPECT_EQ(&r, 0, SPN_compare(lhs_span, rhs_span));
+
+    for(size_t diff_idx = 0; diff_idx < len; diff_idx++) {
+      rhs[diff_idx] = (uint8_t)(lhs[diff_idx] + 1 + (rand() % 255));
+      EXPECT_FALSE(&r, SPN_equals(lhs_span, rhs_span));
+      EXPECT_EQ(&r,
+                get_sign(reference_compare(lhs, len, rhs, len)),
+                get_sign(SPN_compare(lhs_span, rhs_span)));
+      rhs[diff_idx] = lhs[diff_idx];
+    }
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  // random spans of random lengths, with few different bytes so they often share prefixes
+  for(size_t n = 0; n < 10000; n++) {
+    const size_t lhs_len = (size_t)rand() % 40;
+    const size_t rhs_len = (size_t)rand() % 40;
+    for(size_t i = 0; i < lhs_len; i++) lhs[i] = (uint8_t)(rand() % 2);
+    for(size_t i = 0; i < rhs_len; i++) rhs[i] = (uint8_t)(rand() % 2);
+
+    const SPN_Span lhs_span = {.begin = lhs, .len = lhs_len, .element_size = 1};
+    const SPN_Span rhs_span = {.begin = rhs, .len = rhs_len, .element_size = 1};
+    const int      expect   = get_sign(reference_compare(lhs, lhs_len, rhs, rhs_len));
+    EXPECT_EQ(&r, expect, get_sign(SPN_compare(lhs_span, rhs_span)));
+    EXPECT_EQ(&r, -expect, get_sign(SPN_compare(rhs_span, lhs_span)));
+    EXPECT_EQ(&r, (expect == 0), SPN_equals(lhs_span, rhs_span));
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
 static Result tst_find_subspan_basic(void) {
   Result r = PASS;
 
@@ -1075,6 +1322,75 @@ typedef struct {
   uint8_t bytes[10000];
 } BigStruct;
 
+static Result tst_find_subspan_matches_naive(void) {
+  Result r = PASS;
+
+  enum { MAX_LEN = 150, MAX_SUBSPAN_LEN = 6, MAX_ELEMENT_SIZE = 3 };
+
+  uint8_t data[MAX_LEN * MAX_ELEMENT_SIZE];
+  uint8_t sub[MAX_SUBSPAN_LEN * MAX_ELEMENT_SIZE];
+
+  for(size_t element_size = 1; element_size <= MAX_ELEMENT_SIZE; element_size++) {
+    for(size_t iteration = 0; iteration < 100; iteration++) {
+      const size_t len     = (size_t)rand() % MAX_LEN;
+      const size_t sub_len = (size_t)rand() % MAX_SUBSPAN_LEN;
+
+      // few distinct byte values, so that there are matches that straddle element boundaries
+      for(size_t i = 0; i < (len * element_size); i++) data[i] = (uint8_t)(rand() % 2);
+      for(size_t i = 0; i < (sub_len * element_size); i++) sub[i] = (uint8_t)(rand() % 2);
+
+      const SPN_Span span    = {.begin = data, .len = len, .element_size = element_size};
+      const SPN_Span subspan = {.begin = sub, .len = sub_len, .element_size = element_size};
+
+      bool is_contained = false;
+      for(size_t at = 0; at <= len; at++) {
+        size_t expect = SIZE_MAX;
+        for(size_t i = at; (i + sub_len) <= len && expect == SIZE_MAX; i++) {
+          if(memcmp(&data[i * element_size], sub, sub_len * element_size) == 0) expect = i;
+        }
+        if(at == 0) is_contained = (expect != SIZE_MAX);
+
+        size_t idx = SIZE_MAX;
+        EXPECT_EQ(&r,
+                  (expect == SIZE_MAX) ? STAT_OK_NOT_FOUND : OK,
+                  SPN_find_subspan_at(span, subspan, at, &idx));
+        EXPECT_EQ(&r, expect, idx);
+        if(HAS_FAILED(&r)) return r;
+      }
+      EXPECT_EQ(&r, is_contained, SPN_contains_subspan(span, subspan));
+    }
+  }
+
+  return r;
+}
+
+static Result tst_search_at_each_simd_level(void) {
+  Result r = PASS;
+
+  // the kernels for each level the CPU supports, not just the widest one
+  const Test searches[] = {
+      tst_find_all_element_sizes,
+      tst_byte_set_find,
+      tst_count,
+      tst_find_subspan_matches_naive,
+  };
+
+  for(SPN_INT_SimdLevel level = SPN_INT_SIMD_NONE; level <= SPN_INT_SIMD_AVX2; level++) {
+    const SPN_INT_SimdLevel used = SPN_INT_set_max_simd_level(level);
+    EXPECT_TRUE(&r, used <= level);
+    EXPECT_EQ(&r, used, SPN_INT_get_simd_level());
+
+    for(size_t i = 0; i < (sizeof(searches) / sizeof(searches[0])); i++) {
+      EXPECT_EQ(&r, PASS, searches[i]());
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+
+  SPN_INT_set_max_simd_level(SPN_INT_SIMD_AVX2);
+
+  return r;
+}
+
 static Result tst_large_elements(void) {
   Result r = PASS;
 
@@ -1215,6 +1531,27 @@ static Result tst_swap(void) {
   return r;
 }
 
+static Result tst_alignment(void) {
+  Result r = PASS;
+
+  _Alignas(64) uint8_t buf[128] = {0};
+
+  const SPN_Span span = {.begin = buf, .len = sizeof(buf), .element_size = 1};
+
+  EXPECT_TRUE(&r, SPN_get_alignment(span) >= 64);
+  EXPECT_EQ(&r, 1, SPN_get_alignment(SPN_subspan(span, 1, 8)));
+  EXPECT_EQ(&r, 8, SPN_get_alignment(SPN_subspan(span, 8, 8)));
+  EXPECT_EQ(&r, 32, SPN_get_alignment(SPN_subspan(span, 32, 8)));
+
+  EXPECT_TRUE(&r, SPN_is_aligned(span, 64));
+  EXPECT_TRUE(&r, SPN_is_aligned(span, 1));
+  EXPECT_TRUE(&r, SPN_is_aligned(SPN_subspan(span, 16, 8), 16));
+  EXPECT_FALSE(&r, SPN_is_aligned(SPN_subspan(span, 16, 8), 32));
+  EXPECT_FALSE(&r, SPN_is_aligned(span, 0));
+
+  return r;
+}
+
 int main(void) {
   Test tests[] = {
       tst_create_from_cstr,
@@ -1236,16 +1573,23 @@ int main(void) {
       tst_find_at_idx_out_of_range,
       tst_find_at_and_reverse_with_duplicates,
       tst_find_at_likely_usage,
+      tst_find_all_element_sizes,
+      tst_byte_set_find,
+      tst_count,
+      tst_compare_and_equals,
       tst_find_subspan_basic,
       tst_find_subspan_at_basic,
       tst_contains_subspan_invalid_input,
       tst_find_subspan_invalid_spans,
       tst_find_subspan_monster,
+      tst_find_subspan_matches_naive,
+      tst_search_at_each_simd_level,
       tst_large_elements,
       tst_get_first_last_end_cstr,
       tst_get_first_last_end_ints,
       tst_mut,
       tst_swap,
+      tst_alignment,
   };
 
   return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
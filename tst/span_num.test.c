@@ -0,0 +1,399 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <float.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "span.h"
+#include "span_num.h"
+
+#define OK STAT_OK
+
+static uint64_t get_random_u64(void) {
+  uint64_t value = 0;
+  for(size_t i = 0; i < 4; i++) {
+    value = (value << 16) ^ (uint64_t)(rand() & 0xffff);
+  }
+  return value;
+}
+
+static double get_random_double_from_bits(void) {
+  double         value = 0.0;
+  const uint64_t bits  = get_random_u64();
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static bool is_same_double(double lhs, double rhs) {
+  return (isnan(lhs) && isnan(rhs)) || memcmp(&lhs, &rhs, sizeof(double)) == 0;
+}
+
+// Parses str with SPN_parse_f64, and checks it against strtod.
+static Result check_parse_f64(const char * str) {
+  Result r = PASS;
+
+  char *       end      = NULL;
+  const double expect   = strtod(str, &end);
+  double       value    = 0.0;
+  size_t       consumed = 0;
+
+  EXPECT_OK(&r, SPN_parse_f64(SPN_from_cstr(str), &value, &consumed));
+  EXPECT_TRUE(&r, is_same_double(expect, value));
+  EXPECT_EQ(&r, (size_t)(end - str), consumed);
+  if(HAS_FAILED(&r)) printf("parsing \"%s\" gave %.17g, expected %.17g\n", str, value, expect);
+
+  return r;
+}
+
+static Result tst_parse_u64(void) {
+  Result r = PASS;
+
+  uint64_t value    = 0;
+  size_t   consumed = 0;
+
+  EXPECT_OK(&r, SPN_parse_u64(SPN_from_cstr("0"), &value, &consumed));
+  EXPECT_EQ(&r, 0, value);
+  EXPECT_EQ(&r, 1, consumed);
+
+  EXPECT_OK(&r, SPN_parse_u64(SPN_from_cstr("1234,5678"), &value, &consumed));
+  EXPECT_EQ(&r, 1234, value);
+  EXPECT_EQ(&r, 4, consumed);
+
+  EXPECT_OK(&r, SPN_parse_u64(SPN_from_cstr("0000000000000000000000000042"), &value, &consumed));
+  EXPECT_EQ(&r, 42, value);
+  EXPECT_EQ(&r, 28, consumed);
+
+  EXPECT_OK(&r, SPN_parse_u64(SPN_from_cstr("18446744073709551615"), &value, &consumed));
+  EXPECT_EQ(&r, UINT64_MAX, value);
+  EXPECT_EQ(&r, 20, consumed);
+
+  value = 7;
+  EXPECT_EQ(&r, STAT_ERR_RANGE, SPN_parse_u64(SPN_from_cstr("18446744073709551616"), &value, NULL));
+  EXPECT_EQ(&r, STAT_ERR_RANGE, SPN_parse_u64(SPN_from_cstr("99999999999999999999"), &value, NULL));
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_u64(SPN_from_cstr(""), &value, &consumed));
+  EXPECT_EQ(&r, 0, consumed);
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_u64(SPN_from_cstr("-1"), &value, NULL));
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_u64(SPN_from_cstr(" 1"), &value, NULL));
+  EXPECT_EQ(&r, 7, value);
+
+  // a span that ends in the middle of a longer string
+  const SPN_Span digits = SPN_from_cstr("123456789012");
+  EXPECT_OK(&r, SPN_parse_u64(SPN_subspan(digits, 0, 10), &value, &consumed));
+  EXPECT_EQ(&r, 1234567890, value);
+  EXPECT_EQ(&r, 10, consumed);
+
+  for(size_t i = 0; i < 10000; i++) {
+    char           str[32];
+    const uint64_t expect = get_random_u64() >> (rand() % 64);
+    snprintf(str, sizeof(str), "%" PRIu64 "x", expect);
+
+    EXPECT_OK(&r, SPN_parse_u64(SPN_from_cstr(str), &value, &consumed));
+    EXPECT_EQ(&r, expect, value);
+    EXPECT_EQ(&r, strlen(str) - 1, consumed);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  EXPECT_NOK(&r, SPN_parse_u64(SPN_from_cstr("1"), NULL, NULL));
+  EXPECT_NOK(&r, SPN_parse_u64((SPN_Span){0}, &value, NULL));
+
+  return r;
+}
+
+static Result tst_parse_i64(void) {
+  Result r = PASS;
+
+  int64_t value    = 0;
+  size_t  consumed = 0;
+
+  EXPECT_OK(&r, SPN_parse_i64(SPN_from_cstr("-42;"), &value, &consumed));
+  EXPECT_EQ(&r, -42, value);
+  EXPECT_EQ(&r, 3, consumed);
+
+  EXPECT_OK(&r, SPN_parse_i64(SPN_from_cstr("+42"), &value, &consumed));
+  EXPECT_EQ(&r, 42, value);
+  EXPECT_EQ(&r, 3, consumed);
+
+  EXPECT_OK(&r, SPN_parse_i64(SPN_from_cstr("9223372036854775807"), &value, NULL));
+  EXPECT_EQ(&r, INT64_MAX, value);
+  EXPECT_OK(&r, SPN_parse_i64(SPN_from_cstr("-9223372036854775808"), &value, NULL));
+  EXPECT_EQ(&r, INT64_MIN, value);
+
+  EXPECT_EQ(&r, STAT_ERR_RANGE, SPN_parse_i64(SPN_from_cstr("9223372036854775808"), &value, NULL));
+  EXPECT_EQ(&r, STAT_ERR_RANGE, SPN_parse_i64(SPN_from_cstr("-9223372036854775809"), &value, NULL));
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_i64(SPN_from_cstr("-"), &value, &consumed));
+  EXPECT_EQ(&r, 0, consumed);
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_i64(SPN_from_cstr("--1"), &value, NULL));
+
+  for(size_t i = 0; i < 10000; i++) {
+    char          str[32];
+    const int64_t expect = (int64_t)get_random_u64() >> (rand() % 64);
+    snprintf(str, sizeof(str), "%" PRId64 " ", expect);
+
+    EXPECT_OK(&r, SPN_parse_i64(SPN_from_cstr(str), &value, &consumed));
+    EXPECT_EQ(&r, expect, value);
+    EXPECT_EQ(&r, strlen(str) - 1, consumed);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_parse_f64(void) {
+  Result r = PASS;
+
+  const char * cases[] = {
+      "0",
+      "-0",
+      "0.1",
+      "1.5,2.5",
+      ".5",
+      "5.",
+      "-.25e-3",
+      "1e",
+      "1e+",
+      "1E5x",
+      "3.14159265358979323846264338327950288", // more digits than we keep
+      "9007199254740993",                      // 2^53 + 1, halfway between two doubles
+      "9007199254740993.0000000000000000001",  // just above that halfway point
+      "2.2250738585072011e-308",               // just below the smallest normal double
+      "2.2250738585072014e-308",
+      "4.9406564584124654e-324", // smallest subnormal
+      "2.4703282292062327e-324", // halfway to it, rounds to 0
+      "2.4703282292062328e-324", // just above, rounds up to it
+      "1.7976931348623157e308",
+      "1.7976931348623159e308", // rounds to infinity
+      "1e-400",
+      "1e400",
+      "0.000000000000000000000000000000000000000000001",
+      "123456789012345678901234567890e-10",
+      "1e0000000000000000000000000000001",
+      "0e99999999999999999999",
+      "inf",
+      "-Infinity",
+      "NaN",
+      "infinit",
+  };
+  for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    EXPECT_EQ(&r, PASS, check_parse_f64(cases[i]));
+  }
+
+  double value    = 0.0;
+  size_t consumed = 0;
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_f64(SPN_from_cstr("."), &value, &consumed));
+  EXPECT_EQ(&r, 0, consumed);
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_f64(SPN_from_cstr("-e5"), &value, NULL));
+  EXPECT_EQ(&r, STAT_ERR_PARSE, SPN_parse_f64(SPN_from_cstr("in"), &value, NULL));
+  EXPECT_NOK(&r, SPN_parse_f64(SPN_from_cstr("1"), NULL, NULL));
+  if(HAS_FAILED(&r)) return r;
+
+  char str[128];
+  for(size_t i = 0; i < 20000; i++) {
+    // any double, at any precision
+    const double value = get_random_double_from_bits();
+    snprintf(str, sizeof(str), "%.*g", 1 + (rand() % 20), value);
+    EXPECT_EQ(&r, PASS, check_parse_f64(str));
+
+    // short decimals, as found in most data
+    snprintf(str, sizeof(str), "%d.%de%d", rand() % 100000, rand() % 1000, (rand() % 80) - 40);
+    EXPECT_EQ(&r, PASS, check_parse_f64(str));
+
+    // long decimals, that need more digits than we keep
+    size_t len = 0;
+    for(size_t digit = 0; digit < 30; digit++) {
+      str[len++] = (char)('0' + (rand() % 10));
+      if(digit == 15) str[len++] = '.';
+    }
+    snprintf(&str[len], sizeof(str) - len, "e%d", (rand() % 640) - 340);
+    EXPECT_EQ(&r, PASS, check_parse_f64(str));
+
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_parse_f64_ignores_locale(void) {
+  Result r = PASS;
+
+  // too many digits to parse exactly ourselves, so this goes through strtod
+  const char * str    = "3.14159265358979323846264338327950288";
+  const double expect = strtod(str, NULL);
+
+  // only checks anything if one of these locales, which have a decimal comma, is installed
+  const char * locales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8"};
+  for(size_t i = 0; i < (sizeof(locales) / sizeof(locales[0])); i++) {
+    if(setlocale(LC_NUMERIC, locales[i]) == NULL) continue;
+
+    double value    = 0.0;
+    size_t consumed = 0;
+    EXPECT_OK(&r, SPN_parse_f64(SPN_from_cstr(str), &value, &consumed));
+    EXPECT_EQ(&r, strlen(str), consumed);
+    EXPECT_TRUE(&r, value == expect);
+    break;
+  }
+
+  setlocale(LC_NUMERIC, "C");
+
+  return r;
+}
+
+static Result tst_format_integers(void) {
+  Result     r   = PASS;
+  DAR_DArray out = {0};
+
+  EXPECT_OK(&r, DAR_create(&out, sizeof(char)));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, SPN_format_u64(&out, 0));
+  EXPECT_OK(&r, DAR_push_back(&out, ","));
+  EXPECT_OK(&r, SPN_format_u64(&out, UINT64_MAX));
+  EXPECT_OK(&r, DAR_push_back(&out, ","));
+  EXPECT_OK(&r, SPN_format_i64(&out, INT64_MIN));
+  EXPECT_OK(&r, DAR_push_back(&out, ","));
+  EXPECT_OK(&r, SPN_format_i64(&out, -7));
+  EXPECT_TRUE(&r,
+              SPN_equals(DAR_to_span(&out),
+                         SPN_from_cstr("0,18446744073709551615,-9223372036854775808,-7")));
+
+  char str[32];
+  for(size_t i = 0; i < 10000; i++) {
+    EXPECT_OK(&r, DAR_clear(&out));
+
+    const uint64_t u = get_random_u64() >> (rand() % 64);
+    snprintf(str, sizeof(str), "%" PRIu64, u);
+    EXPECT_OK(&r, SPN_format_u64(&out, u));
+    EXPECT_TRUE(&r, SPN_equals(DAR_to_span(&out), SPN_from_cstr(str)));
+
+    EXPECT_OK(&r, DAR_clear(&out));
+
+    const int64_t s = (int64_t)get_random_u64() >> (rand() % 64);
+    snprintf(str, sizeof(str), "%" PRId64, s);
+    EXPECT_OK(&r, SPN_format_i64(&out, s));
+    EXPECT_TRUE(&r, SPN_equals(DAR_to_span(&out), SPN_from_cstr(str)));
+
+    if(HAS_FAILED(&r)) break;
+  }
+
+  DAR_DArray not_chars = {0};
+  EXPECT_OK(&r, DAR_create(&not_chars, sizeof(int)));
+  EXPECT_NOK(&r, SPN_format_u64(&not_chars, 1));
+  EXPECT_NOK(&r, SPN_format_i64(NULL, 1));
+
+  EXPECT_OK(&r, DAR_destroy(&not_chars));
+  EXPECT_OK(&r, DAR_destroy(&out));
+
+  return r;
+}
+
+static Result tst_format_f64(void) {
+  Result     r   = PASS;
+  DAR_DArray out = {0};
+
+  EXPECT_OK(&r, DAR_create(&out, sizeof(char)));
+  if(HAS_FAILED(&r)) return r;
+
+  const struct {
+    double       value;
+    const char * str;
+  } cases[] = {
+      {0.0, "0"},
+      {-0.0, "-0"},
+      {0.1, "0.1"},
+      {-2.5, "-2.5"},
+      {123.0, "123"},
+      {1e21, "1e+21"},
+      {1.0 / 3.0, "0.3333333333333333"},
+      {5e-324, "5e-324"}, // fewer bits, so fewer digits than usual
+      {2.2250738585072014e-308, "2.2250738585072014e-308"},
+      {DBL_MAX, "1.7976931348623157e+308"},
+      {1e23, "1e+23"},
+      {9007199254740992.0, "9007199254740992"},
+      {0x1p-1017, "7.120236347223045e-307"}, // the nearest 16 digits don't parse back, these do
+      {INFINITY, "inf"},
+      {-INFINITY, "-inf"},
+      {NAN, "nan"},
+  };
+  for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    EXPECT_OK(&r, DAR_clear(&out));
+    EXPECT_OK(&r, SPN_format_f64(&out, cases[i].value));
+    EXPECT_TRUE(&r, SPN_equals(DAR_to_span(&out), SPN_from_cstr(cases[i].str)));
+  }
+  if(HAS_FAILED(&r)) printf("formatting gave \"%.*s\"\n", (int)out.size, (const char *)out.data);
+
+  for(size_t i = 0; i < 20000; i++) {
+    EXPECT_OK(&r, DAR_clear(&out));
+
+    const double value = ((rand() % 2) == 0) ? get_random_double_from_bits()
+                                             : (double)(rand() % 100000) / 1000.0;
+    EXPECT_OK(&r, SPN_format_f64(&out, value));
+
+    // it must parse back to the same value, and one digit less must not
+    double parsed = 0.0;
+    EXPECT_OK(&r, SPN_parse_f64(DAR_to_span(&out), &parsed, NULL));
+    EXPECT_TRUE(&r, is_same_double(value, parsed));
+
+    // count significant digits, from the first nonzero one to the last
+    const char * chars      = out.data;
+    size_t       num_seen   = 0;
+    size_t       num_digits = 0;
+    for(size_t c = 0; c < out.size && chars[c] != 'e'; c++) {
+      if(chars[c] == '0' && num_seen > 0) num_seen++;
+      if(chars[c] >= '1' && chars[c] <= '9') num_digits = ++num_seen;
+    }
+    if(isfinite(value) && value != 0.0 && num_digits > 1) {
+      char shorter[32];
+      snprintf(shorter, sizeof(shorter), "%.*g", (int)num_digits - 1, value);
+      EXPECT_FALSE(&r, is_same_double(value, strtod(shorter, NULL)));
+    }
+
+    if(HAS_FAILED(&r)) {
+      printf("formatting %.17g gave \"%.*s\"\n", value, (int)out.size, (const char *)out.data);
+      break;
+    }
+  }
+
+  EXPECT_OK(&r, DAR_destroy(&out));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_parse_u64,
+      tst_parse_i64,
+      tst_parse_f64,
+      tst_parse_f64_ignores_locale,
+      tst_format_integers,
+      tst_format_f64,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
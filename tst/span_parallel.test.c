@@ -0,0 +1,402 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "span.h"
+#include "span_parallel.h"
+#include "span_sort.h"
+#include "threadpool.h"
+
+#define OK STAT_OK
+
+#define NUM_VALUES 100003 // prime, so chunks don't divide evenly
+
+static SPN_MutSpan values_span(int64_t * values, size_t n) {
+  return (SPN_MutSpan){.begin = values, .len = n, .element_size = sizeof(int64_t)};
+}
+
+static void double_in_place(void * element, void * ctx) {
+  (void)ctx;
+  *(int64_t *)element *= 2;
+}
+
+static void add_ctx(const void * in, void * out, void * ctx) {
+  *(int64_t *)out = *(const int64_t *)in + *(const int64_t *)ctx;
+}
+
+static void sum_reduce(void * acc, const void * element, void * ctx) {
+  (void)ctx;
+  *(int64_t *)acc += *(const int64_t *)element;
+}
+
+static void sum_combine(void * acc, const void * other_acc, void * ctx) {
+  (void)ctx;
+  *(int64_t *)acc += *(const int64_t *)other_acc;
+}
+
+static bool is_divisible(const void * element, void * ctx) {
+  return (*(const int64_t *)element % *(const int64_t *)ctx) == 0;
+}
+
+static bool is_equal(const void * element, void * ctx) {
+  return *(const int64_t *)element == *(const int64_t *)ctx;
+}
+
+static int compare_int64(const void * lhs, const void * rhs) {
+  const int64_t l = *(const int64_t *)lhs;
+  const int64_t r = *(const int64_t *)rhs;
+  return (l > r) - (l < r);
+}
+
+typedef struct {
+  TP_Pool pool;
+  int64_t values[NUM_VALUES];
+} Env;
+
+static SPN_ParallelOptions small_grain_options(Env * env) {
+  return (SPN_ParallelOptions){.pool = &env->pool, .grain_size = 1000, .serial_threshold = 2};
+}
+
+static Result tst_for_each_and_transform(void * env_p) {
+  Result r   = PASS;
+  Env *  env = env_p;
+
+  const SPN_ParallelOptions option_sets[] = {
+      small_grain_options(env),
+      (SPN_ParallelOptions){.pool = &env->pool}, // defaults; NUM_VALUES is above threshold
+      (SPN_ParallelOptions){.pool = &env->pool, .serial_threshold = NUM_VALUES + 1}, // serial
+  };
+
+  for(size_t o = 0; o < sizeof(option_sets) / sizeof(option_sets[0]); o++) {
+    for(size_t i = 0; i < NUM_VALUES; i++) env->values[i] = (int64_t)i;
+
+    EXPECT_OK(&r,
+              SPN_parallel_for_each(
+                  values_span(env->values, NUM_VALUES), double_in_place, NULL, option_sets[o]));
+    for(size_t i = 0; i < NUM_VALUES; i++) {
+      EXPECT_EQ(&r, (int64_t)(2 * i), env->values[i]);
+      if(HAS_FAILED(&r)) return r;
+    }
+
+    int64_t addend = 5;
+    EXPECT_OK(&r,
+              SPN_parallel_transform(SPN_mut_to_const(values_span(env->values, NUM_VALUES)),
+                                     values_span(env->values, NUM_VALUES),
+                                     add_ctx,
+                                     &addend,
+                                     option_sets[o]));
+    for(size_t i = 0; i < NUM_VALUES; i++) {
+      EXPECT_EQ(&r, (int64_t)((2 * i) + 5), env->values[i]);
+      if(HAS_FAILED(&r)) return r;
+    }
+  }
+
+  return r;
+}
+
+static Result tst_reduce_count_find(void * env_p) {
+  Result r   = PASS;
+  Env *  env = env_p;
+
+  for(size_t i = 0; i < NUM_VALUES; i++) env->values[i] = (int64_t)i;
+  const SPN_Span span = SPN_mut_to_const(values_span(env->values, NUM_VALUES));
+
+  const SPN_ParallelOptions option_sets[] = {
+      small_grain_options(env),
+      (SPN_ParallelOptions){.pool = &env->pool},
+      (SPN_ParallelOptions){.pool = &env->pool, .serial_threshold = NUM_VALUES + 1},
+  };
+
+  for(size_t o = 0; o < sizeof(option_sets) / sizeof(option_sets[0]); o++) {
+    int64_t sum = 0;
+    EXPECT_OK(&r,
+              SPN_parallel_reduce(
+                  span, &sum, sizeof(sum), sum_reduce, sum_combine, NULL, option_sets[o]));
+    EXPECT_EQ(&r, ((int64_t)NUM_VALUES * (NUM_VALUES - 1)) / 2, sum);
+
+    int64_t divisor = 7;
+    size_t  count   = 0;
+    EXPECT_OK(&r, SPN_parallel_count_if(span, is_divisible, &divisor, &count, option_sets[o]));
+    EXPECT_EQ(&r, (NUM_VALUES + 6) / 7, count);
+
+    const int64_t to_find[] = {0, 999, 1000, 54321, NUM_VALUES - 1};
+    for(size_t i = 0; i < sizeof(to_find) / sizeof(int64_t); i++) {
+      size_t idx = 0;
+      EXPECT_EQ(&r,
+                OK,
+                SPN_parallel_find_if(span, is_equal, (void *)&to_find[i], &idx, option_sets[o]));
+      EXPECT_EQ(&r, (size_t)to_find[i], idx);
+    }
+
+    // multiple matches, we should get the first
+    int64_t big_divisor = 30011;
+    size_t  idx         = 0;
+    EXPECT_EQ(&r, OK, SPN_parallel_find_if(span, is_divisible, &big_divisor, &idx, option_sets[o]));
+    EXPECT_EQ(&r, 0, idx);
+    EXPECT_EQ(&r,
+              OK,
+              SPN_parallel_find_if(SPN_subspan(span, 1, NUM_VALUES),
+                                   is_divisible,
+                                   &big_divisor,
+                                   &idx,
+                                   option_sets[o]));
+    EXPECT_EQ(&r, 30010, idx);
+
+    const int64_t not_there = -1;
+    EXPECT_EQ(&r,
+              STAT_OK_NOT_FOUND,
+              SPN_parallel_find_if(span, is_equal, (void *)&not_there, &idx, option_sets[o]));
+  }
+
+  return r;
+}
+
+static Result tst_sort(void * env_p) {
+  Result r   = PASS;
+  Env *  env = env_p;
+
+  const SPN_ParallelOptions option_sets[] = {
+      small_grain_options(env),
+      (SPN_ParallelOptions){.pool = &env->pool, .serial_threshold = 2},
+      (SPN_ParallelOptions){.pool = &env->pool, .serial_threshold = NUM_VALUES + 1},
+  };
+
+  const size_t lens[] = {0, 1, 2, 999, 1000, 1001, 4567, NUM_VALUES};
+
+  for(size_t o = 0; o < sizeof(option_sets) / sizeof(option_sets[0]); o++) {
+    for(size_t l = 0; l < sizeof(lens) / sizeof(size_t); l++) {
+      const size_t n = lens[l];
+      for(size_t i = 0; i < n; i++) env->values[i] = rand() % 1000; // plenty of duplicates
+
+      int64_t sum_before = 0;
+      for(size_t i = 0; i < n; i++) sum_before += env->values[i];
+
+      EXPECT_OK(&r, SPN_parallel_sort(values_span(env->values, n), compare_int64, option_sets[o]));
+      EXPECT_TRUE(&r, SPN_is_sorted(SPN_mut_to_const(values_span(env->values, n)), compare_int64));
+
+      int64_t sum_after = 0;
+      for(size_t i = 0; i < n; i++) sum_after += env->values[i];
+      EXPECT_EQ(&r, sum_before, sum_after);
+
+      if(HAS_FAILED(&r)) {
+        PRINT_FAIL("failed with n=%zu options %zu", n, o);
+        return r;
+      }
+    }
+  }
+
+  return r;
+}
+
+static Result tst_find_subspan_and_count(void * env_p) {
+  Result r   = PASS;
+  Env *  env = env_p;
+
+  for(size_t i = 0; i < NUM_VALUES; i++) env->values[i] = rand() % 4;
+  const SPN_Span span = SPN_mut_to_const(values_span(env->values, NUM_VALUES));
+
+  const SPN_ParallelOptions option_sets[] = {
+      small_grain_options(env),
+      (SPN_ParallelOptions){.pool = &env->pool, .serial_threshold = 2},
+      (SPN_ParallelOptions){.pool = &env->pool, .serial_threshold = NUM_VALUES + 1},
+  };
+
+  // needles taken from the haystack, some straddling the chunk boundaries of small_grain_options
+  const size_t needle_idxs[] = {0, 998, 1995, 54321, NUM_VALUES - 7};
+  const size_t needle_lens[] = {1, 2, 3, 7};
+
+  DAR_DArray expect_all = {0};
+  DAR_DArray found_all  = {0};
+  EXPECT_OK(&r, DAR_create(&expect_all, sizeof(size_t)));
+  EXPECT_OK(&r, DAR_create(&found_all, sizeof(size_t)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t o = 0; o < sizeof(option_sets) / sizeof(option_sets[0]); o++) {
+    for(size_t n = 0; n < sizeof(needle_idxs) / sizeof(size_t); n++) {
+      for(size_t l = 0; l < sizeof(needle_lens) / sizeof(size_t); l++) {
+        const SPN_Span needle = SPN_subspan(span, needle_idxs[n], needle_lens[l]);
+
+        size_t expect_idx = 0;
+        size_t found_idx  = 0;
+        EXPECT_OK(&r, SPN_find_subspan(span, needle, &expect_idx));
+        EXPECT_EQ(&r, OK, SPN_parallel_find_subspan(span, needle, &found_idx, option_sets[o]));
+        EXPECT_EQ(&r, expect_idx, found_idx);
+
+        EXPECT_OK(&r, SPN_find_subspan_reverse(span, needle, &expect_idx));
+        EXPECT_EQ(&r,
+                  OK,
+                  SPN_parallel_find_subspan_reverse(span, needle, &found_idx, option_sets[o]));
+        EXPECT_EQ(&r, expect_idx, found_idx);
+
+        DAR_clear(&expect_all);
+        DAR_clear(&found_all);
+        size_t at_idx = 0;
+        while(SPN_find_subspan_at(span, needle, at_idx, &expect_idx) == OK) {
+          EXPECT_OK(&r, DAR_push_back(&expect_all, &expect_idx));
+          at_idx = expect_idx + 1;
+        }
+        EXPECT_OK(&r, SPN_parallel_find_all_subspans(span, needle, &found_all, option_sets[o]));
+        EXPECT_TRUE(&r, DAR_equals(&expect_all, &found_all));
+
+        if(needle_lens[l] == 1) {
+          size_t expect_count = 0;
+          size_t found_count  = 0;
+          EXPECT_OK(&r, SPN_count(span, needle.begin, &expect_count));
+          EXPECT_OK(&r, SPN_parallel_count(span, needle.begin, &found_count, option_sets[o]));
+          EXPECT_EQ(&r, expect_count, found_count);
+        }
+
+        if(HAS_FAILED(&r)) {
+          PRINT_FAIL("failed with needle at %zu len %zu options %zu",
+                     needle_idxs[n],
+                     needle_lens[l],
+                     o);
+          DAR_destroy(&expect_all);
+          DAR_destroy(&found_all);
+          return r;
+        }
+      }
+    }
+
+    const int64_t  not_there[] = {0, 4, 1};
+    const SPN_Span missing     = {.begin = not_there, .len = 3, .element_size = sizeof(int64_t)};
+    size_t         idx         = 0;
+    EXPECT_EQ(&r,
+              STAT_OK_NOT_FOUND,
+              SPN_parallel_find_subspan(span, missing, &idx, option_sets[o]));
+    EXPECT_EQ(&r,
+              STAT_OK_NOT_FOUND,
+              SPN_parallel_find_subspan_reverse(span, missing, &idx, option_sets[o]));
+    DAR_clear(&found_all);
+    EXPECT_OK(&r, SPN_parallel_find_all_subspans(span, missing, &found_all, option_sets[o]));
+    EXPECT_EQ(&r, 0, found_all.size);
+
+    // needle longer than haystack
+    EXPECT_EQ(&r,
+              STAT_OK_NOT_FOUND,
+              SPN_parallel_find_subspan(SPN_subspan(span, 0, 2), missing, &idx, option_sets[o]));
+  }
+
+  DAR_destroy(&expect_all);
+  DAR_destroy(&found_all);
+
+  return r;
+}
+
+static Result tst_shared_pool(void) {
+  Result r = PASS;
+
+  int64_t * values = malloc(NUM_VALUES * sizeof(int64_t));
+  EXPECT_NE(&r, NULL, values);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < NUM_VALUES; i++) values[i] = (int64_t)(NUM_VALUES - i);
+
+  EXPECT_OK(&r,
+            SPN_parallel_sort(
+                values_span(values, NUM_VALUES), compare_int64, (SPN_ParallelOptions){0}));
+  EXPECT_TRUE(&r, SPN_is_sorted(SPN_mut_to_const(values_span(values, NUM_VALUES)), compare_int64));
+
+  free(values);
+
+  return r;
+}
+
+static Result tst_bad_args(void * env_p) {
+  Result r   = PASS;
+  Env *  env = env_p;
+
+  const SPN_ParallelOptions opts  = small_grain_options(env);
+  const SPN_MutSpan         span  = values_span(env->values, 10);
+  const SPN_Span            cspan = SPN_mut_to_const(span);
+  int64_t                   acc   = 0;
+  size_t                    out   = 0;
+
+  EXPECT_NOK(&r, SPN_parallel_for_each((SPN_MutSpan){0}, double_in_place, NULL, opts));
+  EXPECT_NOK(&r, SPN_parallel_for_each(span, NULL, NULL, opts));
+  EXPECT_NOK(&r, SPN_parallel_transform(cspan, values_span(env->values, 9), add_ctx, &acc, opts));
+  EXPECT_NOK(&r, SPN_parallel_reduce(cspan, NULL, 8, sum_reduce, sum_combine, NULL, opts));
+  EXPECT_NOK(&r, SPN_parallel_reduce(cspan, &acc, 8, sum_reduce, NULL, NULL, opts));
+  EXPECT_NOK(&r, SPN_parallel_count_if(cspan, is_equal, &acc, NULL, opts));
+  EXPECT_NOK(&r, SPN_parallel_find_if(cspan, NULL, NULL, &out, opts));
+  EXPECT_NOK(&r, SPN_parallel_count(cspan, NULL, &out, opts));
+  EXPECT_NOK(&r, SPN_parallel_find_subspan(cspan, SPN_subspan(cspan, 0, 0), &out, opts));
+  EXPECT_NOK(&r, SPN_parallel_find_subspan_reverse((SPN_Span){0}, cspan, &out, opts));
+  EXPECT_NOK(&r, SPN_parallel_find_all_subspans(cspan, cspan, NULL, opts));
+  EXPECT_NOK(&r, SPN_parallel_sort(span, NULL, opts));
+
+  return r;
+}
+
+static Result setup(void ** env_p) {
+  Result r = PASS;
+
+  srand(time(NULL) + clock());
+
+  Env * env = malloc(sizeof(Env));
+  EXPECT_NE(&r, NULL, env);
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, TP_create(&env->pool, 3));
+
+  *env_p = env;
+
+  return r;
+}
+
+static Result teardown(void ** env_p) {
+  Result r   = PASS;
+  Env *  env = *env_p;
+
+  EXPECT_OK(&r, TP_destroy(&env->pool));
+  free(env);
+  *env_p = NULL;
+
+  return r;
+}
+
+int main(void) {
+  Test tests[] = {
+      tst_shared_pool,
+  };
+
+  TestWithFixture tests_with_fixture[] = {
+      tst_for_each_and_transform,
+      tst_reduce_count_find,
+      tst_sort,
+      tst_find_subspan_and_count,
+      tst_bad_args,
+  };
+
+  const Result test_res = run_tests(tests, sizeof(tests) / sizeof(Test));
+  const Result test_with_fixture_res = run_tests_with_fixture(
+      tests_with_fixture, sizeof(tests_with_fixture) / sizeof(TestWithFixture), setup, teardown);
+
+  return ((test_res == PASS) && (test_with_fixture_res == PASS)) ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "span.h"
+#include "span_search.h"
+
+#define OK STAT_OK
+
+// Returns the first element index at or after at_idx at which needle occurs, or SIZE_MAX.
+static size_t naive_find(SPN_Span haystack, SPN_Span needle, size_t at_idx) {
+  const size_t needle_size = SPN_get_size_in_bytes(needle);
+  for(size_t i = at_idx; (i + needle.len) <= haystack.len; i++) {
+    if(memcmp(SPN_get(haystack, i), needle.begin, needle_size) == 0) return i;
+  }
+  return SIZE_MAX;
+}
+
+static Result tst_find_basic(void) {
+  Result       r        = PASS;
+  SPN_Searcher searcher = {0};
+
+  const SPN_Span log = SPN_from_cstr("12:00 INFO started\n12:01 WARN disk almost full\n"
+                                     "12:02 ERROR disk full\n12:03 ERROR disk full\n");
+
+  EXPECT_OK(&r, SPN_searcher_create(&searcher, SPN_from_cstr("ERROR disk")));
+  if(HAS_FAILED(&r)) return r;
+
+  size_t idx = 0;
+  EXPECT_OK(&r, SPN_searcher_find(&searcher, log, &idx));
+  EXPECT_EQ(&r, 53, idx);
+  EXPECT_OK(&r, SPN_searcher_find_at(&searcher, log, idx + 1, &idx));
+  EXPECT_EQ(&r, 75, idx);
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, SPN_searcher_find_at(&searcher, log, idx + 1, &idx));
+  EXPECT_EQ(&r, 75, idx);
+
+  // the same searcher is reused on other haystacks
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, SPN_searcher_find(&searcher, SPN_from_cstr("ERROR dis"), &idx));
+  EXPECT_OK(&r, SPN_searcher_find(&searcher, SPN_from_cstr("ERROR disk"), &idx));
+  EXPECT_EQ(&r, 0, idx);
+
+  // empty needle is found where we start
+  EXPECT_OK(&r, SPN_searcher_create(&searcher, SPN_from_cstr("")));
+  EXPECT_OK(&r, SPN_searcher_find_at(&searcher, log, 7, &idx));
+  EXPECT_EQ(&r, 7, idx);
+  EXPECT_OK(&r, SPN_searcher_find_at(&searcher, log, log.len, &idx));
+  EXPECT_EQ(&r, log.len, idx);
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, SPN_searcher_find_at(&searcher, log, log.len + 1, &idx));
+
+  return r;
+}
+
+static Result tst_find_matches_naive(void) {
+  Result r = PASS;
+
+  enum { MAX_HAYSTACK_LEN = 300, MAX_NEEDLE_LEN = 24 };
+
+  char haystack[MAX_HAYSTACK_LEN];
+  char needle[MAX_NEEDLE_LEN];
+
+  // small alphabets give many (partial) matches and periodic needles, which are the hard cases
+  for(size_t alphabet = 1; alphabet <= 4; alphabet++) {
+    for(size_t iteration = 0; iteration < 200; iteration++) {
+      const size_t haystack_len = (size_t)rand() % MAX_HAYSTACK_LEN;
+      const size_t needle_len   = 1 + ((size_t)rand() % (MAX_NEEDLE_LEN - 1));
+
+      for(size_t i = 0; i < haystack_len; i++) haystack[i] = (char)('a' + (rand() % alphabet));
+      if(iteration % 2) {
+        for(size_t i = 0; i < needle_len; i++) needle[i] = (char)('a' + (rand() % alphabet));
+      } else if(haystack_len >= needle_len) {
+        // take the needle from the haystack, so that it is found at least once
+        memcpy(needle, &haystack[(size_t)rand() % (haystack_len - needle_len + 1)], needle_len);
+      }
+
+      const SPN_Span hs = {.begin = haystack, .len = haystack_len, .element_size = 1};
+      const SPN_Span nd = {.begin = needle, .len = needle_len, .element_size = 1};
+
+      SPN_Searcher searcher = {0};
+      EXPECT_OK(&r, SPN_searcher_create(&searcher, nd));
+      if(HAS_FAILED(&r)) return r;
+
+      for(size_t at = 0; at <= haystack_len; at++) {
+        const size_t expect = naive_find(hs, nd, at);
+        size_t       idx    = SIZE_MAX;
+        EXPECT_EQ(&r,
+                  (expect == SIZE_MAX) ? STAT_OK_NOT_FOUND : OK,
+                  SPN_searcher_find_at(&searcher, hs, at, &idx));
+        EXPECT_EQ(&r, expect, idx);
+        if(HAS_FAILED(&r)) return r;
+      }
+    }
+  }
+
+  return r;
+}
+
+static Result tst_find_wide_elements(void) {
+  Result r = PASS;
+
+  // bytewise, the needle occurs at byte 1 (straddling elements), but as elements only at index 2
+  const uint16_t haystack[] = {0x0100, 0x0002, 0x0201, 0x0300};
+  const uint16_t needle[]   = {0x0201};
+  const SPN_Span hs         = {.begin = haystack, .len = 4, .element_size = sizeof(uint16_t)};
+  const SPN_Span nd         = {.begin = needle, .len = 1, .element_size = sizeof(uint16_t)};
+
+  SPN_Searcher searcher = {0};
+  EXPECT_OK(&r, SPN_searcher_create(&searcher, nd));
+  if(HAS_FAILED(&r)) return r;
+
+  size_t idx = 0;
+  EXPECT_OK(&r, SPN_searcher_find(&searcher, hs, &idx));
+  EXPECT_EQ(&r, naive_find(hs, nd, 0), idx);
+  EXPECT_EQ(&r, 2, idx);
+
+  return r;
+}
+
+static Result tst_bad_args(void) {
+  Result       r        = PASS;
+  SPN_Searcher searcher = {0};
+  size_t       idx      = 0;
+
+  EXPECT_NOK(&r, SPN_searcher_create(NULL, SPN_from_cstr("abc")));
+  EXPECT_NOK(&r, SPN_searcher_create(&searcher, (SPN_Span){0}));
+  EXPECT_NOK(&r, SPN_searcher_find(&searcher, SPN_from_cstr("abc"), &idx)); // not created
+  EXPECT_NOK(&r, SPN_searcher_find(NULL, SPN_from_cstr("abc"), &idx));
+
+  EXPECT_OK(&r, SPN_searcher_create(&searcher, SPN_from_cstr("abc")));
+  EXPECT_NOK(&r, SPN_searcher_find(&searcher, (SPN_Span){0}, &idx));
+
+  const int ints[] = {1, 2, 3};
+  EXPECT_NOK(&r,
+             SPN_searcher_find(&searcher,
+                               (SPN_Span){.begin = ints, .len = 3, .element_size = sizeof(int)},
+                               &idx));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_find_basic,
+      tst_find_matches_naive,
+      tst_find_wide_elements,
+      tst_bad_args,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "bench_utils.h"
+#include "log.h"
+
+#include "span_sort.h"
+
+#define OK STAT_OK
+
+#define NUM_ELEMENTS 10000000
+
+#define U32_LESS(a, b) ((a) < (b))
+SPN_DEFINE_SORT(sort_u32_typed, uint32_t, U32_LESS)
+
+static double get_time(void) {
+  struct timeval tv = {0};
+  gettimeofday(&tv, NULL);
+  return ((double)tv.tv_sec + ((double)tv.tv_usec / (1000.0 * 1000.0)));
+}
+
+static int compare_u32(const void * lhs, const void * rhs) {
+  const uint32_t l = *(const uint32_t *)lhs;
+  const uint32_t r = *(const uint32_t *)rhs;
+  return (l > r) - (l < r);
+}
+
+static SPN_MutSpan env_to_span(void * env) {
+  return (SPN_MutSpan){.begin = env, .len = NUM_ELEMENTS, .element_size = sizeof(uint32_t)};
+}
+
+static STAT_Val setup_random_u32(void ** env) {
+  if(env == NULL) return LOG_STAT(STAT_ERR_ARGS, "bad env");
+
+  uint32_t * data = malloc(NUM_ELEMENTS * sizeof(uint32_t));
+  if(data == NULL) return LOG_STAT(STAT_ERR_ALLOC, "failed to allocate bench data");
+
+  // xorshift, so every pass sorts the same data
+  uint32_t state = 0x12345678;
+  for(size_t i = 0; i < NUM_ELEMENTS; i++) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    data[i] = state;
+  }
+
+  *env = data;
+
+  return OK;
+}
+
+static BNC_Witness teardown(void ** env) {
+  if(env == NULL) return 0;
+
+  free(*env);
+  *env = NULL;
+
+  return 1;
+}
+
+static BNC_Witness baseline(void * env) { return (env != NULL) ? 1 : 0; }
+
+static BNC_Witness bench_qsort(void * env) {
+  qsort(env, NUM_ELEMENTS, sizeof(uint32_t), compare_u32);
+  return (BNC_Witness)((uint32_t *)env)[0];
+}
+
+static BNC_Witness bench_spn_sort(void * env) {
+  SPN_sort(env_to_span(env), compare_u32);
+  return (BNC_Witness)((uint32_t *)env)[0];
+}
+
+static BNC_Witness bench_spn_stable_sort(void * env) {
+  SPN_stable_sort(env_to_span(env), compare_u32);
+  return (BNC_Witness)((uint32_t *)env)[0];
+}
+
+static BNC_Witness bench_typed_sort(void * env) {
+  sort_u32_typed(env_to_span(env));
+  return (BNC_Witness)((uint32_t *)env)[0];
+}
+
+static BNC_Witness bench_radix_sort(void * env) {
+  SPN_radix_sort_u32(env_to_span(env));
+  return (BNC_Witness)((uint32_t *)env)[0];
+}
+
+#define SORT_BENCHMARK(bench_name, fn)                                                             \
+  {                                                                                                \
+    .name = bench_name, .setup_fn = setup_random_u32, .teardown_fn = teardown, .bench_fn = fn,     \
+    .baseline_fn = baseline, .get_time_fn = get_time, .num_iterations_per_pass = 1,                \
+    .min_num_passes = 3, .max_num_passes = 3, .max_run_time = 30.0,                               \
+    .desired_std_dev_percent = 5.0,                                                                \
+  }
+
+int main(void) {
+  BNC_Benchmark benchmarks[] = {
+      SORT_BENCHMARK("qsort 10M u32", bench_qsort),
+      SORT_BENCHMARK("SPN_sort 10M u32", bench_spn_sort),
+      SORT_BENCHMARK("SPN_stable_sort 10M u32", bench_spn_stable_sort),
+      SORT_BENCHMARK("SPN_DEFINE_SORT 10M u32", bench_typed_sort),
+      SORT_BENCHMARK("SPN_radix_sort_u32 10M u32", bench_radix_sort),
+  };
+
+  const STAT_Val stat = BNC_run_print_and_destroy_benchmarks(
+      benchmarks, sizeof(benchmarks) / sizeof(BNC_Benchmark));
+
+  return STAT_is_OK(stat) ? 0 : 1;
+}
@@ -0,0 +1,610 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "span.h"
+#include "span_sort.h"
+
+#define OK STAT_OK
+
+#define INT_LESS(a, b) ((a) < (b))
+SPN_DEFINE_SORT(sort_ints_typed, int, INT_LESS)
+
+typedef struct {
+  int    key;
+  size_t original_idx;
+} KeyIdxPair;
+
+#define KEY_IDX_PAIR_LESS(a, b) ((a).key < (b).key)
+SPN_DEFINE_SORT(sort_pairs_typed, KeyIdxPair, KEY_IDX_PAIR_LESS)
+
+typedef struct {
+  uint8_t bytes[300]; // bigger than the scratch element SPN_sort keeps on the stack
+  int     key;
+} BigElement;
+
+static int compare_ints(const void * lhs, const void * rhs) {
+  const int l = *(const int *)lhs;
+  const int r = *(const int *)rhs;
+  return (l > r) - (l < r);
+}
+
+static int compare_pairs(const void * lhs, const void * rhs) {
+  return compare_ints(&((const KeyIdxPair *)lhs)->key, &((const KeyIdxPair *)rhs)->key);
+}
+
+static int compare_big_elements(const void * lhs, const void * rhs) {
+  return compare_ints(&((const BigElement *)lhs)->key, &((const BigElement *)rhs)->key);
+}
+
+static SPN_MutSpan ints_to_mut_span(int * arr, size_t n) {
+  return (SPN_MutSpan){.begin = arr, .len = n, .element_size = sizeof(int)};
+}
+
+static SPN_MutSpan u32_to_mut_span(uint32_t * arr, size_t n) {
+  return (SPN_MutSpan){.begin = arr, .len = n, .element_size = sizeof(uint32_t)};
+}
+
+static SPN_MutSpan u64_to_mut_span(uint64_t * arr, size_t n) {
+  return (SPN_MutSpan){.begin = arr, .len = n, .element_size = sizeof(uint64_t)};
+}
+
+typedef enum { RANDOM, FEW_UNIQUE, SORTED, REVERSED, ORGAN_PIPE, ALL_EQUAL, NUM_PATTERNS } Pattern;
+
+static void fill_ints(int * arr, size_t n, Pattern pattern) {
+  for(size_t i = 0; i < n; i++) {
+    switch(pattern) {
+    case RANDOM: arr[i] = rand() - (RAND_MAX / 2); break;
+    case FEW_UNIQUE: arr[i] = rand() % 4; break;
+    case SORTED: arr[i] = (int)i; break;
+    case REVERSED: arr[i] = (int)(n - i); break;
+    case ORGAN_PIPE: arr[i] = (int)((i < (n / 2)) ? i : (n - i)); break;
+    case ALL_EQUAL: arr[i] = 42; break;
+    case NUM_PATTERNS: break;
+    }
+  }
+}
+
+static Result tst_sort_ints(void) {
+  Result r = PASS;
+
+  const size_t sizes[] = {0, 1, 2, 3, 10, 23, 24, 25, 100, 129, 1000, 10000, 100000};
+
+  for(size_t s = 0; s < (sizeof(sizes) / sizeof(size_t)); s++) {
+    const size_t n = sizes[s];
+
+    // +1 so we don't malloc 0 bytes
+    int * original = malloc((n + 1) * sizeof(int));
+    int * arr      = malloc((n + 1) * sizeof(int));
+    int * expected = malloc((n + 1) * sizeof(int));
+    EXPECT_NE(&r, NULL, original);
+    EXPECT_NE(&r, NULL, arr);
+    EXPECT_NE(&r, NULL, expected);
+
+    for(Pattern p = RANDOM; (p < NUM_PATTERNS) && !HAS_FAILED(&r); p++) {
+      fill_ints(original, n, p);
+      memcpy(arr, original, n * sizeof(int));
+      memcpy(expected, original, n * sizeof(int));
+      qsort(expected, n, sizeof(int), compare_ints);
+
+      EXPECT_OK(&r, SPN_sort(ints_to_mut_span(arr, n), compare_ints));
+      EXPECT_ARREQ(&r, int, expected, arr, n);
+      EXPECT_TRUE(&r, SPN_is_sorted(SPN_mut_to_const(ints_to_mut_span(arr, n)), compare_ints));
+
+      memcpy(arr, original, n * sizeof(int));
+      EXPECT_OK(&r, sort_ints_typed(ints_to_mut_span(arr, n)));
+      EXPECT_ARREQ(&r, int, expected, arr, n);
+
+      memcpy(arr, original, n * sizeof(int));
+      EXPECT_OK(&r, SPN_stable_sort(ints_to_mut_span(arr, n), compare_ints));
+      EXPECT_ARREQ(&r, int, expected, arr, n);
+
+      if(HAS_FAILED(&r)) PRINT_FAIL("failed for n=%zu, pattern=%d", n, (int)p);
+    }
+
+    free(original);
+    free(arr);
+    free(expected);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_sort_large_elements(void) {
+  Result r = PASS;
+
+  const size_t n   = 500;
+  BigElement * arr = calloc(n, sizeof(BigElement));
+  EXPECT_NE(&r, NULL, arr);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < n; i++) {
+    arr[i].key = rand() % 100;
+    memset(arr[i].bytes, arr[i].key, sizeof(arr[i].bytes));
+  }
+
+  const SPN_MutSpan span = {.begin = arr, .len = n, .element_size = sizeof(BigElement)};
+
+  EXPECT_OK(&r, SPN_sort(span, compare_big_elements));
+  EXPECT_TRUE(&r, SPN_is_sorted(SPN_mut_to_const(span), compare_big_elements));
+
+  for(size_t i = 0; i < n; i++) {
+    // elements should have been moved as a whole
+    EXPECT_EQ(&r, (uint8_t)arr[i].key, arr[i].bytes[0]);
+    EXPECT_EQ(&r, (uint8_t)arr[i].key, arr[i].bytes[sizeof(arr[i].bytes) - 1]);
+    if(HAS_FAILED(&r)) break;
+  }
+
+  free(arr);
+
+  return r;
+}
+
+static Result tst_stable_sort_is_stable(void) {
+  Result r = PASS;
+
+  DAR_DArray arr = {0};
+  EXPECT_OK(&r, DAR_create(&arr, sizeof(KeyIdxPair)));
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < 5000; i++) {
+    const KeyIdxPair pair = {.key = rand() % 50, .original_idx = i};
+    EXPECT_OK(&r, DAR_push_back(&arr, &pair));
+  }
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, SPN_stable_sort(DAR_to_mut_span(&arr), compare_pairs));
+
+  for(size_t i = 1; i < arr.size; i++) {
+    const KeyIdxPair * prev = DAR_get(&arr, i - 1);
+    const KeyIdxPair * curr = DAR_get(&arr, i);
+
+    EXPECT_LE(&r, prev->key, curr->key);
+    if(prev->key == curr->key) EXPECT_LT(&r, prev->original_idx, curr->original_idx);
+    if(HAS_FAILED(&r)) break;
+  }
+
+  // the typed sort isn't stable, but should still sort correctly
+  for(size_t i = 0; i < arr.size; i++) ((KeyIdxPair *)DAR_get(&arr, i))->key = rand() % 50;
+  EXPECT_OK(&r, sort_pairs_typed(DAR_to_mut_span(&arr)));
+  EXPECT_TRUE(&r, SPN_is_sorted(DAR_to_span(&arr), compare_pairs));
+
+  EXPECT_OK(&r, DAR_destroy(&arr));
+
+  return r;
+}
+
+static Result tst_radix_sort_unsigned(void) {
+  Result r = PASS;
+
+  const size_t n   = 10000;
+  uint32_t *   u32 = malloc(n * sizeof(uint32_t));
+  uint64_t *   u64 = malloc(n * sizeof(uint64_t));
+  EXPECT_NE(&r, NULL, u32);
+  EXPECT_NE(&r, NULL, u64);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < n; i++) {
+    u32[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    u64[i] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+  }
+
+  EXPECT_OK(&r, SPN_radix_sort_u32(u32_to_mut_span(u32, n)));
+  EXPECT_OK(&r, SPN_radix_sort_u64(u64_to_mut_span(u64, n)));
+
+  for(size_t i = 1; i < n; i++) {
+    EXPECT_LE(&r, u32[i - 1], u32[i]);
+    EXPECT_LE(&r, u64[i - 1], u64[i]);
+    if(HAS_FAILED(&r)) break;
+  }
+
+  // keys that only differ in their lowest byte, so most passes are skipped
+  for(size_t i = 0; i < n; i++) u32[i] = 0xabcd0000 | (uint32_t)(rand() % 256);
+  EXPECT_OK(&r, SPN_radix_sort_u32(u32_to_mut_span(u32, n)));
+  for(size_t i = 1; i < n; i++) {
+    EXPECT_LE(&r, u32[i - 1], u32[i]);
+    if(HAS_FAILED(&r)) break;
+  }
+
+  free(u32);
+  free(u64);
+
+  return r;
+}
+
+static Result tst_radix_sort_signed_and_float(void) {
+  Result r = PASS;
+
+  int32_t i32[] = {5, -3, 0, INT32_MIN, 7, -1, INT32_MAX, -3, 2};
+  int64_t i64[] = {5, -3, 0, INT64_MIN, 7, -1, INT64_MAX, -3, 2};
+  float   f32[] = {1.5f, -0.5f, 0.0f, -100.0f, 3.25f, -0.0f, 1e30f, -1e-30f, 2.0f};
+  double  f64[] = {1.5, -0.5, 0.0, -100.0, 3.25, -0.0, 1e300, -1e-300, 2.0};
+
+  const size_t n = sizeof(i32) / sizeof(i32[0]);
+
+  EXPECT_OK(&r, SPN_radix_sort_i32((SPN_MutSpan){.begin = i32, .len = n, .element_size = 4}));
+  EXPECT_OK(&r, SPN_radix_sort_i64((SPN_MutSpan){.begin = i64, .len = n, .element_size = 8}));
+  EXPECT_OK(&r, SPN_radix_sort_f32((SPN_MutSpan){.begin = f32, .len = n, .element_size = 4}));
+  EXPECT_OK(&r, SPN_radix_sort_f64((SPN_MutSpan){.begin = f64, .len = n, .element_size = 8}));
+
+  const int32_t expect_i32[] = {INT32_MIN, -3, -3, -1, 0, 2, 5, 7, INT32_MAX};
+  const int64_t expect_i64[] = {INT64_MIN, -3, -3, -1, 0, 2, 5, 7, INT64_MAX};
+  const float expect_f32[]   = {-100.0f, -0.5f, -1e-30f, -0.0f, 0.0f, 1.5f, 2.0f, 3.25f, 1e30f};
+  const double expect_f64[]  = {-100.0, -0.5, -1e-300, -0.0, 0.0, 1.5, 2.0, 3.25, 1e300};
+
+  EXPECT_ARREQ(&r, int32_t, expect_i32, i32, n);
+  EXPECT_ARREQ(&r, int64_t, expect_i64, i64, n);
+  EXPECT_ARREQ(&r, float, expect_f32, f32, n);
+  EXPECT_ARREQ(&r, double, expect_f64, f64, n);
+
+  // total order puts -0.0 before +0.0
+  EXPECT_NE(&r, 0, signbit(f32[3]));
+  EXPECT_EQ(&r, 0, signbit(f32[4]));
+
+  return r;
+}
+
+static SPN_Span ints_to_span(const int * arr, size_t n) {
+  return (SPN_Span){.begin = arr, .len = n, .element_size = sizeof(int)};
+}
+
+static Result tst_bounds_and_binary_search(void) {
+  Result r = PASS;
+
+  for(size_t n = 0; n < 70; n++) {
+    int arr[70] = {0};
+    for(size_t i = 0; i < n; i++) arr[i] = rand() % 20;
+    sort_ints_typed(ints_to_mut_span(arr, n));
+
+    for(int key = -1; key <= 21; key++) {
+      size_t expect_lower = 0;
+      while(expect_lower < n && arr[expect_lower] < key) expect_lower++;
+      size_t expect_upper = expect_lower;
+      while(expect_upper < n && arr[expect_upper] == key) expect_upper++;
+
+      size_t lower = SIZE_MAX;
+      size_t upper = SIZE_MAX;
+      EXPECT_OK(&r, SPN_lower_bound(ints_to_span(arr, n), &key, compare_ints, &lower));
+      EXPECT_OK(&r, SPN_upper_bound(ints_to_span(arr, n), &key, compare_ints, &upper));
+      EXPECT_EQ(&r, expect_lower, lower);
+      EXPECT_EQ(&r, expect_upper, upper);
+
+      size_t found = SIZE_MAX;
+      if(expect_lower == expect_upper) {
+        EXPECT_EQ(&r,
+                  STAT_OK_NOT_FOUND,
+                  SPN_binary_search(ints_to_span(arr, n), &key, compare_ints, &found));
+        EXPECT_EQ(&r, SIZE_MAX, found);
+        EXPECT_EQ(&r,
+                  STAT_OK_NOT_FOUND,
+                  SPN_binary_search(ints_to_span(arr, n), &key, compare_ints, NULL));
+      } else {
+        EXPECT_OK(&r, SPN_binary_search(ints_to_span(arr, n), &key, compare_ints, &found));
+        EXPECT_EQ(&r, expect_lower, found);
+        EXPECT_OK(&r, SPN_binary_search(ints_to_span(arr, n), &key, compare_ints, NULL));
+      }
+      if(HAS_FAILED(&r)) return r;
+    }
+  }
+
+  return r;
+}
+
+static Result tst_eytzinger(void) {
+  Result r = PASS;
+
+  const size_t n         = 5000;
+  int *        sorted    = malloc(n * sizeof(int));
+  int *        eytzinger = malloc(n * sizeof(int));
+  EXPECT_NE(&r, NULL, sorted);
+  EXPECT_NE(&r, NULL, eytzinger);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t len = 0; len <= n; len = (len * 2) + 1) {
+    for(size_t i = 0; i < len; i++) sorted[i] = rand() % 10000;
+    sort_ints_typed(ints_to_mut_span(sorted, len));
+
+    EXPECT_OK(&r, SPN_to_eytzinger(ints_to_span(sorted, len), ints_to_mut_span(eytzinger, len)));
+
+    // the root is the middle element, and an in-order traversal gives back the sorted order
+    if(len > 0) EXPECT_EQ(&r, sorted[len / 2], eytzinger[0]);
+
+    for(size_t i = 0; i < 200; i++) {
+      const int key = (rand() % 10200) - 100;
+
+      size_t expect = 0;
+      size_t idx    = 0;
+      EXPECT_OK(&r, SPN_lower_bound(ints_to_span(sorted, len), &key, compare_ints, &expect));
+      EXPECT_OK(&r,
+                SPN_eytzinger_lower_bound(ints_to_span(eytzinger, len), &key, compare_ints, &idx));
+
+      if(expect == len) {
+        EXPECT_EQ(&r, len, idx);
+      } else {
+        EXPECT_LT(&r, idx, len);
+        if(HAS_FAILED(&r)) break;
+        EXPECT_EQ(&r, sorted[expect], eytzinger[idx]);
+      }
+      if(HAS_FAILED(&r)) break;
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+
+  free(sorted);
+  free(eytzinger);
+
+  return r;
+}
+
+static Result tst_merge(void) {
+  Result r = PASS;
+
+  KeyIdxPair lhs[300] = {0};
+  KeyIdxPair rhs[200] = {0};
+  KeyIdxPair out[500] = {0};
+
+  for(size_t i = 0; i < 300; i++) lhs[i] = (KeyIdxPair){.key = rand() % 40, .original_idx = i};
+  for(size_t i = 0; i < 200; i++) {
+    rhs[i] = (KeyIdxPair){.key = rand() % 40, .original_idx = 1000 + i};
+  }
+  EXPECT_OK(&r, SPN_stable_sort((SPN_MutSpan){lhs, 300, sizeof(KeyIdxPair)}, compare_pairs));
+  EXPECT_OK(&r, SPN_stable_sort((SPN_MutSpan){rhs, 200, sizeof(KeyIdxPair)}, compare_pairs));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r,
+            SPN_merge((SPN_Span){lhs, 300, sizeof(KeyIdxPair)},
+                      (SPN_Span){rhs, 200, sizeof(KeyIdxPair)},
+                      (SPN_MutSpan){out, 500, sizeof(KeyIdxPair)},
+                      compare_pairs));
+
+  // equal keys keep their order, lhs first
+  for(size_t i = 1; i < 500; i++) {
+    EXPECT_LE(&r, out[i - 1].key, out[i].key);
+    if(out[i - 1].key == out[i].key) EXPECT_LT(&r, out[i - 1].original_idx, out[i].original_idx);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  // either side may be empty
+  int       vals[]   = {1, 2, 3};
+  int       merged[] = {0, 0, 0};
+  const int expect[] = {1, 2, 3};
+  EXPECT_OK(&r,
+            SPN_merge(ints_to_span(NULL, 0),
+                      ints_to_span(vals, 3),
+                      ints_to_mut_span(merged, 3),
+                      compare_ints));
+  EXPECT_ARREQ(&r, int, expect, merged, 3);
+
+  // out too small
+  EXPECT_NOK(&r,
+             SPN_merge(ints_to_span(vals, 3),
+                       ints_to_span(vals, 1),
+                       ints_to_mut_span(merged, 3),
+                       compare_ints));
+
+  return r;
+}
+
+static Result tst_set_intersection(void) {
+  Result r = PASS;
+
+  {
+    const int lhs[]    = {1, 2, 2, 2, 5, 7, 9};
+    const int rhs[]    = {2, 2, 3, 7, 8, 9, 9, 10};
+    const int expect[] = {2, 2, 7, 9};
+    int       out[8]   = {0};
+    size_t    len      = 0;
+
+    EXPECT_OK(&r,
+              SPN_set_intersection(ints_to_span(lhs, 7),
+                                   ints_to_span(rhs, 8),
+                                   ints_to_mut_span(out, 8),
+                                   compare_ints,
+                                   &len));
+    EXPECT_EQ(&r, 4, len);
+    EXPECT_ARREQ(&r, int, expect, out, 4);
+
+    // same result the other way around
+    EXPECT_OK(&r,
+              SPN_set_intersection(ints_to_span(rhs, 8),
+                                   ints_to_span(lhs, 7),
+                                   ints_to_mut_span(out, 8),
+                                   compare_ints,
+                                   &len));
+    EXPECT_EQ(&r, 4, len);
+    EXPECT_ARREQ(&r, int, expect, out, 4);
+  }
+
+  // elements are copied from lhs, also when lhs is the larger one
+  {
+    KeyIdxPair lhs[]  = {{1, 0}, {3, 1}, {5, 2}, {7, 3}};
+    KeyIdxPair rhs[]  = {{3, 10}, {7, 11}};
+    KeyIdxPair out[2] = {0};
+    size_t     len    = 0;
+
+    EXPECT_OK(&r,
+              SPN_set_intersection((SPN_Span){lhs, 4, sizeof(KeyIdxPair)},
+                                   (SPN_Span){rhs, 2, sizeof(KeyIdxPair)},
+                                   (SPN_MutSpan){out, 2, sizeof(KeyIdxPair)},
+                                   compare_pairs,
+                                   &len));
+    EXPECT_EQ(&r, 2, len);
+    EXPECT_EQ(&r, 1, out[0].original_idx);
+    EXPECT_EQ(&r, 3, out[1].original_idx);
+  }
+  if(HAS_FAILED(&r)) return r;
+
+  // very different sizes, compared against a plain merge-style intersection
+  const size_t large_n = 100000;
+  const size_t small_n = 100;
+  int *        large   = malloc(large_n * sizeof(int));
+  int          small[100];
+  int          out[100];
+  EXPECT_NE(&r, NULL, large);
+  if(HAS_FAILED(&r)) return r;
+
+  for(size_t i = 0; i < large_n; i++) large[i] = rand() % 200000;
+  for(size_t i = 0; i < small_n; i++) small[i] = rand() % 200000;
+  sort_ints_typed(ints_to_mut_span(large, large_n));
+  sort_ints_typed(ints_to_mut_span(small, small_n));
+
+  size_t expect_len = 0;
+  int    expect[100];
+  for(size_t i = 0, j = 0; i < small_n && j < large_n;) {
+    if(small[i] < large[j]) {
+      i++;
+    } else if(large[j] < small[i]) {
+      j++;
+    } else {
+      expect[expect_len++] = small[i];
+      i++;
+      j++;
+    }
+  }
+
+  size_t len = 0;
+  EXPECT_OK(&r,
+            SPN_set_intersection(ints_to_span(large, large_n),
+                                 ints_to_span(small, small_n),
+                                 ints_to_mut_span(out, small_n),
+                                 compare_ints,
+                                 &len));
+  EXPECT_EQ(&r, expect_len, len);
+  EXPECT_ARREQ(&r, int, expect, out, expect_len);
+
+  free(large);
+
+  return r;
+}
+
+static Result tst_sort_keyed_spans(void) {
+  Result r = PASS;
+
+  // keys that often share (parts of) their first 8 bytes, or are prefixes of each other
+  enum { NUM_KEYS = 2000, MAX_KEY_LEN = 20 };
+  static char   chars[NUM_KEYS][MAX_KEY_LEN];
+  SPN_Span      spans[NUM_KEYS];
+  SPN_KeyedSpan keyed[NUM_KEYS];
+  for(size_t i = 0; i < NUM_KEYS; i++) {
+    const size_t len = (size_t)rand() % MAX_KEY_LEN;
+    for(size_t c = 0; c < len; c++) {
+      chars[i][c] = (c < 6) ? "prefix"[c] : (char)("\0ab"[rand() % 3]);
+    }
+    spans[i] = (SPN_Span){.begin = chars[i], .len = len, .element_size = 1};
+    keyed[i] = SPN_to_keyed_span(spans[i]);
+  }
+
+  const SPN_MutSpan spans_span = {.begin        = spans,
+                                  .len          = NUM_KEYS,
+                                  .element_size = sizeof(SPN_Span)};
+  const SPN_MutSpan keyed_span = {.begin        = keyed,
+                                  .len          = NUM_KEYS,
+                                  .element_size = sizeof(SPN_KeyedSpan)};
+  EXPECT_OK(&r, SPN_sort(spans_span, SPN_compare_spans));
+  EXPECT_OK(&r, SPN_sort(keyed_span, SPN_compare_keyed_spans));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_TRUE(&r, SPN_is_sorted(SPN_mut_to_const(spans_span), SPN_compare_spans));
+  for(size_t i = 0; i < NUM_KEYS; i++) {
+    EXPECT_TRUE(&r, SPN_equals(spans[i], keyed[i].span));
+    EXPECT_EQ(&r, SPN_to_keyed_span(keyed[i].span).prefix, keyed[i].prefix);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  const SPN_KeyedSpan lhs = SPN_to_keyed_span(SPN_from_cstr("abcdefgh1"));
+  const SPN_KeyedSpan rhs = SPN_to_keyed_span(SPN_from_cstr("abcdefgh2"));
+  EXPECT_EQ(&r, lhs.prefix, rhs.prefix);
+  EXPECT_TRUE(&r, SPN_compare_keyed_spans(&lhs, &rhs) < 0);
+  EXPECT_EQ(&r, 0x6162000000000000, SPN_to_keyed_span(SPN_from_cstr("ab")).prefix);
+
+  return r;
+}
+
+static Result tst_bad_args(void) {
+  Result r = PASS;
+
+  int vals[] = {3, 2, 1};
+
+  EXPECT_NOK(&r, SPN_sort((SPN_MutSpan){0}, compare_ints));
+  EXPECT_NOK(&r, SPN_sort(ints_to_mut_span(vals, 3), NULL));
+  EXPECT_NOK(&r, SPN_stable_sort((SPN_MutSpan){0}, compare_ints));
+  EXPECT_NOK(&r, SPN_stable_sort(ints_to_mut_span(vals, 3), NULL));
+  EXPECT_NOK(&r, SPN_radix_sort_u64(ints_to_mut_span(vals, 3)));
+  EXPECT_NOK(&r, SPN_radix_sort_f64(ints_to_mut_span(vals, 3)));
+  EXPECT_NOK(&r, sort_pairs_typed(ints_to_mut_span(vals, 3)));
+
+  const int key = 2;
+  size_t    idx = 0;
+  size_t    len = 0;
+  EXPECT_NOK(&r, SPN_lower_bound(ints_to_span(vals, 3), NULL, compare_ints, &idx));
+  EXPECT_NOK(&r, SPN_upper_bound(ints_to_span(vals, 3), &key, NULL, &idx));
+  EXPECT_NOK(&r, SPN_binary_search(ints_to_span(vals, 3), &key, NULL, &idx));
+  EXPECT_NOK(&r, SPN_lower_bound(ints_to_span(NULL, 3), &key, compare_ints, &idx));
+  EXPECT_NOK(&r, SPN_to_eytzinger(ints_to_span(vals, 3), ints_to_mut_span(vals, 3)));
+  EXPECT_NOK(&r, SPN_to_eytzinger(ints_to_span(vals, 3), ints_to_mut_span(vals, 2)));
+  EXPECT_NOK(&r,
+             SPN_merge(ints_to_span(vals, 3),
+                       (SPN_Span){vals, 1, sizeof(KeyIdxPair)},
+                       (SPN_MutSpan){NULL, 0, sizeof(int)},
+                       compare_ints));
+  EXPECT_NOK(&r,
+             SPN_set_intersection(ints_to_span(vals, 3),
+                                  ints_to_span(vals, 3),
+                                  ints_to_mut_span(NULL, 0),
+                                  compare_ints,
+                                  &len));
+
+  // nothing should have been touched
+  EXPECT_EQ(&r, 3, vals[0]);
+  EXPECT_EQ(&r, 2, vals[1]);
+  EXPECT_EQ(&r, 1, vals[2]);
+
+  return r;
+}
+
+int main(int argc, const char ** argv) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_sort_ints,
+      tst_sort_large_elements,
+      tst_stable_sort_is_stable,
+      tst_radix_sort_unsigned,
+      tst_radix_sort_signed_and_float,
+      tst_bounds_and_binary_search,
+      tst_eytzinger,
+      tst_merge,
+      tst_set_intersection,
+      tst_sort_keyed_spans,
+      tst_bad_args,
+  };
+
+  return (run_tests_with_args(tests, sizeof(tests) / sizeof(Test), argc, argv) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "span.h"
+#include "span_split.h"
+
+#define OK STAT_OK
+
+// Checks that iterating gives exactly the expected (NULL-terminated list of) parts.
+static Result expect_parts(SPN_SplitIter it, const char * const * expected) {
+  Result r = PASS;
+
+  SPN_Span part = {0};
+  size_t   idx  = 0;
+  while(SPN_split_next(&it, &part)) {
+    EXPECT_NE(&r, NULL, expected[idx]);
+    if(HAS_FAILED(&r)) return r;
+    EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr(expected[idx]), part));
+    idx++;
+  }
+  EXPECT_EQ(&r, NULL, expected[idx]);
+  EXPECT_FALSE(&r, SPN_split_next(&it, &part)); // stays done
+
+  return r;
+}
+
+static Result tst_split_by_element(void) {
+  Result        r  = PASS;
+  SPN_SplitIter it = {0};
+
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr("a,bc,,d"), ","));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"a", "bc", "", "d", NULL}));
+
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr(",a,"), ","));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"", "a", "", NULL}));
+
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr("no delimiters"), ","));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"no delimiters", NULL}));
+
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr(""), ","));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"", NULL}));
+
+  // parts point into the original
+  const char * str = "key=value";
+  SPN_Span     part = {0};
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr(str), "="));
+  EXPECT_TRUE(&r, SPN_split_next(&it, &part));
+  EXPECT_EQ(&r, (const void *)str, part.begin);
+  EXPECT_TRUE(&r, SPN_split_next(&it, &part));
+  EXPECT_EQ(&r, (const void *)&str[4], part.begin);
+
+  // wider elements
+  const int      ints[]    = {1, 2, 0, 3, 0, 0};
+  const int      delimiter = 0;
+  const SPN_Span ints_span = {.begin = ints, .len = 6, .element_size = sizeof(int)};
+  const size_t   lens[]    = {2, 1, 0, 0};
+  size_t         num_parts = 0;
+  EXPECT_OK(&r, SPN_split_by_element(&it, ints_span, &delimiter));
+  while(SPN_split_next(&it, &part)) {
+    EXPECT_LT(&r, num_parts, 4);
+    if(HAS_FAILED(&r)) return r;
+    EXPECT_EQ(&r, lens[num_parts], part.len);
+    num_parts++;
+  }
+  EXPECT_EQ(&r, 4, num_parts);
+
+  return r;
+}
+
+static Result tst_split_by_subspan(void) {
+  Result        r  = PASS;
+  SPN_SplitIter it = {0};
+
+  EXPECT_OK(&r, SPN_split_by_subspan(&it, SPN_from_cstr("a::b:c::::d"), SPN_from_cstr("::")));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"a", "b:c", "", "d", NULL}));
+
+  EXPECT_OK(&r,
+            SPN_split_by_subspan(&it, SPN_from_cstr("line1\r\nline2\r\n"), SPN_from_cstr("\r\n")));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"line1", "line2", "", NULL}));
+
+  EXPECT_NOK(&r, SPN_split_by_subspan(&it, SPN_from_cstr("abc"), SPN_from_cstr("")));
+
+  return r;
+}
+
+static Result tst_split_by_any_of(void) {
+  Result        r  = PASS;
+  SPN_SplitIter it = {0};
+
+  EXPECT_OK(&r, SPN_split_by_any_of(&it, SPN_from_cstr("a b\tc\n\nd"), SPN_from_cstr(" \t\n")));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"a", "b", "c", "", "d", NULL}));
+
+  // high byte values
+  EXPECT_OK(&r,
+            SPN_split_by_any_of(&it,
+                                SPN_from_cstr("a\xff"
+                                              "b\x80"
+                                              "c"),
+                                SPN_from_cstr("\x80\xff")));
+  EXPECT_PASS(&r, expect_parts(it, (const char *[]){"a", "b", "c", NULL}));
+
+  const uint16_t values[]     = {1, 7, 2, 9, 3};
+  const uint16_t delimiters[] = {9, 7};
+  EXPECT_OK(&r,
+            SPN_split_by_any_of(&it,
+                                (SPN_Span){.begin = values, .len = 5, .element_size = 2},
+                                (SPN_Span){.begin = delimiters, .len = 2, .element_size = 2}));
+  SPN_Span part      = {0};
+  size_t   num_parts = 0;
+  while(SPN_split_next(&it, &part)) {
+    EXPECT_EQ(&r, 1, part.len);
+    if(part.len == 1) EXPECT_EQ(&r, num_parts + 1, *(const uint16_t *)part.begin);
+    num_parts++;
+  }
+  EXPECT_EQ(&r, 3, num_parts);
+
+  EXPECT_NOK(&r, SPN_split_by_any_of(&it, SPN_from_cstr("abc"), SPN_from_cstr("")));
+
+  return r;
+}
+
+static Result tst_split_into(void) {
+  Result        r     = PASS;
+  SPN_SplitIter it    = {0};
+  DAR_DArray    parts = {0};
+
+  EXPECT_OK(&r, DAR_create(&parts, sizeof(SPN_Span)));
+  if(HAS_FAILED(&r)) return r;
+
+  const char * const fields[] = {"2024-01-01", "12:00", "INFO", "", "started"};
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr("2024-01-01;12:00;INFO;;started"), ";"));
+  EXPECT_OK(&r, SPN_split_into(&parts, &it));
+  EXPECT_EQ(&r, 5, parts.size);
+  if(HAS_FAILED(&r)) return r;
+  for(size_t i = 0; i < parts.size; i++) {
+    EXPECT_TRUE(&r, SPN_equals(SPN_from_cstr(fields[i]), *(const SPN_Span *)DAR_get(&parts, i)));
+  }
+
+  // an iterator that is partially consumed only adds what is left
+  SPN_Span part = {0};
+  EXPECT_OK(&r, DAR_clear(&parts));
+  EXPECT_OK(&r, SPN_split_by_element(&it, SPN_from_cstr("a;b;c"), ";"));
+  EXPECT_TRUE(&r, SPN_split_next(&it, &part));
+  EXPECT_OK(&r, SPN_split_into(&parts, &it));
+  EXPECT_EQ(&r, 2, parts.size);
+
+  DAR_DArray wrong = {0};
+  EXPECT_OK(&r, DAR_create(&wrong, sizeof(int)));
+  EXPECT_NOK(&r, SPN_split_into(&wrong, &it));
+  EXPECT_NOK(&r, SPN_split_into(NULL, &it));
+
+  EXPECT_OK(&r, DAR_destroy(&wrong));
+  EXPECT_OK(&r, DAR_destroy(&parts));
+
+  return r;
+}
+
+static Result tst_bad_args(void) {
+  Result        r  = PASS;
+  SPN_SplitIter it = {0};
+
+  EXPECT_NOK(&r, SPN_split_by_element(NULL, SPN_from_cstr("a"), ","));
+  EXPECT_NOK(&r, SPN_split_by_element(&it, SPN_from_cstr("a"), NULL));
+  EXPECT_NOK(&r, SPN_split_by_element(&it, (SPN_Span){.begin = NULL, .len = 3}, ","));
+  EXPECT_NOK(&r,
+             SPN_split_by_subspan(&it,
+                                  SPN_from_cstr("a"),
+                                  (SPN_Span){.begin = "ab", .len = 1, .element_size = 2}));
+  EXPECT_FALSE(&r, SPN_split_next(NULL, NULL));
+
+  // an empty span without memory is still one empty part
+  EXPECT_OK(&r, SPN_split_by_element(&it, (SPN_Span){.element_size = 1}, ","));
+  EXPECT_TRUE(&r, SPN_split_next(&it, NULL));
+  EXPECT_FALSE(&r, SPN_split_next(&it, NULL));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_split_by_element,
+      tst_split_by_subspan,
+      tst_split_by_any_of,
+      tst_split_into,
+      tst_bad_args,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
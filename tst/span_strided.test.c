@@ -0,0 +1,265 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "darray.h"
+#include "span.h"
+#include "span_strided.h"
+
+#define OK STAT_OK
+
+typedef struct {
+  uint8_t  flags;
+  uint32_t id;
+  double   price;
+  uint16_t quantity;
+  char     code[5];
+} Record;
+
+#define NUM_RECORDS 1000
+
+static void make_records(Record * records, size_t n) {
+  memset(records, 0, n * sizeof(Record));
+  for(size_t i = 0; i < n; i++) {
+    records[i].flags    = (uint8_t)rand();
+    records[i].id       = (uint32_t)i * 7;
+    records[i].price    = (double)rand() / 100.0;
+    records[i].quantity = (uint16_t)rand();
+    for(size_t c = 0; c < sizeof(records[i].code); c++) {
+      records[i].code[c] = (char)('a' + (rand() % 26));
+    }
+  }
+}
+
+static SPN_Span records_span(const Record * records, size_t n) {
+  return (SPN_Span){.begin = records, .len = n, .element_size = sizeof(Record)};
+}
+
+static Result tst_views(void) {
+  Result r = PASS;
+
+  Record records[NUM_RECORDS];
+  make_records(records, NUM_RECORDS);
+  const SPN_Span span = records_span(records, NUM_RECORDS);
+
+  const SPN_StridedSpan ids = SPN_STRIDED_FIELD(span, Record, id);
+  EXPECT_EQ(&r, NUM_RECORDS, ids.len);
+  EXPECT_EQ(&r, sizeof(uint32_t), ids.element_size);
+  EXPECT_EQ(&r, sizeof(Record), ids.stride);
+  EXPECT_FALSE(&r, SPN_strided_is_contiguous(ids));
+  for(size_t i = 0; i < NUM_RECORDS; i++) {
+    EXPECT_EQ(&r, records[i].id, *(const uint32_t *)SPN_strided_get(ids, i));
+  }
+
+  const SPN_StridedSpan sub = SPN_strided_subspan(ids, 10, 5);
+  EXPECT_EQ(&r, 5, sub.len);
+  EXPECT_EQ(&r, records[12].id, *(const uint32_t *)SPN_strided_get(sub, 2));
+  EXPECT_EQ(&r, 0, SPN_strided_subspan(ids, NUM_RECORDS + 1, 5).len);
+  EXPECT_EQ(&r, 3, SPN_strided_subspan(ids, NUM_RECORDS - 3, 5).len);
+
+  const SPN_StridedSpan whole = SPN_strided_from_span(span);
+  EXPECT_TRUE(&r, SPN_strided_is_contiguous(whole));
+  EXPECT_EQ(&r, &records[3], SPN_strided_get(whole, 3));
+
+  // a field that doesn't fit
+  EXPECT_TRUE(&r, SPN_strided_from_field(span, sizeof(Record) - 2, 4).begin == NULL);
+  EXPECT_TRUE(&r, SPN_strided_from_field(span, 0, 0).begin == NULL);
+
+  return r;
+}
+
+static Result tst_gather(void) {
+  Result r = PASS;
+
+  static Record records[NUM_RECORDS];
+  make_records(records, NUM_RECORDS);
+  const SPN_Span span = records_span(records, NUM_RECORDS);
+
+  // every field, and so every element size, at every length up to a few vectors
+  for(size_t len = 0; len <= 40; len++) {
+    const SPN_Span part = SPN_subspan(span, (size_t)rand() % (NUM_RECORDS - len), len);
+
+    uint8_t  flags[40];
+    uint32_t ids[40];
+    double   prices[40];
+    uint16_t quantities[40];
+    char     codes[40][5];
+
+    const SPN_MutSpan flags_out      = {.begin = flags, .len = 40, .element_size = 1};
+    const SPN_MutSpan ids_out        = {.begin = ids, .len = 40, .element_size = 4};
+    const SPN_MutSpan prices_out     = {.begin = prices, .len = 40, .element_size = 8};
+    const SPN_MutSpan quantities_out = {.begin = quantities, .len = 40, .element_size = 2};
+    const SPN_MutSpan codes_out      = {.begin = codes, .len = 40, .element_size = 5};
+
+    EXPECT_OK(&r, SPN_strided_gather(SPN_STRIDED_FIELD(part, Record, flags), flags_out));
+    EXPECT_OK(&r, SPN_strided_gather(SPN_STRIDED_FIELD(part, Record, id), ids_out));
+    EXPECT_OK(&r, SPN_strided_gather(SPN_STRIDED_FIELD(part, Record, price), prices_out));
+    EXPECT_OK(&r, SPN_strided_gather(SPN_STRIDED_FIELD(part, Record, quantity), quantities_out));
+    EXPECT_OK(&r, SPN_strided_gather(SPN_STRIDED_FIELD(part, Record, code), codes_out));
+    if(HAS_FAILED(&r)) return r;
+
+    const Record * part_records = part.begin;
+    for(size_t i = 0; i < len; i++) {
+      EXPECT_EQ(&r, part_records[i].flags, flags[i]);
+      EXPECT_EQ(&r, part_records[i].id, ids[i]);
+      EXPECT_TRUE(&r, part_records[i].price == prices[i]);
+      EXPECT_EQ(&r, part_records[i].quantity, quantities[i]);
+      EXPECT_ARREQ(&r, char, part_records[i].code, codes[i], 5);
+    }
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  // appending, which gives a contiguous span equal to the strided one
+  DAR_DArray prices = {0};
+  EXPECT_OK(&r, DAR_create(&prices, sizeof(double)));
+  const double first = -1.0;
+  EXPECT_OK(&r, DAR_push_back(&prices, &first));
+
+  const SPN_StridedSpan price_view = SPN_STRIDED_FIELD(span, Record, price);
+  EXPECT_OK(&r, SPN_strided_gather_append(&prices, price_view));
+  EXPECT_EQ(&r, NUM_RECORDS + 1, prices.size);
+  const SPN_Span gathered = SPN_subspan(DAR_to_span(&prices), 1, NUM_RECORDS);
+  EXPECT_TRUE(&r, SPN_strided_equals(price_view, SPN_strided_from_span(gathered)));
+  EXPECT_EQ(&r, first, *(const double *)DAR_first(&prices));
+
+  // bad arguments
+  uint32_t small[4];
+  EXPECT_NOK(&r,
+             SPN_strided_gather(SPN_STRIDED_FIELD(span, Record, id),
+                                (SPN_MutSpan){.begin = small, .len = 4, .element_size = 4}));
+  EXPECT_NOK(&r,
+             SPN_strided_gather(SPN_STRIDED_FIELD(span, Record, price),
+                                (SPN_MutSpan){.begin = small, .len = 4, .element_size = 4}));
+  EXPECT_NOK(&r, SPN_strided_gather_append(&prices, SPN_STRIDED_FIELD(span, Record, id)));
+  EXPECT_NOK(&r, SPN_strided_gather_append(NULL, price_view));
+
+  EXPECT_OK(&r, DAR_destroy(&prices));
+
+  return r;
+}
+
+static Result tst_gather_at_each_simd_level(void) {
+  Result r = PASS;
+
+  // with and without the vector gathers, if the CPU has them
+  const SPN_INT_SimdLevel levels[] = {SPN_INT_SIMD_NONE, SPN_INT_SIMD_AVX2};
+  for(size_t i = 0; i < (sizeof(levels) / sizeof(levels[0])); i++) {
+    EXPECT_TRUE(&r, SPN_INT_set_max_simd_level(levels[i]) <= levels[i]);
+    EXPECT_EQ(&r, PASS, tst_gather());
+    if(HAS_FAILED(&r)) break;
+  }
+
+  SPN_INT_set_max_simd_level(SPN_INT_SIMD_AVX2);
+
+  return r;
+}
+
+static bool sum_quantities(const void * element, void * ctx) {
+  *(uint64_t *)ctx += *(const uint16_t *)element;
+  return true;
+}
+
+static bool count_until_zero_flags(const void * element, void * ctx) {
+  if(*(const uint8_t *)element == 0) return false;
+  (*(size_t *)ctx)++;
+  return true;
+}
+
+static Result tst_find_equals_for_each(void) {
+  Result r = PASS;
+
+  Record records[NUM_RECORDS];
+  make_records(records, NUM_RECORDS);
+  const SPN_Span span = records_span(records, NUM_RECORDS);
+
+  const SPN_StridedSpan ids = SPN_STRIDED_FIELD(span, Record, id);
+  size_t                idx = 0;
+  for(size_t i = 0; i < 100; i++) {
+    const size_t   expect = (size_t)rand() % NUM_RECORDS;
+    const uint32_t id     = records[expect].id;
+    EXPECT_OK(&r, SPN_strided_find(ids, &id, &idx));
+    EXPECT_EQ(&r, expect, idx);
+  }
+  const uint32_t missing_id = 3;
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, SPN_strided_find(ids, &missing_id, &idx));
+  EXPECT_EQ(&r, STAT_OK_NOT_FOUND, SPN_strided_find(ids, &missing_id, NULL));
+  EXPECT_OK(&r, SPN_strided_find(ids, &records[0].id, NULL));
+
+  const char code[5] = {'x', 'y', 'z', 'z', 'y'};
+  memcpy(records[NUM_RECORDS - 1].code, code, sizeof(code));
+  EXPECT_OK(&r, SPN_strided_find(SPN_STRIDED_FIELD(span, Record, code), code, &idx));
+  EXPECT_TRUE(&r, memcmp(records[idx].code, code, sizeof(code)) == 0);
+
+  EXPECT_NOK(&r, SPN_strided_find(ids, NULL, &idx));
+  EXPECT_NOK(&r, SPN_strided_find((SPN_StridedSpan){0}, &missing_id, &idx));
+
+  // equality is by element, regardless of stride
+  uint32_t          id_array[NUM_RECORDS];
+  const SPN_MutSpan id_array_out = {.begin        = id_array,
+                                    .len          = NUM_RECORDS,
+                                    .element_size = sizeof(uint32_t)};
+  EXPECT_OK(&r, SPN_strided_gather(ids, id_array_out));
+  const SPN_StridedSpan id_array_span = SPN_strided_from_span(SPN_mut_to_const(id_array_out));
+  EXPECT_TRUE(&r, SPN_strided_equals(ids, id_array_span));
+  EXPECT_TRUE(&r, SPN_strided_equals(id_array_span, id_array_span));
+  EXPECT_FALSE(&r, SPN_strided_equals(ids, SPN_strided_subspan(id_array_span, 1, NUM_RECORDS)));
+  id_array[NUM_RECORDS / 2]++;
+  EXPECT_FALSE(&r, SPN_strided_equals(ids, id_array_span));
+  EXPECT_FALSE(&r, SPN_strided_equals(ids, SPN_STRIDED_FIELD(span, Record, price)));
+
+  uint64_t sum    = 0;
+  uint64_t expect = 0;
+  for(size_t i = 0; i < NUM_RECORDS; i++) expect += records[i].quantity;
+  EXPECT_OK(&r,
+            SPN_strided_for_each(SPN_STRIDED_FIELD(span, Record, quantity), sum_quantities, &sum));
+  EXPECT_EQ(&r, expect, sum);
+
+  records[0].flags = 1;
+  records[1].flags = 1;
+  records[2].flags = 0;
+  size_t count = 0;
+  EXPECT_OK(&r,
+            SPN_strided_for_each(SPN_STRIDED_FIELD(span, Record, flags),
+                                 count_until_zero_flags,
+                                 &count));
+  EXPECT_EQ(&r, 2, count);
+
+  EXPECT_NOK(&r, SPN_strided_for_each(ids, NULL, NULL));
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_views,
+      tst_gather,
+      tst_gather_at_each_simd_level,
+      tst_find_equals_for_each,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
@@ -0,0 +1,355 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "span.h"
+#include "span_utf8.h"
+
+#define OK STAT_OK
+
+#define MAX_TEXT_LEN 512
+
+static SPN_Span bytes_span(const uint8_t * bytes, size_t len) {
+  return (SPN_Span){.begin = bytes, .len = len, .element_size = 1};
+}
+
+// Returns the length of the longest valid prefix, by decoding each codepoint and checking its
+// value against the bounds of its encoded length.
+static size_t reference_valid_len(const uint8_t * bytes, size_t len) {
+  size_t idx = 0;
+  while(idx < len) {
+    const uint8_t lead      = bytes[idx];
+    size_t        seq_len   = 0;
+    uint32_t      codepoint = 0;
+    uint32_t      min       = 0;
+
+    if(lead < 0x80) {
+      seq_len = 1, codepoint = lead, min = 0;
+    } else if((lead & 0xe0) == 0xc0) {
+      seq_len = 2, codepoint = lead & 0x1f, min = 0x80;
+    } else if((lead & 0xf0) == 0xe0) {
+      seq_len = 3, codepoint = lead & 0x0f, min = 0x800;
+    } else if((lead & 0xf8) == 0xf0) {
+      seq_len = 4, codepoint = lead & 0x07, min = 0x10000;
+    } else {
+      return idx;
+    }
+
+    if((idx + seq_len) > len) return idx;
+    for(size_t i = 1; i < seq_len; i++) {
+      if((bytes[idx + i] & 0xc0) != 0x80) return idx;
+      codepoint = (codepoint << 6) | (bytes[idx + i] & 0x3f);
+    }
+
+    if(codepoint < min || codepoint > 0x10ffff) return idx;
+    if(codepoint >= 0xd800 && codepoint <= 0xdfff) return idx;
+
+    idx += seq_len;
+  }
+  return len;
+}
+
+static size_t encode(uint32_t codepoint, uint8_t * out) {
+  if(codepoint < 0x80) {
+    out[0] = (uint8_t)codepoint;
+    return 1;
+  }
+  if(codepoint < 0x800) {
+    out[0] = (uint8_t)(0xc0 | (codepoint >> 6));
+    out[1] = (uint8_t)(0x80 | (codepoint & 0x3f));
+    return 2;
+  }
+  if(codepoint < 0x10000) {
+    out[0] = (uint8_t)(0xe0 | (codepoint >> 12));
+    out[1] = (uint8_t)(0x80 | ((codepoint >> 6) & 0x3f));
+    out[2] = (uint8_t)(0x80 | (codepoint & 0x3f));
+    return 3;
+  }
+  out[0] = (uint8_t)(0xf0 | (codepoint >> 18));
+  out[1] = (uint8_t)(0x80 | ((codepoint >> 12) & 0x3f));
+  out[2] = (uint8_t)(0x80 | ((codepoint >> 6) & 0x3f));
+  out[3] = (uint8_t)(0x80 | (codepoint & 0x3f));
+  return 4;
+}
+
+static uint32_t get_random_codepoint(void) {
+  switch(rand() % 5) {
+  case 0:
+  case 1: return (uint32_t)(rand() % 0x80); // mostly ASCII, as real text is
+  case 2: return 0x80 + (uint32_t)(rand() % (0x800 - 0x80));
+  case 3: {
+    const uint32_t codepoint = 0x800 + (uint32_t)(rand() % (0x10000 - 0x800));
+    return (codepoint >= 0xd800 && codepoint <= 0xdfff) ? 0xfffd : codepoint;
+  }
+  default: return 0x10000 + (uint32_t)(rand() % (0x110000 - 0x10000));
+  }
+}
+
+// Fills text with valid UTF-8 of at most max_len bytes, and returns its length.
+static size_t make_random_text(uint8_t * text, size_t max_len, size_t * o_num_codepoints) {
+  size_t len            = 0;
+  size_t num_codepoints = 0;
+  while((len + 4) <= max_len) {
+    if((rand() % 64) == 0) break;
+    len += encode(get_random_codepoint(), &text[len]);
+    num_codepoints++;
+  }
+  *o_num_codepoints = num_codepoints;
+  return len;
+}
+
+static Result tst_validate_basic(void) {
+  Result r = PASS;
+
+  const char * valid[] = {
+      "",
+      "plain ASCII text that is long enough to fill a few vectors of 32 bytes each",
+      "caf\xc3\xa9",
+      "\xe2\x82\xac 100",
+      "\xf0\x9f\x98\x80",
+      "\xef\xbf\xbf",     // U+FFFF
+      "\xf4\x8f\xbf\xbf", // U+10FFFF
+      "\xed\x9f\xbf",     // U+D7FF, just before the surrogates
+  };
+  for(size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+    size_t valid_len = SIZE_MAX;
+    EXPECT_EQ(&r, STAT_OK_TRUE, SPN_utf8_validate(SPN_from_cstr(valid[i]), &valid_len));
+    EXPECT_EQ(&r, strlen(valid[i]), valid_len);
+  }
+
+  const struct {
+    const char * text;
+    size_t       valid_len;
+  } invalid[] = {
+      {"abc\x80", 3},                  // stray continuation
+      {"abc\xc3", 3},                  // truncated
+      {"\xc0\xaf", 0},                 // overlong 2 bytes
+      {"ab\xe0\x80\xaf", 2},           // overlong 3 bytes
+      {"\xf0\x80\x80\xaf", 0},         // overlong 4 bytes
+      {"x\xed\xa0\x80", 1},            // surrogate
+      {"\xf4\x90\x80\x80", 0},         // past U+10FFFF
+      {"\xf5\x80\x80\x80", 0},         // invalid lead
+      {"\xe2\x82\x41", 0},             // missing continuation
+      {"\xe2\x82\xac\xe2\x82\xac\xff", 6},
+      {"ASCII long enough to need a full vector before the error \xc3\x28", 57},
+  };
+  for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    size_t valid_len = SIZE_MAX;
+    EXPECT_EQ(&r, STAT_OK_FALSE, SPN_utf8_validate(SPN_from_cstr(invalid[i].text), &valid_len));
+    EXPECT_EQ(&r, invalid[i].valid_len, valid_len);
+  }
+
+  EXPECT_EQ(&r, STAT_OK_TRUE, SPN_utf8_validate(SPN_from_cstr("abc"), NULL));
+  EXPECT_NOK(&r, SPN_utf8_validate((SPN_Span){0}, NULL));
+
+  const int ints[] = {1, 2, 3};
+  EXPECT_NOK(&r,
+             SPN_utf8_validate((SPN_Span){.begin = ints, .len = 3, .element_size = sizeof(int)},
+                               NULL));
+
+  return r;
+}
+
+static Result tst_validate_matches_reference(void) {
+  Result r = PASS;
+
+  uint8_t text[MAX_TEXT_LEN] = {0};
+
+  for(size_t n = 0; n < 2000; n++) {
+    size_t       num_codepoints = 0;
+    const size_t len = make_random_text(text, 1 + ((size_t)rand() % MAX_TEXT_LEN), &num_codepoints);
+
+    size_t valid_len = 0;
+    EXPECT_EQ(&r, STAT_OK_TRUE, SPN_utf8_validate(bytes_span(text, len), &valid_len));
+    EXPECT_EQ(&r, len, valid_len);
+
+    // break a few bytes, which may or may not make it invalid
+    const size_t num_changes = (len == 0) ? 0 : 1 + ((size_t)rand() % 3);
+    for(size_t i = 0; i < num_changes; i++) {
+      text[(size_t)rand() % len] = (uint8_t)(0x80 + (rand() % 0x80));
+    }
+
+    const size_t expect_len = reference_valid_len(text, len);
+    EXPECT_EQ(&r,
+              (expect_len == len) ? STAT_OK_TRUE : STAT_OK_FALSE,
+              SPN_utf8_validate(bytes_span(text, len), &valid_len));
+    EXPECT_EQ(&r, expect_len, valid_len);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  // every two byte combination, at every position in a vector
+  for(uint32_t pair = 0; pair <= 0xffff; pair++) {
+    const size_t pos = pair % 48;
+    memset(text, 'a', 64);
+    text[pos]     = (uint8_t)(pair >> 8);
+    text[pos + 1] = (uint8_t)pair;
+
+    const size_t expect_len = reference_valid_len(text, 64);
+    size_t       valid_len  = 0;
+    EXPECT_EQ(&r,
+              (expect_len == 64) ? STAT_OK_TRUE : STAT_OK_FALSE,
+              SPN_utf8_validate(bytes_span(text, 64), &valid_len));
+    EXPECT_EQ(&r, expect_len, valid_len);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_count_codepoints(void) {
+  Result r = PASS;
+
+  size_t count = 0;
+  EXPECT_OK(&r, SPN_utf8_count_codepoints(SPN_from_cstr(""), &count));
+  EXPECT_EQ(&r, 0, count);
+  EXPECT_OK(&r, SPN_utf8_count_codepoints(SPN_from_cstr("caf\xc3\xa9 \xf0\x9f\x98\x80"), &count));
+  EXPECT_EQ(&r, 6, count);
+
+  uint8_t text[MAX_TEXT_LEN] = {0};
+  for(size_t n = 0; n < 1000; n++) {
+    size_t       num_codepoints = 0;
+    const size_t len = make_random_text(text, 1 + ((size_t)rand() % MAX_TEXT_LEN), &num_codepoints);
+
+    EXPECT_OK(&r, SPN_utf8_count_codepoints(bytes_span(text, len), &count));
+    EXPECT_EQ(&r, num_codepoints, count);
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  EXPECT_NOK(&r, SPN_utf8_count_codepoints(SPN_from_cstr("abc"), NULL));
+  EXPECT_NOK(&r, SPN_utf8_count_codepoints((SPN_Span){0}, &count));
+
+  return r;
+}
+
+// Feeds text to a stream validator in chunks split at the given points, and returns the result.
+static STAT_Val validate_in_chunks(const uint8_t * text,
+                                   size_t          len,
+                                   const size_t *  splits,
+                                   size_t          num_splits) {
+  SPN_Utf8Validator validator = {0};
+  size_t            begin     = 0;
+  for(size_t i = 0; i <= num_splits; i++) {
+    const size_t end = (i < num_splits) ? splits[i] : len;
+    SPN_utf8_validator_feed(&validator, bytes_span(&text[begin], end - begin));
+    begin = end;
+  }
+  return SPN_utf8_validator_finish(&validator);
+}
+
+static Result tst_validate_in_chunks(void) {
+  Result r = PASS;
+
+  const uint8_t emoji[] = {'a', 0xf0, 0x9f, 0x98, 0x80, 'b'};
+  for(size_t split = 0; split <= sizeof(emoji); split++) {
+    EXPECT_EQ(&r, STAT_OK_TRUE, validate_in_chunks(emoji, sizeof(emoji), &split, 1));
+  }
+  // split into single bytes
+  const size_t singles[] = {1, 2, 3, 4, 5};
+  EXPECT_EQ(&r, STAT_OK_TRUE, validate_in_chunks(emoji, sizeof(emoji), singles, 5));
+
+  // cut off at the end of the stream
+  for(size_t split = 0; split <= 4; split++) {
+    EXPECT_EQ(&r, STAT_OK_FALSE, validate_in_chunks(emoji, 4, &split, 1));
+  }
+
+  // a surrogate split across chunks
+  const uint8_t surrogate[] = {0xed, 0xa0, 0x80};
+  for(size_t split = 0; split <= sizeof(surrogate); split++) {
+    EXPECT_EQ(&r, STAT_OK_FALSE, validate_in_chunks(surrogate, sizeof(surrogate), &split, 1));
+  }
+
+  // once invalid, the stream stays invalid
+  SPN_Utf8Validator validator = {0};
+  EXPECT_EQ(&r, STAT_OK_FALSE, SPN_utf8_validator_feed(&validator, SPN_from_cstr("\xff")));
+  EXPECT_EQ(&r, STAT_OK_FALSE, SPN_utf8_validator_feed(&validator, SPN_from_cstr("abc")));
+  EXPECT_EQ(&r, STAT_OK_FALSE, SPN_utf8_validator_finish(&validator));
+
+  EXPECT_NOK(&r, SPN_utf8_validator_feed(NULL, SPN_from_cstr("abc")));
+  EXPECT_NOK(&r, SPN_utf8_validator_finish(NULL));
+
+  uint8_t text[MAX_TEXT_LEN] = {0};
+  for(size_t n = 0; n < 1000; n++) {
+    size_t       num_codepoints = 0;
+    const size_t len = make_random_text(text, 1 + ((size_t)rand() % MAX_TEXT_LEN), &num_codepoints);
+    if(len > 0 && (rand() % 2) == 0) text[(size_t)rand() % len] = (uint8_t)(rand() % 256);
+
+    size_t splits[8] = {0};
+    for(size_t i = 0; i < 8; i++) {
+      splits[i] = (len == 0) ? 0 : (size_t)rand() % len;
+    }
+    for(size_t i = 1; i < 8; i++) { // insertion sort, chunks must be in order
+      for(size_t j = i; j > 0 && splits[j - 1] > splits[j]; j--) {
+        const size_t tmp = splits[j];
+        splits[j]        = splits[j - 1];
+        splits[j - 1]    = tmp;
+      }
+    }
+
+    const STAT_Val expect = SPN_utf8_validate(bytes_span(text, len), NULL);
+    EXPECT_EQ(&r, expect, validate_in_chunks(text, len, splits, 8));
+    if(HAS_FAILED(&r)) return r;
+  }
+
+  return r;
+}
+
+static Result tst_at_each_simd_level(void) {
+  Result r = PASS;
+
+  // the kernels for each level the CPU supports, not just the widest one
+  const Test checks[] = {
+      tst_validate_basic,
+      tst_validate_matches_reference,
+      tst_count_codepoints,
+      tst_validate_in_chunks,
+  };
+
+  for(SPN_INT_SimdLevel level = SPN_INT_SIMD_NONE; level <= SPN_INT_SIMD_AVX2; level++) {
+    EXPECT_TRUE(&r, SPN_INT_set_max_simd_level(level) <= level);
+
+    for(size_t i = 0; i < (sizeof(checks) / sizeof(checks[0])); i++) {
+      EXPECT_EQ(&r, PASS, checks[i]());
+    }
+    if(HAS_FAILED(&r)) break;
+  }
+
+  SPN_INT_set_max_simd_level(SPN_INT_SIMD_AVX2);
+
+  return r;
+}
+
+int main(void) {
+  srand(time(NULL) + clock());
+
+  Test tests[] = {
+      tst_validate_basic,
+      tst_validate_matches_reference,
+      tst_count_codepoints,
+      tst_validate_in_chunks,
+      tst_at_each_simd_level,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}
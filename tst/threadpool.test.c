@@ -0,0 +1,170 @@
+// MIT License
+//
+// Copyright (c) 2024 Arjen P. van Zanten
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stat.h"
+#include "test_utils.h"
+
+#include "threadpool.h"
+
+#define OK STAT_OK
+
+#define NUM_TASKS 1000
+
+typedef struct {
+  TP_Pool *     pool;
+  atomic_int    counts[NUM_TASKS];
+  atomic_size_t num_nested_tasks;
+} Counters;
+
+static void count_task(void * ctx, size_t task_idx) {
+  Counters * counters = ctx;
+  atomic_fetch_add(&counters->counts[task_idx], 1);
+}
+
+static void nested_task(void * ctx, size_t task_idx) {
+  (void)task_idx;
+  Counters * counters = ctx;
+  atomic_fetch_add(&counters->num_nested_tasks, 1);
+}
+
+static void spawn_nested_task(void * ctx, size_t task_idx) {
+  Counters * counters = ctx;
+  atomic_fetch_add(&counters->counts[task_idx], 1);
+  TP_run(counters->pool, nested_task, ctx, 10);
+}
+
+static Result check_counts(Counters * counters, int expect) {
+  Result r = PASS;
+  for(size_t i = 0; i < NUM_TASKS; i++) {
+    EXPECT_EQ(&r, expect, atomic_load(&counters->counts[i]));
+    if(HAS_FAILED(&r)) {
+      PRINT_FAIL("task %zu", i);
+      break;
+    }
+  }
+  return r;
+}
+
+static Result run_count_tasks(size_t num_threads) {
+  Result r = PASS;
+
+  TP_Pool pool = {0};
+  EXPECT_OK(&r, TP_create(&pool, num_threads));
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_EQ(&r, num_threads + 1, TP_get_concurrency(&pool));
+
+  Counters * counters = calloc(1, sizeof(Counters));
+  EXPECT_NE(&r, NULL, counters);
+  if(HAS_FAILED(&r)) return r;
+
+  // run a couple of jobs after another on the same pool
+  for(int i = 1; i <= 5; i++) {
+    EXPECT_OK(&r, TP_run(&pool, count_task, counters, NUM_TASKS));
+    EXPECT_PASS(&r, check_counts(counters, i));
+  }
+
+  free(counters);
+  EXPECT_OK(&r, TP_destroy(&pool));
+
+  return r;
+}
+
+static Result tst_run_without_threads(void) { return run_count_tasks(0); }
+static Result tst_run_with_one_thread(void) { return run_count_tasks(1); }
+static Result tst_run_with_many_threads(void) { return run_count_tasks(8); }
+
+static Result tst_nested_run(void) {
+  Result r = PASS;
+
+  TP_Pool pool = {0};
+  EXPECT_OK(&r, TP_create(&pool, 3));
+  if(HAS_FAILED(&r)) return r;
+
+  Counters * counters = calloc(1, sizeof(Counters));
+  EXPECT_NE(&r, NULL, counters);
+  if(HAS_FAILED(&r)) return r;
+
+  counters->pool = &pool;
+
+  EXPECT_OK(&r, TP_run(&pool, spawn_nested_task, counters, NUM_TASKS));
+  EXPECT_PASS(&r, check_counts(counters, 1));
+  EXPECT_EQ(&r, NUM_TASKS * 10, atomic_load(&counters->num_nested_tasks));
+
+  free(counters);
+  EXPECT_OK(&r, TP_destroy(&pool));
+
+  return r;
+}
+
+static Result tst_shared_pool(void) {
+  Result r = PASS;
+
+  TP_Pool * pool = TP_get_shared_pool();
+  EXPECT_NE(&r, NULL, pool);
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_EQ(&r, pool, TP_get_shared_pool());
+  EXPECT_EQ(&r, TP_get_default_num_threads(), pool->num_threads);
+
+  Counters * counters = calloc(1, sizeof(Counters));
+  EXPECT_NE(&r, NULL, counters);
+  if(HAS_FAILED(&r)) return r;
+
+  EXPECT_OK(&r, TP_run(pool, count_task, counters, NUM_TASKS));
+  EXPECT_PASS(&r, check_counts(counters, 1));
+
+  free(counters);
+
+  return r;
+}
+
+static Result tst_bad_args(void) {
+  Result r = PASS;
+
+  TP_Pool pool = {0};
+  EXPECT_NOK(&r, TP_create(NULL, 1));
+  EXPECT_OK(&r, TP_create(&pool, 1));
+  EXPECT_NOK(&r, TP_run(NULL, count_task, NULL, 1));
+  EXPECT_NOK(&r, TP_run(&pool, NULL, NULL, 1));
+  EXPECT_OK(&r, TP_run(&pool, count_task, NULL, 0)); // nothing to do, so fn is never called
+  EXPECT_OK(&r, TP_destroy(&pool));
+  EXPECT_OK(&r, TP_destroy(NULL));
+
+  return r;
+}
+
+int main(void) {
+  Test tests[] = {
+      tst_run_without_threads,
+      tst_run_with_one_thread,
+      tst_run_with_many_threads,
+      tst_nested_run,
+      tst_shared_pool,
+      tst_bad_args,
+  };
+
+  return (run_tests(tests, sizeof(tests) / sizeof(Test)) == PASS) ? 0 : 1;
+}